@@ -106,6 +106,7 @@ func NewECDSASignatureScheme(c *Curve, h hash.Hash) (ss *ECDSASignatureScheme) {
 	ss.h = h
 	hdesc.dohash = C._ecdsa_dohash(C.cgo_dohash)
 	hdesc.hsz = C.size_t(h.Size())
+	hdesc.blocksz = C.size_t(h.BlockSize())
 	C.mpECDSASignatureScheme_init(ss.css, c.ec, &hdesc)
 	runtime.SetFinalizer(ss, signaturescheme_clear)
 	return ss
@@ -32,11 +32,18 @@
 #define _EC_ECC_H_INCLUDED_
 
 #include <ecc/field.h>
+#include <ecc/fieldi.h>
+#include <ecc/fieldlanes.h>
 #include <ecc/ecdsa.h>
 #include <ecc/ecelgamal.h>
+#include <ecc/ecelgamaldec.h>
 #include <ecc/ecurve.h>
 #include <ecc/ecpoint.h>
+#include <ecc/ecpbatch.h>
+#include <ecc/ecpkeycache.h>
+#include <ecc/ecphash.h>
 #include <ecc/mpzurandom.h>
 #include <ecc/safememory.h>
+#include <ecc/scratch.h>
 
 #endif // _EC_ECC_H_INCLUDED_
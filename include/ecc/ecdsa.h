@@ -35,6 +35,7 @@
 #include <ecc/ecurve.h>
 #include <ecc/field.h>
 #include <gmp.h>
+#include <pthread.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,9 +43,19 @@ extern "C" {
 
 typedef void (*_ecdsa_dohash)(unsigned char *hash, unsigned char *msg, size_t sz);
 
+// optional incremental interface, ctx points to ctxsz bytes of hash state
+typedef void (*_ecdsa_hash_init)(void *ctx);
+typedef void (*_ecdsa_hash_update)(void *ctx, unsigned char *msg, size_t sz);
+typedef void (*_ecdsa_hash_final)(void *ctx, unsigned char *hash);
+
 typedef struct {
     _ecdsa_dohash   dohash;
     size_t          hsz;
+    _ecdsa_hash_init    hinit;
+    _ecdsa_hash_update  hupdate;
+    _ecdsa_hash_final   hfinal;
+    size_t          ctxsz;
+    size_t          blocksz;    // input block size (HMAC), 0 if unknown
 } _mpECDSAHashfunc_t;
 
 typedef _mpECDSAHashfunc_t mpECDSAHashfunc_t[1];
@@ -52,13 +63,38 @@ typedef _mpECDSAHashfunc_t *mpECDSAHashfunc_ptr;
 
 void mpECDSAHashfunc_init(mpECDSAHashfunc_t H);
 void mpECDSAHashfunc_set(mpECDSAHashfunc_t H, mpECDSAHashfunc_ptr Hp);
+void mpECDSAHashfunc_set_incremental(mpECDSAHashfunc_t H, _ecdsa_hash_init hinit, _ecdsa_hash_update hupdate, _ecdsa_hash_final hfinal, size_t ctxsz);
+// the input block size of the hash (e.g. 64 for SHA-256, 128 for SHA-512,
+// 136 for SHA3-256), required for HMAC (deterministic signatures) and for
+// expand_message_xmd. It cannot be derived from the digest size.
+void mpECDSAHashfunc_set_blocksize(mpECDSAHashfunc_t H, size_t blocksz);
 void mpECDSAHashfunc_clear(mpECDSAHashfunc_t H);
 
+// incremental hashing context, for messages which are not held in memory
+// as a whole. Requires a hash function with init/update/final set.
+typedef struct {
+    mpECDSAHashfunc_t H;
+    void *ctx;
+} _mpECDSAHashCtx_t;
+
+typedef _mpECDSAHashCtx_t mpECDSAHashCtx_t[1];
+typedef _mpECDSAHashCtx_t *mpECDSAHashCtx_ptr;
+
+int mpECDSAHashCtx_init(mpECDSAHashCtx_t hctx, mpECDSAHashfunc_t H);
+void mpECDSAHashCtx_update(mpECDSAHashCtx_t hctx, unsigned char *msg, size_t sz);
+// writes H->hsz bytes to hash, the context may then be reused (restarted)
+void mpECDSAHashCtx_final(mpECDSAHashCtx_t hctx, unsigned char *hash);
+void mpECDSAHashCtx_clear(mpECDSAHashCtx_t hctx);
+
+struct _mpECDSANoncePool_struct;
+
 typedef struct {
     mpECurve_ptr cvp;
     mpECP_t cv_G;
     size_t nsz;
     mpECDSAHashfunc_t H;
+    int deterministic;
+    struct _mpECDSANoncePool_struct *pool;
 } _mpECDSASignatureScheme_t;
 
 typedef _mpECDSASignatureScheme_t mpECDSASignatureScheme_t[1];
@@ -67,6 +103,55 @@ typedef _mpECDSASignatureScheme_t *mpECDSASignatureScheme_ptr;
 int mpECDSASignatureScheme_init(mpECDSASignatureScheme_t sscheme, mpECurve_t cv, mpECDSAHashfunc_t H);
 void mpECDSASignatureScheme_clear(mpECDSASignatureScheme_t sscheme);
 
+// when deterministic is nonzero signatures use RFC 6979 nonces derived from
+// the private key and message hash (HMAC over the scheme hash function)
+// instead of drawing k from the random source. Returns nonzero (and leaves
+// the mode unchanged) if the hash function has no block size set.
+int mpECDSASignatureScheme_set_deterministic(mpECDSASignatureScheme_t sscheme, int deterministic);
+
+// Nonce pool: precomputed (k**-1, r) pairs for a signature scheme, computed
+// ahead of time (explicitly via _fill or by a background worker thread) so
+// that signing only costs a hash, two multiplications and an addition mod n.
+// Each entry is used for exactly one signature. Pooled nonces are ignored in
+// deterministic mode. The pool must be cleared before its scheme.
+//
+// Entries do not survive fork(): a forked child would otherwise sign with
+// the same (k**-1, r) as its parent, which reveals the private key. On
+// first use in the child the pool is wiped and emptied and the worker (a
+// thread which does not exist in the child) is considered stopped, so the
+// child falls back to fresh nonces until it fills or restarts the pool.
+
+typedef struct _mpECDSANoncePool_struct {
+    mpECDSASignatureScheme_ptr sscheme;
+    mpFp_field_ptr fn;
+    mp_limb_t *d;       // entries, (kinv, r) as 2 * psize limbs each
+    size_t size;        // capacity (in entries)
+    size_t count;       // entries available
+    size_t head;        // index of oldest entry
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t worker;
+    int running;
+    unsigned long fork_gen; // process generation the entries belong to
+} _mpECDSANoncePool_t;
+
+typedef _mpECDSANoncePool_t mpECDSANoncePool_t[1];
+typedef _mpECDSANoncePool_t *mpECDSANoncePool_ptr;
+
+void mpECDSANoncePool_init(mpECDSANoncePool_t pool, mpECDSASignatureScheme_t sscheme, size_t size);
+void mpECDSANoncePool_clear(mpECDSANoncePool_t pool);
+
+// compute up to n entries in the calling thread, returns the number added
+size_t mpECDSANoncePool_fill(mpECDSANoncePool_t pool, size_t n);
+// start/stop a worker thread which keeps the pool full
+int mpECDSANoncePool_start(mpECDSANoncePool_t pool);
+void mpECDSANoncePool_stop(mpECDSANoncePool_t pool);
+size_t mpECDSANoncePool_count(mpECDSANoncePool_t pool);
+
+// sign with nonces from pool (falls back to fresh nonces when it is empty),
+// pool may be NULL to detach
+void mpECDSASignatureScheme_set_nonce_pool(mpECDSASignatureScheme_t sscheme, mpECDSANoncePool_t pool);
+
 typedef struct {
     mpFp_t  r;
     mpFp_t  s;
@@ -76,14 +161,42 @@ typedef struct {
 typedef _mpECDSASignature_t mpECDSASignature_t[1];
 typedef _mpECDSASignature_t *mpECDSASignature_ptr;
 
+// allocate (zero) r, s for use with the _set_ functions below
+int mpECDSASignature_init(mpECDSASignature_t sig, mpECDSASignatureScheme_t sscheme);
 int mpECDSASignature_init_Sign(mpECDSASignature_t sig, mpECDSASignatureScheme_t sscheme, mpFp_t sK, unsigned char *msg, size_t sz);
+// sign a precomputed message digest (dsz must be the scheme hash size)
+int mpECDSASignature_init_Sign_digest(mpECDSASignature_t sig, mpECDSASignatureScheme_t sscheme, mpFp_t sK, unsigned char *digest, size_t dsz);
 int mpECDSASignature_init_import_bytes(mpECDSASignature_t sig, mpECDSASignatureScheme_t sscheme, unsigned char *bsig, size_t sz);
 int mpECDSASignature_init_import_str(mpECDSASignature_t sig, mpECDSASignatureScheme_t sscheme, char *ssig);
 
 int mpECDSASignature_verify_cmp(mpECDSASignature_t sig, mpECP_t pK, unsigned char *msg, size_t sz);
+int mpECDSASignature_verify_cmp_digest(mpECDSASignature_t sig, mpECP_t pK, unsigned char *digest, size_t dsz);
 unsigned char *mpECDSASignature_export_bytes(mpECDSASignature_t sig, size_t *sz);
 char *mpECDSASignature_export_str(mpECDSASignature_t sig);
 
+// encode/decode to caller supplied buffers without allocation. The raw
+// format is r || s (each nsz bytes big-endian), DER is the X9.62/RFC 3279
+// Ecdsa-Sig-Value SEQUENCE. The _set_ functions require an initialized
+// signature (mpECDSASignature_init or a previous init_Sign/import) and
+// reject malformed encodings and values outside 0 < (r, s) < n.
+size_t mpECDSASignature_out_bytelen(mpECDSASignature_t sig);
+void mpECDSASignature_out_bytes(unsigned char *buf, mpECDSASignature_t sig);
+int mpECDSASignature_set_bytes(mpECDSASignature_t sig, unsigned char *bsig, size_t sz);
+
+size_t mpECDSASignatureScheme_der_max_bytelen(mpECDSASignatureScheme_t sscheme);
+size_t mpECDSASignature_out_der_bytelen(mpECDSASignature_t sig);
+// returns number of bytes written or -1 if bufsz is insufficient
+int mpECDSASignature_out_der(unsigned char *buf, size_t bufsz, mpECDSASignature_t sig);
+int mpECDSASignature_set_der(mpECDSASignature_t sig, unsigned char *bsig, size_t sz);
+
+// batch variants, encodings are packed back to back in buf. For DER len[i]
+// holds the length of each encoding. status (if not NULL) receives the
+// result for each signature, the return value is -1 if any failed.
+void mpECDSASignature_out_bytes_batch(unsigned char *buf, mpECDSASignature_ptr *sig, size_t n);
+int mpECDSASignature_set_bytes_batch(mpECDSASignature_ptr *sig, unsigned char *buf, size_t n, int *status);
+int mpECDSASignature_out_der_batch(unsigned char *buf, size_t bufsz, size_t *len, mpECDSASignature_ptr *sig, size_t n);
+int mpECDSASignature_set_der_batch(mpECDSASignature_ptr *sig, unsigned char *buf, size_t *len, size_t n, int *status);
+
 void mpECDSASignature_clear(mpECDSASignature_t sig);
 
 #ifdef __cplusplus
@@ -59,6 +59,58 @@ int mpECElgamal_init_encrypt(mpECElgamalCiphertext_t ctxt, mpECP_t pK, mpECP_t p
 int mpECElgamal_init_decrypt(mpECP_t ptxt, mpFp_t sK, mpECElgamalCiphertext_t ctxt);
 void mpECElgamal_clear(mpECElgamalCiphertext_t ctxt);
 
+// initialize ctxt to (O, O), i.e. the (trivial) encryption of the neutral
+// element under any key (an empty sum)
+void mpECElgamal_init(mpECElgamalCiphertext_t ctxt, mpECurve_t cv);
+
+// EC Elgamal is additively homomorphic (rop is initialized, may alias):
+// add     : Dec(rop) = Dec(op1) + Dec(op2)
+// scalar  : Dec(rop) = sc * Dec(op)
+// sum     : Dec(rop) = sum(weights[i] * Dec(ctxts[i])), weights NULL for
+//           an unweighted sum. The weighted sum uses a bucket (Pippenger)
+//           accumulator, all additions are projective.
+// return -1 if operands are not on the same curve (or sc not mod n)
+int mpECElgamal_add(mpECElgamalCiphertext_t rop, mpECElgamalCiphertext_t op1, mpECElgamalCiphertext_t op2);
+int mpECElgamal_scalar_mul(mpECElgamalCiphertext_t rop, mpECElgamalCiphertext_t op, mpFp_t sc);
+int mpECElgamal_sum(mpECElgamalCiphertext_t rop, mpECElgamalCiphertext_ptr *ctxts, mpFp_ptr *weights, size_t n);
+
+// An encryptor holds fixed-base tables for the generator and a recipient
+// public key, so that repeated encryptions to the same key use two fixed
+// base multiplications (instead of two variable base ladders)
+
+typedef struct {
+    mpECurve_ptr cvp;
+    mpECP_t cv_G;
+    mpECP_t pK;
+} _mpECElgamalEncryptor_t;
+
+typedef _mpECElgamalEncryptor_t mpECElgamalEncryptor_t[1];
+typedef _mpECElgamalEncryptor_t *mpECElgamalEncryptor_ptr;
+
+int mpECElgamalEncryptor_init(mpECElgamalEncryptor_t enc, mpECP_t pK);
+void mpECElgamalEncryptor_clear(mpECElgamalEncryptor_t enc);
+
+int mpECElgamalEncryptor_init_encrypt(mpECElgamalCiphertext_t ctxt, mpECElgamalEncryptor_t enc, mpECP_t ptxt);
+
+// re-randomize ctxt in place by adding a fresh encryption of the neutral
+// element under the key of enc: (C + kG, D + k pK). Dec(ctxt) is unchanged
+// but the new ciphertext is unlinkable to the old one. The batch variant
+// re-randomizes ctxts[i] for i in [0, n) and normalizes the results
+// (one field inversion per chunk). Returns -1 if any ciphertext is not on
+// the curve of enc.
+int mpECElgamal_rerandomize(mpECElgamalCiphertext_t ctxt, mpECElgamalEncryptor_t enc);
+int mpECElgamal_rerandomize_batch(mpECElgamalCiphertext_ptr *ctxts, mpECElgamalEncryptor_t enc, size_t n);
+
+// batch encryption of ptxts[i] into ctxts[i] and decryption of ctxts[i]
+// into ptxts[i] for i in [0, n). Outputs are initialized as by
+// mpECElgamal_init_encrypt/decrypt (release with mpECElgamal_clear and
+// mpECP_clear) and are returned normalized (affine), sharing one field
+// inversion per chunk. Decryption recodes sK once for all ciphertexts
+// (see mpECP_scalar_mul_batch). Returns -1 (with no output initialized)
+// if any point is not on the curve of enc (or sK is not mod n).
+int mpECElgamal_encrypt_batch(mpECElgamalCiphertext_ptr *ctxts, mpECElgamalEncryptor_t enc, mpECP_ptr *ptxts, size_t n);
+int mpECElgamal_decrypt_batch(mpECP_ptr *ptxts, mpFp_t sK, mpECElgamalCiphertext_ptr *ctxts, size_t n);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,109 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _EC_ECELGAMAL_DECODE_H_INCLUDED_
+#define _EC_ECELGAMAL_DECODE_H_INCLUDED_
+
+#include <ecc/ecelgamal.h>
+#include <ecc/ecpoint.h>
+#include <ecc/ecurve.h>
+#include <ecc/field.h>
+#include <gmp.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// mpECElgamalDecoder_t recovers a small integer m from the point m * G
+// (e.g. the decryption of a sum of votes or counters encrypted as m * G)
+// for m in [0, range) by baby-step giant-step.
+//
+// The baby-step table holds j * G for j in [1, baby], keyed on 64 bits of
+// the affine x coordinate (y for Edwards curves, where -P = (-x, y)) with
+// the parity of the other coordinate, so that one entry covers both +/- j.
+// Each giant step therefore covers 2 * baby + 1 values of m, i.e. with
+// baby ~ sqrt(range) / 2 a decode takes ~ sqrt(range) point additions (one
+// field inversion per 64 steps). Giant steps are split across nthreads
+// threads. Candidates are verified, so key collisions cannot return a
+// wrong result.
+//
+// The table can be saved and later mapped (read only, shared between
+// processes) from disk with mpECElgamalDecoder_init_file. The file format
+// is host endian and tied to the curve (checked on load).
+
+typedef struct {
+    uint64_t key;
+    uint64_t val;       // (j << 1) | parity, 0 for an empty slot
+} _mpECElgamalDecoder_entry_t;
+
+typedef struct {
+    mpECurve_ptr cvp;
+    mpECP_t cv_G;               // with base table
+    uint64_t baby;
+    uint64_t range;
+    uint64_t mask;              // slots - 1 (slots is a power of 2)
+    _mpECElgamalDecoder_entry_t *table;
+    void *map;                  // mapped file (NULL if table is on heap)
+    size_t maplen;
+    int nthreads;
+} _mpECElgamalDecoder_t;
+
+typedef _mpECElgamalDecoder_t mpECElgamalDecoder_t[1];
+typedef _mpECElgamalDecoder_t *mpECElgamalDecoder_ptr;
+
+// minimum giant steps per thread (smaller searches use fewer threads)
+#define _MPECELGAMAL_DECODE_THREAD_MIN  (4096)
+
+// build a decoder for m in [0, range) with a table of baby entries
+// (0 selects ~ sqrt(range) / 2). Returns -1 if range or baby is invalid.
+int mpECElgamalDecoder_init(mpECElgamalDecoder_t dec, mpECurve_t cv, uint64_t range, uint64_t baby);
+// save the table of dec to path, returns -1 on I/O error
+int mpECElgamalDecoder_save(mpECElgamalDecoder_t dec, char *path);
+// map a table saved by mpECElgamalDecoder_save, the range may differ from
+// the one the table was built for. Returns -1 if the file cannot be mapped
+// or was built for a different curve.
+int mpECElgamalDecoder_init_file(mpECElgamalDecoder_t dec, mpECurve_t cv, char *path, uint64_t range);
+void mpECElgamalDecoder_clear(mpECElgamalDecoder_t dec);
+
+// set the number of threads used for giant steps (default 1)
+void mpECElgamalDecoder_set_threads(mpECElgamalDecoder_t dec, int nthreads);
+
+// find m in [0, range) with ptxt == m * G, returns -1 if not found
+int mpECElgamalDecoder_decode(uint64_t *m, mpECElgamalDecoder_t dec, mpECP_t ptxt);
+// decrypt ctxt with sK and decode the plaintext (see above)
+int mpECElgamal_decrypt_decode(uint64_t *m, mpECElgamalDecoder_t dec, mpFp_t sK, mpECElgamalCiphertext_t ctxt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _EC_ECELGAMAL_DECODE_H_INCLUDED_
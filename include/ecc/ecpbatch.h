@@ -0,0 +1,91 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _EC_POINT_BATCH_H_INCLUDED_
+#define _EC_POINT_BATCH_H_INCLUDED_
+
+#include <ecc/ecpoint.h>
+#include <ecc/ecurve.h>
+#include <ecc/field.h>
+#include <gmp.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// mpECPBatch_t holds N points (of the same curve) as a structure of arrays.
+// Coordinates are stored limb-interleaved, i.e. limb k of point i is found
+// at x[(k * n) + i], so the same limb of consecutive points is adjacent in
+// memory (the layout expected by multi-lane arithmetic). Coordinates use the
+// same internal (projective) representation as mpECP_t.
+
+typedef struct {
+    mp_limb_t       *x;
+    mp_limb_t       *y;
+    mp_limb_t       *z;
+    int             *is_neutral;
+    size_t          n;
+    mp_size_t       psize;
+    mpECurve_ptr    cvp;
+} _mpECPBatch_t;
+
+typedef _mpECPBatch_t mpECPBatch_t[1];
+typedef _mpECPBatch_t *mpECPBatch_ptr;
+
+// initialized batch contains n copies of the neutral element
+void mpECPBatch_init(mpECPBatch_t b, size_t n, mpECurve_t cv);
+void mpECPBatch_clear(mpECPBatch_t b);
+
+void mpECPBatch_set(mpECPBatch_t rb, mpECPBatch_t b);
+void mpECPBatch_set_mpECP(mpECPBatch_t rb, size_t i, mpECP_t pt);
+void mpECP_set_mpECPBatch(mpECP_t rpt, mpECPBatch_t b, size_t i);
+
+// element-wise rb[i] = b1[i] + b2[i] and rb[i] = 2 * b[i] (rb may alias)
+void mpECPBatch_add(mpECPBatch_t rb, mpECPBatch_t b1, mpECPBatch_t b2);
+void mpECPBatch_double(mpECPBatch_t rb, mpECPBatch_t b);
+
+// convert all points to affine (z = 1) with a single field inversion
+void mpECPBatch_normalize(mpECPBatch_t b);
+
+// serialize all points (in the format of mpECP_out_bytes), output is n
+// consecutive encodings of mpECPBatch_out_bytelen(b, compress) bytes each
+int  mpECPBatch_out_bytelen(mpECPBatch_t b, int compress);
+void mpECPBatch_out_bytes(unsigned char *s, mpECPBatch_t b, int compress);
+
+// parse n consecutive encodings of length bytes each. Returns 0 on success,
+// or -1 if any encoding was invalid (invalid entries are set to neutral)
+int  mpECPBatch_set_bytes(mpECPBatch_t rb, unsigned char *s, size_t length, mpECurve_t cv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _EC_POINT_BATCH_H_INCLUDED_
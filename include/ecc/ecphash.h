@@ -0,0 +1,132 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _EC_POINT_HASH_H_INCLUDED_
+#define _EC_POINT_HASH_H_INCLUDED_
+
+#include <ecc/ecdsa.h>
+#include <ecc/ecpoint.h>
+#include <ecc/ecurve.h>
+#include <ecc/field.h>
+#include <gmp.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hashing to elliptic curves following RFC 9380. The map to the curve is
+// selected by curve type:
+//   short Weierstrass (A * B != 0) : simplified SWU
+//   short Weierstrass (A * B == 0) : Shallue-van de Woestijne
+//   Montgomery                     : Elligator 2
+//   (twisted) Edwards              : Elligator 2 on the birationally
+//                                    equivalent Montgomery curve
+// The constants (including Z) are derived as in RFC 9380 appendix H.
+// Results are checked against the RFC suites for P256, curve25519 and
+// edwards25519. For P384 and P521 only Z and L are checked against the
+// RFC suite parameters, not the test vectors. RFC suites for
+// A * B == 0 curves (secp256k1) and edwards448 use isogenies instead and
+// are not reproduced.
+//
+// The maps are straight line code: square roots use sqrt_ratio (RFC 9380
+// appendix F.2.1) and the square test a Legendre exponentiation, both on
+// mpz_powm_sec, inversions use mpFp_inv_ct and selections mpFp_cswap, so
+// the time to map does not depend on u (and msg).
+
+#define _MPECP_MAP_SSWU (1)
+#define _MPECP_MAP_SVDW (2)
+#define _MPECP_MAP_ELL2 (3)
+
+#define _MPECP_HASH_MAX_DST (255)
+
+typedef struct {
+    mpECurve_ptr cvp;
+    int map;
+    // Z and map constants c1..c4 (see ecphash.c)
+    mpFp_t Z;
+    mpFp_t c1;
+    mpFp_t c2;
+    mpFp_t c3;
+    mpFp_t c4;
+    // non-square sZ, sqrt_ratio constants s1, s2 and exponents se and
+    // le = (p - 1) / 2 (see ecphash.c)
+    mpFp_t sZ;
+    mpFp_t s1;
+    mpFp_t s2;
+    mpz_t se;
+    mpz_t le;
+    mpECDSAHashfunc_t H;
+    // bytes of uniform data per field element, ceil((ceil(log2(p)) + k) / 8)
+    size_t L;
+    unsigned char dst[_MPECP_HASH_MAX_DST];
+    size_t dsz;
+} _mpECPHashToCurve_t;
+
+typedef _mpECPHashToCurve_t mpECPHashToCurve_t[1];
+typedef _mpECPHashToCurve_t *mpECPHashToCurve_ptr;
+
+// expand_message_xmd (RFC 9380 5.3.1) of msg with the domain separation tag
+// dst, writing len bytes to out. H must be a Merkle-Damgard hash (e.g.
+// SHA-2). msg is hashed through the incremental interface of H if it has
+// one (otherwise it is copied to the heap), so it may be arbitrarily large.
+// Returns nonzero if len or dsz are out of range, or H has no block size
+// set (mpECDSAHashfunc_set_blocksize).
+int mpECP_expand_message_xmd(unsigned char *out, size_t len,
+    unsigned char *msg, size_t msz, unsigned char *dst, size_t dsz,
+    mpECDSAHashfunc_t H);
+
+// set up hashing to the curve cv with hash function H and domain separation
+// tag dst (tags longer than 255 bytes are reduced as RFC 9380 5.3.3).
+// Returns nonzero if no map is defined for the curve or H has no block
+// size set.
+int mpECPHashToCurve_init(mpECPHashToCurve_t h2c, mpECurve_t cv,
+    mpECDSAHashfunc_t H, unsigned char *dst, size_t dsz);
+void mpECPHashToCurve_clear(mpECPHashToCurve_t h2c);
+
+// hash_to_field (RFC 9380 5.2), u[0..count-1] are initialized elements.
+// Returns nonzero if count * L exceeds the 65535 byte xmd output limit.
+int mpECPHashToCurve_hash_to_field(mpFp_ptr *u, size_t count,
+    mpECPHashToCurve_t h2c, unsigned char *msg, size_t msz);
+
+// map_to_curve, rpt is NOT multiplied by the cofactor
+void mpECPHashToCurve_map(mpECP_t rpt, mpECPHashToCurve_t h2c, mpFp_t u);
+
+// hash_to_curve (random oracle, two maps) and encode_to_curve (nonuniform
+// encoding, one map). rpt is in the prime order subgroup.
+int mpECPHashToCurve_hash(mpECP_t rpt, mpECPHashToCurve_t h2c,
+    unsigned char *msg, size_t msz);
+int mpECPHashToCurve_encode(mpECP_t rpt, mpECPHashToCurve_t h2c,
+    unsigned char *msg, size_t msz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _EC_POINT_HASH_H_INCLUDED_
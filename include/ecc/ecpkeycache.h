@@ -0,0 +1,106 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _EC_POINT_KEYCACHE_H_INCLUDED_
+#define _EC_POINT_KEYCACHE_H_INCLUDED_
+
+#include <ecc/ecpoint.h>
+#include <ecc/ecurve.h>
+#include <gmp.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// mpECPKeyCache_t is an LRU cache of decoded (public key) points, keyed on
+// their encoded bytes (as passed to mpECP_set_bytes). A hit avoids decoding
+// (and for compressed keys, the square root). Once a key has been looked up
+// promote times a fixed-base table (see mpECP_scalar_base_mul_setup_bits)
+// is built for it so scalar multiplication by a hot key runs at fixed-base
+// speed (mpECP_scalar_base_mul, which ECDSA verification uses automatically
+// for points with a table). Buckets are chosen with SipHash under a random
+// per-cache key, so chains stay short even for adversarially chosen keys.
+// The cache is not thread-safe.
+
+typedef struct _p_mpECPKeyCache_entry_t {
+    unsigned char *key;
+    size_t keysz;
+    uint64_t hash;
+    unsigned long uses;
+    mpECP_t pt;
+    struct _p_mpECPKeyCache_entry_t *prev;  // LRU list, toward MRU
+    struct _p_mpECPKeyCache_entry_t *next;  // LRU list, toward LRU
+    struct _p_mpECPKeyCache_entry_t *chain; // hash bucket chain
+} _mpECPKeyCache_entry_t;
+
+typedef struct {
+    mpECurve_ptr cvp;
+    size_t size;                    // maximum number of entries
+    size_t count;
+    unsigned long promote;          // uses before table is built, 0 = never
+    int window_bits;                // width of per-key table window
+    size_t nbuckets;
+    uint64_t hkey[2];               // random per-cache key for bucket hash
+    _mpECPKeyCache_entry_t **bucket;
+    _mpECPKeyCache_entry_t *mru;
+    _mpECPKeyCache_entry_t *lru;
+    // statistics
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    unsigned long promotions;
+} _mpECPKeyCache_t;
+
+typedef _mpECPKeyCache_t mpECPKeyCache_t[1];
+typedef _mpECPKeyCache_t *mpECPKeyCache_ptr;
+
+#define _MPECP_KEYCACHE_PROMOTE     (4)
+#define _MPECP_KEYCACHE_WINDOW_BITS (4)
+
+void mpECPKeyCache_init(mpECPKeyCache_t cache, mpECurve_t cv, size_t size);
+void mpECPKeyCache_clear(mpECPKeyCache_t cache);
+
+// set promotion threshold (0 disables tables) and table window width
+void mpECPKeyCache_set_promotion(mpECPKeyCache_t cache, unsigned long promote, int window_bits);
+
+// return the point for encoded key s, decoding (and caching) it on a miss.
+// Returns NULL if s is not a valid point encoding. The point is owned by
+// the cache and remains valid until the next call to lookup or clear.
+mpECP_ptr mpECPKeyCache_lookup(mpECPKeyCache_t cache, unsigned char *s, size_t length);
+
+void mpECPKeyCache_reset_stats(mpECPKeyCache_t cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _EC_POINT_KEYCACHE_H_INCLUDED_
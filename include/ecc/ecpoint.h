@@ -36,6 +36,7 @@
 
 #include <ecc/ecurve.h>
 #include <ecc/field.h>
+#include <ecc/scratch.h>
 #include <gmp.h>
 
 #ifdef __cplusplus
@@ -53,6 +54,8 @@ typedef struct _p_mpECP_t {
     mpECurve_ptr cvp;
     int base_bits;
     struct _p_mpECP_t *base_pt;
+    // prebuilt (read only) base table, used in place of base_pt
+    const mp_limb_t *base_const;
 } _mpECP_t;
 
 typedef _mpECP_t mpECP_t[1];
@@ -61,6 +64,11 @@ typedef _mpECP_t *mpECP_ptr;
 void mpECP_init(mpECP_t pt, mpECurve_t cv);
 void mpECP_clear(mpECP_t pt);
 
+// initialize a temporary point with coordinate storage from a scratch arena.
+// Scratch points are released with the arena, NOT with mpECP_clear, and
+// cannot hold a base point table (i.e. scalar_base_mul_setup)
+void mpECP_init_scratch(mpECP_t pt, mpECurve_t cv, mpECScratch_t scr);
+
 void mpECP_set(mpECP_t rpt, mpECP_t op);
 void mpECP_set_mpz(mpECP_t rpt, mpz_t x, mpz_t y, mpECurve_t cv);
 void mpECP_set_mpFp(mpECP_t rpt, mpFp_t x, mpFp_t y, mpECurve_t cv);
@@ -76,6 +84,11 @@ int  mpECP_out_strlen(mpECP_t pt, int compress);
 void mpECP_out_str(char *s, mpECP_t pt, int compress);
 
 int  mpECP_set_bytes(mpECP_t rpt, unsigned char *s, size_t length, mpECurve_t cv);
+// decode n points (pts[i] from bufs[i] of lens[i] bytes). Compressed points
+// share the curve constants and (for Edwards curves) a single inversion.
+// status[i] (if status is not NULL) is set as for mpECP_set_bytes, the
+// return value is -1 if any point failed to decode.
+int  mpECP_set_bytes_batch(mpECP_ptr *pts, unsigned char **bufs, size_t *lens, size_t n, mpECurve_t cv, int *status);
 int  mpECP_out_bytelen(mpECP_t pt, int compress);
 void mpECP_out_bytes(unsigned char *s, mpECP_t pt, int compress);
 
@@ -88,13 +101,27 @@ void mpECP_sub(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2);
 
 void mpECP_scalar_mul(mpECP_t rpt, mpECP_t pt, mpFp_t sc);
 void mpECP_scalar_mul_mpz(mpECP_t rpt, mpECP_t pt, mpz_t sc);
+void mpECP_scalar_mul_scratch(mpECP_t rpt, mpECP_t pt, mpFp_t sc, mpECScratch_t scr);
+// rpts[i] = sc * pts[i] for i in [0, n) (rpts initialized, may alias pts),
+// the recoding of sc is computed once and shared by all points
+void mpECP_scalar_mul_batch(mpECP_ptr *rpts, mpECP_ptr *pts, mpFp_t sc, size_t n);
+
+// convert n points to affine (z = 1) sharing a single field inversion
+void mpECP_normalize_batch(mpECP_ptr *pts, size_t n);
 
 void mpECP_neg(mpECP_t rpt, mpECP_t pt);
 int  mpECP_cmp(mpECP_t pt1, mpECP_t pt2);
 
+// precompute the fixed base table of pt. If the library is built with
+// prebuilt tables (--enable-base-tables) and pt is the generator of one of
+// P256, secp256k1, Ed25519 or P384 the table in .rodata is used in place
 void mpECP_scalar_base_mul_setup(mpECP_t pt);
+// as above with a window of bits (1..16) per level instead of the default,
+// i.e. a table of ceil(curve bits / bits) * 2**bits points
+void mpECP_scalar_base_mul_setup_bits(mpECP_t pt, int bits);
 void mpECP_scalar_base_mul(mpECP_t rpt, mpECP_t pt, mpFp_t sc);
 void mpECP_scalar_base_mul_mpz(mpECP_t rpt, mpECP_t pt, mpz_t sc);
+void mpECP_scalar_base_mul_scratch(mpECP_t rpt, mpECP_t pt, mpFp_t sc, mpECScratch_t scr);
 
 void mpECP_urandom(mpECP_t rpt, mpECurve_t cv);
 
@@ -48,6 +48,7 @@ typedef enum {EQTypeNone, EQTypeUninitialized, EQTypeShortWeierstrass, EQTypeEdw
 typedef struct {
     mpFp_t a; // coefficient of equation
     mpFp_t b; // coefficient of equation
+    mpFp_t b3; // 3 * b (RCB addition)
 } _mpECurve_ws_curve_coeff_t;
 
 // Edwards curve defined as x**2 + y**2 = c**2 * (1 + (d * x**2 * y**2))
@@ -75,6 +76,7 @@ typedef struct {
     mpFp_t ws_b; // coefficient of transformed equation
     mpFp_t Binv; // coefficient of transform
     mpFp_t Adiv3; // coefficient of transform
+    mpFp_t ws_b3; // 3 * ws_b (RCB addition)
 } _mpECurve_mo_curve_coeff_t;
 
 // Twisted Edwards : a * x**2 + y**2 = 1 + (d * x**2 * y**2)
@@ -100,6 +102,7 @@ typedef struct {
     mpz_t h; // cofactor of curve
     mpz_t G[2]; // x,y coordinates of Generator of EC Group
     unsigned int bits; // bit size of curve, i.e. ceil(log2(p))
+    unsigned long id; // interned identity, equal iff parameters are equal
 } _mpECurve_t;
 
 typedef _mpECurve_t mpECurve_t[1];
@@ -130,8 +133,21 @@ int mpECurve_set_mpz_te(mpECurve_t cv, mpz_t p, mpz_t a, mpz_t d, mpz_t n,
 
 int mpECurve_set_named(mpECurve_t c, char *name);
 
+// mpECurve_named returns the shared instance of a named standard curve (or
+// NULL if name is unknown). Standard curves are parsed and validated once
+// per process, the instance is immutable and lives until exit: it may be
+// used anywhere a (const) mpECurve_t is expected but must not be modified
+// or cleared. mpECurve_set_named copies from this instance.
+mpECurve_ptr mpECurve_named(char *name);
+
 int mpECurve_point_check(mpECurve_t c, mpz_t Px, mpz_t Py);
 
+// curves are interned when set (mpECurve_set_str_XX, _set_mpz_XX, _set,
+// _set_named): curves with the same parameters share an id, so
+// mpECurve_cmp is a single integer compare (0 if equal). Build with
+// _MPECURVE_CMP_CHECK defined to also compare all parameters and assert
+// that both agree (curve parameters must only be changed through the
+// setters).
 int mpECurve_cmp(mpECurve_t op1, mpECurve_t op2);
 
 /* note, _list_standard_curves allocates space for the list of curves and 
@@ -37,6 +37,19 @@
 #include <gmp.h>
 #include <assert.h>
 
+// _MPFP_MAX_LIMBS would be a 2048-bit integer in most cases (32*64)
+// This defines the limit on the bitsize of p**2 (which implies that
+// p can be at most 1024 bits)
+#define _MPFP_MAX_LIMBS   (32)
+
+// number of radix 2**52 limbs required to represent the largest p, used by
+// the multi-lane (SIMD) arithmetic in fieldlanes.c
+#define _MPFP_MAX_LIMBS52 ((((_MPFP_MAX_LIMBS / 2) * 64) + 51) / 52)
+
+// number of signed radix 2**62 limbs required to represent the largest p
+// (with sign and headroom), used by the safegcd inverse in fieldinv.c
+#define _MPFP_MAX_LIMBS62 ((((_MPFP_MAX_LIMBS / 2) * 64) / 62) + 1)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -48,13 +61,73 @@ typedef struct {
     mpz_t       pc;     // pc is complement of p in F(2**(limbsize*limbs))
     mp_size_t   psize;
     mp_size_t   p2size;
+    // Barrett reciprocal floor(2**(2*GMP_NUMB_BITS*psize) / p), psize+1 limbs
+    mp_limb_t   mu[(_MPFP_MAX_LIMBS / 2) + 1];
+    // radix 2**52 Montgomery constants for multi-lane arithmetic: p, R**2
+    // mod p (R = 2**(52*l52size)) and -1/p mod 2**52. l52size == 0 if the
+    // multi-lane implementation is not supported for this field.
+    mp_size_t   l52size;
+    mp_limb_t   pinv52;
+    mp_limb_t   p52[_MPFP_MAX_LIMBS52];
+    mp_limb_t   r2_52[_MPFP_MAX_LIMBS52];
+    // square root strategy and constants (see mpFp_sqrt), with
+    // p - 1 = q * 2**sqrt_s (q odd):
+    //   _MPFP_SQRT_3MOD4 : sqrt_e = (p + 1) / 4
+    //   _MPFP_SQRT_5MOD8 : sqrt_e = (p - 5) / 8 (Atkin)
+    //   _MPFP_SQRT_TS    : sqrt_e = (q - 1) / 2, sqrt_c = z**q for a fixed
+    //                      quadratic non-residue z (Tonelli-Shanks)
+    int         sqrt_type;
+    int         sqrt_s;
+    mpz_t       sqrt_e;
+    mpz_t       sqrt_c;
+    // inversion backend used by mpFp_inv (see mpFp_field_set_inv) and the
+    // constants of the constant-time inverses: p in signed radix 2**62
+    // limbs, 1/p mod 2**62 and the number of 62 divstep batches for
+    // safegcd (sg_size == 0 if not supported for this field), p - 2 for
+    // Fermat's little theorem
+    int         inv_type;
+    int         sg_size;
+    int         sg_batches;
+    mp_limb_t   sg_pinv62;
+    mp_limb_t   sg_p62[_MPFP_MAX_LIMBS62];
+    mpz_t       inv_e;
 } _mpFp_field_struct;
 
+#define _MPFP_SQRT_NONE     (0)
+#define _MPFP_SQRT_3MOD4    (1)
+#define _MPFP_SQRT_5MOD8    (2)
+#define _MPFP_SQRT_TS       (3)
+
+#define _MPFP_INV_GMP       (0)
+#define _MPFP_INV_SAFEGCD   (1)
+#define _MPFP_INV_FERMAT    (2)
+
 typedef _mpFp_field_struct mpFp_field[1];
 typedef _mpFp_field_struct *mpFp_field_ptr;
 
 mpFp_field_ptr _mpFp_field_lookup(mpz_t p);
 
+// fixed size multiply-reduce kernels for 4 limb fields (field4.c), used by
+// mpFp_mul/mpFp_sqr when available (_MPFP_KERNEL4 defined). select chooses
+// the MULX/ADX product (if use_mulx != 0 and supported by the CPU) or the
+// portable one, returns 1 for MULX/ADX, 0 for portable and -1 if the
+// kernels are not available on this platform
+#if (GMP_NUMB_BITS == 64) && defined(__SIZEOF_INT128__)
+#define _MPFP_KERNEL4
+#endif
+
+int  _mpFp_kernel4_select(int use_mulx);
+void _mpFp_mul4(mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b, mpFp_field_ptr fp);
+void _mpFp_sqr4(mp_limb_t *r, const mp_limb_t *a, mpFp_field_ptr fp);
+
+// constant-time (safegcd) inverse requires 64-bit limbs and a 128-bit
+// product (fieldinv.c), fields are set up for it by _mpFp_field_inv_setup
+#if (GMP_NUMB_BITS == 64) && defined(__SIZEOF_INT128__)
+#define _MPFP_SAFEGCD
+#endif
+
+void _mpFp_field_inv_setup(mpFp_field_ptr fp);
+
 typedef struct {
     mpz_t           i;
     mpFp_field_ptr  fp;
@@ -107,6 +180,20 @@ void mpFp_neg(mpFp_t rop, mpFp_t op);
 // return nonzero on error (NOTE: return behavior opposite of mpz_invert)
 int mpFp_inv(mpFp_t rop, mpFp_t op);
 
+// constant-time inverses (return nonzero on error, as mpFp_inv). safegcd
+// is the Bernstein-Yang divstep algorithm (p odd, requires _MPFP_SAFEGCD),
+// Fermat computes op**(p-2) with mpz_powm_sec. mpFp_inv_ct uses safegcd
+// where supported, otherwise Fermat. For op == 0 rop is set to 0 (the
+// inv0 of RFC 9380) in the same time as for any other input.
+int mpFp_inv_safegcd(mpFp_t rop, mpFp_t op);
+int mpFp_inv_fermat(mpFp_t rop, mpFp_t op);
+int mpFp_inv_ct(mpFp_t rop, mpFp_t op);
+
+// select the backend used by mpFp_inv for all elements of the field
+// (_MPFP_INV_GMP, _MPFP_INV_SAFEGCD or _MPFP_INV_FERMAT), returns nonzero
+// if the backend is not supported for the field
+int mpFp_field_set_inv(mpFp_field_ptr fp, int inv_type);
+
 /* comparison */
 
 int mpFp_cmp(mpFp_t op1, mpFp_t op2);
@@ -117,6 +204,11 @@ int mpFp_cmp_mpz(mpFp_t op1, mpz_t op2);
 
 int  mpFp_sqrt(mpFp_t rop, mpFp_t op);
 
+// return nonzero if op is a square (quadratic residue or zero), Legendre
+// symbol only, much faster than attempting mpFp_sqrt. Like mpFp_sqrt it is
+// NOT constant time (mpz_legendre, and the sqrt methods, branch on op).
+int  mpFp_is_square(mpFp_t op);
+
 /* bit operations */ 
 
 int  mpFp_tstbit(mpFp_t op, int bit);
@@ -0,0 +1,106 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _EC_FIELDI_H_INCLUDED_
+#define _EC_FIELDI_H_INCLUDED_
+
+#include <ecc/field.h>
+#include <gmp.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// mpFpi_t is an alternative representation of an element of Fp which holds
+// its limbs inline (fixed capacity) instead of in a separately allocated mpz.
+// Arithmetic operates on the limbs directly with mpn_* calls. As there is no
+// owned heap storage an mpFpi_t never allocates, can be copied by assignment
+// (or memcpy) and arrays of elements (or structs built from them) are one
+// contiguous block of memory. Values are always fully reduced and stored in
+// exactly fp->psize limbs (upper limbs are don't care).
+
+// p may be at most half of _MPFP_MAX_LIMBS (see field.h)
+#define _MPFPI_MAX_LIMBS    (_MPFP_MAX_LIMBS / 2)
+
+typedef struct {
+    mp_limb_t       d[_MPFPI_MAX_LIMBS];
+    mpFp_field_ptr  fp;
+} _mpFpi_struct;
+
+typedef _mpFpi_struct mpFpi_t[1];
+typedef _mpFpi_struct *mpFpi_ptr;
+
+/* initialization (clear only wipes, there is nothing to free) */
+
+void mpFpi_init_fp(mpFpi_t a, mpFp_field_ptr fp);
+void mpFpi_clear(mpFpi_t a);
+
+/* assignment and conversion */
+
+void mpFpi_set(mpFpi_t rop, mpFpi_t op);
+void mpFpi_set_mpz_fp(mpFpi_t rop, mpz_t op, mpFp_field_ptr fp);
+void mpFpi_set_ui_fp(mpFpi_t rop, unsigned long op, mpFp_field_ptr fp);
+void mpFpi_set_mpFp(mpFpi_t rop, mpFp_t op);
+
+void mpFp_set_mpFpi(mpFp_t rop, mpFpi_t op);
+void mpz_set_mpFpi(mpz_t rop, mpFpi_t op);
+
+/* swap (and constant time conditional swap) */
+
+void mpFpi_swap(mpFpi_t rop, mpFpi_t op);
+void mpFpi_cswap(mpFpi_t rop, mpFpi_t op, int swap);
+
+/* basic arithmetic */
+
+void mpFpi_add(mpFpi_t rop, mpFpi_t op1, mpFpi_t op2);
+void mpFpi_sub(mpFpi_t rop, mpFpi_t op1, mpFpi_t op2);
+void mpFpi_neg(mpFpi_t rop, mpFpi_t op);
+void mpFpi_mul(mpFpi_t rop, mpFpi_t op1, mpFpi_t op2);
+void mpFpi_mul_ui(mpFpi_t rop, mpFpi_t op1, unsigned long op2);
+void mpFpi_sqr(mpFpi_t rop, mpFpi_t op);
+void mpFpi_pow_mpz(mpFpi_t rop, mpFpi_t op1, mpz_t op2);
+
+// return nonzero on error (same convention as mpFp_inv)
+int mpFpi_inv(mpFpi_t rop, mpFpi_t op);
+
+/* comparison */
+
+int mpFpi_cmp(mpFpi_t op1, mpFpi_t op2);
+int mpFpi_cmp_ui(mpFpi_t op1, unsigned long op2);
+
+/* bit operations */
+
+int mpFpi_tstbit(mpFpi_t op, int bit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _EC_FIELDI_H_INCLUDED_
@@ -0,0 +1,69 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _EC_FIELDLANES_H_INCLUDED_
+#define _EC_FIELDLANES_H_INCLUDED_
+
+#include <ecc/field.h>
+#include <gmp.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Multi-lane field arithmetic for many independent operations in the same
+// field. Operands are arrays of n elements stored limb-interleaved (limb k
+// of element i at a[(k * n) + i], the layout of mpECPBatch_t coordinates),
+// each element fully reduced (< p). Lanes are processed with a radix 2**52
+// Montgomery multiplication, 8 lanes at a time with AVX-512 IFMA or 4 lanes
+// with IFMA on 256-bit vectors, selected at runtime by CPU feature. Without
+// IFMA (e.g. AVX2 only, which lacks a 52-bit multiplier) or on non-x86_64
+// hosts a scalar (mpn) implementation is used.
+
+// r[i] = a[i] * b[i] mod p for i in [0, n), r may alias a and/or b
+void mpFp_mul_lanes(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, size_t n, mpFp_field_ptr fp);
+
+// r[i] = a[i]**2 mod p for i in [0, n), r may alias a
+void mpFp_sqr_lanes(mp_limb_t *r, mp_limb_t *a, size_t n, mpFp_field_ptr fp);
+
+// select the implementation with the widest lane count <= width supported
+// by the CPU (width 0 selects the best available). Returns the lane count
+// selected (1 for the scalar implementation).
+int  mpFp_lanes_select(int width);
+
+// initialize the radix 2**52 constants in a field (called from field.c)
+void _mpFp_field_lanes_setup(mpFp_field_ptr fp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _EC_FIELDLANES_H_INCLUDED_
@@ -39,10 +39,16 @@ extern "C" {
 
 // provides Cryptographically secure random numbers for GMP. Why this is not
 // part of GMP libraries is beyond me... 
+// Numbers are drawn from a per-thread ChaCha20 DRBG seeded by the kernel,
+// which is reseeded periodically and automatically after fork().
 
-// return non-negative random number less than or equal to rand_max
+// return uniformly distributed non-negative random number less than
+// rand_max (rand_max must be positive)
 void mpz_urandom(mpz_t rop, mpz_t rand_max);
 
+// force the calling thread's generator to mix in fresh kernel entropy
+void mpz_urandom_reseed(void);
+
 #ifdef __cplusplus
 }
 #endif
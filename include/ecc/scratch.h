@@ -0,0 +1,77 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _EC_SCRATCH_H_INCLUDED_
+#define _EC_SCRATCH_H_INCLUDED_
+
+#include <ecc/field.h>
+#include <gmp.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Scratch arena for temporary field elements (and points). Storage is either
+// allocated once by mpECScratch_init (and reused across many operations) or
+// supplied by the caller (e.g. a local array on the stack). Elements carved
+// out of the arena never call malloc/free, so they must NOT be released with
+// mpFp_clear/mpECP_clear. Instead the arena is used with stack discipline:
+// save a mark, initialize temporaries, then release back to the mark.
+
+typedef struct {
+    mp_limb_t   *d;     // limb storage
+    size_t      alloc;  // size of storage (in limbs)
+    size_t      used;   // limbs currently handed out
+    int         owner;  // nonzero if d was allocated by mpECScratch_init
+} _mpECScratch_t;
+
+typedef _mpECScratch_t mpECScratch_t[1];
+typedef _mpECScratch_t *mpECScratch_ptr;
+
+// number of field elements of maximal size in a default (stack) arena
+#define _MPEC_SCRATCH_ELEMENTS  (24)
+#define _MPEC_SCRATCH_LIMBS     (_MPEC_SCRATCH_ELEMENTS * _MPFP_MAX_LIMBS)
+
+void mpECScratch_init(mpECScratch_t scr, size_t nlimbs);
+void mpECScratch_init_buffer(mpECScratch_t scr, mp_limb_t *d, size_t nlimbs);
+void mpECScratch_clear(mpECScratch_t scr);
+
+size_t mpECScratch_mark(mpECScratch_t scr);
+void mpECScratch_release(mpECScratch_t scr, size_t mark);
+
+// initialize a field element with limbs taken from the arena
+void mpFp_init_scratch(mpFp_t a, mpFp_field_ptr fp, mpECScratch_t scr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _EC_SCRATCH_H_INCLUDED_
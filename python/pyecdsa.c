@@ -472,6 +472,7 @@ static int ECDSASignatureScheme_init(ECDSASignatureScheme *self, PyObject *args,
 
     Py_INCREF(hashmodule);
     self->hashmodule = hashmodule;
+    mpECDSAHashfunc_init(hf);
     hf->dohash = _python_hash_wrapper;
     hf->hsz = hsz;
 
@@ -33,25 +33,84 @@
 #include <ecc/ecpoint.h>
 #include <ecc/ecurve.h>
 #include <ecc/field.h>
+#include <ecc/scratch.h>
 #include <gmp.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 
 void mpECDSAHashfunc_init(mpECDSAHashfunc_t H) {
+    H->dohash = NULL;
+    H->hsz = 0;
+    H->hinit = NULL;
+    H->hupdate = NULL;
+    H->hfinal = NULL;
+    H->ctxsz = 0;
+    H->blocksz = 0;
     return;
 }
 
 void mpECDSAHashfunc_set(mpECDSAHashfunc_t H, mpECDSAHashfunc_ptr Hp) {
     H->dohash = Hp->dohash;
     H->hsz = Hp->hsz;
+    H->hinit = Hp->hinit;
+    H->hupdate = Hp->hupdate;
+    H->hfinal = Hp->hfinal;
+    H->ctxsz = Hp->ctxsz;
+    H->blocksz = Hp->blocksz;
+    return;
+}
+
+void mpECDSAHashfunc_set_incremental(mpECDSAHashfunc_t H, _ecdsa_hash_init hinit, _ecdsa_hash_update hupdate, _ecdsa_hash_final hfinal, size_t ctxsz) {
+    H->hinit = hinit;
+    H->hupdate = hupdate;
+    H->hfinal = hfinal;
+    H->ctxsz = ctxsz;
+    return;
+}
+
+void mpECDSAHashfunc_set_blocksize(mpECDSAHashfunc_t H, size_t blocksz) {
+    H->blocksz = blocksz;
     return;
 }
 
 void mpECDSAHashfunc_clear(mpECDSAHashfunc_t H) {
-    H->dohash = NULL;
-    H->hsz = 0;
+    mpECDSAHashfunc_init(H);
+    return;
+}
+
+int mpECDSAHashCtx_init(mpECDSAHashCtx_t hctx, mpECDSAHashfunc_t H) {
+    if ((H->hinit == NULL) || (H->hupdate == NULL) || (H->hfinal == NULL) ||
+        (H->ctxsz == 0)) {
+        return -1;
+    }
+    mpECDSAHashfunc_init(hctx->H);
+    mpECDSAHashfunc_set(hctx->H, H);
+    hctx->ctx = malloc(H->ctxsz);
+    assert(hctx->ctx != NULL);
+    H->hinit(hctx->ctx);
+    return 0;
+}
+
+void mpECDSAHashCtx_update(mpECDSAHashCtx_t hctx, unsigned char *msg, size_t sz) {
+    hctx->H->hupdate(hctx->ctx, msg, sz);
+    return;
+}
+
+void mpECDSAHashCtx_final(mpECDSAHashCtx_t hctx, unsigned char *hash) {
+    hctx->H->hfinal(hctx->ctx, hash);
+    hctx->H->hinit(hctx->ctx);
+    return;
+}
+
+void mpECDSAHashCtx_clear(mpECDSAHashCtx_t hctx) {
+    // hash state is derived from message (possibly secret) data
+    memset(hctx->ctx, 0, hctx->H->ctxsz);
+    free(hctx->ctx);
+    hctx->ctx = NULL;
+    mpECDSAHashfunc_clear(hctx->H);
     return;
 }
 
@@ -66,6 +125,17 @@ int mpECDSASignatureScheme_init(mpECDSASignatureScheme_t sscheme, mpECurve_t cv,
     mpECP_init(sscheme->cv_G, cv);
     mpECP_set_mpz(sscheme->cv_G, cv->G[0], cv->G[1], cv);
     mpECP_scalar_base_mul_setup(sscheme->cv_G);
+    sscheme->deterministic = 0;
+    sscheme->pool = NULL;
+    return 0;
+}
+
+int mpECDSASignatureScheme_set_deterministic(mpECDSASignatureScheme_t sscheme, int deterministic) {
+    // HMAC keys are hsz bytes, which must fit in one block
+    if ((deterministic != 0) && (sscheme->H->blocksz < sscheme->H->hsz)) {
+        return -1;
+    }
+    sscheme->deterministic = (deterministic != 0);
     return 0;
 }
 
@@ -74,92 +144,518 @@ void mpECDSASignatureScheme_clear(mpECDSASignatureScheme_t sscheme) {
     mpECDSAHashfunc_clear(sscheme->H);
     sscheme->cvp = NULL;
     sscheme->nsz = 0;
+    sscheme->deterministic = 0;
+    sscheme->pool = NULL;
+    return;
+}
+
+void mpECDSASignatureScheme_set_nonce_pool(mpECDSASignatureScheme_t sscheme, mpECDSANoncePool_t pool) {
+    if (pool != NULL) {
+        assert(pool->fn == _mpFp_field_lookup(sscheme->cvp->n));
+    }
+    sscheme->pool = pool;
+    return;
+}
+
+// reduce the (truncated) message digest into e (mod n)
+static void _mpECDSA_digest_to_mpFp(mpFp_t e, mpECDSASignatureScheme_t sscheme, unsigned char *hash) {
+    size_t isz;
+
+    isz = sscheme->H->hsz;
+    if (sscheme->nsz <= isz) {
+        isz = sscheme->nsz;
+    }
+    // nsz bytes always fit in the limbs allocated for e
+    mpz_import(e->i, isz, 1, 1, 1, 0, hash);
+    mpFp_set_mpz_fp(e, e->i, e->fp);
+    return;
+}
+
+// out = HMAC(key, msg) (RFC 2104) with a key of exactly hsz bytes. out may
+// alias key or msg.
+static void _mpECDSA_hmac(unsigned char *out, mpECDSAHashfunc_t H, unsigned char *key, unsigned char *msg, size_t sz) {
+    size_t bsz = H->blocksz;
+    unsigned char ibuf[bsz + sz];
+    unsigned char obuf[bsz + H->hsz];
+    size_t i;
+
+    assert(bsz >= H->hsz);
+    for (i = 0; i < bsz; i++) {
+        unsigned char kb = (i < H->hsz) ? key[i] : 0;
+        ibuf[i] = kb ^ 0x36;
+        obuf[i] = kb ^ 0x5c;
+    }
+    memcpy(ibuf + bsz, msg, sz);
+    H->dohash(obuf + bsz, ibuf, bsz + sz);
+    H->dohash(out, obuf, bsz + H->hsz);
+#ifdef SAFE_CLEAN
+    memset(ibuf, 0, bsz + sz);
+    memset(obuf, 0, bsz + H->hsz);
+#endif
+    return;
+}
+
+// big-endian len byte encoding of a (int2octets), read directly from the
+// limbs so it works on scratch elements without allocation
+static void _mpFp_export_octets(unsigned char *b, size_t len, mpFp_t a) {
+    const mp_limb_t *al = mpz_limbs_read(a->i);
+    size_t psize = a->fp->psize;
+    size_t j;
+
+    for (j = 0; j < len; j++) {
+        size_t idx = len - 1 - j;
+        size_t li = idx / sizeof(mp_limb_t);
+
+        if (li < psize) {
+            b[j] = (unsigned char)(al[li] >> (8 * (idx % sizeof(mp_limb_t))));
+        } else {
+            b[j] = 0;
+        }
+    }
+    return;
+}
+
+// z = leftmost qlen bits of b (bits2int). At most nsz bytes are imported so
+// z never outgrows the limbs of an element mod n.
+static void _mpECDSA_bits2int(mpz_t z, unsigned char *b, size_t blen, size_t qlen) {
+    size_t nb = (qlen + 7) >> 3;
+
+    if (blen < nb) nb = blen;
+    mpz_import(z, nb, 1, 1, 1, 0, b);
+    if ((nb << 3) > qlen) {
+        mpz_tdiv_q_2exp(z, z, (nb << 3) - qlen);
+    }
+    return;
+}
+
+// RFC 6979 section 3.2 steps b. through f.: seed K, V from the private key
+// and bits2octets(h1). t is scratch space of at least hsz + 1 + 2 * nsz bytes.
+static void _mpECDSA_rfc6979_init(unsigned char *K, unsigned char *V, mpECDSASignatureScheme_t sscheme, mpFp_t sK, mpFp_t h, unsigned char *t) {
+    size_t hsz = sscheme->H->hsz;
+    size_t nsz = sscheme->nsz;
+    size_t tsz = hsz + 1 + (nsz << 1);
+    int i;
+
+    memset(V, 0x01, hsz);
+    memset(K, 0x00, hsz);
+    _mpFp_export_octets(t + hsz + 1, nsz, sK);
+    _mpFp_export_octets(t + hsz + 1 + nsz, nsz, h);
+    for (i = 0; i < 2; i++) {
+        memcpy(t, V, hsz);
+        t[hsz] = (unsigned char)i;
+        _mpECDSA_hmac(K, sscheme->H, K, t, tsz);
+        _mpECDSA_hmac(V, sscheme->H, K, V, hsz);
+    }
+#ifdef SAFE_CLEAN
+    memset(t, 0, tsz);
+#endif
+    return;
+}
+
+// RFC 6979 section 3.2 step h.: next candidate nonce 1 <= k < n. If retry is
+// set the previous candidate was rejected (by the caller or here) and K, V
+// are stepped first. t is scratch space as for _mpECDSA_rfc6979_init.
+static void _mpECDSA_rfc6979_next(mpFp_t k, unsigned char *K, unsigned char *V, mpECDSASignatureScheme_t sscheme, unsigned char *t, int retry) {
+    size_t hsz = sscheme->H->hsz;
+    size_t qlen = mpz_sizeinbase(sscheme->cvp->n, 2);
+    size_t tlen;
+
+    while (1) {
+        if (retry) {
+            memcpy(t, V, hsz);
+            t[hsz] = 0x00;
+            _mpECDSA_hmac(K, sscheme->H, K, t, hsz + 1);
+            _mpECDSA_hmac(V, sscheme->H, K, V, hsz);
+        }
+        retry = 1;
+        // only the first nsz bytes of T are used by bits2int
+        for (tlen = 0; tlen < sscheme->nsz; tlen += hsz) {
+            _mpECDSA_hmac(V, sscheme->H, K, V, hsz);
+            memcpy(t + tlen, V, ((sscheme->nsz - tlen) < hsz) ? (sscheme->nsz - tlen) : hsz);
+        }
+        _mpECDSA_bits2int(k->i, t, sscheme->nsz, qlen);
+        if ((mpz_sgn(k->i) != 0) && (mpz_cmp(k->i, sscheme->cvp->n) < 0)) break;
+    }
+    mpFp_set_mpz_fp(k, k->i, k->fp);
+#ifdef SAFE_CLEAN
+    memset(t, 0, sscheme->nsz);
+#endif
+    return;
+}
+
+// set rop (in field fp) to the integer value of op (which may be in a
+// different field, e.g. x coordinate mod p -> r mod n)
+static void _mpFp_set_mpFp_fp(mpFp_t rop, mpFp_t op, mpFp_field_ptr fp) {
+    mpz_set_mpFp(rop->i, op);
+    mpFp_set_mpz_fp(rop, rop->i, fp);
+    return;
+}
+
+// compute one pool entry (kinv, r) into e. Only the (already existing)
+// fields of the curve are used so this is safe to call from the worker.
+static void _mpECDSANoncePool_compute(mpECDSANoncePool_t pool, mp_limb_t *e) {
+    mpECDSASignatureScheme_ptr sscheme = pool->sscheme;
+    size_t psize = pool->fn->psize;
+    mpFp_t k_n;
+    mpFp_t r_n;
+    mpFp_t kinv;
+    mpFp_t x;
+    mpECP_t R;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPEC_SCRATCH_LIMBS];
+    int status;
+
+    mpECScratch_init_buffer(scr, scrl, _MPEC_SCRATCH_LIMBS);
+    mpFp_init_scratch(k_n, pool->fn, scr);
+    mpFp_init_scratch(r_n, pool->fn, scr);
+    mpFp_init_scratch(kinv, pool->fn, scr);
+    mpFp_init_scratch(x, sscheme->cvp->fp, scr);
+    mpECP_init_scratch(R, sscheme->cvp, scr);
+
+    do {
+        mpFp_urandom(k_n, sscheme->cvp->n);
+        if (__GMP_UNLIKELY(mpFp_cmp_ui(k_n, 0) == 0)) continue;
+        mpECP_scalar_base_mul_scratch(R, sscheme->cv_G, k_n, scr);
+        mpFp_set_mpECP_affine_x(x, R);
+        _mpFp_set_mpFp_fp(r_n, x, pool->fn);
+        if (__GMP_UNLIKELY(mpFp_cmp_ui(r_n, 0) == 0)) continue;
+        // k is secret, constant-time inverse
+        status = mpFp_inv_ct(kinv, k_n);
+        if (__GMP_LIKELY(status == 0)) break;
+    } while (1);
+
+    memcpy(e, kinv->i->_mp_d, psize * sizeof(mp_limb_t));
+    memcpy(e + psize, r_n->i->_mp_d, psize * sizeof(mp_limb_t));
+    mpECScratch_clear(scr);
+    return;
+}
+
+// append entry e if there is room, called with the lock held
+static int _mpECDSANoncePool_put_locked(mpECDSANoncePool_t pool, mp_limb_t *e) {
+    size_t esz = pool->fn->psize << 1;
+    size_t tail;
+
+    if (pool->count >= pool->size) return -1;
+    tail = (pool->head + pool->count) % pool->size;
+    memcpy(pool->d + (tail * esz), e, esz * sizeof(mp_limb_t));
+    pool->count += 1;
+    return 0;
+}
+
+// incremented in the child after each fork(), as for the random source in
+// mpzurandom.c. A pool whose generation is stale is in a forked child.
+static unsigned long _mpECDSANoncePool_fork_gen = 0;
+static pthread_once_t _mpECDSANoncePool_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t _mpECDSANoncePool_fork_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void _mpECDSANoncePool_atfork_child(void) {
+    __atomic_add_fetch(&_mpECDSANoncePool_fork_gen, 1, __ATOMIC_RELEASE);
+    pthread_mutex_init(&_mpECDSANoncePool_fork_lock, NULL);
+}
+
+static void _mpECDSANoncePool_once_init(void) {
+    int status;
+    status = pthread_atfork(NULL, NULL, _mpECDSANoncePool_atfork_child);
+    assert(status == 0);
+}
+
+// in a forked child discard the entries inherited from the parent (which
+// the parent will also use) and forget the worker, which only exists in
+// the parent. The pool lock may have been held by a parent thread at the
+// time of the fork so it is reinitialized.
+static void _mpECDSANoncePool_check_fork(mpECDSANoncePool_t pool) {
+    unsigned long gen;
+
+    gen = __atomic_load_n(&_mpECDSANoncePool_fork_gen, __ATOMIC_ACQUIRE);
+    if (__GMP_LIKELY(__atomic_load_n(&pool->fork_gen, __ATOMIC_ACQUIRE) == gen)) {
+        return;
+    }
+    pthread_mutex_lock(&_mpECDSANoncePool_fork_lock);
+    if (pool->fork_gen != gen) {
+        pthread_mutex_init(&pool->lock, NULL);
+        pthread_cond_init(&pool->cond, NULL);
+        memset(pool->d, 0, pool->size * (pool->fn->psize << 1) * sizeof(mp_limb_t));
+        pool->count = 0;
+        pool->head = 0;
+        pool->running = 0;
+        __atomic_store_n(&pool->fork_gen, gen, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&_mpECDSANoncePool_fork_lock);
+    return;
+}
+
+// remove the oldest entry into (kinv, r), returns -1 if the pool is empty
+static int _mpECDSANoncePool_take(mpECDSANoncePool_t pool, mpFp_t kinv, mpFp_t r) {
+    size_t psize = pool->fn->psize;
+    mp_limb_t *e;
+
+    _mpECDSANoncePool_check_fork(pool);
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == 0) {
+        pthread_mutex_unlock(&pool->lock);
+        return -1;
+    }
+    e = pool->d + (pool->head * (psize << 1));
+    memcpy(kinv->i->_mp_d, e, psize * sizeof(mp_limb_t));
+    memcpy(r->i->_mp_d, e + psize, psize * sizeof(mp_limb_t));
+    kinv->i->_mp_size = psize;
+    r->i->_mp_size = psize;
+    // a nonce must never be used twice
+    memset(e, 0, (psize << 1) * sizeof(mp_limb_t));
+    pool->head = (pool->head + 1) % pool->size;
+    pool->count -= 1;
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+static void *_mpECDSANoncePool_worker(void *arg) {
+    mpECDSANoncePool_ptr pool = (mpECDSANoncePool_ptr)arg;
+    mp_limb_t e[_MPFP_MAX_LIMBS];
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running) {
+        if (pool->count >= pool->size) {
+            pthread_cond_wait(&pool->cond, &pool->lock);
+            continue;
+        }
+        // compute without holding the lock so signers are never blocked
+        pthread_mutex_unlock(&pool->lock);
+        _mpECDSANoncePool_compute(pool, e);
+        pthread_mutex_lock(&pool->lock);
+        _mpECDSANoncePool_put_locked(pool, e);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    memset(e, 0, sizeof(e));
+    return NULL;
+}
+
+void mpECDSANoncePool_init(mpECDSANoncePool_t pool, mpECDSASignatureScheme_t sscheme, size_t size) {
+    assert(size > 0);
+    pool->sscheme = sscheme;
+    pool->fn = _mpFp_field_lookup(sscheme->cvp->n);
+    // entries are copied as 2 * psize limbs, see _mpECDSANoncePool_worker
+    assert((pool->fn->psize << 1) <= _MPFP_MAX_LIMBS);
+    pool->d = (mp_limb_t *)malloc(size * (pool->fn->psize << 1) * sizeof(mp_limb_t));
+    assert(pool->d != NULL);
+    pool->size = size;
+    pool->count = 0;
+    pool->head = 0;
+    pool->running = 0;
+    pthread_once(&_mpECDSANoncePool_once, _mpECDSANoncePool_once_init);
+    pool->fork_gen = __atomic_load_n(&_mpECDSANoncePool_fork_gen, __ATOMIC_ACQUIRE);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    return;
+}
+
+void mpECDSANoncePool_clear(mpECDSANoncePool_t pool) {
+    mpECDSANoncePool_stop(pool);
+    if (pool->sscheme->pool == pool) {
+        pool->sscheme->pool = NULL;
+    }
+    memset(pool->d, 0, pool->size * (pool->fn->psize << 1) * sizeof(mp_limb_t));
+    free(pool->d);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    pool->d = NULL;
+    pool->size = 0;
+    pool->count = 0;
+    pool->sscheme = NULL;
+    return;
+}
+
+size_t mpECDSANoncePool_fill(mpECDSANoncePool_t pool, size_t n) {
+    mp_limb_t e[_MPFP_MAX_LIMBS];
+    size_t added = 0;
+    int status;
+
+    _mpECDSANoncePool_check_fork(pool);
+    while (added < n) {
+        if (mpECDSANoncePool_count(pool) >= pool->size) break;
+        _mpECDSANoncePool_compute(pool, e);
+        pthread_mutex_lock(&pool->lock);
+        status = _mpECDSANoncePool_put_locked(pool, e);
+        pthread_mutex_unlock(&pool->lock);
+        if (status != 0) break;
+        added += 1;
+    }
+    memset(e, 0, sizeof(e));
+    return added;
+}
+
+int mpECDSANoncePool_start(mpECDSANoncePool_t pool) {
+    int status;
+
+    _mpECDSANoncePool_check_fork(pool);
+    pthread_mutex_lock(&pool->lock);
+    if (pool->running) {
+        pthread_mutex_unlock(&pool->lock);
+        return -1;
+    }
+    pool->running = 1;
+    status = pthread_create(&pool->worker, NULL, _mpECDSANoncePool_worker, pool);
+    if (status != 0) {
+        pool->running = 0;
+        pthread_mutex_unlock(&pool->lock);
+        return -1;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+void mpECDSANoncePool_stop(mpECDSANoncePool_t pool) {
+    _mpECDSANoncePool_check_fork(pool);
+    pthread_mutex_lock(&pool->lock);
+    if (!pool->running) {
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+    pool->running = 0;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+    pthread_join(pool->worker, NULL);
     return;
 }
 
+size_t mpECDSANoncePool_count(mpECDSANoncePool_t pool) {
+    size_t count;
+
+    _mpECDSANoncePool_check_fork(pool);
+    pthread_mutex_lock(&pool->lock);
+    count = pool->count;
+    pthread_mutex_unlock(&pool->lock);
+    return count;
+}
+
 int mpECDSASignature_init_Sign(mpECDSASignature_t sig, mpECDSASignatureScheme_t sscheme, mpFp_t sK, unsigned char *msg, size_t sz) {
-    unsigned char *hash;
+    if (sscheme == NULL) return -1;
+
+    if ((msg == NULL) || (sz == 0)) return -1;
+
+    unsigned char hash[sscheme->H->hsz];
+
+    sscheme->H->dohash(hash, msg, sz);
+    return mpECDSASignature_init_Sign_digest(sig, sscheme, sK, hash, sscheme->H->hsz);
+}
+
+int mpECDSASignature_init_Sign_digest(mpECDSASignature_t sig, mpECDSASignatureScheme_t sscheme, mpFp_t sK, unsigned char *hash, size_t dsz) {
+    mpFp_field_ptr fn;
     mpFp_t k_n;
     mpFp_t r_n;
     mpFp_t s_n;
     mpFp_t e_n;
-    mpz_t e;
-    mpz_t r;
+    mpFp_t kinv;
+    mpFp_t x;
     mpECP_t R;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPEC_SCRATCH_LIMBS];
     int status;
+    int retry = 0;
 
     if (sscheme == NULL) return -1;
 
-    if ((msg == NULL) || (sz == 0)) return -1;
+    if ((hash == NULL) || (dsz != sscheme->H->hsz)) return -1;
 
-    hash = (unsigned char *)malloc(sscheme->H->hsz * sizeof(char));
-    assert(hash != NULL);
+    unsigned char dK[sscheme->H->hsz];
+    unsigned char dV[sscheme->H->hsz];
+    unsigned char dt[sscheme->H->hsz + 1 + (sscheme->nsz << 1)];
 
-    mpFp_init(k_n, sscheme->cvp->n);
-    mpFp_init(r_n, sscheme->cvp->n);
-    mpFp_init(s_n, sscheme->cvp->n);
-    mpFp_init(e_n, sscheme->cvp->n);
-    mpz_init(r);
-    mpz_init(e);
-    mpECP_init(R, sscheme->cvp);
+    // all temporaries are taken from a stack backed scratch arena so that
+    // signing does not touch the heap (other than sig->r, sig->s)
+    mpECScratch_init_buffer(scr, scrl, _MPEC_SCRATCH_LIMBS);
+    fn = _mpFp_field_lookup(sscheme->cvp->n);
+    mpFp_init_scratch(k_n, fn, scr);
+    mpFp_init_scratch(r_n, fn, scr);
+    mpFp_init_scratch(s_n, fn, scr);
+    mpFp_init_scratch(e_n, fn, scr);
+    mpFp_init_scratch(kinv, fn, scr);
+    mpFp_init_scratch(x, sscheme->cvp->fp, scr);
+    mpECP_init_scratch(R, sscheme->cvp, scr);
 
-    sscheme->H->dohash(hash, msg, sz);
-    if (sscheme->nsz <= sscheme->H->hsz) {
-        mpz_import(e, sscheme->nsz, 1, 1, 1, 0, hash);
-    } else {
-        mpz_import(e, sscheme->H->hsz, 1, 1, 1, 0, hash);
+    _mpECDSA_digest_to_mpFp(e_n, sscheme, hash);
+    if ((!sscheme->deterministic) && (sscheme->pool != NULL)) {
+        // s = kinv * (e + r * sK) from a precomputed (kinv, r)
+        if (_mpECDSANoncePool_take(sscheme->pool, kinv, r_n) == 0) {
+            mpFp_mul(s_n, r_n, sK);
+            mpFp_add(s_n, s_n, e_n);
+            mpFp_mul(s_n, s_n, kinv);
+            if (__GMP_LIKELY(mpFp_cmp_ui(s_n, 0) != 0)) goto signature;
+        }
+    }
+    if (sscheme->deterministic) {
+        // bits2octets(h1) = bits2int(h1) mod n, k_n is used as a temporary
+        _mpECDSA_bits2int(k_n->i, hash, sscheme->H->hsz, mpz_sizeinbase(sscheme->cvp->n, 2));
+        mpFp_set_mpz_fp(k_n, k_n->i, fn);
+        _mpECDSA_rfc6979_init(dK, dV, sscheme, sK, k_n, dt);
     }
-    free(hash);
-    mpFp_set_mpz(e_n, e, sscheme->cvp->n);
 new_random:
-    mpFp_urandom(k_n, sscheme->cvp->n);
-    if (__GMP_UNLIKELY(mpFp_cmp_ui(k_n, 0) == 0)) goto new_random;
+    if (sscheme->deterministic) {
+        _mpECDSA_rfc6979_next(k_n, dK, dV, sscheme, dt, retry);
+        retry = 1;
+    } else {
+        mpFp_urandom(k_n, sscheme->cvp->n);
+        if (__GMP_UNLIKELY(mpFp_cmp_ui(k_n, 0) == 0)) goto new_random;
+    }
 
-    mpECP_scalar_base_mul(R, sscheme->cv_G, k_n);
-    mpz_set_mpECP_affine_x(r, R);
-    if (__GMP_UNLIKELY(mpz_cmp_ui(r, 0) == 0)) goto new_random;
+    mpECP_scalar_base_mul_scratch(R, sscheme->cv_G, k_n, scr);
+    mpFp_set_mpECP_affine_x(x, R);
+    _mpFp_set_mpFp_fp(r_n, x, fn);
+    if (__GMP_UNLIKELY(mpFp_cmp_ui(r_n, 0) == 0)) goto new_random;
 
-    mpFp_set_mpz(r_n, r, sscheme->cvp->n);
     mpFp_mul(s_n, r_n, sK);
     mpFp_add(s_n, s_n, e_n);
-    status = mpFp_inv(e_n, k_n);
+    // k is secret, constant-time inverse
+    status = mpFp_inv_ct(kinv, k_n);
     if (status != 0) goto new_random;
-    mpFp_mul(s_n, s_n, e_n);
+    mpFp_mul(s_n, s_n, kinv);
     if (__GMP_UNLIKELY(mpFp_cmp_ui(s_n, 0) == 0)) goto new_random;
 
-    mpFp_init(sig->r, sscheme->cvp->n);
-    mpFp_init(sig->s, sscheme->cvp->n);
+signature:
+    mpFp_init_fp(sig->r, fn);
+    mpFp_init_fp(sig->s, fn);
 
     mpFp_set(sig->r, r_n);
     mpFp_set(sig->s, s_n);
     sig->sscheme = sscheme;
 
-    mpECP_clear(R);
-    mpz_clear(e);
-    mpz_clear(r);
-    mpFp_clear(e_n);
-    mpFp_clear(s_n);
-    mpFp_clear(r_n);
-    mpFp_clear(k_n);
+#ifdef SAFE_CLEAN
+    memset(dK, 0, sizeof(dK));
+    memset(dV, 0, sizeof(dV));
+#endif
+    mpECScratch_clear(scr);
     return 0;
 }
 
 int mpECDSASignature_verify_cmp(mpECDSASignature_t sig, mpECP_t pK, unsigned char *msg, size_t sz) {
-    unsigned char *hash;
+    if (sz == 0) return -1;
+
+    if ((sig == NULL) || (sig->sscheme == NULL)) return -1;
+
+    unsigned char hash[sig->sscheme->H->hsz];
+
+    sig->sscheme->H->dohash(hash, msg, sz);
+    return mpECDSASignature_verify_cmp_digest(sig, pK, hash, sig->sscheme->H->hsz);
+}
+
+int mpECDSASignature_verify_cmp_digest(mpECDSASignature_t sig, mpECP_t pK, unsigned char *hash, size_t dsz) {
+    mpFp_field_ptr fn;
     mpFp_t w;
     mpFp_t u1;
     mpFp_t u2;
     mpFp_t e_n;
     mpFp_t p_n;
-    mpz_t e;
+    mpFp_t x;
     mpECP_t P;
     mpECP_t Pq;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPEC_SCRATCH_LIMBS];
     int status;
 
-    if (sz == 0) return -1;
-
     if (sig == NULL) return -1;
 
+    if ((hash == NULL) || (dsz != sig->sscheme->H->hsz)) return -1;
+
     // validate signature input, presume public key was validated at import
     if ((mpz_cmp(sig->r->fp->p, sig->sscheme->cvp->n) != 0) ||
         (mpz_cmp(sig->s->fp->p, sig->sscheme->cvp->n) != 0)) {
@@ -169,96 +665,320 @@ int mpECDSASignature_verify_cmp(mpECDSASignature_t sig, mpECP_t pK, unsigned cha
     if ((mpFp_cmp_ui(sig->r, 0) == 0) || (mpFp_cmp_ui(sig->s, 0) == 0)) {
         return -1;
     }
-    
-    hash = (unsigned char *)malloc(sig->sscheme->H->hsz * sizeof(char));
 
-    mpz_init(e);
-    mpFp_init_fp(p_n, sig->sscheme->cvp->fp);
-    mpFp_init(e_n, sig->sscheme->cvp->n);
-    mpFp_init(w, sig->sscheme->cvp->n);
-    mpFp_init(u1, sig->sscheme->cvp->n);
-    mpFp_init(u2, sig->sscheme->cvp->n);
-    mpECP_init(P, sig->sscheme->cvp);
-    mpECP_init(Pq, sig->sscheme->cvp);
+    mpECScratch_init_buffer(scr, scrl, _MPEC_SCRATCH_LIMBS);
+    fn = sig->r->fp;
+    mpFp_init_scratch(w, fn, scr);
+    mpFp_init_scratch(u1, fn, scr);
+    mpFp_init_scratch(u2, fn, scr);
+    mpFp_init_scratch(e_n, fn, scr);
+    mpFp_init_scratch(p_n, fn, scr);
+    mpFp_init_scratch(x, sig->sscheme->cvp->fp, scr);
+    mpECP_init_scratch(P, sig->sscheme->cvp, scr);
+    mpECP_init_scratch(Pq, sig->sscheme->cvp, scr);
 
-    sig->sscheme->H->dohash(hash, msg, sz);
-    if (sig->sscheme->nsz <= sig->sscheme->H->hsz) {
-        mpz_import(e, sig->sscheme->nsz, 1, 1, 1, 0, hash);
-    } else {
-        mpz_import(e, sig->sscheme->H->hsz, 1, 1, 1, 0, hash);
-    }
-    free(hash);
-    mpFp_set_mpz(e_n, e, sig->sscheme->cvp->n);
+    _mpECDSA_digest_to_mpFp(e_n, sig->sscheme, hash);
     mpFp_inv(w, sig->s);
     mpFp_mul(u1, e_n, w);
     mpFp_mul(u2, sig->r, w);
-    mpECP_scalar_base_mul(P, sig->sscheme->cv_G, u1);
-    mpECP_scalar_mul(Pq, pK, u2);
+    mpECP_scalar_base_mul_scratch(P, sig->sscheme->cv_G, u1, scr);
+    // public keys with a precomputed table (e.g. hot keys from a
+    // mpECPKeyCache_t) use fixed-base multiplication
+    if (pK->base_bits != 0) {
+        mpECP_scalar_base_mul_scratch(Pq, pK, u2, scr);
+    } else {
+        mpECP_scalar_mul_scratch(Pq, pK, u2, scr);
+    }
     mpECP_add(P, P, Pq);
-    mpz_set_mpECP_affine_x(e, P);
-    mpFp_set_mpz(p_n, e, sig->sscheme->cvp->n);
+    mpFp_set_mpECP_affine_x(x, P);
+    _mpFp_set_mpFp_fp(p_n, x, fn);
 
     status = mpFp_cmp(p_n, sig->r);
 
-    mpECP_clear(Pq);
-    mpECP_clear(P);
-    mpFp_clear(u2);
-    mpFp_clear(u1);
-    mpFp_clear(w);
-    mpFp_clear(e_n);
-    mpFp_clear(p_n);
-    mpz_clear(e);
-
+    mpECScratch_clear(scr);
     return status;
 }
 
-static void _shift_right_and_zero_pad(unsigned char *buffer, size_t len, size_t shift) {
-    int i;
+int mpECDSASignature_init(mpECDSASignature_t sig, mpECDSASignatureScheme_t sscheme) {
+    if (sscheme == NULL) return -1;
+
+    mpFp_init(sig->r, sscheme->cvp->n);
+    mpFp_init(sig->s, sscheme->cvp->n);
+    sig->sscheme = sscheme;
+    return 0;
+}
+
+// ad = big-endian b (len <= psize limbs)
+static void _mpECDSA_import_octets(mp_limb_t *ad, size_t psize, unsigned char *b, size_t len) {
+    size_t j;
+
+    assert(len <= (psize * sizeof(mp_limb_t)));
+    memset(ad, 0, psize * sizeof(mp_limb_t));
+    for (j = 0; j < len; j++) {
+        size_t idx = len - 1 - j;
+
+        ad[idx / sizeof(mp_limb_t)] |= ((mp_limb_t)b[j]) << (8 * (idx % sizeof(mp_limb_t)));
+    }
+    return;
+}
+
+// 0 < ad < n, where n is the modulus of a (ad is psize limbs)
+static int _mpECDSA_scalar_valid(const mp_limb_t *ad, mpFp_t a) {
+    if (mpn_zero_p(ad, a->fp->psize)) return 0;
+    return (mpn_cmp(ad, mpz_limbs_read(a->fp->p), a->fp->psize) < 0);
+}
+
+// a = ad, directly into the existing limbs
+static void _mpECDSA_commit_scalar(mpFp_t a, const mp_limb_t *ad) {
+    memcpy(a->i->_mp_d, ad, a->fp->psize * sizeof(mp_limb_t));
+    a->i->_mp_size = a->fp->psize;
+    return;
+}
+
+size_t mpECDSASignature_out_bytelen(mpECDSASignature_t sig) {
+    return (sig->sscheme->nsz << 1);
+}
+
+void mpECDSASignature_out_bytes(unsigned char *buf, mpECDSASignature_t sig) {
+    _mpFp_export_octets(buf, sig->sscheme->nsz, sig->r);
+    _mpFp_export_octets(buf + sig->sscheme->nsz, sig->sscheme->nsz, sig->s);
+    return;
+}
+
+int mpECDSASignature_set_bytes(mpECDSASignature_t sig, unsigned char *bsig, size_t sz) {
+    mp_limb_t r[_MPFP_MAX_LIMBS];
+    mp_limb_t s[_MPFP_MAX_LIMBS];
+    size_t nsz, psize;
+
+    if ((sig == NULL) || (sig->sscheme == NULL)) return -1;
+
+    nsz = sig->sscheme->nsz;
+    if ((bsig == NULL) || (sz != (nsz << 1))) return -1;
+
+    // decode and validate both before touching sig
+    psize = sig->r->fp->psize;
+    _mpECDSA_import_octets(r, psize, bsig, nsz);
+    _mpECDSA_import_octets(s, psize, bsig + nsz, nsz);
+    if ((!_mpECDSA_scalar_valid(r, sig->r)) || (!_mpECDSA_scalar_valid(s, sig->s))) {
+        return -1;
+    }
+    _mpECDSA_commit_scalar(sig->r, r);
+    _mpECDSA_commit_scalar(sig->s, s);
+    return 0;
+}
+
+// DER: SEQUENCE { INTEGER r, INTEGER s } with minimal length INTEGERs
+
+// length of minimal (positive) DER INTEGER content for nsz octet value b
+static size_t _der_int_len(unsigned char *b, size_t nsz) {
+    size_t i = 0;
+
+    while ((i < (nsz - 1)) && (b[i] == 0)) i++;
+    return (nsz - i) + ((b[i] & 0x80) ? 1 : 0);
+}
+
+static size_t _der_len_len(size_t len) {
+    if (len < 0x80) return 1;
+    if (len < 0x100) return 2;
+    return 3;
+}
+
+static unsigned char *_der_put_len(unsigned char *p, size_t len) {
+    if (len >= 0x100) {
+        *p++ = 0x82;
+        *p++ = (unsigned char)(len >> 8);
+    } else if (len >= 0x80) {
+        *p++ = 0x81;
+    }
+    *p++ = (unsigned char)len;
+    return p;
+}
+
+static unsigned char *_der_put_int(unsigned char *p, unsigned char *b, size_t nsz) {
+    size_t ilen = _der_int_len(b, nsz);
+
+    *p++ = 0x02;
+    p = _der_put_len(p, ilen);
+    if (ilen > nsz) {
+        *p++ = 0x00;
+        memcpy(p, b, nsz);
+        return p + nsz;
+    }
+    memcpy(p, b + (nsz - ilen), ilen);
+    return p + ilen;
+}
+
+size_t mpECDSASignatureScheme_der_max_bytelen(mpECDSASignatureScheme_t sscheme) {
+    size_t ilen = sscheme->nsz + 1;
+    size_t slen = 2 * (1 + _der_len_len(ilen) + ilen);
+
+    return 1 + _der_len_len(slen) + slen;
+}
+
+size_t mpECDSASignature_out_der_bytelen(mpECDSASignature_t sig) {
+    size_t nsz = sig->sscheme->nsz;
+    unsigned char b[nsz << 1];
+    size_t rlen, slen, len;
+
+    mpECDSASignature_out_bytes(b, sig);
+    rlen = _der_int_len(b, nsz);
+    slen = _der_int_len(b + nsz, nsz);
+    len = 2 + _der_len_len(rlen) + _der_len_len(slen) + rlen + slen;
+    return 1 + _der_len_len(len) + len;
+}
+
+int mpECDSASignature_out_der(unsigned char *buf, size_t bufsz, mpECDSASignature_t sig) {
+    size_t nsz = sig->sscheme->nsz;
+    unsigned char b[nsz << 1];
+    unsigned char *p;
+    size_t rlen, slen, len;
+
+    mpECDSASignature_out_bytes(b, sig);
+    rlen = _der_int_len(b, nsz);
+    slen = _der_int_len(b + nsz, nsz);
+    len = 2 + _der_len_len(rlen) + _der_len_len(slen) + rlen + slen;
+    if ((1 + _der_len_len(len) + len) > bufsz) return -1;
+
+    p = buf;
+    *p++ = 0x30;
+    p = _der_put_len(p, len);
+    p = _der_put_int(p, b, nsz);
+    p = _der_put_int(p, b + nsz, nsz);
+    return (int)(p - buf);
+}
+
+// parse a DER length at *p (strictly minimal), -1 if malformed
+static int _der_get_len(unsigned char **p, unsigned char *end, size_t *len) {
+    unsigned char *q = *p;
+    size_t l;
+
+    if (q >= end) return -1;
+    l = *q++;
+    if (l == 0x81) {
+        if ((q >= end) || (*q < 0x80)) return -1;
+        l = *q++;
+    } else if (l == 0x82) {
+        if (((end - q) < 2) || (*q == 0)) return -1;
+        l = (((size_t)q[0]) << 8) | q[1];
+        if (l < 0x100) return -1;
+        q += 2;
+    } else if (l >= 0x80) {
+        return -1;
+    }
+    if (l > (size_t)(end - q)) return -1;
+    *len = l;
+    *p = q;
+    return 0;
+}
 
-    for (i = len-1; i >= shift; i--) {
-        buffer[i] = buffer[i-shift];
+// ad (psize limbs of a) = DER INTEGER at *p, -1 if malformed or not in (0, n)
+static int _der_get_int(mp_limb_t *ad, mpFp_t a, unsigned char **p, unsigned char *end, size_t nsz) {
+    unsigned char *q = *p;
+    size_t ilen;
+
+    if ((q >= end) || (*q++ != 0x02)) return -1;
+    if (_der_get_len(&q, end, &ilen) != 0) return -1;
+    // positive, minimal encoding only
+    if ((ilen == 0) || (q[0] & 0x80)) return -1;
+    if ((q[0] == 0) && ((ilen == 1) || ((q[1] & 0x80) == 0))) return -1;
+    if (q[0] == 0) {
+        q++;
+        ilen--;
     }
-    for (i = shift - 1; i >= 0; i--) {
-        buffer[i] = 0;
+    if (ilen > nsz) return -1;
+    _mpECDSA_import_octets(ad, a->fp->psize, q, ilen);
+    if (!_mpECDSA_scalar_valid(ad, a)) return -1;
+    *p = q + ilen;
+    return 0;
+}
+
+int mpECDSASignature_set_der(mpECDSASignature_t sig, unsigned char *bsig, size_t sz) {
+    mp_limb_t r[_MPFP_MAX_LIMBS];
+    mp_limb_t s[_MPFP_MAX_LIMBS];
+    unsigned char *p;
+    unsigned char *end;
+    size_t len;
+
+    if ((sig == NULL) || (sig->sscheme == NULL)) return -1;
+
+    if ((bsig == NULL) || (sz < 2)) return -1;
+
+    p = bsig;
+    end = bsig + sz;
+    if (*p++ != 0x30) return -1;
+    if (_der_get_len(&p, end, &len) != 0) return -1;
+    if ((p + len) != end) return -1;
+    if (_der_get_int(r, sig->r, &p, end, sig->sscheme->nsz) != 0) return -1;
+    if (_der_get_int(s, sig->s, &p, end, sig->sscheme->nsz) != 0) return -1;
+    if (p != end) return -1;
+    _mpECDSA_commit_scalar(sig->r, r);
+    _mpECDSA_commit_scalar(sig->s, s);
+    return 0;
+}
+
+void mpECDSASignature_out_bytes_batch(unsigned char *buf, mpECDSASignature_ptr *sig, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        mpECDSASignature_out_bytes(buf, sig[i]);
+        buf += (sig[i]->sscheme->nsz << 1);
     }
     return;
 }
 
-unsigned char *mpECDSASignature_export_bytes(mpECDSASignature_t sig, size_t *sz) {
-    mpz_t r;
-    mpz_t s;
-    unsigned char *buffer;
-    unsigned char *br;
-    unsigned char *bs;
-    size_t bsz;
+int mpECDSASignature_set_bytes_batch(mpECDSASignature_ptr *sig, unsigned char *buf, size_t n, int *status) {
+    size_t i;
+    int result = 0;
 
-    mpz_init(r);
-    mpz_init(s);
-    
-    buffer = (unsigned char *)malloc((sig->sscheme->nsz << 1) * sizeof(char));
-    br = buffer;
-    bs = buffer + sig->sscheme->nsz;
-    assert(buffer != NULL);
+    for (i = 0; i < n; i++) {
+        size_t sz = (sig[i]->sscheme->nsz << 1);
+        int st;
 
-    mpz_set_mpFp(r, sig->r);
-    mpz_set_mpFp(s, sig->s);
+        st = mpECDSASignature_set_bytes(sig[i], buf, sz);
+        if (status != NULL) status[i] = st;
+        if (st != 0) result = -1;
+        buf += sz;
+    }
+    return result;
+}
 
-    mpz_export(br, &bsz, 1, sizeof(char), 0, 0, r);
-    assert(bsz <= sig->sscheme->nsz);
-    if (bsz < sig->sscheme->nsz) {
-        _shift_right_and_zero_pad(br, sig->sscheme->nsz, sig->sscheme->nsz - bsz);
+int mpECDSASignature_out_der_batch(unsigned char *buf, size_t bufsz, size_t *len, mpECDSASignature_ptr *sig, size_t n) {
+    size_t i;
+    size_t total = 0;
+
+    for (i = 0; i < n; i++) {
+        int l;
+
+        l = mpECDSASignature_out_der(buf + total, bufsz - total, sig[i]);
+        if (l < 0) return -1;
+        len[i] = (size_t)l;
+        total += (size_t)l;
     }
+    return (int)total;
+}
+
+int mpECDSASignature_set_der_batch(mpECDSASignature_ptr *sig, unsigned char *buf, size_t *len, size_t n, int *status) {
+    size_t i;
+    int result = 0;
 
-    mpz_export(bs, &bsz, 1, sizeof(char), 0, 0, s);
-    assert(bsz <= sig->sscheme->nsz);
-    if (bsz < sig->sscheme->nsz) {
-        _shift_right_and_zero_pad(bs, sig->sscheme->nsz, sig->sscheme->nsz - bsz);
+    for (i = 0; i < n; i++) {
+        int st;
+
+        st = mpECDSASignature_set_der(sig[i], buf, len[i]);
+        if (status != NULL) status[i] = st;
+        if (st != 0) result = -1;
+        buf += len[i];
     }
+    return result;
+}
 
-    mpz_clear(s);
-    mpz_clear(r);
+unsigned char *mpECDSASignature_export_bytes(mpECDSASignature_t sig, size_t *sz) {
+    unsigned char *buffer;
 
-    *sz = (sig->sscheme->nsz << 1);
+    *sz = mpECDSASignature_out_bytelen(sig);
+    buffer = (unsigned char *)malloc(*sz * sizeof(char));
+    assert(buffer != NULL);
+    mpECDSASignature_out_bytes(buffer, sig);
     return buffer;
 }
 
@@ -282,11 +1002,6 @@ char *mpECDSASignature_export_str(mpECDSASignature_t sig) {
 }
 
 int mpECDSASignature_init_import_bytes(mpECDSASignature_t sig, mpECDSASignatureScheme_t sscheme, unsigned char *bsig, size_t sz) {
-    mpz_t r;
-    mpz_t s;
-    unsigned char *br;
-    unsigned char *bs;
-    
     if (sig == NULL) return -1;
 
     if (sscheme == NULL) return -1;
@@ -295,29 +1010,11 @@ int mpECDSASignature_init_import_bytes(mpECDSASignature_t sig, mpECDSASignatureS
         return -1;
     }
 
-    br = bsig;
-    bs = bsig + sscheme->nsz;
-
-    mpz_init(r);
-    mpz_init(s);
-
-    mpz_import (r, sscheme->nsz, 1, sizeof(char), 0, 0, br);
-    mpz_import (s, sscheme->nsz, 1, sizeof(char), 0, 0, bs);
-
-    if ((mpz_cmp_ui(r, 0) <= 0) || (mpz_cmp_ui(s, 0) <= 0) ||
-        (mpz_cmp(r, sscheme->cvp->n) >= 0) || (mpz_cmp(s, sscheme->cvp->n) >= 0)) {
-        mpz_clear(s);
-        mpz_clear(r);
+    mpECDSASignature_init(sig, sscheme);
+    if (mpECDSASignature_set_bytes(sig, bsig, sz) != 0) {
+        mpECDSASignature_clear(sig);
         return -1;
     }
-
-    mpFp_init(sig->r, sscheme->cvp->n);
-    mpFp_set_mpz(sig->r, r, sscheme->cvp->n);
-    mpFp_init(sig->s, sscheme->cvp->n);
-    mpFp_set_mpz(sig->s, s, sscheme->cvp->n);
-    sig->sscheme = sscheme;
-    mpz_clear(s);
-    mpz_clear(r);
     return 0;
 }
 
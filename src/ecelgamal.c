@@ -38,6 +38,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+// number of ciphertexts processed (nonces, normalization) per chunk
+#define _MPECELGAMAL_BATCH_CHUNK    (64)
+
 int mpECElgamal_init_encrypt(mpECElgamalCiphertext_t ctxt, mpECP_t pK, mpECP_t ptxt) {
     mpFp_t k;
     if (mpECurve_cmp(pK->cvp, ptxt->cvp) != 0) {
@@ -77,3 +80,355 @@ void mpECElgamal_clear(mpECElgamalCiphertext_t ctxt) {
     mpECP_clear(ctxt->C);
     return;
 }
+
+void mpECElgamal_init(mpECElgamalCiphertext_t ctxt, mpECurve_t cv) {
+    mpECP_init(ctxt->C, cv);
+    mpECP_init(ctxt->D, cv);
+    mpECP_set_neutral(ctxt->C, cv);
+    mpECP_set_neutral(ctxt->D, cv);
+    return;
+}
+
+int mpECElgamal_add(mpECElgamalCiphertext_t rop, mpECElgamalCiphertext_t op1, mpECElgamalCiphertext_t op2) {
+    if (mpECurve_cmp(op1->C->cvp, op2->C->cvp) != 0) {
+        return -1;
+    }
+    mpECP_add(rop->C, op1->C, op2->C);
+    mpECP_add(rop->D, op1->D, op2->D);
+    return 0;
+}
+
+int mpECElgamal_scalar_mul(mpECElgamalCiphertext_t rop, mpECElgamalCiphertext_t op, mpFp_t sc) {
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPEC_SCRATCH_LIMBS];
+    if (mpz_cmp(sc->fp->p, op->C->cvp->n) != 0) {
+        return -1;
+    }
+    mpECScratch_init_buffer(scr, scrl, _MPEC_SCRATCH_LIMBS);
+    mpECP_scalar_mul_scratch(rop->C, op->C, sc, scr);
+    mpECP_scalar_mul_scratch(rop->D, op->D, sc, scr);
+    mpECScratch_clear(scr);
+    return 0;
+}
+
+// bucket window width for a weighted sum of n terms
+static int _mpECElgamal_sum_window(size_t n) {
+    int c;
+
+    c = 0;
+    while ((n >> c) > 1) c++;
+    c -= 2;
+    if (c < 2) c = 2;
+    if (c > 12) c = 12;
+    return c;
+}
+
+int mpECElgamal_sum(mpECElgamalCiphertext_t rop, mpECElgamalCiphertext_ptr *ctxts, mpFp_ptr *weights, size_t n) {
+    mpECurve_ptr cvp;
+    mpECScratch_t scr;
+    // backing for the unweighted accumulators, which are read after the
+    // branch so this lives at function scope
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 3 * 2];
+    mpECP_t accC, accD;
+    size_t i;
+
+    if (n == 0) {
+        mpECP_set_neutral(rop->C, rop->C->cvp);
+        mpECP_set_neutral(rop->D, rop->D->cvp);
+        return 0;
+    }
+    cvp = ctxts[0]->C->cvp;
+    for (i = 0; i < n; i++) {
+        if (mpECurve_cmp(ctxts[i]->C->cvp, cvp) != 0) {
+            return -1;
+        }
+        if ((weights != NULL) && (mpz_cmp(weights[i]->fp->p, cvp->n) != 0)) {
+            return -1;
+        }
+    }
+
+    if (weights == NULL) {
+        mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 3 * 2);
+        mpECP_init_scratch(accC, cvp, scr);
+        mpECP_init_scratch(accD, cvp, scr);
+        mpECP_set(accC, ctxts[0]->C);
+        mpECP_set(accD, ctxts[0]->D);
+        for (i = 1; i < n; i++) {
+            mpECP_add(accC, accC, ctxts[i]->C);
+            mpECP_add(accD, accD, ctxts[i]->D);
+        }
+    } else {
+        // Pippenger: for each c bit window (from the top) the terms are
+        // added into 2**c - 1 buckets by digit, the window sum
+        // sum(b * bucket[b]) is formed with running sums
+        mpECP_t *bC, *bD;
+        mpECP_t runC, runD, winC, winD;
+        size_t bits, wbits;
+        int c, nb, j, b, w;
+
+        // weights are fixed size (not normalized), so the bit length is
+        // taken from the highest nonzero limb
+        bits = 0;
+        for (i = 0; i < n; i++) {
+            mp_size_t l;
+            mp_limb_t top;
+
+            l = weights[i]->fp->psize;
+            while ((l > 0) && (weights[i]->i->_mp_d[l - 1] == 0)) l--;
+            if (l == 0) continue;
+            top = weights[i]->i->_mp_d[l - 1];
+            wbits = (l - 1) * GMP_NUMB_BITS;
+            while (top != 0) {
+                top >>= 1;
+                wbits++;
+            }
+            if (wbits > bits) {
+                bits = wbits;
+            }
+        }
+        c = _mpECElgamal_sum_window(n);
+        nb = (1 << c) - 1;
+        bC = (mpECP_t *)malloc(nb * sizeof(mpECP_t));
+        bD = (mpECP_t *)malloc(nb * sizeof(mpECP_t));
+        mpECScratch_init(scr, ((2 * nb) + 6) * 3 * cvp->fp->p2size);
+        for (b = 0; b < nb; b++) {
+            mpECP_init_scratch(bC[b], cvp, scr);
+            mpECP_init_scratch(bD[b], cvp, scr);
+        }
+        mpECP_init_scratch(accC, cvp, scr);
+        mpECP_init_scratch(accD, cvp, scr);
+        mpECP_init_scratch(runC, cvp, scr);
+        mpECP_init_scratch(runD, cvp, scr);
+        mpECP_init_scratch(winC, cvp, scr);
+        mpECP_init_scratch(winD, cvp, scr);
+        mpECP_set_neutral(accC, cvp);
+        mpECP_set_neutral(accD, cvp);
+
+        for (w = (int)((bits + c - 1) / c) - 1; w >= 0; w--) {
+            for (j = 0; j < c; j++) {
+                mpECP_double(accC, accC);
+                mpECP_double(accD, accD);
+            }
+            for (b = 0; b < nb; b++) {
+                mpECP_set_neutral(bC[b], cvp);
+                mpECP_set_neutral(bD[b], cvp);
+            }
+            for (i = 0; i < n; i++) {
+                int digit;
+
+                digit = 0;
+                for (j = c - 1; j >= 0; j--) {
+                    digit = (digit << 1) | mpz_tstbit(weights[i]->i, (w * c) + j);
+                }
+                if (digit == 0) continue;
+                mpECP_add(bC[digit - 1], bC[digit - 1], ctxts[i]->C);
+                mpECP_add(bD[digit - 1], bD[digit - 1], ctxts[i]->D);
+            }
+            mpECP_set_neutral(runC, cvp);
+            mpECP_set_neutral(runD, cvp);
+            mpECP_set_neutral(winC, cvp);
+            mpECP_set_neutral(winD, cvp);
+            for (b = nb - 1; b >= 0; b--) {
+                mpECP_add(runC, runC, bC[b]);
+                mpECP_add(runD, runD, bD[b]);
+                mpECP_add(winC, winC, runC);
+                mpECP_add(winD, winD, runD);
+            }
+            mpECP_add(accC, accC, winC);
+            mpECP_add(accD, accD, winD);
+        }
+        free(bD);
+        free(bC);
+    }
+    mpECP_set(rop->C, accC);
+    mpECP_set(rop->D, accD);
+    mpECScratch_clear(scr);
+    return 0;
+}
+
+int mpECElgamalEncryptor_init(mpECElgamalEncryptor_t enc, mpECP_t pK) {
+    if (__GMP_UNLIKELY(pK->is_neutral != 0)) {
+        return -1;
+    }
+    enc->cvp = pK->cvp;
+    mpECP_init(enc->cv_G, pK->cvp);
+    mpECP_set_mpz(enc->cv_G, pK->cvp->G[0], pK->cvp->G[1], pK->cvp);
+    mpECP_scalar_base_mul_setup(enc->cv_G);
+    mpECP_init(enc->pK, pK->cvp);
+    mpECP_set(enc->pK, pK);
+    mpECP_scalar_base_mul_setup(enc->pK);
+    return 0;
+}
+
+void mpECElgamalEncryptor_clear(mpECElgamalEncryptor_t enc) {
+    mpECP_clear(enc->pK);
+    mpECP_clear(enc->cv_G);
+    enc->cvp = NULL;
+    return;
+}
+
+int mpECElgamalEncryptor_init_encrypt(mpECElgamalCiphertext_t ctxt, mpECElgamalEncryptor_t enc, mpECP_t ptxt) {
+    mpFp_t k;
+    if (mpECurve_cmp(enc->cvp, ptxt->cvp) != 0) {
+        return -1;
+    }
+    mpECP_init(ctxt->C, enc->cvp);
+    mpECP_init(ctxt->D, enc->cvp);
+    mpFp_init(k, enc->cvp->n);
+
+    do {
+        mpFp_urandom(k, enc->cvp->n);
+    } while (mpFp_cmp_ui(k, 0) == 0);
+
+    mpECP_scalar_base_mul(ctxt->C, enc->cv_G, k);
+    mpECP_scalar_base_mul(ctxt->D, enc->pK, k);
+    mpECP_add(ctxt->D, ctxt->D, ptxt);
+
+    mpFp_clear(k);
+    return 0;
+}
+
+int mpECElgamal_rerandomize(mpECElgamalCiphertext_t ctxt, mpECElgamalEncryptor_t enc) {
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPEC_SCRATCH_LIMBS + (_MPFP_MAX_LIMBS * 7)];
+    mpFp_t k;
+    mpECP_t kG, kpK;
+
+    if ((mpECurve_cmp(enc->cvp, ctxt->C->cvp) != 0) ||
+        (mpECurve_cmp(enc->cvp, ctxt->D->cvp) != 0)) {
+        return -1;
+    }
+    mpECScratch_init_buffer(scr, scrl, _MPEC_SCRATCH_LIMBS + (_MPFP_MAX_LIMBS * 7));
+    mpFp_init_scratch(k, _mpFp_field_lookup(enc->cvp->n), scr);
+    mpECP_init_scratch(kG, enc->cvp, scr);
+    mpECP_init_scratch(kpK, enc->cvp, scr);
+
+    do {
+        mpFp_urandom(k, enc->cvp->n);
+    } while (mpFp_cmp_ui(k, 0) == 0);
+
+    mpECP_scalar_base_mul_scratch(kG, enc->cv_G, k, scr);
+    mpECP_scalar_base_mul_scratch(kpK, enc->pK, k, scr);
+    mpECP_add(ctxt->C, ctxt->C, kG);
+    mpECP_add(ctxt->D, ctxt->D, kpK);
+
+    mpECScratch_clear(scr);
+    return 0;
+}
+
+int mpECElgamal_rerandomize_batch(mpECElgamalCiphertext_ptr *ctxts, mpECElgamalEncryptor_t enc, size_t n) {
+    mpECScratch_t scr;
+    mpFp_t k;
+    mpECP_t kG, kpK;
+    mpECP_ptr pts[2 * _MPECELGAMAL_BATCH_CHUNK];
+    mpFp_field_ptr fn;
+    size_t base, i, j, cnt;
+
+    for (i = 0; i < n; i++) {
+        if ((mpECurve_cmp(enc->cvp, ctxts[i]->C->cvp) != 0) ||
+            (mpECurve_cmp(enc->cvp, ctxts[i]->D->cvp) != 0)) {
+            return -1;
+        }
+    }
+    fn = _mpFp_field_lookup(enc->cvp->n);
+    mpECScratch_init(scr, fn->p2size + (6 * enc->cvp->fp->p2size) + _MPEC_SCRATCH_LIMBS);
+    mpFp_init_scratch(k, fn, scr);
+    mpECP_init_scratch(kG, enc->cvp, scr);
+    mpECP_init_scratch(kpK, enc->cvp, scr);
+
+    for (base = 0; base < n; base += _MPECELGAMAL_BATCH_CHUNK) {
+        cnt = n - base;
+        if (cnt > _MPECELGAMAL_BATCH_CHUNK) cnt = _MPECELGAMAL_BATCH_CHUNK;
+        for (j = 0; j < cnt; j++) {
+            mpECElgamalCiphertext_ptr ctxt;
+
+            ctxt = ctxts[base + j];
+            do {
+                mpFp_urandom(k, enc->cvp->n);
+            } while (mpFp_cmp_ui(k, 0) == 0);
+            mpECP_scalar_base_mul_scratch(kG, enc->cv_G, k, scr);
+            mpECP_scalar_base_mul_scratch(kpK, enc->pK, k, scr);
+            mpECP_add(ctxt->C, ctxt->C, kG);
+            mpECP_add(ctxt->D, ctxt->D, kpK);
+            pts[2 * j] = ctxt->C;
+            pts[(2 * j) + 1] = ctxt->D;
+        }
+        mpECP_normalize_batch(pts, 2 * cnt);
+    }
+    mpECScratch_clear(scr);
+    return 0;
+}
+
+int mpECElgamal_encrypt_batch(mpECElgamalCiphertext_ptr *ctxts, mpECElgamalEncryptor_t enc, mpECP_ptr *ptxts, size_t n) {
+    mpECScratch_t scr;
+    mpFp_t k[_MPECELGAMAL_BATCH_CHUNK];
+    mpECP_ptr pts[2 * _MPECELGAMAL_BATCH_CHUNK];
+    mpFp_field_ptr fn;
+    size_t base, i, j, cnt;
+
+    for (i = 0; i < n; i++) {
+        if (mpECurve_cmp(enc->cvp, ptxts[i]->cvp) != 0) {
+            return -1;
+        }
+    }
+    fn = _mpFp_field_lookup(enc->cvp->n);
+    mpECScratch_init(scr, (_MPECELGAMAL_BATCH_CHUNK * fn->p2size) + _MPEC_SCRATCH_LIMBS);
+    for (j = 0; j < _MPECELGAMAL_BATCH_CHUNK; j++) {
+        mpFp_init_scratch(k[j], fn, scr);
+    }
+
+    for (base = 0; base < n; base += _MPECELGAMAL_BATCH_CHUNK) {
+        cnt = n - base;
+        if (cnt > _MPECELGAMAL_BATCH_CHUNK) cnt = _MPECELGAMAL_BATCH_CHUNK;
+        // nonces for the chunk
+        for (j = 0; j < cnt; j++) {
+            do {
+                mpFp_urandom(k[j], enc->cvp->n);
+            } while (mpFp_cmp_ui(k[j], 0) == 0);
+        }
+        for (j = 0; j < cnt; j++) {
+            mpECElgamalCiphertext_ptr ctxt;
+
+            ctxt = ctxts[base + j];
+            mpECP_init(ctxt->C, enc->cvp);
+            mpECP_init(ctxt->D, enc->cvp);
+            mpECP_scalar_base_mul_scratch(ctxt->C, enc->cv_G, k[j], scr);
+            mpECP_scalar_base_mul_scratch(ctxt->D, enc->pK, k[j], scr);
+            mpECP_add(ctxt->D, ctxt->D, ptxts[base + j]);
+            pts[2 * j] = ctxt->C;
+            pts[(2 * j) + 1] = ctxt->D;
+        }
+        mpECP_normalize_batch(pts, 2 * cnt);
+    }
+    mpECScratch_clear(scr);
+    return 0;
+}
+
+int mpECElgamal_decrypt_batch(mpECP_ptr *ptxts, mpFp_t sK, mpECElgamalCiphertext_ptr *ctxts, size_t n) {
+    mpECP_ptr C[_MPECELGAMAL_BATCH_CHUNK];
+    size_t base, i, j, cnt;
+
+    for (i = 0; i < n; i++) {
+        assert(ctxts[i]->C->cvp == ctxts[i]->D->cvp);
+        if (mpz_cmp(sK->fp->p, ctxts[i]->C->cvp->n) != 0) {
+            return -1;
+        }
+    }
+
+    for (base = 0; base < n; base += _MPECELGAMAL_BATCH_CHUNK) {
+        cnt = n - base;
+        if (cnt > _MPECELGAMAL_BATCH_CHUNK) cnt = _MPECELGAMAL_BATCH_CHUNK;
+        for (j = 0; j < cnt; j++) {
+            mpECP_init(ptxts[base + j], ctxts[base + j]->C->cvp);
+            C[j] = ctxts[base + j]->C;
+        }
+        // ptxt = D - sK * C
+        mpECP_scalar_mul_batch(&ptxts[base], C, sK, cnt);
+        for (j = 0; j < cnt; j++) {
+            mpECP_neg(ptxts[base + j], ptxts[base + j]);
+            mpECP_add(ptxts[base + j], ptxts[base + j], ctxts[base + j]->D);
+        }
+        mpECP_normalize_batch(&ptxts[base], cnt);
+    }
+    return 0;
+}
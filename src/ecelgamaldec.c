@@ -0,0 +1,456 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecc/ecelgamal.h>
+#include <ecc/ecelgamaldec.h>
+#include <ecc/ecpoint.h>
+#include <ecc/ecurve.h>
+#include <ecc/field.h>
+#include <fcntl.h>
+#include <gmp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// points added (and normalized with one inversion) per chunk
+#define _MPECELGAMAL_DECODE_CHUNK   (64)
+
+#define _MPECELGAMAL_DECODE_MAGIC   "ECBSGS01"
+
+typedef struct {
+    char magic[8];
+    uint64_t baby;
+    uint64_t slots;
+    uint64_t bits;      // curve bits
+    uint64_t gkey;      // key of G, identifies the curve (with gval)
+    uint64_t gval;
+} _mpECElgamalDecoder_header_t;
+
+// key is 64 bits of the coordinate that P and -P share, the parity of the
+// other coordinate distinguishes P from -P. pt must be affine.
+static inline void _mpECElgamalDecoder_key(uint64_t *key, int *parity, mpECP_t pt) {
+    mpFp_ptr k, s;
+
+    if ((pt->cvp->type == EQTypeEdwards) || (pt->cvp->type == EQTypeTwistedEdwards)) {
+        k = pt->y;
+        s = pt->x;
+    } else {
+        k = pt->x;
+        s = pt->y;
+    }
+    *key = (uint64_t)k->i->_mp_d[0];
+#if GMP_NUMB_BITS < 64
+    if (k->fp->psize > 1) {
+        *key |= ((uint64_t)k->i->_mp_d[1]) << GMP_NUMB_BITS;
+    }
+#endif
+    *parity = (int)(s->i->_mp_d[0] & 1);
+    return;
+}
+
+// pt must be affine (or neutral)
+static inline int _mpECElgamalDecoder_is_neutral(mpECP_t pt) {
+    if (pt->is_neutral != 0) return 1;
+    if ((pt->cvp->type == EQTypeEdwards) || (pt->cvp->type == EQTypeTwistedEdwards)) {
+        return (mpFp_cmp_ui(pt->x, 0) == 0) && (mpFp_cmp_ui(pt->y, 1) == 0);
+    }
+    return 0;
+}
+
+static void _mpECElgamalDecoder_insert(mpECElgamalDecoder_t dec, uint64_t key, uint64_t val) {
+    uint64_t slot;
+
+    // x (y) coordinates are uniformly distributed, so the low bits of the
+    // key serve as the hash
+    slot = key & dec->mask;
+    while (dec->table[slot].val != 0) {
+        slot = (slot + 1) & dec->mask;
+    }
+    dec->table[slot].key = key;
+    dec->table[slot].val = val;
+    return;
+}
+
+static int _mpECElgamalDecoder_setup(mpECElgamalDecoder_t dec, mpECurve_t cv, uint64_t range) {
+    if (range == 0) return -1;
+    if (mpz_cmp_ui(cv->n, range) < 0) return -1;
+    dec->cvp = (mpECurve_ptr)cv;
+    dec->range = range;
+    dec->nthreads = 1;
+    dec->table = NULL;
+    dec->map = NULL;
+    dec->maplen = 0;
+    mpECP_init(dec->cv_G, cv);
+    mpECP_set_mpz(dec->cv_G, cv->G[0], cv->G[1], cv);
+    mpECP_scalar_base_mul_setup(dec->cv_G);
+    return 0;
+}
+
+int mpECElgamalDecoder_init(mpECElgamalDecoder_t dec, mpECurve_t cv, uint64_t range, uint64_t baby) {
+    mpECScratch_t scr;
+    mpECP_t Q[_MPECELGAMAL_DECODE_CHUNK];
+    mpECP_ptr pts[_MPECELGAMAL_DECODE_CHUNK];
+    uint64_t slots, j;
+    int k, cnt;
+
+    if (baby == 0) {
+        mpz_t r;
+
+        // ~ sqrt(range) / 2, each entry covers +/- j
+        mpz_init(r);
+        mpz_set_ui(r, range);
+        mpz_sqrt(r, r);
+        baby = (mpz_get_ui(r) + 1) >> 1;
+        if (baby == 0) baby = 1;
+        mpz_clear(r);
+    }
+    if (baby > (UINT64_C(1) << 40)) return -1;
+    if (_mpECElgamalDecoder_setup(dec, cv, range) != 0) return -1;
+
+    // power of 2 slots, load factor <= 1/2
+    slots = 1;
+    while (slots < (baby << 1)) slots <<= 1;
+    dec->baby = baby;
+    dec->mask = slots - 1;
+    dec->table = (_mpECElgamalDecoder_entry_t *)calloc(slots, sizeof(_mpECElgamalDecoder_entry_t));
+    assert(dec->table != NULL);
+
+    mpECScratch_init(scr, _MPECELGAMAL_DECODE_CHUNK * 3 * cv->fp->p2size);
+    for (k = 0; k < _MPECELGAMAL_DECODE_CHUNK; k++) {
+        mpECP_init_scratch(Q[k], cv, scr);
+        pts[k] = Q[k];
+    }
+    // j * G for j in [1, baby]
+    for (j = 1; j <= baby; j += cnt) {
+        cnt = _MPECELGAMAL_DECODE_CHUNK;
+        if ((baby - j + 1) < (uint64_t)cnt) cnt = (int)(baby - j + 1);
+        for (k = 0; k < cnt; k++) {
+            if (k > 0) {
+                mpECP_add(Q[k], Q[k - 1], dec->cv_G);
+            } else if (j > 1) {
+                mpECP_add(Q[0], Q[_MPECELGAMAL_DECODE_CHUNK - 1], dec->cv_G);
+            } else {
+                mpECP_set(Q[0], dec->cv_G);
+            }
+        }
+        mpECP_normalize_batch(pts, cnt);
+        for (k = 0; k < cnt; k++) {
+            uint64_t key;
+            int parity;
+
+            _mpECElgamalDecoder_key(&key, &parity, Q[k]);
+            _mpECElgamalDecoder_insert(dec, key, ((j + k) << 1) | parity);
+        }
+    }
+    mpECScratch_clear(scr);
+    return 0;
+}
+
+static void _mpECElgamalDecoder_header(_mpECElgamalDecoder_header_t *h, mpECElgamalDecoder_t dec) {
+    mpECP_t G;
+    int parity;
+
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, _MPECELGAMAL_DECODE_MAGIC, 8);
+    h->baby = dec->baby;
+    h->slots = dec->mask + 1;
+    h->bits = dec->cvp->bits;
+    mpECP_init(G, dec->cvp);
+    mpECP_set_mpz(G, dec->cvp->G[0], dec->cvp->G[1], dec->cvp);
+    _mpECElgamalDecoder_key(&(h->gkey), &parity, G);
+    h->gval = (1 << 1) | parity;
+    mpECP_clear(G);
+    return;
+}
+
+int mpECElgamalDecoder_save(mpECElgamalDecoder_t dec, char *path) {
+    _mpECElgamalDecoder_header_t h;
+    FILE *f;
+    size_t slots;
+    int status;
+
+    _mpECElgamalDecoder_header(&h, dec);
+    slots = dec->mask + 1;
+    f = fopen(path, "wb");
+    if (f == NULL) return -1;
+    status = 0;
+    if (fwrite(&h, sizeof(h), 1, f) != 1) status = -1;
+    if ((status == 0) && (fwrite(dec->table, sizeof(_mpECElgamalDecoder_entry_t), slots, f) != slots)) status = -1;
+    if (fclose(f) != 0) status = -1;
+    return status;
+}
+
+int mpECElgamalDecoder_init_file(mpECElgamalDecoder_t dec, mpECurve_t cv, char *path, uint64_t range) {
+    _mpECElgamalDecoder_header_t h, *fh;
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(h))) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    fh = (_mpECElgamalDecoder_header_t *)map;
+    // the table contents are not trusted beyond this: baby steps must fit
+    // in the table, the size must not overflow and every probe is bounded
+    if ((memcmp(fh->magic, _MPECELGAMAL_DECODE_MAGIC, 8) != 0) ||
+        (fh->baby == 0) || (fh->slots == 0) ||
+        ((fh->slots & (fh->slots - 1)) != 0) ||
+        (fh->baby >= fh->slots) ||
+        (fh->slots > ((SIZE_MAX - sizeof(h)) / sizeof(_mpECElgamalDecoder_entry_t))) ||
+        ((size_t)st.st_size != (sizeof(h) + (fh->slots * sizeof(_mpECElgamalDecoder_entry_t))))) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    if (_mpECElgamalDecoder_setup(dec, cv, range) != 0) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    dec->baby = fh->baby;
+    dec->mask = fh->slots - 1;
+    _mpECElgamalDecoder_header(&h, dec);
+    if ((h.bits != fh->bits) || (h.gkey != fh->gkey) || (h.gval != fh->gval)) {
+        munmap(map, (size_t)st.st_size);
+        mpECP_clear(dec->cv_G);
+        return -1;
+    }
+    dec->map = map;
+    dec->maplen = (size_t)st.st_size;
+    dec->table = (_mpECElgamalDecoder_entry_t *)(((unsigned char *)map) + sizeof(h));
+    return 0;
+}
+
+void mpECElgamalDecoder_clear(mpECElgamalDecoder_t dec) {
+    if (dec->map != NULL) {
+        munmap(dec->map, dec->maplen);
+    } else {
+        free(dec->table);
+    }
+    dec->map = NULL;
+    dec->maplen = 0;
+    dec->table = NULL;
+    mpECP_clear(dec->cv_G);
+    dec->cvp = NULL;
+    return;
+}
+
+void mpECElgamalDecoder_set_threads(mpECElgamalDecoder_t dec, int nthreads) {
+    assert(nthreads > 0);
+    dec->nthreads = nthreads;
+    return;
+}
+
+typedef struct {
+    mpECElgamalDecoder_ptr dec;
+    mpECP_ptr pt;
+    uint64_t first;         // giant steps [first, last)
+    uint64_t last;
+    int *found;             // set once under lock, polled lock-free
+    uint64_t *m;
+    pthread_mutex_t *lock;
+} _mpECElgamalDecoder_job_t;
+
+// candidate m, verify m * G == P and publish
+static void _mpECElgamalDecoder_check(_mpECElgamalDecoder_job_t *job, mpECP_t P, mpECP_t T, uint64_t m) {
+    mpz_t mz;
+
+    if (m >= job->dec->range) return;
+    mpz_init(mz);
+    mpz_set_ui(mz, m);
+    mpECP_scalar_base_mul_mpz(T, job->dec->cv_G, mz);
+    mpz_clear(mz);
+    if (mpECP_cmp(T, P) != 0) return;
+    pthread_mutex_lock(job->lock);
+    if (__atomic_load_n(job->found, __ATOMIC_ACQUIRE) == 0) {
+        *(job->m) = m;
+        __atomic_store_n(job->found, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(job->lock);
+    return;
+}
+
+// Q_i = P - (i * (2 * baby + 1) + baby) * G for i in [first, last), any
+// match Q_i = +/- j * G gives m = i * (2 * baby + 1) + baby +/- j
+static void *_mpECElgamalDecoder_search(void *arg) {
+    _mpECElgamalDecoder_job_t *job;
+    mpECElgamalDecoder_ptr dec;
+    mpECurve_ptr cvp;
+    mpECScratch_t scr;
+    mpECP_t Q[_MPECELGAMAL_DECODE_CHUNK];
+    mpECP_ptr pts[_MPECELGAMAL_DECODE_CHUNK];
+    mpECP_t P, S, T;
+    mpz_t c;
+    uint64_t stride, i;
+    int k, cnt;
+
+    job = (_mpECElgamalDecoder_job_t *)arg;
+    dec = job->dec;
+    cvp = dec->cvp;
+    stride = (dec->baby << 1) + 1;
+
+    mpECScratch_init(scr, (_MPECELGAMAL_DECODE_CHUNK + 3) * 3 * cvp->fp->p2size);
+    for (k = 0; k < _MPECELGAMAL_DECODE_CHUNK; k++) {
+        mpECP_init_scratch(Q[k], cvp, scr);
+        pts[k] = Q[k];
+    }
+    mpECP_init_scratch(P, cvp, scr);
+    mpECP_init_scratch(S, cvp, scr);
+    mpECP_init_scratch(T, cvp, scr);
+    mpECP_set(P, job->pt);
+    mpz_init(c);
+    // S = -stride * G, T = P - (first * stride + baby) * G
+    mpz_set_ui(c, stride);
+    mpECP_scalar_base_mul_mpz(S, dec->cv_G, c);
+    mpECP_neg(S, S);
+    mpz_set_ui(c, job->first);
+    mpz_mul_ui(c, c, stride);
+    mpz_add_ui(c, c, dec->baby);
+    mpz_mod(c, c, cvp->n);
+    mpECP_scalar_base_mul_mpz(T, dec->cv_G, c);
+    mpECP_sub(T, P, T);
+    mpz_clear(c);
+
+    for (i = job->first; i < job->last; i += cnt) {
+        if (__atomic_load_n(job->found, __ATOMIC_ACQUIRE) != 0) break;
+        cnt = _MPECELGAMAL_DECODE_CHUNK;
+        if ((job->last - i) < (uint64_t)cnt) cnt = (int)(job->last - i);
+        mpECP_set(Q[0], T);
+        for (k = 1; k < cnt; k++) {
+            mpECP_add(Q[k], Q[k - 1], S);
+        }
+        mpECP_add(T, Q[cnt - 1], S);
+        mpECP_normalize_batch(pts, cnt);
+        for (k = 0; k < cnt; k++) {
+            uint64_t center, key, slot, probe;
+            int parity;
+
+            center = ((i + k) * stride) + dec->baby;
+            if (__GMP_UNLIKELY(_mpECElgamalDecoder_is_neutral(Q[k]))) {
+                _mpECElgamalDecoder_check(job, P, Q[k], center);
+                continue;
+            }
+            _mpECElgamalDecoder_key(&key, &parity, Q[k]);
+            slot = key & dec->mask;
+            // a well formed table always has an empty slot, a corrupt
+            // (mapped) one may not, so the probe sequence is bounded
+            for (probe = 0; (probe <= dec->mask) && (dec->table[slot].val != 0); probe++) {
+                if (__GMP_UNLIKELY(dec->table[slot].key == key)) {
+                    uint64_t j, val;
+
+                    val = dec->table[slot].val;
+                    j = val >> 1;
+                    if ((int)(val & 1) == parity) {
+                        _mpECElgamalDecoder_check(job, P, Q[k], center + j);
+                    } else {
+                        _mpECElgamalDecoder_check(job, P, Q[k], center - j);
+                    }
+                }
+                slot = (slot + 1) & dec->mask;
+            }
+        }
+    }
+    mpECScratch_clear(scr);
+    return NULL;
+}
+
+int mpECElgamalDecoder_decode(uint64_t *m, mpECElgamalDecoder_t dec, mpECP_t ptxt) {
+    _mpECElgamalDecoder_job_t job[1];
+    pthread_mutex_t lock;
+    int found;
+    uint64_t giant;
+    int nt, t;
+
+    if (mpECurve_cmp(dec->cvp, ptxt->cvp) != 0) return -1;
+    giant = (dec->range + (dec->baby << 1)) / ((dec->baby << 1) + 1);
+    nt = dec->nthreads;
+    if ((giant / _MPECELGAMAL_DECODE_THREAD_MIN) < (uint64_t)nt) {
+        nt = (int)(giant / _MPECELGAMAL_DECODE_THREAD_MIN);
+        if (nt < 1) nt = 1;
+    }
+    found = 0;
+    pthread_mutex_init(&lock, NULL);
+    job->dec = dec;
+    job->pt = ptxt;
+    job->found = &found;
+    job->m = m;
+    job->lock = &lock;
+    if (nt == 1) {
+        job->first = 0;
+        job->last = giant;
+        _mpECElgamalDecoder_search(job);
+    } else {
+        _mpECElgamalDecoder_job_t *jobs;
+        pthread_t *tid;
+
+        jobs = (_mpECElgamalDecoder_job_t *)malloc(nt * sizeof(_mpECElgamalDecoder_job_t));
+        tid = (pthread_t *)malloc(nt * sizeof(pthread_t));
+        assert((jobs != NULL) && (tid != NULL));
+        for (t = 0; t < nt; t++) {
+            jobs[t] = job[0];
+            jobs[t].first = (giant * t) / nt;
+            jobs[t].last = (giant * (t + 1)) / nt;
+            if (pthread_create(&tid[t], NULL, _mpECElgamalDecoder_search, &jobs[t]) != 0) {
+                // fall back to searching in this thread
+                _mpECElgamalDecoder_search(&jobs[t]);
+                tid[t] = pthread_self();
+            }
+        }
+        for (t = 0; t < nt; t++) {
+            if (!pthread_equal(tid[t], pthread_self())) {
+                pthread_join(tid[t], NULL);
+            }
+        }
+        free(tid);
+        free(jobs);
+    }
+    pthread_mutex_destroy(&lock);
+    return (found != 0) ? 0 : -1;
+}
+
+int mpECElgamal_decrypt_decode(uint64_t *m, mpECElgamalDecoder_t dec, mpFp_t sK, mpECElgamalCiphertext_t ctxt) {
+    mpECP_t ptxt;
+    int status;
+
+    if (mpECElgamal_init_decrypt(ptxt, sK, ctxt) != 0) return -1;
+    status = mpECElgamalDecoder_decode(m, dec, ptxt);
+    mpECP_clear(ptxt);
+    return status;
+}
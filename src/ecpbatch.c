@@ -0,0 +1,356 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecc/ecpbatch.h>
+#include <ecc/ecpoint.h>
+#include <ecc/ecurve.h>
+#include <ecc/field.h>
+#include <ecc/fieldi.h>
+#include <ecc/fieldlanes.h>
+#include <ecc/scratch.h>
+#include <gmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+// point conversion to affine coordinates (ecpoint.c)
+void _mpECP_to_affine(mpECP_t pt);
+
+static inline mp_limb_t *_batch_limbs(mpECPBatch_t b) {
+    return b->x;
+}
+
+// gather/scatter a single interleaved coordinate
+static inline void _batch_get_mpFp(mpFp_t a, mp_limb_t *c, mpECPBatch_t b, size_t i) {
+    mp_size_t k;
+    for (k = 0; k < b->psize; k++) {
+        a->i->_mp_d[k] = c[(k * b->n) + i];
+    }
+    a->i->_mp_size = b->psize;
+    a->fp = b->cvp->fp;
+}
+
+static inline void _batch_set_mpFp(mp_limb_t *c, mpECPBatch_t b, size_t i, mpFp_t a) {
+    mp_size_t k;
+    assert(a->i->_mp_size == b->psize);
+    for (k = 0; k < b->psize; k++) {
+        c[(k * b->n) + i] = a->i->_mp_d[k];
+    }
+}
+
+static inline void _batch_get_mpFpi(mpFpi_t a, mp_limb_t *c, mpECPBatch_t b, size_t i) {
+    mp_size_t k;
+    for (k = 0; k < b->psize; k++) {
+        a->d[k] = c[(k * b->n) + i];
+    }
+    a->fp = b->cvp->fp;
+}
+
+static inline void _batch_set_mpFpi(mp_limb_t *c, mpECPBatch_t b, size_t i, mpFpi_t a) {
+    mp_size_t k;
+    for (k = 0; k < b->psize; k++) {
+        c[(k * b->n) + i] = a->d[k];
+    }
+}
+
+static inline int _batch_z_is_one(mpECPBatch_t b, size_t i) {
+    mp_size_t k;
+    int cmp;
+    cmp = (b->z[i] != 1);
+    for (k = 1; k < b->psize; k++) {
+        cmp |= (b->z[(k * b->n) + i] != 0);
+    }
+    return (cmp == 0);
+}
+
+void mpECPBatch_init(mpECPBatch_t b, size_t n, mpECurve_t cv) {
+    mpECP_t neutral;
+    size_t i, nlimbs;
+    assert(n > 0);
+    b->n = n;
+    b->psize = cv->fp->psize;
+    b->cvp = cv;
+    nlimbs = n * b->psize;
+    // one contiguous block for all three coordinates
+    b->x = (mp_limb_t *)malloc(3 * nlimbs * sizeof(mp_limb_t));
+    assert(b->x != NULL);
+    b->y = &(b->x[nlimbs]);
+    b->z = &(b->x[2 * nlimbs]);
+    b->is_neutral = (int *)malloc(n * sizeof(int));
+    assert(b->is_neutral != NULL);
+
+    mpECP_init(neutral, cv);
+    mpECP_set_neutral(neutral, cv);
+    for (i = 0; i < n; i++) {
+        mpECPBatch_set_mpECP(b, i, neutral);
+    }
+    mpECP_clear(neutral);
+    return;
+}
+
+void mpECPBatch_clear(mpECPBatch_t b) {
+#ifdef  SAFE_CLEAN
+    memset((void *)_batch_limbs(b), 0, 3 * b->n * b->psize * sizeof(mp_limb_t));
+    memset((void *)b->is_neutral, 0, b->n * sizeof(int));
+#endif
+    free(_batch_limbs(b));
+    free(b->is_neutral);
+    b->x = NULL;
+    b->y = NULL;
+    b->z = NULL;
+    b->is_neutral = NULL;
+    b->n = 0;
+    b->cvp = NULL;
+    return;
+}
+
+void mpECPBatch_set(mpECPBatch_t rb, mpECPBatch_t b) {
+    assert(rb->n == b->n);
+    assert(mpECurve_cmp(rb->cvp, b->cvp) == 0);
+    if (rb == b) return;
+    memcpy(_batch_limbs(rb), _batch_limbs(b), 3 * b->n * b->psize * sizeof(mp_limb_t));
+    memcpy(rb->is_neutral, b->is_neutral, b->n * sizeof(int));
+    return;
+}
+
+void mpECPBatch_set_mpECP(mpECPBatch_t rb, size_t i, mpECP_t pt) {
+    assert(i < rb->n);
+    assert(mpECurve_cmp(rb->cvp, pt->cvp) == 0);
+    _batch_set_mpFp(rb->x, rb, i, pt->x);
+    _batch_set_mpFp(rb->y, rb, i, pt->y);
+    _batch_set_mpFp(rb->z, rb, i, pt->z);
+    rb->is_neutral[i] = pt->is_neutral;
+    return;
+}
+
+void mpECP_set_mpECPBatch(mpECP_t rpt, mpECPBatch_t b, size_t i) {
+    assert(i < b->n);
+    // establish curve and release any base point table
+    mpECP_set_neutral(rpt, b->cvp);
+    _batch_get_mpFp(rpt->x, b->x, b, i);
+    _batch_get_mpFp(rpt->y, b->y, b, i);
+    _batch_get_mpFp(rpt->z, b->z, b, i);
+    rpt->is_neutral = b->is_neutral[i];
+    return;
+}
+
+void mpECPBatch_add(mpECPBatch_t rb, mpECPBatch_t b1, mpECPBatch_t b2) {
+    mpECP_t p1, p2;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 6];
+    size_t i;
+    assert(rb->n == b1->n);
+    assert(rb->n == b2->n);
+    assert(mpECurve_cmp(b1->cvp, b2->cvp) == 0);
+    assert(mpECurve_cmp(rb->cvp, b1->cvp) == 0);
+
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 6);
+    mpECP_init_scratch(p1, rb->cvp, scr);
+    mpECP_init_scratch(p2, rb->cvp, scr);
+    for (i = 0; i < rb->n; i++) {
+        mpECP_set_mpECPBatch(p1, b1, i);
+        mpECP_set_mpECPBatch(p2, b2, i);
+        mpECP_add(p1, p1, p2);
+        mpECPBatch_set_mpECP(rb, i, p1);
+    }
+    mpECScratch_clear(scr);
+    return;
+}
+
+void mpECPBatch_double(mpECPBatch_t rb, mpECPBatch_t b) {
+    mpECP_t p1;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 3];
+    size_t i;
+    assert(rb->n == b->n);
+    assert(mpECurve_cmp(rb->cvp, b->cvp) == 0);
+
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 3);
+    mpECP_init_scratch(p1, rb->cvp, scr);
+    for (i = 0; i < rb->n; i++) {
+        mpECP_set_mpECPBatch(p1, b, i);
+        mpECP_double(p1, p1);
+        mpECPBatch_set_mpECP(rb, i, p1);
+    }
+    mpECScratch_clear(scr);
+    return;
+}
+
+#ifdef _MPECP_USE_RCB
+void mpECPBatch_normalize(mpECPBatch_t b) {
+    // Montgomery's simultaneous inversion: with a[j] = z[0] * ... * z[j],
+    // a single inverse of a[m-1] yields every z[j]**-1 at the cost of three
+    // multiplications per point. The final scaling of x and y is done for
+    // all lanes at once (with zinv = 1 for points which are already affine)
+    mpFpi_ptr acc;
+    mpFpi_t inv, zinv, t;
+    mp_limb_t *zl;
+    size_t *idx;
+    size_t i, j, m;
+
+    idx = (size_t *)malloc(b->n * sizeof(size_t));
+    assert(idx != NULL);
+    m = 0;
+    for (i = 0; i < b->n; i++) {
+        if ((b->is_neutral[i] == 0) && (_batch_z_is_one(b, i) == 0)) {
+            idx[m] = i;
+            m += 1;
+        }
+    }
+    if (m == 0) {
+        free(idx);
+        return;
+    }
+    acc = (mpFpi_ptr)malloc(m * sizeof(_mpFpi_struct));
+    assert(acc != NULL);
+    zl = (mp_limb_t *)malloc(b->n * b->psize * sizeof(mp_limb_t));
+    assert(zl != NULL);
+
+    mpFpi_init_fp(t, b->cvp->fp);
+    _batch_get_mpFpi(&(acc[0]), b->z, b, idx[0]);
+    for (j = 1; j < m; j++) {
+        _batch_get_mpFpi(t, b->z, b, idx[j]);
+        mpFpi_mul(&(acc[j]), &(acc[j - 1]), t);
+    }
+    // projective z of a point (not neutral) is never zero
+    mpFpi_init_fp(inv, b->cvp->fp);
+    mpFpi_init_fp(zinv, b->cvp->fp);
+    j = mpFpi_inv(inv, &(acc[m - 1]));
+    assert(j == 0);
+
+    mpFpi_set_ui_fp(t, 1, b->cvp->fp);
+    for (i = 0; i < b->n; i++) {
+        _batch_set_mpFpi(zl, b, i, t);
+    }
+    for (j = m; j-- > 0; ) {
+        i = idx[j];
+        _batch_get_mpFpi(t, b->z, b, i);
+        if (j > 0) {
+            mpFpi_mul(zinv, inv, &(acc[j - 1]));
+            mpFpi_mul(inv, inv, t);
+        } else {
+            mpFpi_set(zinv, inv);
+        }
+        _batch_set_mpFpi(zl, b, i, zinv);
+    }
+
+    // Projective x = X/Z y = Y/Z, z = 1
+    mpFp_mul_lanes(b->x, b->x, zl, b->n, b->cvp->fp);
+    mpFp_mul_lanes(b->y, b->y, zl, b->n, b->cvp->fp);
+    mpFpi_set_ui_fp(t, 1, b->cvp->fp);
+    for (j = 0; j < m; j++) {
+        _batch_set_mpFpi(b->z, b, idx[j], t);
+    }
+
+#ifdef  SAFE_CLEAN
+    memset((void *)acc, 0, m * sizeof(_mpFpi_struct));
+    memset((void *)zl, 0, b->n * b->psize * sizeof(mp_limb_t));
+#endif
+    mpFpi_clear(zinv);
+    mpFpi_clear(inv);
+    mpFpi_clear(t);
+    free(zl);
+    free(acc);
+    free(idx);
+    return;
+}
+#else
+void mpECPBatch_normalize(mpECPBatch_t b) {
+    mpECP_t p1;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 3];
+    size_t i;
+
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 3);
+    mpECP_init_scratch(p1, b->cvp, scr);
+    for (i = 0; i < b->n; i++) {
+        mpECP_set_mpECPBatch(p1, b, i);
+        _mpECP_to_affine(p1);
+        mpECPBatch_set_mpECP(b, i, p1);
+    }
+    mpECScratch_clear(scr);
+    return;
+}
+#endif
+
+int  mpECPBatch_out_bytelen(mpECPBatch_t b, int compress) {
+    mpECP_t p1;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 3];
+    int bytes;
+
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 3);
+    mpECP_init_scratch(p1, b->cvp, scr);
+    bytes = mpECP_out_bytelen(p1, compress);
+    mpECScratch_clear(scr);
+    return bytes;
+}
+
+void mpECPBatch_out_bytes(unsigned char *s, mpECPBatch_t b, int compress) {
+    mpECP_t p1;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 3];
+    size_t i;
+    int bytes;
+
+    // normalizing first means the per point conversion needs no inversion
+    mpECPBatch_normalize(b);
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 3);
+    mpECP_init_scratch(p1, b->cvp, scr);
+    bytes = mpECP_out_bytelen(p1, compress);
+    for (i = 0; i < b->n; i++) {
+        mpECP_set_mpECPBatch(p1, b, i);
+        mpECP_out_bytes(&(s[i * bytes]), p1, compress);
+    }
+    mpECScratch_clear(scr);
+    return;
+}
+
+int  mpECPBatch_set_bytes(mpECPBatch_t rb, unsigned char *s, size_t length, mpECurve_t cv) {
+    mpECP_t p1;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 3];
+    size_t i;
+    int status;
+    assert(mpECurve_cmp(rb->cvp, cv) == 0);
+
+    status = 0;
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 3);
+    mpECP_init_scratch(p1, rb->cvp, scr);
+    for (i = 0; i < rb->n; i++) {
+        if (mpECP_set_bytes(p1, &(s[i * length]), length, rb->cvp) != 0) {
+            mpECP_set_neutral(p1, rb->cvp);
+            status = -1;
+        }
+        mpECPBatch_set_mpECP(rb, i, p1);
+    }
+    mpECScratch_clear(scr);
+    return status;
+}
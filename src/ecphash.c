@@ -0,0 +1,1011 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecc/ecdsa.h>
+#include <ecc/ecphash.h>
+#include <ecc/ecpoint.h>
+#include <ecc/ecurve.h>
+#include <ecc/field.h>
+#include <ecc/scratch.h>
+#include <gmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+// map constants (RFC 9380 section 6), per map:
+//   SSWU : c1 = -B / A, c2 = B / (Z * A)
+//   SVDW : c1 = g(Z), c2 = -Z / 2, c3 = sqrt(-g(Z) * (3 * Z^2 + 4 * A)),
+//          c4 = -4 * g(Z) / (3 * Z^2 + 4 * A)
+//   ELL2 : Montgomery curve K * t^2 = s^3 + J * s^2 + s, c1 = J / K,
+//          c2 = 1 / K^2, c4 = K and c3 scales v in the rational map to
+//          (twisted) Edwards form
+
+// hash = H(part[0] || ... || part[n-1]). The parts are fed through the
+// incremental interface where H has one, so msg is never copied, otherwise
+// they are concatenated on the heap (msg may be too large for the stack)
+static int _mpECP_hash_parts(unsigned char *hash, mpECDSAHashfunc_t H,
+    unsigned char **part, size_t *psz, int n) {
+    mpECDSAHashCtx_t hctx;
+    unsigned char *m;
+    size_t sz;
+    int i;
+
+    if (mpECDSAHashCtx_init(hctx, H) == 0) {
+        for (i = 0; i < n; i++) {
+            mpECDSAHashCtx_update(hctx, part[i], psz[i]);
+        }
+        mpECDSAHashCtx_final(hctx, hash);
+        mpECDSAHashCtx_clear(hctx);
+        return 0;
+    }
+    sz = 0;
+    for (i = 0; i < n; i++) {
+        sz += psz[i];
+    }
+    m = (unsigned char *)malloc(sz);
+    if (m == NULL) return -1;
+    sz = 0;
+    for (i = 0; i < n; i++) {
+        memcpy(m + sz, part[i], psz[i]);
+        sz += psz[i];
+    }
+    H->dohash(hash, m, sz);
+#ifdef SAFE_CLEAN
+    memset(m, 0, sz);
+#endif
+    free(m);
+    return 0;
+}
+
+int mpECP_expand_message_xmd(unsigned char *out, size_t len,
+    unsigned char *msg, size_t msz, unsigned char *dst, size_t dsz,
+    mpECDSAHashfunc_t H) {
+    size_t bsz, hsz, ell, i, j, n;
+
+    hsz = H->hsz;
+    // Z_pad is one input block of H (see mpECDSAHashfunc_set_blocksize)
+    bsz = H->blocksz;
+    if (bsz == 0) return -1;
+    ell = (len + hsz - 1) / hsz;
+    if ((ell > 255) || (len > 65535) || (dsz > 255)) return -1;
+    {
+        // msg_prime = Z_pad || msg || I2OSP(len, 2) || I2OSP(0, 1) || DST_prime
+        unsigned char zpad[bsz];
+        unsigned char lstr[3];
+        unsigned char dlen[1];
+        unsigned char *part[5];
+        size_t psz[5];
+        // b_i input = (b_0 XOR b_(i-1)) || I2OSP(i, 1) || DST_prime
+        unsigned char mi[hsz + 1 + dsz + 1];
+        unsigned char b0[hsz];
+        unsigned char bi[hsz];
+
+        memset(zpad, 0, bsz);
+        lstr[0] = (unsigned char)(len >> 8);
+        lstr[1] = (unsigned char)(len & 0xff);
+        lstr[2] = 0;
+        dlen[0] = (unsigned char)dsz;
+        part[0] = zpad;
+        psz[0] = bsz;
+        part[1] = msg;
+        psz[1] = msz;
+        part[2] = lstr;
+        psz[2] = 3;
+        part[3] = dst;
+        psz[3] = dsz;
+        part[4] = dlen;
+        psz[4] = 1;
+        if (_mpECP_hash_parts(b0, H, part, psz, 5) != 0) return -1;
+
+        memcpy(mi + hsz + 1, dst, dsz);
+        mi[hsz + 1 + dsz] = (unsigned char)dsz;
+        for (i = 1; i <= ell; i++) {
+            for (j = 0; j < hsz; j++) {
+                mi[j] = (i == 1) ? b0[j] : (b0[j] ^ bi[j]);
+            }
+            mi[hsz] = (unsigned char)i;
+            H->dohash(bi, mi, sizeof(mi));
+            n = len - ((i - 1) * hsz);
+            if (n > hsz) n = hsz;
+            memcpy(out + ((i - 1) * hsz), bi, n);
+        }
+#ifdef SAFE_CLEAN
+        memset(mi, 0, sizeof(mi));
+        memset(b0, 0, sizeof(b0));
+        memset(bi, 0, sizeof(bi));
+#endif
+    }
+    return 0;
+}
+
+static inline int _mpFp_sgn0(mpFp_t a) {
+    return mpFp_tstbit(a, 0);
+}
+
+// r = 1 / a, or 0 if a == 0. mpFp_inv_ct already writes 0 for a == 0, so
+// its return (which only flags that case) is not branched on
+static inline void _mpFp_inv0(mpFp_t r, mpFp_t a) {
+    (void)mpFp_inv_ct(r, a);
+    return;
+}
+
+// a = -a if c (t is a temporary)
+static inline void _mpFp_cneg(mpFp_t a, int c, mpFp_t t) {
+    mpFp_neg(t, a);
+    mpFp_cswap(a, t, c);
+    return;
+}
+
+// 1 if a == b, else 0 (without branching on the limbs)
+static inline int _mpFp_eq_ct(mpFp_t a, mpFp_t b) {
+    mp_limb_t d;
+    int i;
+
+    d = 0;
+    for (i = 0; i < a->fp->psize; i++) {
+        d |= a->i->_mp_d[i] ^ b->i->_mp_d[i];
+    }
+    return (int)(((d | (0 - d)) >> (GMP_LIMB_BITS - 1)) ^ 1);
+}
+
+// 1 if a == v (v is 0 or 1), else 0 (without branching on the limbs)
+static inline int _mpFp_eq_ui_ct(mpFp_t a, mp_limb_t v) {
+    mp_limb_t d;
+    int i;
+
+    d = a->i->_mp_d[0] ^ v;
+    for (i = 1; i < a->fp->psize; i++) {
+        d |= a->i->_mp_d[i];
+    }
+    return (int)(((d | (0 - d)) >> (GMP_LIMB_BITS - 1)) ^ 1);
+}
+
+// r = a^e with mpz_powm_sec (e is public, r may alias a)
+static void _mpFp_pow_sec(mpFp_t r, mpFp_t a, mpz_t e) {
+    mpFp_field_ptr fp;
+    mpz_t t;
+    mp_limb_t tl[_MPFP_MAX_LIMBS];
+    int i;
+
+    fp = a->fp;
+    if (mpz_sgn(e) == 0) {
+        mpFp_set_ui_fp(r, 1, fp);
+        return;
+    }
+    assert(a->i->_mp_size == fp->psize);
+    // normalized copy of a, as mpFp_inv_fermat
+    for (i = 0; i < fp->psize; i++) {
+        tl[i] = a->i->_mp_d[i];
+    }
+    t->_mp_d = tl;
+    t->_mp_alloc = fp->psize;
+    t->_mp_size = fp->psize;
+    while ((t->_mp_size > 0) && (tl[t->_mp_size - 1] == 0)) {
+        t->_mp_size -= 1;
+    }
+    r->fp = fp;
+    mpz_powm_sec(r->i, t, e, fp->p);
+    for (i = r->i->_mp_size; i < fp->psize; i++) {
+        r->i->_mp_d[i] = 0;
+    }
+    r->i->_mp_size = fp->psize;
+#ifdef SAFE_CLEAN
+    memset(tl, 0, sizeof(tl));
+#endif
+    return;
+}
+
+static inline void _mpFp_set_si_fp(mpFp_t a, long v, mpFp_field_ptr fp) {
+    mpFp_set_ui_fp(a, (unsigned long)labs(v), fp);
+    if (v < 0) mpFp_neg(a, a);
+    return;
+}
+
+// gx = x^3 + A * x + B
+static inline void _mpECPHashToCurve_g(mpFp_t gx, mpFp_t x, mpFp_t A, mpFp_t B) {
+    mpFp_sqr(gx, x);
+    mpFp_add(gx, gx, A);
+    mpFp_mul(gx, gx, x);
+    mpFp_add(gx, gx, B);
+    return;
+}
+
+// r = a * b mod f = x^3 + A * x + C, polynomials of degree < 3 over F(p)
+static void _poly_mulmod(mpz_t *r, mpz_t *a, mpz_t *b, mpz_t A, mpz_t C, mpz_t p) {
+    mpz_t t[5];
+    int i, j;
+
+    for (i = 0; i < 5; i++) {
+        mpz_init(t[i]);
+    }
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            mpz_addmul(t[i + j], a[i], b[j]);
+        }
+    }
+    mpz_mod(t[4], t[4], p);
+    // x^4 = -A * x^2 - C * x
+    mpz_submul(t[2], A, t[4]);
+    mpz_submul(t[1], C, t[4]);
+    mpz_mod(t[3], t[3], p);
+    // x^3 = -A * x - C
+    mpz_submul(t[1], A, t[3]);
+    mpz_submul(t[0], C, t[3]);
+    for (i = 0; i < 3; i++) {
+        mpz_mod(r[i], t[i], p);
+        mpz_clear(t[i]);
+    }
+    mpz_clear(t[3]);
+    mpz_clear(t[4]);
+    return;
+}
+
+// a = a^p mod f
+static void _poly_powp(mpz_t *a, mpz_t A, mpz_t C, mpz_t p) {
+    mpz_t r[3];
+    int i, b;
+
+    for (i = 0; i < 3; i++) {
+        mpz_init(r[i]);
+    }
+    mpz_set_ui(r[0], 1);
+    for (b = mpz_sizeinbase(p, 2) - 1; b >= 0; b--) {
+        _poly_mulmod(r, r, r, A, C, p);
+        if (mpz_tstbit(p, b)) {
+            _poly_mulmod(r, r, a, A, C, p);
+        }
+    }
+    for (i = 0; i < 3; i++) {
+        mpz_set(a[i], r[i]);
+        mpz_clear(r[i]);
+    }
+    return;
+}
+
+// a cubic f over F(p) is irreducible iff x^(p^3) == x and x^p != x (mod f)
+static int _poly_cubic_irreducible(mpz_t A, mpz_t C, mpz_t p) {
+    mpz_t a[3];
+    int i, irr;
+
+    for (i = 0; i < 3; i++) {
+        mpz_init(a[i]);
+    }
+    mpz_set_ui(a[1], 1);
+    _poly_powp(a, A, C, p);
+    irr = !((mpz_cmp_ui(a[0], 0) == 0) && (mpz_cmp_ui(a[1], 1) == 0) &&
+        (mpz_cmp_ui(a[2], 0) == 0));
+    if (irr) {
+        _poly_powp(a, A, C, p);
+        _poly_powp(a, A, C, p);
+        irr = ((mpz_cmp_ui(a[0], 0) == 0) && (mpz_cmp_ui(a[1], 1) == 0) &&
+            (mpz_cmp_ui(a[2], 0) == 0));
+    }
+    for (i = 0; i < 3; i++) {
+        mpz_clear(a[i]);
+    }
+    return irr;
+}
+
+// Z selection (RFC 9380 appendix H), candidates 1, -1, 2, -2, ...
+static void _mpECPHashToCurve_find_z(mpECPHashToCurve_t h2c, mpFp_t A, mpFp_t B) {
+    mpFp_field_ptr fp;
+    mpFp_t Z, t, u, gz;
+    mpz_t za, zc;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 4];
+    long ctr;
+    int sign;
+
+    fp = h2c->cvp->fp;
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 4);
+    mpFp_init_scratch(Z, fp, scr);
+    mpFp_init_scratch(t, fp, scr);
+    mpFp_init_scratch(u, fp, scr);
+    mpFp_init_scratch(gz, fp, scr);
+    mpz_init(za);
+    mpz_init(zc);
+    for (ctr = 1; ; ctr++) {
+        for (sign = 1; sign >= -1; sign -= 2) {
+            _mpFp_set_si_fp(Z, sign * ctr, fp);
+            switch (h2c->map) {
+                case _MPECP_MAP_SSWU:
+                    // non-square, != -1, g(x) - Z irreducible and
+                    // g(B / (Z * A)) square
+                    if (mpFp_is_square(Z)) continue;
+                    mpFp_add_ui(t, Z, 1);
+                    if (mpFp_cmp_ui(t, 0) == 0) continue;
+                    mpz_set_mpFp(za, A);
+                    mpFp_sub(t, B, Z);
+                    mpz_set_mpFp(zc, t);
+                    if (!_poly_cubic_irreducible(za, zc, fp->p)) continue;
+                    mpFp_mul(t, Z, A);
+                    _mpFp_inv0(t, t);
+                    mpFp_mul(t, t, B);
+                    _mpECPHashToCurve_g(gz, t, A, B);
+                    if (!mpFp_is_square(gz)) continue;
+                    break;
+                case _MPECP_MAP_SVDW:
+                    // g(Z) != 0, h(Z) = -(3 * Z^2 + 4 * A) / (4 * g(Z)) non
+                    // zero and square, g(Z) or g(-Z / 2) square
+                    _mpECPHashToCurve_g(gz, Z, A, B);
+                    if (mpFp_cmp_ui(gz, 0) == 0) continue;
+                    mpFp_sqr(t, Z);
+                    mpFp_mul_ui(t, t, 3);
+                    mpFp_mul_ui(u, A, 4);
+                    mpFp_add(t, t, u);
+                    mpFp_neg(t, t);
+                    mpFp_mul_ui(u, gz, 4);
+                    _mpFp_inv0(u, u);
+                    mpFp_mul(t, t, u);
+                    if (mpFp_cmp_ui(t, 0) == 0) continue;
+                    if (!mpFp_is_square(t)) continue;
+                    if (!mpFp_is_square(gz)) {
+                        mpFp_set_ui_fp(t, 2, fp);
+                        _mpFp_inv0(t, t);
+                        mpFp_mul(t, t, Z);
+                        mpFp_neg(t, t);
+                        _mpECPHashToCurve_g(u, t, A, B);
+                        if (!mpFp_is_square(u)) continue;
+                    }
+                    break;
+                default:
+                    // Elligator 2, non-square
+                    if (mpFp_is_square(Z)) continue;
+                    break;
+            }
+            mpFp_set(h2c->Z, Z);
+            mpz_clear(zc);
+            mpz_clear(za);
+            mpECScratch_clear(scr);
+            return;
+        }
+    }
+}
+
+// sqrt_ratio (RFC 9380 appendix F.2.1) constants for the non-square sZ (Z
+// for SSWU and Elligator 2, the least non-square n >= 2 for SVDW):
+//   _MPFP_SQRT_3MOD4 : se = (p - 3) / 4, s1 = sqrt(-sZ)
+//   _MPFP_SQRT_5MOD8 : se = (p - 5) / 8, s1 = sqrt(-1), s2 = sqrt(sZ / s1)
+//   _MPFP_SQRT_TS    : p - 1 = q * 2^s (s = fp->sqrt_s), se = (q - 1) / 2,
+//                      s1 = sZ^q, s2 = sZ^((q + 1) / 2)
+// and le = (p - 1) / 2 for the Legendre exponentiation. All public, so the
+// variable time mpFp_is_square and mpFp_sqrt are fine here
+static void _mpECPHashToCurve_sqrt_setup(mpECPHashToCurve_t h2c, mpFp_t t) {
+    mpFp_field_ptr fp;
+    mpz_t q;
+    unsigned long n;
+    int e;
+
+    fp = h2c->cvp->fp;
+    e = 0;
+    if (h2c->map == _MPECP_MAP_SVDW) {
+        for (n = 2; ; n++) {
+            mpFp_set_ui_fp(h2c->sZ, n, fp);
+            if (!mpFp_is_square(h2c->sZ)) break;
+        }
+    } else {
+        mpFp_set(h2c->sZ, h2c->Z);
+    }
+    mpz_sub_ui(h2c->le, fp->p, 1);
+    mpz_tdiv_q_2exp(h2c->le, h2c->le, 1);
+    switch (fp->sqrt_type) {
+        case _MPFP_SQRT_3MOD4:
+            mpz_sub_ui(h2c->se, fp->p, 3);
+            mpz_tdiv_q_2exp(h2c->se, h2c->se, 2);
+            mpFp_neg(t, h2c->sZ);
+            e = mpFp_sqrt(h2c->s1, t);
+            assert(e == 0);
+            break;
+        case _MPFP_SQRT_5MOD8:
+            mpz_sub_ui(h2c->se, fp->p, 5);
+            mpz_tdiv_q_2exp(h2c->se, h2c->se, 3);
+            mpFp_set_ui_fp(t, 1, fp);
+            mpFp_neg(t, t);
+            e = mpFp_sqrt(h2c->s1, t);
+            assert(e == 0);
+            _mpFp_inv0(t, h2c->s1);
+            mpFp_mul(t, t, h2c->sZ);
+            e = mpFp_sqrt(h2c->s2, t);
+            assert(e == 0);
+            break;
+        default:
+            mpz_init(q);
+            mpz_sub_ui(q, fp->p, 1);
+            mpz_tdiv_q_2exp(q, q, fp->sqrt_s);
+            mpz_tdiv_q_2exp(h2c->se, q, 1);
+            mpFp_pow_mpz(h2c->s1, h2c->sZ, q);
+            mpz_add_ui(q, h2c->se, 1);
+            mpFp_pow_mpz(h2c->s2, h2c->sZ, q);
+            mpz_clear(q);
+            break;
+    }
+    (void)e;
+    return;
+}
+
+// Elligator 2 constants for the Montgomery curve K * t^2 = s^3 + J * s^2 + s
+static void _mpECPHashToCurve_ell2_setup(mpECPHashToCurve_t h2c, mpFp_t J, mpFp_t K) {
+    _mpFp_inv0(h2c->c2, K);
+    mpFp_mul(h2c->c1, J, h2c->c2);
+    mpFp_sqr(h2c->c2, h2c->c2);
+    mpFp_set(h2c->c4, K);
+    return;
+}
+
+int mpECPHashToCurve_init(mpECPHashToCurve_t h2c, mpECurve_t cv,
+    mpECDSAHashfunc_t H, unsigned char *dst, size_t dsz) {
+    mpFp_field_ptr fp;
+    mpFp_t J, K, t, u;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 4];
+    int bits;
+
+    if (H->blocksz == 0) return -1;
+    fp = cv->fp;
+    h2c->cvp = (mpECurve_ptr)cv;
+    mpFp_init_fp(h2c->Z, fp);
+    mpFp_init_fp(h2c->c1, fp);
+    mpFp_init_fp(h2c->c2, fp);
+    mpFp_init_fp(h2c->c3, fp);
+    mpFp_init_fp(h2c->c4, fp);
+    mpFp_init_fp(h2c->sZ, fp);
+    mpFp_init_fp(h2c->s1, fp);
+    mpFp_init_fp(h2c->s2, fp);
+    mpz_init(h2c->se);
+    mpz_init(h2c->le);
+    mpFp_set_ui_fp(h2c->c3, 1, fp);
+    mpECDSAHashfunc_init(h2c->H);
+    mpECDSAHashfunc_set(h2c->H, H);
+    // k (security level) = ceil(log2(p)) / 2
+    bits = mpz_sizeinbase(fp->p, 2);
+    h2c->L = (bits + ((bits + 1) / 2) + 7) / 8;
+    if (dsz > _MPECP_HASH_MAX_DST) {
+        // DST = H("H2C-OVERSIZE-DST-" || DST)
+        unsigned char *part[2];
+        size_t psz[2];
+
+        assert(H->hsz <= _MPECP_HASH_MAX_DST);
+        part[0] = (unsigned char *)"H2C-OVERSIZE-DST-";
+        psz[0] = 17;
+        part[1] = dst;
+        psz[1] = dsz;
+        if (_mpECP_hash_parts(h2c->dst, H, part, psz, 2) != 0) {
+            mpECPHashToCurve_clear(h2c);
+            return -1;
+        }
+        h2c->dsz = H->hsz;
+    } else {
+        memcpy(h2c->dst, dst, dsz);
+        h2c->dsz = dsz;
+    }
+
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 4);
+    mpFp_init_scratch(J, fp, scr);
+    mpFp_init_scratch(K, fp, scr);
+    mpFp_init_scratch(t, fp, scr);
+    mpFp_init_scratch(u, fp, scr);
+    switch (cv->type) {
+        case EQTypeShortWeierstrass:
+            if ((mpFp_cmp_ui(cv->coeff.ws.a, 0) != 0) &&
+                (mpFp_cmp_ui(cv->coeff.ws.b, 0) != 0)) {
+                h2c->map = _MPECP_MAP_SSWU;
+                _mpECPHashToCurve_find_z(h2c, cv->coeff.ws.a, cv->coeff.ws.b);
+                _mpFp_inv0(t, cv->coeff.ws.a);
+                mpFp_mul(h2c->c1, cv->coeff.ws.b, t);
+                mpFp_neg(h2c->c1, h2c->c1);
+                mpFp_mul(h2c->c2, h2c->Z, cv->coeff.ws.a);
+                _mpFp_inv0(h2c->c2, h2c->c2);
+                mpFp_mul(h2c->c2, h2c->c2, cv->coeff.ws.b);
+            } else {
+                h2c->map = _MPECP_MAP_SVDW;
+                _mpECPHashToCurve_find_z(h2c, cv->coeff.ws.a, cv->coeff.ws.b);
+                _mpECPHashToCurve_g(h2c->c1, h2c->Z, cv->coeff.ws.a, cv->coeff.ws.b);
+                mpFp_set_ui_fp(t, 2, fp);
+                _mpFp_inv0(t, t);
+                mpFp_mul(h2c->c2, h2c->Z, t);
+                mpFp_neg(h2c->c2, h2c->c2);
+                // t = 3 * Z^2 + 4 * A
+                mpFp_sqr(t, h2c->Z);
+                mpFp_mul_ui(t, t, 3);
+                mpFp_mul_ui(u, cv->coeff.ws.a, 4);
+                mpFp_add(t, t, u);
+                mpFp_mul(u, h2c->c1, t);
+                mpFp_neg(u, u);
+                if (mpFp_sqrt(h2c->c3, u) != 0) {
+                    mpECScratch_clear(scr);
+                    mpECPHashToCurve_clear(h2c);
+                    return -1;
+                }
+                _mpFp_cneg(h2c->c3, _mpFp_sgn0(h2c->c3), u);
+                _mpFp_inv0(t, t);
+                mpFp_mul(h2c->c4, h2c->c1, t);
+                mpFp_mul_ui(h2c->c4, h2c->c4, 4);
+                mpFp_neg(h2c->c4, h2c->c4);
+            }
+            break;
+        case EQTypeMontgomery:
+            // B * y^2 = x^3 + A * x^2 + x
+            h2c->map = _MPECP_MAP_ELL2;
+            _mpECPHashToCurve_find_z(h2c, NULL, NULL);
+            _mpECPHashToCurve_ell2_setup(h2c, cv->coeff.mo.A, cv->coeff.mo.B);
+            break;
+        case EQTypeEdwards:
+        case EQTypeTwistedEdwards:
+            // twisted Edwards a * x^2 + y^2 = 1 + d * x^2 * y^2 maps to
+            // J = 2 * (a + d) / (a - d), K = 4 / (a - d). Edwards
+            // x^2 + y^2 = c^2 * (1 + d * x^2 * y^2) is scaled by c to a = 1,
+            // d = d * c^4. If K is a square the map is to K = 1 and v is
+            // scaled by sqrt(K) (as RFC 9380 for edwards25519).
+            h2c->map = _MPECP_MAP_ELL2;
+            _mpECPHashToCurve_find_z(h2c, NULL, NULL);
+            if (cv->type == EQTypeTwistedEdwards) {
+                mpFp_set(J, cv->coeff.te.a);
+                mpFp_set(K, cv->coeff.te.d);
+            } else {
+                mpFp_set_ui_fp(J, 1, fp);
+                mpFp_sqr(K, cv->coeff.ed.c);
+                mpFp_sqr(K, K);
+                mpFp_mul(K, K, cv->coeff.ed.d);
+            }
+            mpFp_sub(t, J, K);
+            _mpFp_inv0(t, t);
+            mpFp_add(J, J, K);
+            mpFp_mul(J, J, t);
+            mpFp_mul_ui(J, J, 2);
+            mpFp_mul_ui(K, t, 4);
+            if (mpFp_sqrt(h2c->c3, K) == 0) {
+                _mpFp_cneg(h2c->c3, _mpFp_sgn0(h2c->c3), u);
+                mpFp_set_ui_fp(K, 1, fp);
+            }
+            _mpECPHashToCurve_ell2_setup(h2c, J, K);
+            break;
+        default:
+            mpECScratch_clear(scr);
+            mpECPHashToCurve_clear(h2c);
+            return -1;
+    }
+    _mpECPHashToCurve_sqrt_setup(h2c, t);
+    mpECScratch_clear(scr);
+    return 0;
+}
+
+void mpECPHashToCurve_clear(mpECPHashToCurve_t h2c) {
+    mpz_clear(h2c->le);
+    mpz_clear(h2c->se);
+    mpFp_clear(h2c->s2);
+    mpFp_clear(h2c->s1);
+    mpFp_clear(h2c->sZ);
+    mpFp_clear(h2c->c4);
+    mpFp_clear(h2c->c3);
+    mpFp_clear(h2c->c2);
+    mpFp_clear(h2c->c1);
+    mpFp_clear(h2c->Z);
+    mpECDSAHashfunc_clear(h2c->H);
+    h2c->cvp = NULL;
+    h2c->map = 0;
+    h2c->L = 0;
+    h2c->dsz = 0;
+    return;
+}
+
+int mpECPHashToCurve_hash_to_field(mpFp_ptr *u, size_t count,
+    mpECPHashToCurve_t h2c, unsigned char *msg, size_t msz) {
+    unsigned char *b;
+    size_t len;
+    mpz_t e;
+    size_t i;
+
+    // expand_message_xmd output is limited to 65535 bytes
+    if ((count == 0) || (count > (65535 / h2c->L))) return -1;
+    len = count * h2c->L;
+    b = (unsigned char *)malloc(len);
+    if (b == NULL) return -1;
+    if (mpECP_expand_message_xmd(b, len, msg, msz, h2c->dst,
+        h2c->dsz, h2c->H) != 0) {
+        free(b);
+        return -1;
+    }
+    mpz_init(e);
+    for (i = 0; i < count; i++) {
+        mpz_import(e, h2c->L, 1, 1, 1, 0, &b[i * h2c->L]);
+        mpFp_set_mpz_fp(u[i], e, h2c->cvp->fp);
+    }
+    mpz_clear(e);
+#ifdef SAFE_CLEAN
+    memset(b, 0, len);
+#endif
+    free(b);
+    return 0;
+}
+
+// 1 if a is a square (or 0), else 0: Legendre symbol as a^((p - 1) / 2)
+static int _mpECPHashToCurve_is_square(mpFp_t a, mpECPHashToCurve_t h2c, mpECScratch_t scr) {
+    mpFp_t t;
+    size_t mark;
+    int e;
+
+    mark = mpECScratch_mark(scr);
+    mpFp_init_scratch(t, h2c->cvp->fp, scr);
+    _mpFp_pow_sec(t, a, h2c->le);
+    e = _mpFp_eq_ui_ct(t, 0) | _mpFp_eq_ui_ct(t, 1);
+    mpECScratch_release(scr, mark);
+    return e;
+}
+
+// sqrt_ratio (RFC 9380 F.2.1) for v != 0: returns 1 and y = sqrt(u / v) if
+// u / v is square, else 0 and y = sqrt(sZ * u / v) (y may alias u or v)
+static int _mpECPHashToCurve_sqrt_ratio(mpFp_t y, mpFp_t u, mpFp_t v, mpECPHashToCurve_t h2c, mpECScratch_t scr) {
+    mpFp_field_ptr fp;
+    mpFp_t tv1, tv2, tv3, tv4, tv5;
+    size_t mark;
+    int isqr, e, i, j;
+
+    fp = h2c->cvp->fp;
+    mark = mpECScratch_mark(scr);
+    mpFp_init_scratch(tv1, fp, scr);
+    mpFp_init_scratch(tv2, fp, scr);
+    mpFp_init_scratch(tv3, fp, scr);
+    mpFp_init_scratch(tv4, fp, scr);
+    mpFp_init_scratch(tv5, fp, scr);
+    switch (fp->sqrt_type) {
+        case _MPFP_SQRT_3MOD4:
+            // F.2.1.2: y1 = (u * v^3)^se * u * v, y2 = y1 * sqrt(-sZ)
+            mpFp_sqr(tv1, v);
+            mpFp_mul(tv2, u, v);
+            mpFp_mul(tv1, tv1, tv2);
+            _mpFp_pow_sec(tv3, tv1, h2c->se);
+            mpFp_mul(tv3, tv3, tv2);
+            mpFp_mul(tv4, tv3, h2c->s1);
+            mpFp_sqr(tv1, tv3);
+            mpFp_mul(tv1, tv1, v);
+            isqr = _mpFp_eq_ct(tv1, u);
+            mpFp_cswap(tv3, tv4, isqr ^ 1);
+            break;
+        case _MPFP_SQRT_5MOD8:
+            // F.2.1.3: y1 = (u * v^7)^se * u * v^3 (times sqrt(-1) if
+            // needed), y2 = y1 * sqrt(sZ / sqrt(-1)) (again times sqrt(-1))
+            mpFp_sqr(tv1, v);
+            mpFp_mul(tv2, tv1, v);
+            mpFp_sqr(tv1, tv1);
+            mpFp_mul(tv2, tv2, u);
+            mpFp_mul(tv1, tv1, tv2);
+            _mpFp_pow_sec(tv3, tv1, h2c->se);
+            mpFp_mul(tv3, tv3, tv2);
+            mpFp_mul(tv1, tv3, h2c->s1);
+            mpFp_sqr(tv2, tv1);
+            mpFp_mul(tv2, tv2, v);
+            e = _mpFp_eq_ct(tv2, u);
+            mpFp_cswap(tv3, tv1, e);
+            mpFp_sqr(tv2, tv3);
+            mpFp_mul(tv2, tv2, v);
+            isqr = _mpFp_eq_ct(tv2, u);
+            mpFp_mul(tv4, tv3, h2c->s2);
+            mpFp_mul(tv1, tv4, h2c->s1);
+            mpFp_sqr(tv2, tv1);
+            mpFp_mul(tv2, tv2, v);
+            mpFp_mul(tv5, h2c->sZ, u);
+            e = _mpFp_eq_ct(tv2, tv5);
+            mpFp_cswap(tv4, tv1, e);
+            mpFp_cswap(tv3, tv4, isqr ^ 1);
+            break;
+        default:
+            // F.2.1.1 (constant time Tonelli-Shanks), s = fp->sqrt_s,
+            // tv1 = sZ^q, tv2 = v^(2^s - 1)
+            mpFp_set(tv1, h2c->s1);
+            mpFp_set(tv2, v);
+            for (i = 1; i < fp->sqrt_s; i++) {
+                mpFp_sqr(tv2, tv2);
+                mpFp_mul(tv2, tv2, v);
+            }
+            mpFp_sqr(tv3, tv2);
+            mpFp_mul(tv3, tv3, v);
+            mpFp_mul(tv5, u, tv3);
+            _mpFp_pow_sec(tv5, tv5, h2c->se);
+            mpFp_mul(tv5, tv5, tv2);
+            mpFp_mul(tv2, tv5, v);
+            mpFp_mul(tv3, tv5, u);
+            mpFp_mul(tv4, tv3, tv2);
+            // isqr = (tv4^(2^(s - 1)) == 1)
+            mpFp_set(tv5, tv4);
+            for (i = 1; i < fp->sqrt_s; i++) {
+                mpFp_sqr(tv5, tv5);
+            }
+            isqr = _mpFp_eq_ui_ct(tv5, 1);
+            mpFp_mul(tv2, tv3, h2c->s2);
+            mpFp_mul(tv5, tv4, tv1);
+            mpFp_cswap(tv3, tv2, isqr ^ 1);
+            mpFp_cswap(tv4, tv5, isqr ^ 1);
+            for (i = fp->sqrt_s; i >= 2; i--) {
+                mpFp_set(tv5, tv4);
+                for (j = 1; j <= (i - 2); j++) {
+                    mpFp_sqr(tv5, tv5);
+                }
+                e = _mpFp_eq_ui_ct(tv5, 1);
+                mpFp_mul(tv2, tv3, tv1);
+                mpFp_sqr(tv1, tv1);
+                mpFp_mul(tv5, tv4, tv1);
+                mpFp_cswap(tv3, tv2, e ^ 1);
+                mpFp_cswap(tv4, tv5, e ^ 1);
+            }
+            break;
+    }
+    mpFp_set(y, tv3);
+    mpECScratch_release(scr, mark);
+    return isqr;
+}
+
+// simplified SWU (RFC 9380 6.6.2)
+static void _mpECPHashToCurve_sswu(mpFp_t x, mpFp_t y, mpECPHashToCurve_t h2c, mpFp_t u, mpECScratch_t scr) {
+    mpFp_ptr A, B;
+    mpFp_t tv1, tv2, x2, gx1, y2;
+    int e;
+
+    A = h2c->cvp->coeff.ws.a;
+    B = h2c->cvp->coeff.ws.b;
+    mpFp_init_scratch(tv1, h2c->cvp->fp, scr);
+    mpFp_init_scratch(tv2, h2c->cvp->fp, scr);
+    mpFp_init_scratch(x2, h2c->cvp->fp, scr);
+    mpFp_init_scratch(gx1, h2c->cvp->fp, scr);
+    mpFp_init_scratch(y2, h2c->cvp->fp, scr);
+    // tv2 = inv0(Z^2 * u^4 + Z * u^2)
+    mpFp_sqr(tv1, u);
+    mpFp_mul(tv1, tv1, h2c->Z);
+    mpFp_sqr(tv2, tv1);
+    mpFp_add(tv2, tv2, tv1);
+    _mpFp_inv0(tv2, tv2);
+    e = _mpFp_eq_ui_ct(tv2, 0);
+    // x1 = c1 * (1 + tv2), or c2 if tv2 == 0
+    mpFp_add_ui(x, tv2, 1);
+    mpFp_mul(x, x, h2c->c1);
+    mpFp_set(x2, h2c->c2);
+    mpFp_cswap(x, x2, e);
+    _mpECPHashToCurve_g(gx1, x, A, B);
+    mpFp_mul(x2, tv1, x);
+    // y1 = sqrt(gx1), or sqrt(Z * gx1) if gx1 is not square. Then
+    // gx2 = (Z * u^2)^3 * gx1 so y2 = Z * u^3 * y1 (the exceptional case
+    // always has gx1 square by the choice of Z)
+    mpFp_set_ui_fp(tv2, 1, h2c->cvp->fp);
+    e = _mpECPHashToCurve_sqrt_ratio(y, gx1, tv2, h2c, scr);
+    mpFp_mul(y2, tv1, u);
+    mpFp_mul(y2, y2, y);
+    mpFp_cswap(x, x2, e ^ 1);
+    mpFp_cswap(y, y2, e ^ 1);
+    _mpFp_cneg(y, _mpFp_sgn0(u) ^ _mpFp_sgn0(y), tv1);
+    return;
+}
+
+// Shallue-van de Woestijne (RFC 9380 6.6.1)
+static void _mpECPHashToCurve_svdw(mpFp_t x, mpFp_t y, mpECPHashToCurve_t h2c, mpFp_t u, mpECScratch_t scr) {
+    mpFp_ptr A, B;
+    mpFp_t tv1, tv2, tv3, tv4, x2, x3, gx;
+    int e1, e2;
+
+    A = h2c->cvp->coeff.ws.a;
+    B = h2c->cvp->coeff.ws.b;
+    mpFp_init_scratch(tv1, h2c->cvp->fp, scr);
+    mpFp_init_scratch(tv2, h2c->cvp->fp, scr);
+    mpFp_init_scratch(tv3, h2c->cvp->fp, scr);
+    mpFp_init_scratch(tv4, h2c->cvp->fp, scr);
+    mpFp_init_scratch(x2, h2c->cvp->fp, scr);
+    mpFp_init_scratch(x3, h2c->cvp->fp, scr);
+    mpFp_init_scratch(gx, h2c->cvp->fp, scr);
+    mpFp_sqr(tv1, u);
+    mpFp_mul(tv1, tv1, h2c->c1);
+    mpFp_add_ui(tv2, tv1, 1);
+    mpFp_neg(tv1, tv1);
+    mpFp_add_ui(tv1, tv1, 1);
+    mpFp_mul(tv3, tv1, tv2);
+    _mpFp_inv0(tv3, tv3);
+    mpFp_mul(tv4, u, tv1);
+    mpFp_mul(tv4, tv4, tv3);
+    mpFp_mul(tv4, tv4, h2c->c3);
+    // x1 = c2 - tv4, x2 = c2 + tv4
+    mpFp_sub(x, h2c->c2, tv4);
+    _mpECPHashToCurve_g(gx, x, A, B);
+    e1 = _mpECPHashToCurve_is_square(gx, h2c, scr);
+    mpFp_add(x2, h2c->c2, tv4);
+    _mpECPHashToCurve_g(gx, x2, A, B);
+    e2 = _mpECPHashToCurve_is_square(gx, h2c, scr) & (e1 ^ 1);
+    // x3 = Z + c4 * (tv2^2 * tv3)^2
+    mpFp_sqr(x3, tv2);
+    mpFp_mul(x3, x3, tv3);
+    mpFp_sqr(x3, x3);
+    mpFp_mul(x3, x3, h2c->c4);
+    mpFp_add(x3, x3, h2c->Z);
+    // x = x1 if e1, x2 if e2, else x3
+    mpFp_cswap(x, x3, e1 ^ 1);
+    mpFp_cswap(x, x2, e2);
+    _mpECPHashToCurve_g(gx, x, A, B);
+    mpFp_set_ui_fp(tv2, 1, h2c->cvp->fp);
+    e1 = _mpECPHashToCurve_sqrt_ratio(y, gx, tv2, h2c, scr);
+    assert(e1 == 1);
+    _mpFp_cneg(y, _mpFp_sgn0(u) ^ _mpFp_sgn0(y), tv1);
+    return;
+}
+
+// Elligator 2 (RFC 9380 6.7.1), (s, t) on K * t^2 = s^3 + J * s^2 + s
+static void _mpECPHashToCurve_ell2(mpFp_t s, mpFp_t t, mpECPHashToCurve_t h2c, mpFp_t u, mpECScratch_t scr) {
+    mpFp_t tv1, x2, gx1, gx2;
+    int e;
+
+    mpFp_init_scratch(tv1, h2c->cvp->fp, scr);
+    mpFp_init_scratch(x2, h2c->cvp->fp, scr);
+    mpFp_init_scratch(gx1, h2c->cvp->fp, scr);
+    mpFp_init_scratch(gx2, h2c->cvp->fp, scr);
+    // x1 = -c1 * inv0(1 + Z * u^2), or -c1 if x1 == 0
+    mpFp_sqr(tv1, u);
+    mpFp_mul(tv1, tv1, h2c->Z);
+    mpFp_add_ui(tv1, tv1, 1);
+    _mpFp_inv0(tv1, tv1);
+    e = _mpFp_eq_ui_ct(tv1, 0);
+    mpFp_neg(x2, h2c->c1);
+    mpFp_mul(s, x2, tv1);
+    mpFp_cswap(s, x2, e);
+    // gx1 = x1^3 + c1 * x1^2 + c2 * x1
+    mpFp_add(gx1, s, h2c->c1);
+    mpFp_mul(gx1, gx1, s);
+    mpFp_add(gx1, gx1, h2c->c2);
+    mpFp_mul(gx1, gx1, s);
+    // x2 = -x1 - c1
+    mpFp_add(x2, s, h2c->c1);
+    mpFp_neg(x2, x2);
+    mpFp_add(gx2, x2, h2c->c1);
+    mpFp_mul(gx2, gx2, x2);
+    mpFp_add(gx2, gx2, h2c->c2);
+    mpFp_mul(gx2, gx2, x2);
+    e = _mpECPHashToCurve_is_square(gx1, h2c, scr);
+    mpFp_cswap(s, x2, e ^ 1);
+    mpFp_cswap(gx1, gx2, e ^ 1);
+    // sgn0(y) == 1 for x1, 0 for x2
+    mpFp_set_ui_fp(tv1, 1, h2c->cvp->fp);
+    (void)_mpECPHashToCurve_sqrt_ratio(t, gx1, tv1, h2c, scr);
+    _mpFp_cneg(t, _mpFp_sgn0(t) ^ e, tv1);
+    mpFp_mul(s, s, h2c->c4);
+    mpFp_mul(t, t, h2c->c4);
+    return;
+}
+
+void mpECPHashToCurve_map(mpECP_t rpt, mpECPHashToCurve_t h2c, mpFp_t u) {
+    mpECurve_ptr cvp;
+    mpFp_t x, y, v, w, d;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 16];
+    int e;
+
+    cvp = h2c->cvp;
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 16);
+    mpFp_init_scratch(x, cvp->fp, scr);
+    mpFp_init_scratch(y, cvp->fp, scr);
+    switch (h2c->map) {
+        case _MPECP_MAP_SSWU:
+            _mpECPHashToCurve_sswu(x, y, h2c, u, scr);
+            break;
+        case _MPECP_MAP_SVDW:
+            _mpECPHashToCurve_svdw(x, y, h2c, u, scr);
+            break;
+        default:
+            _mpECPHashToCurve_ell2(x, y, h2c, u, scr);
+            if (cvp->type == EQTypeMontgomery) break;
+            // rational map v = c3 * s / t, w = (s - 1) / (s + 1) with one
+            // inversion of t * (s + 1), exceptional cases map to (0, 1)
+            mpFp_init_scratch(v, cvp->fp, scr);
+            mpFp_init_scratch(w, cvp->fp, scr);
+            mpFp_init_scratch(d, cvp->fp, scr);
+            mpFp_add_ui(w, x, 1);
+            mpFp_mul(d, y, w);
+            _mpFp_inv0(d, d);
+            e = _mpFp_eq_ui_ct(d, 0);
+            mpFp_mul(v, x, w);
+            mpFp_mul(v, v, d);
+            mpFp_mul(v, v, h2c->c3);
+            mpFp_sub_ui(w, x, 1);
+            mpFp_mul(w, w, y);
+            mpFp_mul(w, w, d);
+            mpFp_set_ui_fp(d, 1, cvp->fp);
+            mpFp_cswap(w, d, e);
+            if (cvp->type == EQTypeEdwards) {
+                mpFp_mul(v, v, cvp->coeff.ed.c);
+                mpFp_mul(w, w, cvp->coeff.ed.c);
+            }
+            mpFp_set(x, v);
+            mpFp_set(y, w);
+            break;
+    }
+    mpECP_set_mpFp(rpt, x, y, cvp);
+    mpECScratch_clear(scr);
+    return;
+}
+
+// rpt = h * rpt, double and add over the (small) cofactor
+static void _mpECPHashToCurve_clear_cofactor(mpECP_t rpt) {
+    mpECP_t a;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 3];
+    int b;
+
+    if (mpz_cmp_ui(rpt->cvp->h, 1) == 0) return;
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 3);
+    mpECP_init_scratch(a, rpt->cvp, scr);
+    mpECP_set(a, rpt);
+    for (b = mpz_sizeinbase(rpt->cvp->h, 2) - 2; b >= 0; b--) {
+        mpECP_double(rpt, rpt);
+        if (mpz_tstbit(rpt->cvp->h, b)) {
+            mpECP_add(rpt, rpt, a);
+        }
+    }
+    mpECScratch_clear(scr);
+    return;
+}
+
+int mpECPHashToCurve_hash(mpECP_t rpt, mpECPHashToCurve_t h2c,
+    unsigned char *msg, size_t msz) {
+    mpFp_t u0, u1;
+    mpFp_ptr u[2];
+    mpECP_t q;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 5];
+
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 5);
+    mpFp_init_scratch(u0, h2c->cvp->fp, scr);
+    mpFp_init_scratch(u1, h2c->cvp->fp, scr);
+    mpECP_init_scratch(q, h2c->cvp, scr);
+    u[0] = u0;
+    u[1] = u1;
+    if (mpECPHashToCurve_hash_to_field(u, 2, h2c, msg, msz) != 0) {
+        mpECScratch_clear(scr);
+        return -1;
+    }
+    mpECPHashToCurve_map(rpt, h2c, u0);
+    mpECPHashToCurve_map(q, h2c, u1);
+    mpECP_add(rpt, rpt, q);
+    _mpECPHashToCurve_clear_cofactor(rpt);
+    mpECScratch_clear(scr);
+    return 0;
+}
+
+int mpECPHashToCurve_encode(mpECP_t rpt, mpECPHashToCurve_t h2c,
+    unsigned char *msg, size_t msz) {
+    mpFp_t u0;
+    mpFp_ptr u[1];
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS];
+
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS);
+    mpFp_init_scratch(u0, h2c->cvp->fp, scr);
+    u[0] = u0;
+    if (mpECPHashToCurve_hash_to_field(u, 1, h2c, msg, msz) != 0) {
+        mpECScratch_clear(scr);
+        return -1;
+    }
+    mpECPHashToCurve_map(rpt, h2c, u0);
+    _mpECPHashToCurve_clear_cofactor(rpt);
+    mpECScratch_clear(scr);
+    return 0;
+}
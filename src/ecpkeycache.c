@@ -0,0 +1,266 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecc/ecpkeycache.h>
+#include <ecc/ecpoint.h>
+#include <ecc/ecurve.h>
+#include <ecc/mpzurandom.h>
+#include <gmp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _SIP_ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define _SIP_ROUND(v0, v1, v2, v3) do {                       \
+        v0 += v1; v1 = _SIP_ROTL(v1, 13); v1 ^= v0;             \
+        v0 = _SIP_ROTL(v0, 32);                                  \
+        v2 += v3; v3 = _SIP_ROTL(v3, 16); v3 ^= v2;             \
+        v0 += v3; v3 = _SIP_ROTL(v3, 21); v3 ^= v0;             \
+        v2 += v1; v1 = _SIP_ROTL(v1, 17); v1 ^= v2;             \
+        v2 = _SIP_ROTL(v2, 32);                                  \
+    } while (0)
+
+// SipHash-2-4 keyed with the per-cache random key, so bucket placement
+// (and chain length) cannot be chosen by whoever supplies the encoded keys
+static uint64_t _mpECPKeyCache_hash(mpECPKeyCache_t cache, unsigned char *s, size_t length) {
+    uint64_t v0 = cache->hkey[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = cache->hkey[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = cache->hkey[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = cache->hkey[1] ^ 0x7465646279746573ULL;
+    uint64_t m;
+    size_t i, j;
+
+    for (i = 0; (i + 8) <= length; i += 8) {
+        m = 0;
+        for (j = 0; j < 8; j++) {
+            m |= ((uint64_t)s[i + j]) << (8 * j);
+        }
+        v3 ^= m;
+        _SIP_ROUND(v0, v1, v2, v3);
+        _SIP_ROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    m = ((uint64_t)length) << 56;
+    for (j = 0; i < length; i++, j++) {
+        m |= ((uint64_t)s[i]) << (8 * j);
+    }
+    v3 ^= m;
+    _SIP_ROUND(v0, v1, v2, v3);
+    _SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= m;
+    v2 ^= 0xff;
+    _SIP_ROUND(v0, v1, v2, v3);
+    _SIP_ROUND(v0, v1, v2, v3);
+    _SIP_ROUND(v0, v1, v2, v3);
+    _SIP_ROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// hkey = 128 random bits
+static void _mpECPKeyCache_seed(mpECPKeyCache_t cache) {
+    mpz_t r, rmax;
+
+    mpz_init(r);
+    mpz_init(rmax);
+    mpz_setbit(rmax, 128);
+    mpz_urandom(r, rmax);
+    cache->hkey[0] = 0;
+    cache->hkey[1] = 0;
+    mpz_export(cache->hkey, NULL, -1, sizeof(uint64_t), 0, 0, r);
+    mpz_clear(rmax);
+    mpz_clear(r);
+    return;
+}
+
+void mpECPKeyCache_init(mpECPKeyCache_t cache, mpECurve_t cv, size_t size) {
+    size_t nb;
+
+    assert(size > 0);
+    cache->cvp = (mpECurve_ptr)cv;
+    cache->size = size;
+    cache->count = 0;
+    cache->promote = _MPECP_KEYCACHE_PROMOTE;
+    cache->window_bits = _MPECP_KEYCACHE_WINDOW_BITS;
+    // power of 2 buckets, load factor <= 1/2
+    nb = 1;
+    while (nb < (size << 1)) nb <<= 1;
+    cache->nbuckets = nb;
+    cache->bucket = (_mpECPKeyCache_entry_t **)calloc(nb, sizeof(_mpECPKeyCache_entry_t *));
+    assert(cache->bucket != NULL);
+    cache->mru = NULL;
+    cache->lru = NULL;
+    _mpECPKeyCache_seed(cache);
+    mpECPKeyCache_reset_stats(cache);
+    return;
+}
+
+static void _mpECPKeyCache_entry_free(_mpECPKeyCache_entry_t *e) {
+    mpECP_clear(e->pt);
+    free(e->key);
+    free(e);
+    return;
+}
+
+void mpECPKeyCache_clear(mpECPKeyCache_t cache) {
+    _mpECPKeyCache_entry_t *e;
+
+    e = cache->mru;
+    while (e != NULL) {
+        _mpECPKeyCache_entry_t *next = e->next;
+        _mpECPKeyCache_entry_free(e);
+        e = next;
+    }
+    free(cache->bucket);
+    cache->bucket = NULL;
+    cache->nbuckets = 0;
+    cache->mru = NULL;
+    cache->lru = NULL;
+    cache->count = 0;
+    cache->size = 0;
+    cache->hkey[0] = 0;
+    cache->hkey[1] = 0;
+    cache->cvp = NULL;
+    return;
+}
+
+void mpECPKeyCache_set_promotion(mpECPKeyCache_t cache, unsigned long promote, int window_bits) {
+    assert((window_bits > 0) && (window_bits <= 16));
+    cache->promote = promote;
+    cache->window_bits = window_bits;
+    return;
+}
+
+void mpECPKeyCache_reset_stats(mpECPKeyCache_t cache) {
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    cache->promotions = 0;
+    return;
+}
+
+static void _mpECPKeyCache_unlink(mpECPKeyCache_t cache, _mpECPKeyCache_entry_t *e) {
+    if (e->prev != NULL) {
+        e->prev->next = e->next;
+    } else {
+        cache->mru = e->next;
+    }
+    if (e->next != NULL) {
+        e->next->prev = e->prev;
+    } else {
+        cache->lru = e->prev;
+    }
+    return;
+}
+
+static void _mpECPKeyCache_push_mru(mpECPKeyCache_t cache, _mpECPKeyCache_entry_t *e) {
+    e->prev = NULL;
+    e->next = cache->mru;
+    if (cache->mru != NULL) {
+        cache->mru->prev = e;
+    } else {
+        cache->lru = e;
+    }
+    cache->mru = e;
+    return;
+}
+
+static void _mpECPKeyCache_evict(mpECPKeyCache_t cache) {
+    _mpECPKeyCache_entry_t *e = cache->lru;
+    _mpECPKeyCache_entry_t **b;
+
+    assert(e != NULL);
+    _mpECPKeyCache_unlink(cache, e);
+    b = &cache->bucket[e->hash & (cache->nbuckets - 1)];
+    while (*b != e) {
+        b = &((*b)->chain);
+    }
+    *b = e->chain;
+    _mpECPKeyCache_entry_free(e);
+    cache->count -= 1;
+    cache->evictions += 1;
+    return;
+}
+
+mpECP_ptr mpECPKeyCache_lookup(mpECPKeyCache_t cache, unsigned char *s, size_t length) {
+    _mpECPKeyCache_entry_t *e;
+    _mpECPKeyCache_entry_t **b;
+    uint64_t h;
+
+    h = _mpECPKeyCache_hash(cache, s, length);
+    b = &cache->bucket[h & (cache->nbuckets - 1)];
+    for (e = *b; e != NULL; e = e->chain) {
+        if ((e->hash == h) && (e->keysz == length) &&
+            (memcmp(e->key, s, length) == 0)) {
+            break;
+        }
+    }
+
+    if (e != NULL) {
+        cache->hits += 1;
+        if (e != cache->mru) {
+            _mpECPKeyCache_unlink(cache, e);
+            _mpECPKeyCache_push_mru(cache, e);
+        }
+    } else {
+        cache->misses += 1;
+        e = (_mpECPKeyCache_entry_t *)malloc(sizeof(_mpECPKeyCache_entry_t));
+        assert(e != NULL);
+        mpECP_init(e->pt, cache->cvp);
+        if (mpECP_set_bytes(e->pt, s, length, cache->cvp) != 0) {
+            // invalid keys are not cached
+            mpECP_clear(e->pt);
+            free(e);
+            return NULL;
+        }
+        e->key = (unsigned char *)malloc(length);
+        assert(e->key != NULL);
+        memcpy(e->key, s, length);
+        e->keysz = length;
+        e->hash = h;
+        e->uses = 0;
+        if (cache->count >= cache->size) {
+            _mpECPKeyCache_evict(cache);
+        }
+        e->chain = *b;
+        *b = e;
+        _mpECPKeyCache_push_mru(cache, e);
+        cache->count += 1;
+    }
+
+    e->uses += 1;
+    if ((cache->promote != 0) && (e->uses >= cache->promote) &&
+        (e->pt->base_bits == 0)) {
+        mpECP_scalar_base_mul_setup_bits(e->pt, cache->window_bits);
+        cache->promotions += 1;
+    }
+    return e->pt;
+}
@@ -32,6 +32,7 @@
 #include <ecc/ecpoint.h>
 #include <ecc/ecurve.h>
 #include <ecc/field.h>
+#include <ecc/scratch.h>
 #include <gmp.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -39,6 +40,14 @@
 
 #define _MPECP_BASE_BITS    (8)
 
+#ifdef _MPECP_BASE_CONST
+// prebuilt base tables for the generator of selected curves, see gentables.c
+#include "ecpbase_const.h"
+#if _MPECP_BASE_CONST_NUMB_BITS != GMP_NUMB_BITS
+#error "ecpbase_const.h generated for a different limb size"
+#endif
+#endif
+
 // defining _MPECP_MPFP_NOMALLOC uses fixed structures for mpFp elements
 // it is of course critical that *_realloc is never called, so _mp_alloc
 // should be set to >= fp->p2size to avoid realloc being called from
@@ -46,9 +55,6 @@
 #define _MPECP_MPFP_NOMALLOC
 #ifdef _MPECP_MPFP_NOMALLOC
 
-// this definition should match the one in field.c
-#define _MPFP_MAX_LIMBS   (32)
-
 typedef mp_limb_t __local_limb_t[_MPFP_MAX_LIMBS];
 
 #endif // #ifdef _MPECP_MPFP_NOMALLOC
@@ -69,6 +75,12 @@ static inline int _mpECP_n_base_pts(mpECP_t pt) {
 
 static void _mpECP_base_pts_cleanup(mpECP_t pt) {
     int i, npts;
+    if (pt->base_const != NULL) {
+        // prebuilt table, nothing allocated
+        pt->base_const = NULL;
+        pt->base_bits = 0;
+        return;
+    }
     assert(pt->base_pt != NULL);
     npts = _mpECP_n_base_pts(pt);
     for (i = 0; i < npts; i++) {
@@ -93,6 +105,19 @@ void mpECP_init(mpECP_t pt, mpECurve_t cv) {
     mpFp_init_fp(pt->z, cv->fp);
     pt->base_bits = 0;
     pt->base_pt = NULL;
+    pt->base_const = NULL;
+    return;
+}
+
+void mpECP_init_scratch(mpECP_t pt, mpECurve_t cv, mpECScratch_t scr) {
+    pt->cvp = cv;
+    mpFp_init_scratch(pt->x, cv->fp, scr);
+    mpFp_init_scratch(pt->y, cv->fp, scr);
+    mpFp_init_scratch(pt->z, cv->fp, scr);
+    pt->is_neutral = 0;
+    pt->base_bits = 0;
+    pt->base_pt = NULL;
+    pt->base_const = NULL;
     return;
 }
 
@@ -187,10 +212,13 @@ void mpECP_set_neutral(mpECP_t rpt, mpECurve_t cv) {
 
 void _mpECP_to_affine(mpECP_t pt) {
     mpFp_t zinv;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 2];
     if (mpFp_cmp_ui(pt->z, 1) == 0) {
         return;
     }
-    mpFp_init_fp(zinv, pt->cvp->fp);
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 2);
+    mpFp_init_scratch(zinv, pt->cvp->fp, scr);
     switch (pt->cvp->type) {
         case EQTypeMontgomery:
             // Montgomery curve point internal representation is short-WS
@@ -202,14 +230,13 @@ void _mpECP_to_affine(mpECP_t pt) {
                 mpFp_t t;
                 if (pt->is_neutral != 0) break;
                 // Jacobian coords x = X/Z**2 y = Y/Z**3);
-                mpFp_init_fp(t, pt->cvp->fp);
+                mpFp_init_scratch(t, pt->cvp->fp, scr);
                 mpFp_inv(zinv, pt->z);
                 mpFp_sqr(t, zinv);
                 mpFp_mul(pt->x, pt->x, t);
                 mpFp_pow_ui(t, zinv, 3);
                 mpFp_mul(pt->y, pt->y, t);
                 mpFp_set_ui_fp(pt->z, 1, pt->cvp->fp);
-                mpFp_clear(t);
             }
             break;
 #endif
@@ -225,7 +252,7 @@ void _mpECP_to_affine(mpECP_t pt) {
         default:
             assert(_known_curve_type(pt->cvp));
     }
-    mpFp_clear(zinv);
+    mpECScratch_clear(scr);
     return;
 }
 
@@ -272,10 +299,13 @@ void mpz_set_mpECP_affine_x(mpz_t x, mpECP_t pt) {
     _mpECP_to_affine(pt);
     if (pt->cvp->type == EQTypeMontgomery) {
         mpFp_t t;
-        mpFp_init_fp(t, pt->cvp->fp);
+        mpECScratch_t scr;
+        mp_limb_t scrl[_MPFP_MAX_LIMBS];
+        mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS);
+        mpFp_init_scratch(t, pt->cvp->fp, scr);
         _transform_ws_to_mo_x(t, pt);
         mpz_set_mpFp(x, t);
-        mpFp_clear(t);
+        mpECScratch_clear(scr);
     } else {
         mpz_set_mpFp(x, pt->x);
     }
@@ -286,10 +316,13 @@ void mpz_set_mpECP_affine_y(mpz_t y, mpECP_t pt) {
     _mpECP_to_affine(pt);
     if (pt->cvp->type == EQTypeMontgomery) {
         mpFp_t t;
-        mpFp_init_fp(t, pt->cvp->fp);
+        mpECScratch_t scr;
+        mp_limb_t scrl[_MPFP_MAX_LIMBS];
+        mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS);
+        mpFp_init_scratch(t, pt->cvp->fp, scr);
         _transform_ws_to_mo_y(t, pt);
         mpz_set_mpFp(y, t);
-        mpFp_clear(t);
+        mpECScratch_clear(scr);
     } else {
         mpz_set_mpFp(y, pt->y);
     }
@@ -331,6 +364,8 @@ int mpECP_set_str(mpECP_t rpt, char *s, mpECurve_t cv) {
 
 int mpECP_set_bytes(mpECP_t rpt, unsigned char *b, size_t blen, mpECurve_t cv) {
     int bytes;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 6];
 
     bytes = _bytelen(cv->bits);
     if (blen < (1 + bytes)) return -1;
@@ -339,29 +374,31 @@ int mpECP_set_bytes(mpECP_t rpt, unsigned char *b, size_t blen, mpECurve_t cv) {
             mpECP_set_neutral(rpt, cv);
             return 0;
         case 4: {
+                mpFp_t x, y;
                 if (blen != (1 + (2 * bytes))) return -1;
-                mpz_t x, y;
-                mpz_init(x);
-                mpz_init(y);
-                mpz_import(x, bytes, 1, sizeof(unsigned char), 1, 0, &(b[1]));
-                mpz_import(y, bytes, 1, sizeof(unsigned char), 1, 0, &(b[1 + bytes]));
-                mpECP_set_mpz(rpt, x, y, cv);
-                mpz_clear(y);
-                mpz_clear(x);
+                mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 6);
+                mpFp_init_scratch(x, cv->fp, scr);
+                mpFp_init_scratch(y, cv->fp, scr);
+                // import directly into element limbs (bytes <= psize limbs)
+                mpz_import(x->i, bytes, 1, sizeof(unsigned char), 1, 0, &(b[1]));
+                mpz_import(y->i, bytes, 1, sizeof(unsigned char), 1, 0, &(b[1 + bytes]));
+                mpFp_set_mpz_fp(x, x->i, cv->fp);
+                mpFp_set_mpz_fp(y, y->i, cv->fp);
+                mpECP_set_mpFp(rpt, x, y, cv);
+                mpECScratch_clear(scr);
             }
             return 0;
         case 2:
         case 3: {
-                mpz_t xz;
                 mpFp_t x, y, t;
                 int error, odd;
                 if (blen != (1 + bytes)) return -1;
-                mpz_init(xz);
-                mpFp_init_fp(x, cv->fp);
-                mpFp_init_fp(y, cv->fp);
-                mpFp_init_fp(t, cv->fp);
-                mpz_import(xz, bytes, 1, sizeof(unsigned char), 1, 0, &b[1]);
-                mpFp_set_mpz_fp(x, xz, cv->fp);
+                mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 6);
+                mpFp_init_scratch(x, cv->fp, scr);
+                mpFp_init_scratch(y, cv->fp, scr);
+                mpFp_init_scratch(t, cv->fp, scr);
+                mpz_import(x->i, bytes, 1, sizeof(unsigned char), 1, 0, &b[1]);
+                mpFp_set_mpz_fp(x, x->i, cv->fp);
                 switch (cv->type) {
                     case EQTypeShortWeierstrass: {
                             // y**2 = x**3 + ax + b
@@ -370,19 +407,12 @@ int mpECP_set_bytes(mpECP_t rpt, unsigned char *b, size_t blen, mpECurve_t cv) {
                             mpFp_pow_ui(t, x, 3);
                             mpFp_add(y, y, t);
                             error = mpFp_sqrt(y, y);
-                            if (error != 0) {
-                                mpFp_clear(t);
-                                mpFp_clear(y);
-                                mpFp_clear(x);
-                                mpz_clear(xz);
-                                return -1;
-                            }
                         }
                         break;
                     case EQTypeEdwards: {
                             mpFp_t c2, x2;
-                            mpFp_init_fp(c2, cv->fp);
-                            mpFp_init_fp(x2, cv->fp);
+                            mpFp_init_scratch(c2, cv->fp, scr);
+                            mpFp_init_scratch(x2, cv->fp, scr);
                             // x**2 + y**2 = c**2 (1 + d * x**2 * y**2)
                             // y**2 - C**2 * d * x**2 * y**2 = c**2 - x**2
                             // y**2 = (c**2 - x**2) / (1 - c**2 * d * x**2)
@@ -396,51 +426,30 @@ int mpECP_set_bytes(mpECP_t rpt, unsigned char *b, size_t blen, mpECurve_t cv) {
                             mpFp_inv(t, t);
                             mpFp_mul(t, t, y);
                             error = mpFp_sqrt(y, t);
-                            mpFp_clear(x2);
-                            mpFp_clear(c2);
-                            if (error != 0) {
-                                mpFp_clear(t);
-                                mpFp_clear(y);
-                                mpFp_clear(x);
-                                mpz_clear(xz);
-                                return -1;
-                            }
                         }
                         break;
                     case EQTypeTwistedEdwards: {
-                            mpFp_t a, x2;
-                            mpFp_init_fp(a, cv->fp);
-                            mpFp_init_fp(x2, cv->fp);
+                            mpFp_t x2;
+                            mpFp_init_scratch(x2, cv->fp, scr);
                             // a * x**2 + y**2 = 1 + d * x**2 * y**2
                             // y**2 - d * x**2 * y**2 = 1 - a * x**2
                             // y**2 = (1 - a * x**2) / (1 - d * x**2)
-                            mpFp_set(a, cv->coeff.te.a);
                             mpFp_set(t, cv->coeff.te.d);
                             mpFp_pow_ui(x2, x, 2);
                             mpFp_mul(t, t, x2);
                             mpFp_set_ui_fp(y, 1, cv->fp);
                             mpFp_sub(t, y, t);
-                            mpFp_mul(x2, x2, a);
+                            mpFp_mul(x2, x2, cv->coeff.te.a);
                             mpFp_sub(y, y, x2);
                             mpFp_inv(t, t);
                             mpFp_mul(t, t, y);
                             error = mpFp_sqrt(y, t);
-                            mpFp_clear(x2);
-                            mpFp_clear(a);
-                            if (error != 0) {
-                                mpFp_clear(t);
-                                mpFp_clear(y);
-                                mpFp_clear(x);
-                                mpz_clear(xz);
-                                return -1;
-                            }
                         }
                         break;
                     case EQTypeMontgomery: {
-                            int error;
                             // B * y**2 = x**3 + A * x**2 + x
                             mpFp_t s;
-                            mpFp_init_fp(s, cv->fp);
+                            mpFp_init_scratch(s, cv->fp, scr);
                             mpFp_mul(s, x, x);
                             mpFp_mul(t, s, x);
                             mpFp_mul(s, s, cv->coeff.mo.A);
@@ -448,30 +457,23 @@ int mpECP_set_bytes(mpECP_t rpt, unsigned char *b, size_t blen, mpECurve_t cv) {
                             mpFp_add(s, s, x);
                             mpFp_mul(s, s, cv->coeff.mo.Binv);
                             error = mpFp_sqrt(y, s);
-                            mpFp_clear(s);
-                            if (error != 0) {
-                                mpFp_clear(t);
-                                mpFp_clear(y);
-                                mpFp_clear(x);
-                                mpz_clear(xz);
-                                return -1;
-                            }
                         }
                         break;
                     default:
                         assert(_known_curve_type(cv));
-                        return -1;
+                        error = -1;
+                }
+                if (error != 0) {
+                    mpECScratch_clear(scr);
+                    return -1;
                 }
-                odd = mpz_tstbit(y->i, 0);
+                odd = mpFp_tstbit(y, 0);
                 // '3' implies odd, '2' even... negate if not matched
                 if ((b[0] & 0x01) != odd) {
                     mpFp_neg(y, y);
                 }
                 mpECP_set_mpFp(rpt, x, y, cv);
-                mpFp_clear(t);
-                mpFp_clear(y);
-                mpFp_clear(x);
-                mpz_clear(xz);
+                mpECScratch_clear(scr);
             }
             return 0;
         default:
@@ -480,6 +482,160 @@ int mpECP_set_bytes(mpECP_t rpt, unsigned char *b, size_t blen, mpECurve_t cv) {
     assert(0);
 }
 
+// number of points decoded together by mpECP_set_bytes_batch (bounds the
+// workspace independent of n)
+#define _MPECP_SET_BYTES_CHUNK  (64)
+
+int mpECP_set_bytes_batch(mpECP_ptr *pts, unsigned char **bufs, size_t *lens, size_t n, mpECurve_t cv, int *status) {
+    int bytes;
+    int result = 0;
+    size_t base;
+    mpECScratch_t scr;
+    mpFp_t x[_MPECP_SET_BYTES_CHUNK];
+    mpFp_t num[_MPECP_SET_BYTES_CHUNK];
+    mpFp_t den[_MPECP_SET_BYTES_CHUNK];
+    mpFp_t pre[_MPECP_SET_BYTES_CHUNK];
+    int valid[_MPECP_SET_BYTES_CHUNK];
+    mpFp_t k, t, y, one;
+    size_t j;
+
+    bytes = _bytelen(cv->bits);
+    mpECScratch_init(scr, ((4 * _MPECP_SET_BYTES_CHUNK) + 5) * cv->fp->p2size);
+    for (j = 0; j < _MPECP_SET_BYTES_CHUNK; j++) {
+        mpFp_init_scratch(x[j], cv->fp, scr);
+        mpFp_init_scratch(num[j], cv->fp, scr);
+        mpFp_init_scratch(den[j], cv->fp, scr);
+        mpFp_init_scratch(pre[j], cv->fp, scr);
+    }
+    mpFp_init_scratch(k, cv->fp, scr);
+    mpFp_init_scratch(t, cv->fp, scr);
+    mpFp_init_scratch(y, cv->fp, scr);
+    mpFp_init_scratch(one, cv->fp, scr);
+    mpFp_set_ui_fp(one, 1, cv->fp);
+
+    // curve constant shared by all points: c**2 * d (Edwards), d (twisted)
+    switch (cv->type) {
+        case EQTypeEdwards:
+            mpFp_mul(k, cv->coeff.ed.c, cv->coeff.ed.c);
+            mpFp_mul(k, k, cv->coeff.ed.d);
+            break;
+        case EQTypeTwistedEdwards:
+            mpFp_set(k, cv->coeff.te.d);
+            break;
+        default:
+            assert(_known_curve_type(cv));
+            break;
+    }
+
+    for (base = 0; base < n; base += _MPECP_SET_BYTES_CHUNK) {
+        size_t m = n - base;
+        int ninv = 0;
+
+        if (m > _MPECP_SET_BYTES_CHUNK) m = _MPECP_SET_BYTES_CHUNK;
+
+        // pass 1: y**2 = num / den for compressed points (den = 1 unless
+        // Edwards/twisted Edwards), others are decoded directly
+        for (j = 0; j < m; j++) {
+            unsigned char *b = bufs[base + j];
+            size_t blen = lens[base + j];
+
+            valid[j] = 0;
+            mpFp_set(den[j], one);
+            if ((blen != (1 + bytes)) || ((b[0] != 2) && (b[0] != 3))) {
+                // neutral, uncompressed (or invalid)
+                valid[j] = (mpECP_set_bytes(pts[base + j], b, blen, cv) == 0) ? 2 : -1;
+                continue;
+            }
+            valid[j] = 1;
+            mpz_import(x[j]->i, bytes, 1, sizeof(unsigned char), 1, 0, &b[1]);
+            mpFp_set_mpz_fp(x[j], x[j]->i, cv->fp);
+            switch (cv->type) {
+                case EQTypeShortWeierstrass:
+                    // y**2 = x**3 + ax + b
+                    mpFp_sqr(t, x[j]);
+                    mpFp_add(t, t, cv->coeff.ws.a);
+                    mpFp_mul(t, t, x[j]);
+                    mpFp_add(num[j], t, cv->coeff.ws.b);
+                    break;
+                case EQTypeEdwards:
+                    // y**2 = (c**2 - x**2) / (1 - c**2 * d * x**2)
+                    mpFp_sqr(t, x[j]);
+                    mpFp_mul(den[j], k, t);
+                    mpFp_sub(den[j], one, den[j]);
+                    mpFp_mul(num[j], cv->coeff.ed.c, cv->coeff.ed.c);
+                    mpFp_sub(num[j], num[j], t);
+                    ninv = 1;
+                    break;
+                case EQTypeTwistedEdwards:
+                    // y**2 = (1 - a * x**2) / (1 - d * x**2)
+                    mpFp_sqr(t, x[j]);
+                    mpFp_mul(den[j], k, t);
+                    mpFp_sub(den[j], one, den[j]);
+                    mpFp_mul(num[j], cv->coeff.te.a, t);
+                    mpFp_sub(num[j], one, num[j]);
+                    ninv = 1;
+                    break;
+                case EQTypeMontgomery:
+                    // B * y**2 = x**3 + A * x**2 + x
+                    mpFp_add(t, x[j], cv->coeff.mo.A);
+                    mpFp_mul(t, t, x[j]);
+                    mpFp_add(t, t, one);
+                    mpFp_mul(num[j], x[j], t);
+                    mpFp_mul(num[j], num[j], cv->coeff.mo.Binv);
+                    break;
+                default:
+                    valid[j] = -1;
+                    break;
+            }
+            if (mpFp_cmp_ui(den[j], 0) == 0) {
+                // not invertible, keep the product chain nonzero
+                valid[j] = -1;
+                mpFp_set(den[j], one);
+            }
+        }
+
+        // pass 2: invert all denominators with a single inversion
+        if (ninv) {
+            mpFp_set(pre[0], den[0]);
+            for (j = 1; j < m; j++) {
+                mpFp_mul(pre[j], pre[j - 1], den[j]);
+            }
+            mpFp_inv(t, pre[m - 1]);
+            for (j = m - 1; j > 0; j--) {
+                mpFp_mul(y, t, pre[j - 1]);
+                mpFp_mul(t, t, den[j]);
+                mpFp_mul(num[j], num[j], y);
+            }
+            mpFp_mul(num[0], num[0], t);
+        }
+
+        // pass 3: square roots, sign from the encoding
+        for (j = 0; j < m; j++) {
+            unsigned char *b = bufs[base + j];
+            int st = 0;
+
+            if (valid[j] == 1) {
+                if (mpFp_sqrt(y, num[j]) != 0) {
+                    st = -1;
+                } else {
+                    // '3' implies odd, '2' even... negate if not matched
+                    if ((b[0] & 0x01) != mpFp_tstbit(y, 0)) {
+                        mpFp_neg(y, y);
+                    }
+                    mpECP_set_mpFp(pts[base + j], x[j], y, cv);
+                }
+            } else if (valid[j] < 0) {
+                st = -1;
+            }
+            if (status != NULL) status[base + j] = st;
+            if (st != 0) result = -1;
+        }
+    }
+
+    mpECScratch_clear(scr);
+    return result;
+}
+
 int  mpECP_out_bytelen(mpECP_t pt, int compress) {
     int bytes;
     bytes = _bytelen(pt->cvp->bits);
@@ -636,6 +792,8 @@ void mpECP_neg(mpECP_t rpt, mpECP_t pt) {
 }
 
 int mpECP_cmp(mpECP_t pt1, mpECP_t pt2) {
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 2];
     if (mpECurve_cmp(pt1->cvp, pt2->cvp) != 0) return -1;
     if (pt1->is_neutral != 0) {
         if (pt2->is_neutral != 0) {
@@ -653,8 +811,9 @@ int mpECP_cmp(mpECP_t pt1, mpECP_t pt2) {
 #ifndef _MPECP_USE_RCB
             {
                 mpFp_t U1, U2;
-                mpFp_init_fp(U1, pt1->cvp->fp);
-                mpFp_init_fp(U2, pt1->cvp->fp);
+                mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 2);
+                mpFp_init_scratch(U1, pt1->cvp->fp, scr);
+                mpFp_init_scratch(U2, pt1->cvp->fp, scr);
                 mpFp_pow_ui(U1, pt2->z, 2);
                 mpFp_mul(U1, U1, pt1->x);
                 mpFp_pow_ui(U2, pt1->z, 2);
@@ -665,32 +824,29 @@ int mpECP_cmp(mpECP_t pt1, mpECP_t pt2) {
                 mpFp_pow_ui(U2, pt1->z, 3);
                 mpFp_mul(U2, U2, pt2->y);
                 if (mpFp_cmp(U1, U2) != 0) goto mows_return_notequal;
-                mpFp_clear(U2);
-                mpFp_clear(U1);
+                mpECScratch_clear(scr);
                 break;
 mows_return_notequal:
-                mpFp_clear(U2);
-                mpFp_clear(U1);
+                mpECScratch_clear(scr);
                 return -1;
             }
 #endif
         case EQTypeEdwards:
         case EQTypeTwistedEdwards: {
                 mpFp_t U1, U2;
-                mpFp_init_fp(U1, pt1->cvp->fp);
-                mpFp_init_fp(U2, pt1->cvp->fp);
+                mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 2);
+                mpFp_init_scratch(U1, pt1->cvp->fp, scr);
+                mpFp_init_scratch(U2, pt1->cvp->fp, scr);
                 mpFp_mul(U1, pt2->z, pt1->x);
                 mpFp_mul(U2, pt1->z, pt2->x);
                 if (mpFp_cmp(U1, U2) != 0) goto edte_return_notequal;
                 mpFp_mul(U1, pt2->z, pt1->y);
                 mpFp_mul(U2, pt1->z, pt2->y);
                 if (mpFp_cmp(U1, U2) != 0) goto edte_return_notequal;
-                mpFp_clear(U2);
-                mpFp_clear(U1);
+                mpECScratch_clear(scr);
                 break;
 edte_return_notequal:
-                mpFp_clear(U2);
-                mpFp_clear(U1);
+                mpECScratch_clear(scr);
                 return -1;
             }
         default:
@@ -702,6 +858,7 @@ edte_return_notequal:
 void mpECP_swap(mpECP_t pt2, mpECP_t pt1) {
     int t;
     struct _p_mpECP_t *t_base_pt;
+    const mp_limb_t *t_base_const;
     assert(mpECurve_cmp(pt1->cvp, pt2->cvp) == 0);
     mpFp_cswap(pt2->x, pt1->x, 1);
     mpFp_cswap(pt2->y, pt1->y, 1);
@@ -715,6 +872,9 @@ void mpECP_swap(mpECP_t pt2, mpECP_t pt1) {
     t_base_pt = pt2->base_pt;
     pt2->base_pt = pt1->base_pt;
     pt1->base_pt = t_base_pt;
+    t_base_const = pt2->base_const;
+    pt2->base_const = pt1->base_const;
+    pt1->base_const = t_base_const;
     return;
 }
 
@@ -743,7 +903,7 @@ void mpECP_cswap(mpECP_t pt2, mpECP_t pt1, int swap) {
 
 void mpECP_add(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
 #ifdef _MPECP_USE_RCB
-    mpFp_ptr aa, bb;
+    mpFp_ptr aa, b3;
 #endif
     assert(mpECurve_cmp(pt1->cvp, pt2->cvp) == 0);
     if (pt1->is_neutral != 0) {
@@ -761,14 +921,14 @@ void mpECP_add(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
     if (rpt->base_bits != 0) _mpECP_base_pts_cleanup(rpt);
 #ifdef _MPECP_USE_RCB
     aa = pt1->cvp->coeff.ws.a;
-    bb = pt1->cvp->coeff.ws.b;
+    b3 = pt1->cvp->coeff.ws.b3;
 #endif
     switch (pt1->cvp->type) {
         case EQTypeMontgomery:
             // Montgomery curve point internal representation is short-WS
 #ifdef _MPECP_USE_RCB
             aa = pt1->cvp->coeff.mo.ws_a;
-            bb = pt1->cvp->coeff.mo.ws_b;
+            b3 = pt1->cvp->coeff.mo.ws_b3;
 #endif
         case EQTypeShortWeierstrass: {
             // RCB uses projective coords, so fall through to same xform as Ed
@@ -776,16 +936,15 @@ void mpECP_add(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
                 //assert(0); // might want to implement something here ;)
                 // 2015 Renes-Costello-Batina "Algorithm 1"
                 // from https://eprint.iacr.org/2015/1060.pdf
-                mpFp_t t0, t1, t2, t3, t4, t5, b3;
+                mpFp_t t0, t1, t2, t3, t4, t5;
 #ifdef _MPECP_MPFP_NOMALLOC
-                __local_limb_t lt0, lt1, lt2, lt3, lt4, lt5, lb3;
+                __local_limb_t lt0, lt1, lt2, lt3, lt4, lt5;
                 t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt1->cvp->fp;
                 t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt1->cvp->fp;
                 t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt1->cvp->fp;
                 t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt1->cvp->fp;
                 t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt1->cvp->fp;
                 t5->i->_mp_d = lt5; t5->i->_mp_size = 0; t5->i->_mp_alloc = _MPFP_MAX_LIMBS; t5->fp = pt1->cvp->fp;
-                b3->i->_mp_d = lb3; b3->i->_mp_size = 0; b3->i->_mp_alloc = _MPFP_MAX_LIMBS; b3->fp = pt1->cvp->fp;
 #else
                 mpFp_init_fp(t0, pt1->cvp->fp);
                 mpFp_init_fp(t1, pt1->cvp->fp);
@@ -793,11 +952,8 @@ void mpECP_add(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
                 mpFp_init_fp(t3, pt1->cvp->fp);
                 mpFp_init_fp(t4, pt1->cvp->fp);
                 mpFp_init_fp(t5, pt1->cvp->fp);
-                mpFp_init_fp(b3, pt1->cvp->fp);
 #endif
-                // TODO: Precalculate b3 and store in coeff.ws.b3
-                mpFp_add(b3, bb, bb);
-                mpFp_add(b3, b3, bb);
+                // b3 = 3 * b is precomputed with the curve
 
                 // 1. t0 <- X1 * X2
                 // 2. t1 <- Y1 * Y2
@@ -930,7 +1086,6 @@ void mpECP_add(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
                 }
 
 #ifndef _MPECP_MPFP_NOMALLOC
-                mpFp_clear(b3);
                 mpFp_clear(t5);
                 mpFp_clear(t4);
                 mpFp_clear(t3);
@@ -1315,19 +1470,33 @@ void mpECP_sub(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
         }
     } else {
         mpECP_t n;
-        mpECP_init(n, pt1->cvp);
+        mpECScratch_t scr;
+        mp_limb_t scrl[_MPFP_MAX_LIMBS * 3];
+        mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 3);
+        mpECP_init_scratch(n, pt1->cvp, scr);
         mpECP_neg(n, pt2);
         mpECP_add(rpt, pt1, n);
-        mpECP_clear(n);
+        mpECScratch_clear(scr);
     }
     return;
 }
 
 void mpECP_scalar_mul(mpECP_t rpt, mpECP_t pt, mpFp_t sc) {
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPEC_SCRATCH_LIMBS];
+    mpECScratch_init_buffer(scr, scrl, _MPEC_SCRATCH_LIMBS);
+    mpECP_scalar_mul_scratch(rpt, pt, sc, scr);
+    mpECScratch_clear(scr);
+    return;
+}
+
+void mpECP_scalar_mul_scratch(mpECP_t rpt, mpECP_t pt, mpFp_t sc, mpECScratch_t scr) {
     int i;
+    size_t mark;
     mpECP_t R0, R1;
-    mpECP_init(R0, pt->cvp);
-    mpECP_init(R1, pt->cvp);
+    mark = mpECScratch_mark(scr);
+    mpECP_init_scratch(R0, pt->cvp, scr);
+    mpECP_init_scratch(R1, pt->cvp, scr);
     mpECP_set_neutral(R0, pt->cvp);
     mpECP_set(R1, pt);
     // scalar should be modulo the order of the curve
@@ -1342,21 +1511,244 @@ void mpECP_scalar_mul(mpECP_t rpt, mpECP_t pt, mpFp_t sc) {
         _mpECP_cswap_safe(R0, R1, b);
     }
     mpECP_set(rpt, R0);
-    mpECP_clear(R1);
-    mpECP_clear(R0);
+    mpECScratch_release(scr, mark);
     return;
 }
 
 void mpECP_scalar_mul_mpz(mpECP_t rpt, mpECP_t pt, mpz_t sc) {
     mpFp_t s;
-    mpFp_init_fp(s, pt->cvp->fp);
-    mpFp_set_mpz(s, sc, pt->cvp->n);
-    mpECP_scalar_mul(rpt, pt, s);
-    mpFp_clear(s);
+    mpFp_field_ptr fn;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPEC_SCRATCH_LIMBS];
+    mpECScratch_init_buffer(scr, scrl, _MPEC_SCRATCH_LIMBS);
+    fn = _mpFp_field_lookup(pt->cvp->n);
+    mpFp_init_scratch(s, fn, scr);
+    mpFp_set_mpz_fp(s, sc, fn);
+    mpECP_scalar_mul_scratch(rpt, pt, s, scr);
+    mpECScratch_clear(scr);
+    return;
+}
+
+// window width of the shared scalar recoding in mpECP_scalar_mul_batch
+#define _MPECP_BATCH_WINDOW     (4)
+#define _MPECP_BATCH_TABLE      (1 << (_MPECP_BATCH_WINDOW - 1))
+#define _MPECP_MAX_DIGITS       ((((_MPFP_MAX_LIMBS / 2) * GMP_NUMB_BITS) / _MPECP_BATCH_WINDOW) + 2)
+
+// rpt = pt if c != 0, without branching on c
+static void _mpECP_cmov(mpECP_t rpt, mpECP_t pt, int c) {
+    mp_limb_t mask;
+    int i;
+
+    mask = -((mp_limb_t)(c != 0));
+    for (i = 0; i < rpt->cvp->fp->psize; i++) {
+        rpt->x->i->_mp_d[i] ^= mask & (rpt->x->i->_mp_d[i] ^ pt->x->i->_mp_d[i]);
+        rpt->y->i->_mp_d[i] ^= mask & (rpt->y->i->_mp_d[i] ^ pt->y->i->_mp_d[i]);
+        rpt->z->i->_mp_d[i] ^= mask & (rpt->z->i->_mp_d[i] ^ pt->z->i->_mp_d[i]);
+    }
+    rpt->is_neutral ^= (int)mask & (rpt->is_neutral ^ pt->is_neutral);
     return;
 }
 
+// Multiply many points by the same scalar. The scalar (forced odd) is
+// recoded once into signed odd digits (regular recoding, Joye-Tunstall), so
+// every window is a fixed number of doublings plus one addition from a
+// per-point table of odd multiples, selected without branching on the
+// digit. Even scalars are corrected by a conditional subtraction of pt.
+void mpECP_scalar_mul_batch(mpECP_ptr *rpts, mpECP_ptr *pts, mpFp_t sc, size_t n) {
+    signed char digit[_MPECP_MAX_DIGITS];
+    mp_limb_t k[(_MPFP_MAX_LIMBS / 2) + 1];
+    mpECP_t T[_MPECP_BATCH_TABLE], P2, Q, Qn, R, Rm, Pn;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 3 * (_MPECP_BATCH_TABLE + 6)];
+    mpECurve_ptr cvp;
+    mp_size_t ksize;
+    int i, j, l, m, even;
+    size_t q;
+
+    if (n == 0) return;
+    cvp = pts[0]->cvp;
+    // scalar should be modulo the order of the curve
+    assert(mpz_cmp(sc->fp->p, cvp->n) == 0);
+
+    // k = sc | 1, digits d[i] odd with |d[i]| < 2**w and sum(d[i] * 2**(w*i))
+    // = k, the top digit is 1
+    ksize = sc->fp->psize;
+    for (i = 0; i < ksize; i++) {
+        k[i] = sc->i->_mp_d[i];
+    }
+    even = (int)(1 - (k[0] & 1));
+    k[0] |= 1;
+    m = ((mpz_sizeinbase(cvp->n, 2) + _MPECP_BATCH_WINDOW - 1) / _MPECP_BATCH_WINDOW) + 1;
+    assert(m <= _MPECP_MAX_DIGITS);
+    for (i = 0; i < (m - 1); i++) {
+        digit[i] = (signed char)((int)(k[0] & ((2 << _MPECP_BATCH_WINDOW) - 1)) - (1 << _MPECP_BATCH_WINDOW));
+        mpn_rshift(k, k, ksize, _MPECP_BATCH_WINDOW);
+        k[0] |= 1;
+    }
+    assert(mpn_zero_p(k + 1, ksize - 1) && (k[0] == 1));
+
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 3 * (_MPECP_BATCH_TABLE + 6));
+    for (j = 0; j < _MPECP_BATCH_TABLE; j++) {
+        mpECP_init_scratch(T[j], cvp, scr);
+    }
+    mpECP_init_scratch(P2, cvp, scr);
+    mpECP_init_scratch(Q, cvp, scr);
+    mpECP_init_scratch(Qn, cvp, scr);
+    mpECP_init_scratch(R, cvp, scr);
+    mpECP_init_scratch(Rm, cvp, scr);
+    mpECP_init_scratch(Pn, cvp, scr);
+
+    for (q = 0; q < n; q++) {
+        assert(mpECurve_cmp(pts[q]->cvp, cvp) == 0);
+        if (pts[q]->is_neutral != 0) {
+            mpECP_set_neutral(rpts[q], cvp);
+            continue;
+        }
+        // T[j] = (2j + 1) * pt
+        mpECP_set(T[0], pts[q]);
+        mpECP_double(P2, T[0]);
+        for (j = 1; j < _MPECP_BATCH_TABLE; j++) {
+            mpECP_add(T[j], T[j - 1], P2);
+        }
+        mpECP_neg(Pn, T[0]);
+
+        mpECP_set(R, T[0]);
+        for (i = m - 2; i >= 0; i--) {
+            int a, s;
+
+            for (l = 0; l < _MPECP_BATCH_WINDOW; l++) {
+                mpECP_double(R, R);
+            }
+            s = (digit[i] < 0);
+            a = (digit[i] ^ -s) + s;
+            mpECP_set(Q, T[0]);
+            for (j = 1; j < _MPECP_BATCH_TABLE; j++) {
+                _mpECP_cmov(Q, T[j], j == ((a - 1) >> 1));
+            }
+            mpECP_neg(Qn, Q);
+            _mpECP_cswap_safe(Q, Qn, s);
+            mpECP_add(R, R, Q);
+        }
+        mpECP_add(Rm, R, Pn);
+        _mpECP_cswap_safe(R, Rm, even);
+        mpECP_set(rpts[q], R);
+    }
+#ifdef SAFE_CLEAN
+    memset(digit, 0, sizeof(digit));
+    memset(k, 0, sizeof(k));
+#endif
+    mpECScratch_clear(scr);
+    return;
+}
+
+// convert points to affine coordinates (z = 1) with one field inversion
+// per chunk of points
+void mpECP_normalize_batch(mpECP_ptr *pts, size_t n) {
+    mpECurve_ptr cvp;
+    mpECScratch_t scr;
+    mpFp_t pre[_MPECP_SET_BYTES_CHUNK];
+    mpFp_t inv, zinv, t;
+    size_t base, idx[_MPECP_SET_BYTES_CHUNK];
+    int j, cnt;
+
+    if (n == 0) return;
+    cvp = pts[0]->cvp;
+    mpECScratch_init(scr, (_MPECP_SET_BYTES_CHUNK + 3) * cvp->fp->p2size);
+    for (j = 0; j < _MPECP_SET_BYTES_CHUNK; j++) {
+        mpFp_init_scratch(pre[j], cvp->fp, scr);
+    }
+    mpFp_init_scratch(inv, cvp->fp, scr);
+    mpFp_init_scratch(zinv, cvp->fp, scr);
+    mpFp_init_scratch(t, cvp->fp, scr);
+
+    for (base = 0; base < n; base += _MPECP_SET_BYTES_CHUNK) {
+        size_t q;
+
+        // prefix products of the z coordinates that need normalizing
+        cnt = 0;
+        for (q = base; (q < n) && (q < (base + _MPECP_SET_BYTES_CHUNK)); q++) {
+            assert(mpECurve_cmp(pts[q]->cvp, cvp) == 0);
+            if (pts[q]->is_neutral != 0) continue;
+            if (mpFp_cmp_ui(pts[q]->z, 1) == 0) continue;
+            if (__GMP_UNLIKELY(mpFp_cmp_ui(pts[q]->z, 0) == 0)) continue;
+            if (cnt == 0) {
+                mpFp_set(pre[0], pts[q]->z);
+            } else {
+                mpFp_mul(pre[cnt], pre[cnt - 1], pts[q]->z);
+            }
+            idx[cnt] = q;
+            cnt++;
+        }
+        if (cnt == 0) continue;
+        mpFp_inv(inv, pre[cnt - 1]);
+        for (j = cnt - 1; j >= 0; j--) {
+            mpECP_ptr pt;
+
+            pt = pts[idx[j]];
+            if (j > 0) {
+                mpFp_mul(zinv, inv, pre[j - 1]);
+                mpFp_mul(inv, inv, pt->z);
+            } else {
+                mpFp_set(zinv, inv);
+            }
+            switch (cvp->type) {
+                case EQTypeMontgomery:
+                case EQTypeShortWeierstrass:
+#ifndef _MPECP_USE_RCB
+                    // Jacobian coords x = X/Z**2 y = Y/Z**3
+                    mpFp_sqr(t, zinv);
+                    mpFp_mul(pt->x, pt->x, t);
+                    mpFp_mul(t, t, zinv);
+                    mpFp_mul(pt->y, pt->y, t);
+                    break;
+#endif
+                case EQTypeEdwards:
+                case EQTypeTwistedEdwards:
+                    mpFp_mul(pt->x, pt->x, zinv);
+                    mpFp_mul(pt->y, pt->y, zinv);
+                    break;
+                default:
+                    assert(_known_curve_type(cvp));
+            }
+            mpFp_set_ui_fp(pt->z, 1, cvp->fp);
+        }
+    }
+    mpECScratch_clear(scr);
+    return;
+}
+
+#ifdef _MPECP_BASE_CONST
+// use the prebuilt table if pt is the generator of a curve which has one
+static int _mpECP_base_const_attach(mpECP_t pt, int bits) {
+    const _mpECP_base_const_t *bc;
+    mpECurve_ptr cv;
+    mpECP_t G;
+    int i, match;
+
+    for (i = 0; i < _MPECP_BASE_CONST_COUNT; i++) {
+        bc = &(_mpECP_base_const[i]);
+        if ((bc->base_bits != bits) || (bc->psize != pt->cvp->fp->psize)) continue;
+        cv = mpECurve_named(bc->name);
+        if ((cv == NULL) || (mpECurve_cmp(cv, pt->cvp) != 0)) continue;
+        mpECP_init(G, pt->cvp);
+        mpECP_set_mpz(G, pt->cvp->G[0], pt->cvp->G[1], pt->cvp);
+        match = (mpECP_cmp(G, pt) == 0);
+        mpECP_clear(G);
+        if (match == 0) return 0;
+        pt->base_bits = bits;
+        pt->base_const = bc->xy;
+        return 1;
+    }
+    return 0;
+}
+#endif
+
 void mpECP_scalar_base_mul_setup(mpECP_t pt) {
+    mpECP_scalar_base_mul_setup_bits(pt, _MPECP_BASE_BITS);
+    return;
+}
+
+void mpECP_scalar_base_mul_setup_bits(mpECP_t pt, int bits) {
     int i, j, npts, nlevels, levelsz;
     mpECP_t a, b;
     struct _p_mpECP_t *level_pt;
@@ -1365,10 +1757,14 @@ void mpECP_scalar_base_mul_setup(mpECP_t pt) {
         // already set up... 
         return;
     }
+    assert((bits > 0) && (bits <= 16));
+#ifdef _MPECP_BASE_CONST
+    if (_mpECP_base_const_attach(pt, bits) != 0) return;
+#endif
     mpECP_init(a, pt->cvp);
     mpECP_init(b, pt->cvp);
     assert(pt->base_bits == 0);
-    pt->base_bits = _MPECP_BASE_BITS;
+    pt->base_bits = bits;
     npts = _mpECP_n_base_pts(pt);
     base_pt = (struct _p_mpECP_t *)malloc(npts * sizeof(struct _p_mpECP_t));
     for (i = 0; i < npts; i++) {
@@ -1400,54 +1796,143 @@ void mpECP_scalar_base_mul_setup(mpECP_t pt) {
     return;
 }
 
+// extract the base_bits wide window at level j directly from scalar limbs
+static inline int _mpECP_base_window(mpFp_t sc, int base_bits, int j) {
+    int bit, limb, shift, k;
+    mp_limb_t w;
+    bit = j * base_bits;
+    limb = bit / GMP_NUMB_BITS;
+    shift = bit % GMP_NUMB_BITS;
+    if (limb >= sc->fp->psize) return 0;
+    w = sc->i->_mp_d[limb] >> shift;
+    if (((shift + base_bits) > GMP_NUMB_BITS) && ((limb + 1) < sc->fp->psize)) {
+        w |= sc->i->_mp_d[limb + 1] << (GMP_NUMB_BITS - shift);
+    }
+    k = (int)(w & ((((mp_limb_t)1) << base_bits) - 1));
+    return k;
+}
+
+#ifdef _MPECP_BASE_CONST
+// read only view of psize limbs (e.g. a prebuilt table coordinate)
+static inline void _mpFp_view_limbs(mpFp_t a, const mp_limb_t *d, mpFp_field_ptr fp) {
+    a->fp = fp;
+    a->i->_mp_d = (mp_limb_t *)d;
+    a->i->_mp_alloc = fp->psize;
+    a->i->_mp_size = fp->psize;
+    return;
+}
+
+static void _mpECP_scalar_base_mul_const(mpECP_t rpt, mpECP_t pt, mpFp_t sc, mpECScratch_t scr) {
+    int j, k, nlevels, levelsz, psize;
+    size_t mark;
+    mpECP_t a, e, nt;
+    mpECScratch_t nscr;
+    mp_limb_t nscrl[_MPFP_MAX_LIMBS * 3];
+    mp_limb_t one[_MPFP_MAX_LIMBS];
+
+    psize = pt->cvp->fp->psize;
+    mark = mpECScratch_mark(scr);
+    mpECP_init_scratch(a, pt->cvp, scr);
+    mpECP_set_neutral(a, pt->cvp);
+    mpECScratch_init_buffer(nscr, nscrl, _MPFP_MAX_LIMBS * 3);
+    mpECP_init_scratch(nt, pt->cvp, nscr);
+    mpECP_set_neutral(nt, pt->cvp);
+    // table entries are affine, z = 1
+    memset(one, 0, psize * sizeof(mp_limb_t));
+    one[0] = 1;
+    e->cvp = pt->cvp;
+    e->is_neutral = 0;
+    e->base_bits = 0;
+    e->base_pt = NULL;
+    e->base_const = NULL;
+    _mpFp_view_limbs(e->z, one, pt->cvp->fp);
+    nlevels = _mpECP_n_base_pt_levels(pt);
+    levelsz = _mpECP_n_base_pt_level_size(pt);
+    for (j = 0; j < nlevels; j++) {
+        const mp_limb_t *xy;
+
+        k = _mpECP_base_window(sc, pt->base_bits, j);
+        if (k == 0) {
+            // neutral entries are not stored
+            mpECP_add(a, a, nt);
+            continue;
+        }
+        xy = &(pt->base_const[((j * (levelsz - 1)) + (k - 1)) * 2 * psize]);
+        _mpFp_view_limbs(e->x, xy, pt->cvp->fp);
+        _mpFp_view_limbs(e->y, xy + psize, pt->cvp->fp);
+        mpECP_add(a, a, e);
+    }
+    mpECP_set(rpt, a);
+    mpECScratch_clear(nscr);
+    mpECScratch_release(scr, mark);
+    return;
+}
+#endif
+
 void mpECP_scalar_base_mul(mpECP_t rpt, mpECP_t pt, mpFp_t sc) {
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 3];
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 3);
+    mpECP_scalar_base_mul_scratch(rpt, pt, sc, scr);
+    mpECScratch_clear(scr);
+    return;
+}
+
+void mpECP_scalar_base_mul_scratch(mpECP_t rpt, mpECP_t pt, mpFp_t sc, mpECScratch_t scr) {
     int j, nlevels, levelsz;
-    mpz_t s, kmpz;
+    size_t mark;
     mpECP_t a;
     assert (mpz_cmp(sc->fp->p, pt->cvp->n) == 0);
     if (pt->base_bits == 0) {
         mpECP_scalar_base_mul_setup(pt);
     }
-    mpz_init(s);
-    mpz_init(kmpz);
-    mpECP_init(a, pt->cvp);
+#ifdef _MPECP_BASE_CONST
+    if (pt->base_const != NULL) {
+        _mpECP_scalar_base_mul_const(rpt, pt, sc, scr);
+        return;
+    }
+#endif
+    mark = mpECScratch_mark(scr);
+    mpECP_init_scratch(a, pt->cvp, scr);
     mpECP_set_neutral(a, pt->cvp);
-    mpz_set_mpFp(s, sc);
     nlevels = _mpECP_n_base_pt_levels(pt);
     levelsz = _mpECP_n_base_pt_level_size(pt);
     for (j = 0; j < nlevels; j++) {
         int k;
 
-        mpz_mod_ui(kmpz, s, levelsz);
-        k = mpz_get_ui(kmpz);
+        k = _mpECP_base_window(sc, pt->base_bits, j);
         mpECP_add(a, a, &pt->base_pt[(j * levelsz) + k]);
-        mpz_tdiv_q_ui(s, s, levelsz);
     }
     mpECP_set(rpt, a);
-    mpECP_clear(a);
-    mpz_clear(kmpz);
-    mpz_clear(s);
+    mpECScratch_release(scr, mark);
     return;
 }
 
 void mpECP_scalar_base_mul_mpz(mpECP_t rpt, mpECP_t pt, mpz_t s) {
     mpFp_t sc;
-    mpFp_init_fp(sc, pt->cvp->fp);
-    mpFp_set_mpz(sc, s, pt->cvp->n);
-    mpECP_scalar_base_mul(rpt, pt, sc);
-    mpFp_clear(sc);
+    mpFp_field_ptr fn;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 4];
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 4);
+    fn = _mpFp_field_lookup(pt->cvp->n);
+    mpFp_init_scratch(sc, fn, scr);
+    mpFp_set_mpz_fp(sc, s, fn);
+    mpECP_scalar_base_mul_scratch(rpt, pt, sc, scr);
+    mpECScratch_clear(scr);
     return;
 }
 
 void mpECP_urandom(mpECP_t rpt, mpECurve_t cv) {
     mpFp_t a;
     mpECP_t g;
-    mpFp_init_fp(a, cv->fp);
-    mpECP_init(g, cv);
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPEC_SCRATCH_LIMBS];
+    mpECScratch_init_buffer(scr, scrl, _MPEC_SCRATCH_LIMBS);
+    mpFp_init_scratch(a, _mpFp_field_lookup(cv->n), scr);
+    mpECP_init_scratch(g, cv, scr);
     mpECP_set_mpz(g, cv->G[0], cv->G[1], cv);
     mpFp_urandom(a, cv->n);
-    mpECP_scalar_mul(rpt, g, a);
-    mpECP_clear(g);
-    mpFp_clear(a);
+    mpECP_scalar_mul_scratch(rpt, g, a, scr);
+    mpECScratch_clear(scr);
     return;
 }
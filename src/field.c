@@ -30,17 +30,16 @@
 
 #include <assert.h>
 #include <ecc/field.h>
+#include <ecc/fieldlanes.h>
 #include <ecc/mpzurandom.h>
+#include <ecc/scratch.h>
 #include <gmp.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define ARRAY_SZ    (200000)
-// _MPFP_MAX_LIMBS would be a 2048-bit integer in most cases (32*64)
-// This defines the limit on the bitsize of p**2 (which implies that
-// p can be at most 1024 bits)
-#define _MPFP_MAX_LIMBS   (32)
 
 #if 1
 #define PARANOID_ASSERT(X)  assert((X))
@@ -51,12 +50,65 @@
 void mpFp_field_init(mpFp_field field) {
     mpz_init(field->p);
     mpz_init(field->pc);
+    mpz_init(field->sqrt_e);
+    mpz_init(field->sqrt_c);
+    mpz_init(field->inv_e);
+    field->sqrt_type = _MPFP_SQRT_NONE;
+    field->inv_type = _MPFP_INV_GMP;
+    field->sg_size = 0;
     return;
 }
 
 void mpFp_field_clear(mpFp_field field) {
     mpz_clear(field->p);
     mpz_clear(field->pc);
+    mpz_clear(field->sqrt_e);
+    mpz_clear(field->sqrt_c);
+    mpz_clear(field->inv_e);
+    return;
+}
+
+// select the square root method for p and precompute its constants, so
+// that mpFp_sqrt needs neither a Legendre symbol nor a non-residue search
+static void _mpFp_field_sqrt_setup(mpFp_field field) {
+    mpz_t q;
+
+    field->sqrt_type = _MPFP_SQRT_NONE;
+    field->sqrt_s = 0;
+    mpz_set_ui(field->sqrt_e, 0);
+    mpz_set_ui(field->sqrt_c, 0);
+    if ((mpz_tstbit(field->p, 0) == 0) || (mpz_cmp_ui(field->p, 3) < 0)) {
+        return;
+    }
+    if (mpz_tstbit(field->p, 1) != 0) {
+        // p = 3 mod 4
+        mpz_tdiv_q_2exp(field->sqrt_e, field->p, 2);
+        mpz_add_ui(field->sqrt_e, field->sqrt_e, 1);
+        field->sqrt_s = 1;
+        field->sqrt_type = _MPFP_SQRT_3MOD4;
+        return;
+    }
+    if (mpz_tstbit(field->p, 2) != 0) {
+        // p = 5 mod 8
+        mpz_tdiv_q_2exp(field->sqrt_e, field->p, 3);
+        field->sqrt_s = 2;
+        field->sqrt_type = _MPFP_SQRT_5MOD8;
+        return;
+    }
+    // p = 1 mod 8
+    mpz_init(q);
+    mpz_sub_ui(q, field->p, 1);
+    field->sqrt_s = (int)mpz_scan1(q, 0);
+    mpz_tdiv_q_2exp(q, q, field->sqrt_s);
+    mpz_tdiv_q_2exp(field->sqrt_e, q, 1);
+    mpz_set_ui(field->sqrt_c, 2);
+    while (mpz_legendre(field->sqrt_c, field->p) != -1) {
+        mpz_add_ui(field->sqrt_c, field->sqrt_c, 1);
+        assert(mpz_cmp(field->sqrt_c, field->p) < 0);
+    }
+    mpz_powm(field->sqrt_c, field->sqrt_c, q, field->p);
+    mpz_clear(q);
+    field->sqrt_type = _MPFP_SQRT_TS;
     return;
 }
 
@@ -80,6 +132,23 @@ void mpFp_field_set_mpz(mpFp_field field, mpz_t p) {
     for (i = field->pc->_mp_size; i < field->psize; i++) {
         field->pc->_mp_d[i] = 0;
     }
+
+    // Barrett reciprocal (for fixed size reduction kernels)
+    {
+        mpz_t mu;
+        mpz_init(mu);
+        mpz_setbit(mu, 2 * GMP_NUMB_BITS * field->psize);
+        mpz_tdiv_q(mu, mu, field->p);
+        assert(mu->_mp_size <= (field->psize + 1));
+        for (i = 0; i <= field->psize; i++) {
+            field->mu[i] = mpz_getlimbn(mu, i);
+        }
+        mpz_clear(mu);
+    }
+
+    _mpFp_field_lanes_setup(field);
+    _mpFp_field_sqrt_setup(field);
+    _mpFp_field_inv_setup(field);
     return;
 }
 
@@ -105,9 +174,26 @@ static void _cleanup_field_list(void) {
     }
 }
 
+static pthread_mutex_t _static_field_list_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static mpFp_field_ptr _mpFp_field_find(_mpFp_field_list_t ***l, mpz_t p) {
+    _mpFp_field_list_t *l_this;
+
+    while ((l_this = __atomic_load_n(*l, __ATOMIC_ACQUIRE)) != NULL) {
+        if (mpz_cmp(l_this->fp->p, p) == 0) {
+            return l_this->fp;
+        }
+        *l = &(l_this->next);
+    }
+    return NULL;
+}
+
+// lookups are lock free, fields are only appended (fully initialized) to
+// the list so concurrent readers (e.g. nonce pool workers) are safe.
 mpFp_field_ptr _mpFp_field_lookup(mpz_t p) {
     _mpFp_field_list_t **l;
     _mpFp_field_list_t *l_this;
+    mpFp_field_ptr fp;
 
     size_t psz;
 
@@ -116,26 +202,29 @@ mpFp_field_ptr _mpFp_field_lookup(mpz_t p) {
     // definition of contstant and recomile library
     assert ((psz * 2) <= _MPFP_MAX_LIMBS);
 
+    l = &_static_field_list;
+    fp = _mpFp_field_find(&l, p);
+    if (__GMP_LIKELY(fp != NULL)) return fp;
+
+    pthread_mutex_lock(&_static_field_list_lock);
     if (_static_field_list == NULL) {
         atexit(&_cleanup_field_list);
     }
-
-    l = &_static_field_list;
-    while (*l != NULL) {
-        l_this = *l;
-        if (mpz_cmp(l_this->fp->p, p) == 0) {
-            return l_this->fp;
-        }
-        l = &(l_this->next);
+    // another thread may have appended while we were unlocked
+    fp = _mpFp_field_find(&l, p);
+    if (fp != NULL) {
+        pthread_mutex_unlock(&_static_field_list_lock);
+        return fp;
     }
     l_this = (_mpFp_field_list_t *)malloc(sizeof(_mpFp_field_list_t));
     assert(l_this != NULL);
     l_this->fp = (mpFp_field_ptr)malloc(sizeof(_mpFp_field_struct));
     assert(l_this->fp != NULL);
-    *l = l_this;
     mpFp_field_init(l_this->fp);
     mpFp_field_set_mpz(l_this->fp, p);
     l_this->next = NULL;
+    __atomic_store_n(l, l_this, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&_static_field_list_lock);
     //gmp_printf("created field Fp: p = 0x%ZX\n", p);
     return l_this->fp;
 }
@@ -151,7 +240,7 @@ void mpFp_init(mpFp_t c, mpz_t p) {
     fp = _mpFp_field_lookup(p);
     c->fp = fp;
     assert(fp != NULL);
-    mpz_init2(c->i,fp->p2size*sizeof(c->i->_mp_d[0]));
+    mpz_init2(c->i, fp->p2size * GMP_NUMB_BITS);
     ///mpz_realloc(c->i, fp->p2size);
     mpFp_realloc(c);
     return;
@@ -160,7 +249,7 @@ void mpFp_init(mpFp_t c, mpz_t p) {
 void mpFp_init_fp(mpFp_t c, mpFp_field_ptr fp) {
     c->fp = fp;
     assert(fp != NULL);
-    mpz_init2(c->i,fp->p2size*sizeof(c->i->_mp_d[0]));
+    mpz_init2(c->i, fp->p2size * GMP_NUMB_BITS);
     ///mpz_realloc(c->i, fp->p2size);
     mpFp_realloc(c);
     return;
@@ -194,8 +283,9 @@ void mpFp_set_mpz_fp(mpFp_t c, mpz_t a, mpFp_field_ptr fp) {
     c->fp = fp;
     assert(fp != NULL);
 
-    mpz_set(c->i, a);
-    mpz_mod(c->i, c->i, fp->p);
+    // mpz_mod never grows c->i beyond the size of p, so this is safe for
+    // elements with fixed (e.g. scratch) limb storage
+    mpz_mod(c->i, a, fp->p);
     assert (c->i->_mp_size <= fp->psize);
     //mpz_realloc(c->i, fp->p2size);
     mpFp_realloc(c);
@@ -406,6 +496,14 @@ int mpFp_inv(mpFp_t c, mpFp_t a) {
     mpFp_field_ptr fp;
     mp_limb_t tl[_MPFP_MAX_LIMBS*2];
     fp = a->fp;
+    switch (fp->inv_type) {
+        case _MPFP_INV_SAFEGCD:
+            return mpFp_inv_safegcd(c, a);
+        case _MPFP_INV_FERMAT:
+            return mpFp_inv_fermat(c, a);
+        default:
+            break;
+    }
     c->fp = a->fp;
     PARANOID_ASSERT(a->i->_mp_size == fp->psize);
     PARANOID_ASSERT(fp->psize <= _MPFP_MAX_LIMBS);
@@ -450,6 +548,13 @@ void mpFp_mul(mpFp_t c, mpFp_t a, mpFp_t b) {
     c->fp = a->fp;
     mpFp_realloc(c);
 
+#ifdef _MPFP_KERNEL4
+    if (fp->psize == 4) {
+        _mpFp_mul4(c->i->_mp_d, a->i->_mp_d, b->i->_mp_d, fp);
+        c->i->_mp_size = fp->psize;
+        return;
+    }
+#endif
     mpn_mul_n(tl, a->i->_mp_d, b->i->_mp_d, fp->psize);
     t->_mp_d = tl;
     t->_mp_size = fp->p2size;
@@ -509,6 +614,13 @@ void mpFp_sqr(mpFp_t c, mpFp_t a) {
     c->fp = a->fp;
     mpFp_realloc(c);
 
+#ifdef _MPFP_KERNEL4
+    if (fp->psize == 4) {
+        _mpFp_sqr4(c->i->_mp_d, a->i->_mp_d, fp);
+        c->i->_mp_size = fp->psize;
+        return;
+    }
+#endif
     mpn_sqr(tl, a->i->_mp_d, fp->psize);
     t->_mp_d = tl;
     t->_mp_size = fp->p2size;
@@ -528,9 +640,28 @@ void mpFp_sqr(mpFp_t c, mpFp_t a) {
     return;
 }
 
+// Exponentiation defers to mpz_powm (Montgomery form, windowed) which is
+// faster than a window over mpFp_mul/mpFp_sqr for all but the smallest
+// exponents. Squares (used throughout the curve arithmetic) use mpFp_sqr.
+
 void mpFp_pow_ui(mpFp_t c, mpFp_t a, unsigned long int b) {
     mpFp_field_ptr fp;
     fp = a->fp;
+
+    if (b <= 2) {
+        switch (b) {
+            case 0:
+                mpFp_set_ui_fp(c, 1, fp);
+                return;
+            case 1:
+                mpFp_set(c, a);
+                return;
+            default:
+                mpFp_sqr(c, a);
+                return;
+        }
+    }
+
     c->fp = a->fp;
     mpFp_realloc(c);
 
@@ -551,6 +682,12 @@ void mpFp_pow_ui(mpFp_t c, mpFp_t a, unsigned long int b) {
 void mpFp_pow_mpz(mpFp_t c, mpFp_t a, mpz_t b) {
     mpFp_field_ptr fp;
     fp = a->fp;
+
+    if ((mpz_sgn(b) >= 0) && (mpz_cmp_ui(b, 2) <= 0)) {
+        mpFp_pow_ui(c, a, mpz_get_ui(b));
+        return;
+    }
+
     c->fp = a->fp;
     mpFp_realloc(c);
 
@@ -611,7 +748,9 @@ void mpz_set_mpFp(mpz_t c, mpFp_t a) {
     mpFp_field_ptr fp;
     int i = 0;
     fp = a->fp;
-    mpz_realloc(c, fp->p2size);
+    if (__GMP_UNLIKELY(c->_mp_alloc < fp->psize)) {
+        mpz_realloc(c, fp->psize);
+    }
     assert (a->i->_mp_size == fp->psize);
 
     for (i = 0; i < fp->psize; i++) {
@@ -628,144 +767,103 @@ void mpz_set_mpFp(mpz_t c, mpFp_t a) {
 }
 
 void mpFp_urandom(mpFp_t a, mpz_t p) {
-    mpz_t aa;
-    mpz_init(aa);
-    mpz_urandom(aa, p);
-    mpFp_set_mpz(a, aa, p);
-    mpz_clear(aa);
+    mpFp_field_ptr fp;
+    fp = _mpFp_field_lookup(p);
+    a->fp = fp;
+    mpFp_realloc(a);
+    // mpz_urandom samples (< p) directly into the psize limbs of a, which
+    // are already allocated, so no temporary is required
+    mpz_urandom(a->i, p);
+    mpFp_set_mpz_fp(a, a->i, fp);
     return;
 }
 
-// python from RosettaCode
-//def tonelli(n, p):
-//    assert legendre(n, p) == 1, "not a square (mod p)"
-//    q = p - 1
-//    s = 0
-//    while q % 2 == 0:
-//        q //= 2
-//        s += 1
-//    if s == 1:
-//        return pow(n, (p + 1) // 4, p)
-//    for z in range(2, p):
-//        if p - 1 == legendre(z, p):
-//            break
-//    c = pow(z, q, p)
-//    r = pow(n, (q + 1) // 2, p)
-//    t = pow(n, q, p)
-//    m = s
-//    t2 = 0
-//    while (t - 1) % p != 0:
-//        t2 = (t * t) % p
-//        for i in range(1, m):
-//            if (t2 - 1) % p == 0:
-//                break
-//            t2 = (t2 * t2) % p
-//        b = pow(c, 1 << (m - i - 1), p)
-//        r = (r * b) % p
-//        c = (b * b) % p
-//        t = (t * c) % p
-//        m = i
-//    return r
-
 /* modular square root - return nonzero if not quadratic residue */ 
 
-int mpFp_sqrt(mpFp_t rop, mpFp_t op) {
-    int s;
-    int leg_op;
-    mpz_t t, q, opi;
-    mpz_init(opi);
-    mpz_set_mpFp(opi, op);
-    // determine whether i is a quadratic residue (mod p)
-    leg_op = mpz_legendre(opi, op->fp->p);
-    if (leg_op < 0) {
-        mpz_clear(opi);
-        return -1;
-    } else if (leg_op == 0) {
-        mpFp_set_ui_fp(rop, 0, op->fp);
-        mpz_clear(opi);
-        return 0;
-    }
-    mpz_init(t);
-    mpz_init(q);
+// The method (and its constants) are chosen per field at lookup time. There
+// is no separate Legendre symbol test, instead the candidate root is
+// verified by squaring. For p = 1 mod 8 this is the constant-time variant
+// of Tonelli-Shanks (RFC 9380 appendix I.4, fixed number of operations with
+// conditional swaps), using a non-residue found once per field.
 
-    // tonelli shanks algorithm
-    mpz_sub_ui(q, op->fp->p, 1);
-    s = 0;
-    assert(mpz_cmp_ui(q, 0) != 0);
-    while (mpz_tstbit(q, 0) == 0) {
-        mpz_tdiv_q_ui(q, q, 2);
-        s += 1;
-    }
-    if (s == 1) {
-        // p = 3 mod 4 case, sqrt by exponentiation
-        mpz_add_ui(t, op->fp->p, 1);
-        mpz_tdiv_q_ui(t, t, 4);
-        rop->fp = op->fp;
-        mpFp_realloc(rop);
-        mpz_powm(rop->i, opi, t, op->fp->p);
-    } else {
-        int m;
-        mpz_t z, c, r, b;
-        mpz_init(z);
-        mpz_init(c);
-        mpz_init(r);
-        mpz_init(b);
-        mpz_set_ui(z, 2);
-        while(mpz_legendre(z, op->fp->p) != -1) {
-            mpz_add_ui(z, z, 1);
-            assert (mpz_cmp(z, op->fp->p) < 0);
-        }
-        mpz_powm(c, z, q, op->fp->p);
-        mpz_add_ui(t, q, 1);
-        mpz_tdiv_q_ui(t, t, 2);
-        mpz_powm(r, opi, t, op->fp->p);
-        mpz_powm(t, opi, q, op->fp->p);
-        m = s;
-        while (1) {
-            int i;
-
-            if (mpz_cmp_ui(t, 1) == 0) {
-                break;
-            }
-            mpz_set(z, t);
-            for (i = 0; i < (m-1); i++) {
-                if (mpz_cmp_ui(z, 1) == 0) {
-                    break;
+int mpFp_sqrt(mpFp_t rop, mpFp_t op) {
+    mpFp_field_ptr fp;
+    mpFp_t a, x, t, b, c, xt, tt;
+    mpECScratch_t scr;
+    mp_limb_t scrl[_MPFP_MAX_LIMBS * 7];
+    int i, j, status;
+
+    fp = op->fp;
+    mpECScratch_init_buffer(scr, scrl, _MPFP_MAX_LIMBS * 7);
+    mpFp_init_scratch(a, fp, scr);
+    mpFp_init_scratch(x, fp, scr);
+    mpFp_init_scratch(t, fp, scr);
+    // (rop may alias op)
+    mpFp_set(a, op);
+
+    switch (fp->sqrt_type) {
+        case _MPFP_SQRT_3MOD4:
+            // x = a**((p + 1) / 4)
+            mpFp_pow_mpz(x, a, fp->sqrt_e);
+            break;
+        case _MPFP_SQRT_5MOD8:
+            // Atkin: b = (2a)**((p - 5) / 8), i = 2a * b**2, x = a * b * (i - 1)
+            mpFp_init_scratch(b, fp, scr);
+            mpFp_add(t, a, a);
+            mpFp_pow_mpz(b, t, fp->sqrt_e);
+            mpFp_sqr(x, b);
+            mpFp_mul(t, t, x);
+            mpFp_sub_ui(t, t, 1);
+            mpFp_mul(x, a, b);
+            mpFp_mul(x, x, t);
+            break;
+        case _MPFP_SQRT_TS:
+            mpFp_init_scratch(b, fp, scr);
+            mpFp_init_scratch(c, fp, scr);
+            mpFp_init_scratch(xt, fp, scr);
+            mpFp_init_scratch(tt, fp, scr);
+            mpFp_pow_mpz(x, a, fp->sqrt_e);
+            mpFp_sqr(t, x);
+            mpFp_mul(t, t, a);
+            mpFp_mul(x, x, a);
+            mpFp_set(b, t);
+            mpFp_set_mpz_fp(c, fp->sqrt_c, fp);
+            for (i = fp->sqrt_s; i >= 2; i--) {
+                int e;
+
+                for (j = 1; j <= (i - 2); j++) {
+                    mpFp_sqr(b, b);
                 }
-                mpz_powm_ui(z, z, 2, op->fp->p);
-                //mpz_add_ui(i, i, 1); 
+                e = (mpFp_cmp_ui(b, 1) == 0);
+                mpFp_mul(xt, x, c);
+                mpFp_cswap(x, xt, 1 - e);
+                mpFp_sqr(c, c);
+                mpFp_mul(tt, t, c);
+                mpFp_cswap(t, tt, 1 - e);
+                mpFp_set(b, t);
             }
-            mpz_powm_ui(b, c, 1 << (m - i - 1), op->fp->p);
-            mpz_mul(r, r, b);
-            mpz_mod(r, r, op->fp->p);
-            mpz_powm_ui(c, b, 2, op->fp->p);
-            mpz_mul(t, t, c);
-            mpz_mod(t, t, op->fp->p);
-            //mpz_set(m, i);
-            m = i;
-        }
-        rop->fp = op->fp;
-        mpFp_realloc(rop);
-        mpz_set(rop->i, r);
-        mpz_clear(b);
-        mpz_clear(r);
-        mpz_clear(c);
-        mpz_clear(z);
+            break;
+        default:
+            mpECScratch_clear(scr);
+            return -1;
     }
-    mpz_clear(q);
-    mpz_clear(t);
-    mpz_clear(opi);
-
-    if (__GMP_UNLIKELY(rop->i->_mp_size < op->fp->psize)) {
-        int i;
 
-        for (i = rop->i->_mp_size; i < op->fp->psize; i++) {
-            rop->i->_mp_d[i] = 0;
-        }
+    // x is a root iff a is a square (or zero)
+    mpFp_sqr(t, x);
+    status = (mpFp_cmp(t, a) == 0) ? 0 : -1;
+    if (status == 0) {
+        mpFp_set(rop, x);
     }
+    mpECScratch_clear(scr);
+    return status;
+}
+
+int mpFp_is_square(mpFp_t op) {
+    mpz_t a;
 
-    rop->i->_mp_size = op->fp->psize;
-    return 0;
+    // normalized read only view of the (fixed size) element
+    mpz_roinit_n(a, op->i->_mp_d, op->fp->psize);
+    return (mpz_legendre(a, op->fp->p) >= 0);
 }
 
 int  mpFp_tstbit(mpFp_t op, int bit) {
@@ -0,0 +1,263 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecc/field.h>
+#include <gmp.h>
+#include <string.h>
+
+// Fixed size multiply and reduce kernels for 4 limb (i.e. 193-256 bit)
+// fields. The 4x4 limb product uses MULX/ADCX/ADOX (two independent carry
+// chains) where the CPU supports BMI2 and ADX, otherwise portable C with
+// unsigned __int128. Reduction is Barrett's method using the reciprocal
+// fp->mu = floor(2**512 / p), which has no restriction on the form of p.
+
+#ifdef _MPFP_KERNEL4
+
+typedef unsigned __int128 _uint128_t;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define _MPFP_KERNEL4_MULX
+#include <cpuid.h>
+#endif // defined(__x86_64__) && defined(__GNUC__)
+
+// r[0..7] = a[0..3] * b[0..3]
+static void _mul4_c(mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b) {
+    _uint128_t t;
+    mp_limb_t carry;
+    int i, j;
+
+    for (i = 0; i < 8; i++) {
+        r[i] = 0;
+    }
+    for (i = 0; i < 4; i++) {
+        carry = 0;
+        for (j = 0; j < 4; j++) {
+            t = ((_uint128_t)a[j] * b[i]) + r[i + j] + carry;
+            r[i + j] = (mp_limb_t)t;
+            carry = (mp_limb_t)(t >> 64);
+        }
+        r[i + 4] = carry;
+    }
+}
+
+#ifdef _MPFP_KERNEL4_MULX
+// r[0..7] = a[0..3] * b[0..3], row-wise product scanning with the low
+// halves of each row accumulated on the CF chain (adcx) and the high halves
+// on the OF chain (adox). Requires BMI2 (mulx) and ADX (adcx/adox)
+__attribute__((target("bmi2,adx")))
+static void _mul4_mulx(mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b) {
+    __asm__ volatile (
+        // row 0 : b[0] * a, plain add/adc chain
+        "movq   0(%[b]), %%rdx\n\t"
+        "mulxq  0(%[a]), %%r8, %%r9\n\t"
+        "mulxq  8(%[a]), %%rax, %%r10\n\t"
+        "addq   %%rax, %%r9\n\t"
+        "mulxq  16(%[a]), %%rax, %%r11\n\t"
+        "adcq   %%rax, %%r10\n\t"
+        "mulxq  24(%[a]), %%rax, %%r12\n\t"
+        "adcq   %%rax, %%r11\n\t"
+        "adcq   $0, %%r12\n\t"
+        "movq   %%r8, 0(%[r])\n\t"
+        "movq   $0, %%r8\n\t"
+        // row 1 : accumulate b[1] * a into r9..r13
+        "movq   8(%[b]), %%rdx\n\t"
+        "xorq   %%r13, %%r13\n\t"
+        "mulxq  0(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r9\n\t"
+        "adoxq  %%rcx, %%r10\n\t"
+        "mulxq  8(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r10\n\t"
+        "adoxq  %%rcx, %%r11\n\t"
+        "mulxq  16(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r11\n\t"
+        "adoxq  %%rcx, %%r12\n\t"
+        "mulxq  24(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r12\n\t"
+        "adoxq  %%rcx, %%r13\n\t"
+        "adcxq  %%r8, %%r13\n\t"
+        "movq   %%r9, 8(%[r])\n\t"
+        // row 2 : accumulate b[2] * a into r10..r14
+        "movq   16(%[b]), %%rdx\n\t"
+        "xorq   %%r14, %%r14\n\t"
+        "mulxq  0(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r10\n\t"
+        "adoxq  %%rcx, %%r11\n\t"
+        "mulxq  8(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r11\n\t"
+        "adoxq  %%rcx, %%r12\n\t"
+        "mulxq  16(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r12\n\t"
+        "adoxq  %%rcx, %%r13\n\t"
+        "mulxq  24(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r13\n\t"
+        "adoxq  %%rcx, %%r14\n\t"
+        "adcxq  %%r8, %%r14\n\t"
+        "movq   %%r10, 16(%[r])\n\t"
+        // row 3 : accumulate b[3] * a into r11..r15
+        "movq   24(%[b]), %%rdx\n\t"
+        "xorq   %%r15, %%r15\n\t"
+        "mulxq  0(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r11\n\t"
+        "adoxq  %%rcx, %%r12\n\t"
+        "mulxq  8(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r12\n\t"
+        "adoxq  %%rcx, %%r13\n\t"
+        "mulxq  16(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r13\n\t"
+        "adoxq  %%rcx, %%r14\n\t"
+        "mulxq  24(%[a]), %%rax, %%rcx\n\t"
+        "adcxq  %%rax, %%r14\n\t"
+        "adoxq  %%rcx, %%r15\n\t"
+        "adcxq  %%r8, %%r15\n\t"
+        "movq   %%r11, 24(%[r])\n\t"
+        "movq   %%r12, 32(%[r])\n\t"
+        "movq   %%r13, 40(%[r])\n\t"
+        "movq   %%r14, 48(%[r])\n\t"
+        "movq   %%r15, 56(%[r])\n\t"
+        :
+        : [r] "r" (r), [a] "r" (a), [b] "r" (b)
+        : "rax", "rcx", "rdx", "r8", "r9", "r10", "r11", "r12", "r13",
+          "r14", "r15", "cc", "memory"
+    );
+}
+#endif // _MPFP_KERNEL4_MULX
+
+// Barrett reduction (HAC 14.42) of an 8 limb t, r = t mod p (4 limbs)
+static void _reduce4(mp_limb_t *r, const mp_limb_t *t, mpFp_field_ptr fp) {
+    mp_limb_t q[10];
+    mp_limb_t s[5];
+    mp_limb_t carry, borrow;
+    const mp_limb_t *mu, *p;
+    _uint128_t u;
+    int i, j;
+
+    mu = fp->mu;
+    p = fp->p->_mp_d;
+
+    // q2 = floor(t / 2**192) * mu, q3 = floor(q2 / 2**320) = q[5..9]. Partial
+    // products below limb 3 of q2 are skipped (HAC 14.44), the carries lost
+    // can only make q3 slightly smaller, which the final correction absorbs
+    for (i = 0; i < 10; i++) {
+        q[i] = 0;
+    }
+    for (i = 0; i < 5; i++) {
+        carry = 0;
+        for (j = ((i < 3) ? (3 - i) : 0); j < 5; j++) {
+            u = ((_uint128_t)t[3 + j] * mu[i]) + q[i + j] + carry;
+            q[i + j] = (mp_limb_t)u;
+            carry = (mp_limb_t)(u >> 64);
+        }
+        q[i + 5] = carry;
+    }
+
+    // s = (q3 * p) mod 2**320
+    for (i = 0; i < 5; i++) {
+        s[i] = 0;
+    }
+    for (i = 0; i < 5; i++) {
+        carry = 0;
+        for (j = 0; (j < 4) && ((i + j) < 5); j++) {
+            u = ((_uint128_t)p[j] * q[5 + i]) + s[i + j] + carry;
+            s[i + j] = (mp_limb_t)u;
+            carry = (mp_limb_t)(u >> 64);
+        }
+        if ((i + j) < 5) {
+            s[i + j] += carry;
+        }
+    }
+
+    // s = (t mod 2**320) - s, 0 <= s < 5p
+    borrow = 0;
+    for (i = 0; i < 5; i++) {
+        u = (_uint128_t)t[i] - s[i] - borrow;
+        s[i] = (mp_limb_t)u;
+        borrow = (mp_limb_t)(u >> 64) & 1;
+    }
+
+    while ((s[4] != 0) || (mpn_cmp(s, p, 4) >= 0)) {
+        s[4] -= mpn_sub_n(s, s, p, 4);
+    }
+    for (i = 0; i < 4; i++) {
+        r[i] = s[i];
+    }
+}
+
+typedef void (*_mul4_fn)(mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b);
+
+static _mul4_fn _mul4_impl = NULL;
+
+int  _mpFp_kernel4_select(int use_mulx) {
+#ifdef _MPFP_KERNEL4_MULX
+    unsigned int eax, ebx, ecx, edx;
+
+    if (use_mulx != 0) {
+        // cpuid leaf 7, ebx bit 8 = BMI2 (mulx), bit 19 = ADX (adcx/adox)
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+            ((ebx & (1 << 8)) != 0) && ((ebx & (1 << 19)) != 0)) {
+            _mul4_impl = _mul4_mulx;
+            return 1;
+        }
+    }
+#endif // _MPFP_KERNEL4_MULX
+    _mul4_impl = _mul4_c;
+    return 0;
+}
+
+void _mpFp_mul4(mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b, mpFp_field_ptr fp) {
+    mp_limb_t t[8];
+    if (__GMP_UNLIKELY(_mul4_impl == NULL)) {
+        _mpFp_kernel4_select(1);
+    }
+    _mul4_impl(t, a, b);
+    _reduce4(r, t, fp);
+}
+
+void _mpFp_sqr4(mp_limb_t *r, const mp_limb_t *a, mpFp_field_ptr fp) {
+    _mpFp_mul4(r, a, a, fp);
+}
+
+#else // _MPFP_KERNEL4
+
+// kernels unavailable, mpFp_mul/mpFp_sqr use the general (mpz_mod) path
+
+int  _mpFp_kernel4_select(int use_mulx) {
+    return -1;
+}
+
+void _mpFp_mul4(mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b, mpFp_field_ptr fp) {
+    assert(0);
+}
+
+void _mpFp_sqr4(mp_limb_t *r, const mp_limb_t *a, mpFp_field_ptr fp) {
+    assert(0);
+}
+
+#endif // _MPFP_KERNEL4
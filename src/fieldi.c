@@ -0,0 +1,321 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecc/field.h>
+#include <ecc/fieldi.h>
+#include <gmp.h>
+#include <string.h>
+
+#if 1
+#define PARANOID_ASSERT(X)  assert((X))
+#else
+#define PARANOID_ASSERT(X)
+#endif
+
+// wrap the limbs of an element as a (read only) mpz, normalized
+static inline void _mpz_wrap_mpFpi(mpz_t z, mpFpi_t a) {
+    mp_size_t sz;
+    sz = a->fp->psize;
+    while ((sz > 0) && (a->d[sz - 1] == 0)) {
+        sz -= 1;
+    }
+    z->_mp_d = (mp_limb_t *)a->d;
+    z->_mp_size = sz;
+    z->_mp_alloc = a->fp->psize;
+}
+
+// copy a (reduced, nonnegative) mpz into element limbs, zero padded
+static inline void _mpFpi_set_limbs(mpFpi_t c, mpz_t z) {
+    mp_size_t i;
+    PARANOID_ASSERT(z->_mp_size >= 0);
+    PARANOID_ASSERT(z->_mp_size <= c->fp->psize);
+    for (i = 0; i < z->_mp_size; i++) {
+        c->d[i] = z->_mp_d[i];
+    }
+    for (; i < c->fp->psize; i++) {
+        c->d[i] = 0;
+    }
+}
+
+// reduce nlimbs of t (psize <= nlimbs <= p2size) mod p into c
+static inline void _mpFpi_reduce(mpFpi_t c, mp_limb_t *t, mp_size_t nlimbs) {
+    mp_limb_t ql[_MPFP_MAX_LIMBS + 1];
+    mpFp_field_ptr fp;
+    fp = c->fp;
+    mpn_tdiv_qr(ql, c->d, 0, t, nlimbs, fp->p->_mp_d, fp->psize);
+}
+
+void mpFpi_init_fp(mpFpi_t a, mpFp_field_ptr fp) {
+    assert(fp != NULL);
+    // if this is out of bounds there is no recovery... need to increase
+    // definition of constant and recompile library
+    assert(fp->psize <= _MPFPI_MAX_LIMBS);
+    a->fp = fp;
+    mpn_zero(a->d, fp->psize);
+    return;
+}
+
+void mpFpi_clear(mpFpi_t a) {
+#ifdef  SAFE_CLEAN
+    memset((void *)a, 0, sizeof(*a));
+#endif
+    a->fp = NULL;
+    return;
+}
+
+void mpFpi_set(mpFpi_t c, mpFpi_t a) {
+    c->fp = a->fp;
+    mpn_copyi(c->d, a->d, a->fp->psize);
+    return;
+}
+
+void mpFpi_set_mpz_fp(mpFpi_t c, mpz_t a, mpFp_field_ptr fp) {
+    mpz_t t;
+    mp_limb_t tl[_MPFP_MAX_LIMBS + 1];
+    assert(fp != NULL);
+    assert(fp->psize <= _MPFPI_MAX_LIMBS);
+    c->fp = fp;
+
+    // mpz_mod may transiently require psize + 1 limbs of output (negative
+    // input), so reduce into a local which is never reallocated
+    t->_mp_d = tl;
+    t->_mp_size = 0;
+    t->_mp_alloc = _MPFP_MAX_LIMBS + 1;
+    mpz_mod(t, a, fp->p);
+    _mpFpi_set_limbs(c, t);
+    return;
+}
+
+void mpFpi_set_ui_fp(mpFpi_t c, unsigned long int a, mpFp_field_ptr fp) {
+    mp_limb_t al;
+    assert(fp != NULL);
+    assert(fp->psize <= _MPFPI_MAX_LIMBS);
+    c->fp = fp;
+
+    al = a;
+    mpn_zero(c->d, fp->psize);
+    if (__GMP_UNLIKELY(fp->psize == 1)) {
+        al = al % fp->p->_mp_d[0];
+    }
+    c->d[0] = al;
+    return;
+}
+
+void mpFpi_set_mpFp(mpFpi_t c, mpFp_t a) {
+    mpFp_field_ptr fp;
+    fp = a->fp;
+    assert(fp->psize <= _MPFPI_MAX_LIMBS);
+    PARANOID_ASSERT(a->i->_mp_size == fp->psize);
+    c->fp = fp;
+    mpn_copyi(c->d, a->i->_mp_d, fp->psize);
+    return;
+}
+
+void mpFp_set_mpFpi(mpFp_t c, mpFpi_t a) {
+    mpz_t t;
+    _mpz_wrap_mpFpi(t, a);
+    // value is already reduced, set_mpz_fp zero pads to psize
+    mpFp_set_mpz_fp(c, t, a->fp);
+    return;
+}
+
+void mpz_set_mpFpi(mpz_t c, mpFpi_t a) {
+    mpz_t t;
+    _mpz_wrap_mpFpi(t, a);
+    mpz_set(c, t);
+    return;
+}
+
+void mpFpi_swap(mpFpi_t a, mpFpi_t b) {
+    mpFpi_cswap(a, b, 1);
+    return;
+}
+
+void mpFpi_cswap(mpFpi_t a, mpFpi_t b, int swap) {
+    PARANOID_ASSERT(a->fp == b->fp);
+    mpn_cnd_swap((mp_limb_t)(swap != 0), a->d, b->d, a->fp->psize);
+    return;
+}
+
+void mpFpi_add(mpFpi_t c, mpFpi_t a, mpFpi_t b) {
+    mpFp_field_ptr fp;
+    mp_limb_t carry, borrow;
+    PARANOID_ASSERT(a->fp == b->fp);
+    fp = a->fp;
+    c->fp = fp;
+
+    carry = mpn_add_n(c->d, a->d, b->d, fp->psize);
+    if ((carry != 0) || (mpn_cmp(c->d, fp->p->_mp_d, fp->psize) >= 0)) {
+        borrow = mpn_sub_n(c->d, c->d, fp->p->_mp_d, fp->psize);
+        PARANOID_ASSERT(borrow == carry);
+    }
+    return;
+}
+
+void mpFpi_sub(mpFpi_t c, mpFpi_t a, mpFpi_t b) {
+    mpFp_field_ptr fp;
+    mp_limb_t carry, borrow;
+    PARANOID_ASSERT(a->fp == b->fp);
+    fp = a->fp;
+    c->fp = fp;
+
+    borrow = mpn_sub_n(c->d, a->d, b->d, fp->psize);
+    if (borrow != 0) {
+        carry = mpn_add_n(c->d, c->d, fp->p->_mp_d, fp->psize);
+        PARANOID_ASSERT(carry == 1);
+    }
+    return;
+}
+
+void mpFpi_neg(mpFpi_t c, mpFpi_t a) {
+    mpFp_field_ptr fp;
+    mp_limb_t borrow;
+    fp = a->fp;
+    c->fp = fp;
+
+    // -0 = 0, need to detect 0
+    if (__GMP_UNLIKELY(mpn_zero_p(a->d, fp->psize))) {
+        mpn_zero(c->d, fp->psize);
+    } else {
+        borrow = mpn_sub_n(c->d, fp->p->_mp_d, a->d, fp->psize);
+        PARANOID_ASSERT(borrow == 0);
+    }
+    return;
+}
+
+void mpFpi_mul(mpFpi_t c, mpFpi_t a, mpFpi_t b) {
+    mp_limb_t tl[_MPFP_MAX_LIMBS];
+    mpFp_field_ptr fp;
+    PARANOID_ASSERT(a->fp == b->fp);
+    fp = a->fp;
+    c->fp = fp;
+
+#ifdef _MPFP_KERNEL4
+    if (fp->psize == 4) {
+        _mpFp_mul4(c->d, a->d, b->d, fp);
+        return;
+    }
+#endif
+    mpn_mul_n(tl, a->d, b->d, fp->psize);
+    _mpFpi_reduce(c, tl, fp->p2size);
+    return;
+}
+
+void mpFpi_mul_ui(mpFpi_t c, mpFpi_t a, unsigned long int b) {
+    mp_limb_t tl[_MPFPI_MAX_LIMBS + 1];
+    mpFp_field_ptr fp;
+    fp = a->fp;
+    c->fp = fp;
+
+    tl[fp->psize] = mpn_mul_1(tl, a->d, fp->psize, (mp_limb_t)b);
+    _mpFpi_reduce(c, tl, fp->psize + 1);
+    return;
+}
+
+void mpFpi_sqr(mpFpi_t c, mpFpi_t a) {
+    mp_limb_t tl[_MPFP_MAX_LIMBS];
+    mpFp_field_ptr fp;
+    fp = a->fp;
+    c->fp = fp;
+
+#ifdef _MPFP_KERNEL4
+    if (fp->psize == 4) {
+        _mpFp_sqr4(c->d, a->d, fp);
+        return;
+    }
+#endif
+    mpn_sqr(tl, a->d, fp->psize);
+    _mpFpi_reduce(c, tl, fp->p2size);
+    return;
+}
+
+void mpFpi_pow_mpz(mpFpi_t c, mpFpi_t a, mpz_t b) {
+    mpz_t t, r;
+    mp_limb_t rl[_MPFP_MAX_LIMBS + 1];
+    mpFp_field_ptr fp;
+    fp = a->fp;
+
+    _mpz_wrap_mpFpi(t, a);
+    r->_mp_d = rl;
+    r->_mp_size = 0;
+    r->_mp_alloc = _MPFP_MAX_LIMBS + 1;
+    mpz_powm(r, t, b, fp->p);
+    c->fp = fp;
+    _mpFpi_set_limbs(c, r);
+    return;
+}
+
+int mpFpi_inv(mpFpi_t c, mpFpi_t a) {
+    mpz_t t, r;
+    mp_limb_t rl[_MPFP_MAX_LIMBS + 1];
+    mpFp_field_ptr fp;
+    int rstatus;
+    fp = a->fp;
+
+    _mpz_wrap_mpFpi(t, a);
+    if (t->_mp_size == 0) return -1;
+
+    // the result may transiently occupy psize + 1 limbs within mpz_invert
+    r->_mp_d = rl;
+    r->_mp_size = 0;
+    r->_mp_alloc = _MPFP_MAX_LIMBS + 1;
+    // mpz_invert returns 0 on failure... reverse status
+    rstatus = mpz_invert(r, t, fp->p);
+    if (rstatus == 0) return -1;
+    c->fp = fp;
+    _mpFpi_set_limbs(c, r);
+    return 0;
+}
+
+int mpFpi_cmp(mpFpi_t a, mpFpi_t b) {
+    PARANOID_ASSERT(a->fp == b->fp);
+    return mpn_cmp(a->d, b->d, a->fp->psize);
+}
+
+int mpFpi_cmp_ui(mpFpi_t a, unsigned long b) {
+    mp_limb_t b_limb;
+    int cmp;
+    int i;
+    b_limb = b;
+
+    cmp = !(b_limb == a->d[0]);
+    for (i = 1; i < a->fp->psize; i++) {
+        cmp |= !(0 == a->d[i]);
+    }
+    return cmp;
+}
+
+int mpFpi_tstbit(mpFpi_t a, int bit) {
+    int limb;
+    limb = bit / GMP_NUMB_BITS;
+    if (limb >= a->fp->psize) return 0;
+    return (int)((a->d[limb] >> (bit % GMP_NUMB_BITS)) & 1);
+}
@@ -0,0 +1,427 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecc/field.h>
+#include <gmp.h>
+#include <stdint.h>
+#include <string.h>
+
+// Constant-time modular inversion. The safegcd inverse follows Bernstein
+// and Yang, "Fast constant-time gcd computation and modular inversion"
+// (2019): divsteps on (f, g) = (p, a) are applied 62 at a time to the low
+// limb only, accumulating a 2x2 transition matrix which is then applied to
+// the full (signed radix 2**62) f, g and to the Bezout coefficients d, e
+// (kept mod p by adding multiples of p that clear the low 62 bits, as in
+// the libsecp256k1 modinv64 implementation). The number of divsteps is the
+// bound from the paper for the bit length of p, so the sequence of
+// operations is independent of the input. The core is specialized (fully
+// unrolled by the compiler) for 2, 3, 4, 5, 7 and 9 radix 2**62 limbs. A p
+// of n bits uses n / 62 + 1 limbs, so 128 bit fields use 3 limbs, 192 bit
+// 4, 256 bit 5, 384 bit 7 and 521 bit 9. Other sizes (e.g. 320 bit -> 6 and
+// 448 bit -> 8 limbs) use the generic version.
+
+#ifdef _MPFP_SAFEGCD
+
+typedef __int128 _int128_t;
+
+#define _M62    (UINT64_MAX >> 2)
+
+#define _SG_INLINE  static inline __attribute__((always_inline))
+
+typedef struct {
+    int64_t u, v, q, r;
+} _sg_trans_t;
+
+// 62 divsteps on the low bits of f (odd) and g. Returns the updated delta,
+// with t such that 2**62 * [f', g'] = t * [f, g]
+_SG_INLINE int64_t _sg_divsteps_62(int64_t delta, uint64_t f, uint64_t g,
+        _sg_trans_t *t) {
+    uint64_t u = 1, v = 0, q = 0, r = 1;
+    uint64_t mask1, mask2, x, y, z;
+    int i;
+
+    for (i = 0; i < 62; i++) {
+        // mask1 = (delta > 0), mask2 = (g odd)
+        mask1 = (uint64_t)((-delta) >> 63);
+        mask2 = -(g & 1);
+        // g += (delta > 0 ? -f : f) if g odd (same for the matrix rows)
+        x = (f ^ mask1) - mask1;
+        y = (u ^ mask1) - mask1;
+        z = (v ^ mask1) - mask1;
+        g += x & mask2;
+        q += y & mask2;
+        r += z & mask2;
+        // if (delta > 0 and g odd), delta = -delta and f = (old) g
+        mask1 &= mask2;
+        delta = (delta ^ (int64_t)mask1) - (int64_t)mask1 + 1;
+        f += g & mask1;
+        u += q & mask1;
+        v += r & mask1;
+        // g = g / 2 (f row doubled to keep the common 2**i scale)
+        g >>= 1;
+        u <<= 1;
+        v <<= 1;
+    }
+    t->u = (int64_t)u;
+    t->v = (int64_t)v;
+    t->q = (int64_t)q;
+    t->r = (int64_t)r;
+    return delta;
+}
+
+// [d, e] = t * [d, e] / 2**62 mod p, with d, e in (-2p, p)
+_SG_INLINE void _sg_update_de(int64_t *d, int64_t *e, const _sg_trans_t *t,
+        const int64_t *m, uint64_t minv, const int n) {
+    const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+    int64_t md, me, sd, se;
+    _int128_t cd, ce;
+    int i;
+
+    // add [u, q] * p if d is negative, [v, r] * p if e is negative
+    sd = d[n - 1] >> 63;
+    se = e[n - 1] >> 63;
+    md = (u & sd) + (v & se);
+    me = (q & sd) + (r & se);
+    cd = ((_int128_t)u * d[0]) + ((_int128_t)v * e[0]);
+    ce = ((_int128_t)q * d[0]) + ((_int128_t)r * e[0]);
+    // correct md, me so that the low 62 bits of t * [d, e] + p * [md, me]
+    // are zero
+    md -= ((minv * (uint64_t)cd) + md) & _M62;
+    me -= ((minv * (uint64_t)ce) + me) & _M62;
+    cd += (_int128_t)m[0] * md;
+    ce += (_int128_t)m[0] * me;
+    cd >>= 62;
+    ce >>= 62;
+    for (i = 1; i < n; i++) {
+        cd += ((_int128_t)u * d[i]) + ((_int128_t)v * e[i]) + ((_int128_t)m[i] * md);
+        ce += ((_int128_t)q * d[i]) + ((_int128_t)r * e[i]) + ((_int128_t)m[i] * me);
+        d[i - 1] = (int64_t)cd & _M62;
+        e[i - 1] = (int64_t)ce & _M62;
+        cd >>= 62;
+        ce >>= 62;
+    }
+    d[n - 1] = (int64_t)cd;
+    e[n - 1] = (int64_t)ce;
+    return;
+}
+
+// [f, g] = t * [f, g] / 2**62 (exact)
+_SG_INLINE void _sg_update_fg(int64_t *f, int64_t *g, const _sg_trans_t *t,
+        const int n) {
+    const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+    _int128_t cf, cg;
+    int i;
+
+    cf = ((_int128_t)u * f[0]) + ((_int128_t)v * g[0]);
+    cg = ((_int128_t)q * f[0]) + ((_int128_t)r * g[0]);
+    cf >>= 62;
+    cg >>= 62;
+    for (i = 1; i < n; i++) {
+        cf += ((_int128_t)u * f[i]) + ((_int128_t)v * g[i]);
+        cg += ((_int128_t)q * f[i]) + ((_int128_t)r * g[i]);
+        f[i - 1] = (int64_t)cf & _M62;
+        g[i - 1] = (int64_t)cg & _M62;
+        cf >>= 62;
+        cg >>= 62;
+    }
+    f[n - 1] = (int64_t)cf;
+    g[n - 1] = (int64_t)cg;
+    return;
+}
+
+// r = r * sign(s) mod p in [0, p) for r in (-2p, p)
+_SG_INLINE void _sg_normalize(int64_t *r, int64_t s, const int64_t *m,
+        const int n) {
+    int64_t cond_add, cond_negate;
+    int i;
+
+    cond_add = r[n - 1] >> 63;
+    for (i = 0; i < n; i++) {
+        r[i] += m[i] & cond_add;
+    }
+    cond_negate = s >> 63;
+    for (i = 0; i < n; i++) {
+        r[i] = (r[i] ^ cond_negate) - cond_negate;
+    }
+    for (i = 1; i < n; i++) {
+        r[i] += r[i - 1] >> 62;
+        r[i - 1] &= _M62;
+    }
+    cond_add = r[n - 1] >> 63;
+    for (i = 0; i < n; i++) {
+        r[i] += m[i] & cond_add;
+    }
+    for (i = 1; i < n; i++) {
+        r[i] += r[i - 1] >> 62;
+        r[i - 1] &= _M62;
+    }
+    return;
+}
+
+// x = 1/x mod p (0 if x == 0)
+_SG_INLINE void _sg_inv(int64_t *x, const int64_t *m, uint64_t minv,
+        int batches, const int n) {
+    int64_t d[_MPFP_MAX_LIMBS62], e[_MPFP_MAX_LIMBS62];
+    int64_t f[_MPFP_MAX_LIMBS62], g[_MPFP_MAX_LIMBS62];
+    int64_t delta = 1;
+    _sg_trans_t t;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        d[i] = 0;
+        e[i] = 0;
+        f[i] = m[i];
+        g[i] = x[i];
+    }
+    e[0] = 1;
+    // invariant f = d * x, g = e * x (mod p), ends with g = 0, f = +/-1
+    for (i = 0; i < batches; i++) {
+        delta = _sg_divsteps_62(delta, (uint64_t)f[0], (uint64_t)g[0], &t);
+        _sg_update_de(d, e, &t, m, minv, n);
+        _sg_update_fg(f, g, &t, n);
+    }
+    _sg_normalize(d, f[n - 1], m, n);
+    for (i = 0; i < n; i++) {
+        x[i] = d[i];
+    }
+    return;
+}
+
+#define _MPFP_SG_SPECIALIZE(N) \
+static void _sg_inv_##N(int64_t *x, const int64_t *m, uint64_t minv, \
+        int batches) { \
+    _sg_inv(x, m, minv, batches, N); \
+}
+
+_MPFP_SG_SPECIALIZE(2)
+_MPFP_SG_SPECIALIZE(3)
+_MPFP_SG_SPECIALIZE(4)
+_MPFP_SG_SPECIALIZE(5)
+_MPFP_SG_SPECIALIZE(7)
+_MPFP_SG_SPECIALIZE(9)
+
+static void _sg_inv_n(int64_t *x, const int64_t *m, uint64_t minv,
+        int batches, int n) {
+    _sg_inv(x, m, minv, batches, n);
+}
+
+// radix 2**64 (psize limbs) <-> radix 2**62 (n limbs, value < 2**(62*n))
+static void _sg_to62(int64_t *r, const mp_limb_t *a, int psize, int n) {
+    int i, bit, limb, off;
+
+    for (i = 0; i < n; i++) {
+        bit = 62 * i;
+        limb = bit / 64;
+        off = bit % 64;
+        r[i] = 0;
+        if (limb < psize) {
+            r[i] = (int64_t)(a[limb] >> off);
+            if ((off > 2) && ((limb + 1) < psize)) {
+                r[i] |= (int64_t)(a[limb + 1] << (64 - off));
+            }
+        }
+        r[i] &= _M62;
+    }
+    return;
+}
+
+static void _sg_from62(mp_limb_t *r, const int64_t *a, int psize, int n) {
+    int i, bit, limb, off;
+
+    for (i = 0; i < psize; i++) {
+        r[i] = 0;
+    }
+    for (i = 0; i < n; i++) {
+        bit = 62 * i;
+        limb = bit / 64;
+        off = bit % 64;
+        if (limb < psize) {
+            r[limb] |= ((mp_limb_t)a[i]) << off;
+            if ((off > 2) && ((limb + 1) < psize)) {
+                r[limb + 1] |= ((mp_limb_t)a[i]) >> (64 - off);
+            }
+        }
+    }
+    return;
+}
+
+#endif // _MPFP_SAFEGCD
+
+static inline void mpFp_realloc(mpFp_t c) {
+    if (__GMP_UNLIKELY(c->i->_mp_alloc < c->fp->p2size)) {
+        mpz_realloc(c->i, c->fp->p2size);
+    }
+}
+
+void _mpFp_field_inv_setup(mpFp_field_ptr fp) {
+    fp->inv_type = _MPFP_INV_GMP;
+    fp->sg_size = 0;
+    fp->sg_batches = 0;
+    mpz_set_ui(fp->inv_e, 0);
+    if (mpz_even_p(fp->p) || (mpz_cmp_ui(fp->p, 3) < 0)) return;
+    mpz_sub_ui(fp->inv_e, fp->p, 2);
+#ifdef _MPFP_SAFEGCD
+    {
+        size_t bits;
+        unsigned long steps;
+        mp_limb_t p0, inv;
+        int i;
+
+        bits = mpz_sizeinbase(fp->p, 2);
+        fp->sg_size = (int)(bits / 62) + 1;
+        assert(fp->sg_size <= _MPFP_MAX_LIMBS62);
+        _sg_to62((int64_t *)fp->sg_p62, fp->p->_mp_d, fp->psize, fp->sg_size);
+        // divsteps sufficient for 0 <= g <= f < 2**bits (theorem 11.2)
+        steps = ((49 * bits) + ((bits < 46) ? 80 : 57)) / 17;
+        fp->sg_batches = (int)((steps + 62) / 62);
+        // 1/p mod 2**62 by Newton iteration
+        p0 = fp->p->_mp_d[0];
+        inv = p0;
+        for (i = 0; i < 5; i++) {
+            inv *= 2 - (p0 * inv);
+        }
+        assert((inv * p0) == 1);
+        fp->sg_pinv62 = inv & _M62;
+    }
+#endif
+    return;
+}
+
+int mpFp_inv_safegcd(mpFp_t c, mpFp_t a) {
+#ifdef _MPFP_SAFEGCD
+    mpFp_field_ptr fp;
+    int64_t x[_MPFP_MAX_LIMBS62];
+    const int64_t *m;
+    uint64_t minv;
+    mp_limb_t nz;
+    int i;
+
+    fp = a->fp;
+    if (__GMP_UNLIKELY(fp->sg_size == 0)) return -1;
+    assert(a->i->_mp_size == fp->psize);
+    m = (const int64_t *)fp->sg_p62;
+    minv = fp->sg_pinv62;
+    nz = 0;
+    for (i = 0; i < fp->psize; i++) {
+        nz |= a->i->_mp_d[i];
+    }
+    _sg_to62(x, a->i->_mp_d, fp->psize, fp->sg_size);
+    switch (fp->sg_size) {
+        case 2:
+            _sg_inv_2(x, m, minv, fp->sg_batches);
+            break;
+        case 3:
+            _sg_inv_3(x, m, minv, fp->sg_batches);
+            break;
+        case 4:
+            _sg_inv_4(x, m, minv, fp->sg_batches);
+            break;
+        case 5:
+            _sg_inv_5(x, m, minv, fp->sg_batches);
+            break;
+        case 7:
+            _sg_inv_7(x, m, minv, fp->sg_batches);
+            break;
+        case 9:
+            _sg_inv_9(x, m, minv, fp->sg_batches);
+            break;
+        default:
+            _sg_inv_n(x, m, minv, fp->sg_batches, fp->sg_size);
+            break;
+    }
+    c->fp = fp;
+    mpFp_realloc(c);
+    _sg_from62(c->i->_mp_d, x, fp->psize, fp->sg_size);
+    c->i->_mp_size = fp->psize;
+#ifdef SAFE_CLEAN
+    memset(x, 0, sizeof(x));
+#endif
+    return (nz == 0) ? -1 : 0;
+#else
+    return -1;
+#endif
+}
+
+int mpFp_inv_fermat(mpFp_t c, mpFp_t a) {
+    mpFp_field_ptr fp;
+    mpz_t t;
+    mp_limb_t tl[_MPFP_MAX_LIMBS];
+    int i;
+
+    fp = a->fp;
+    if (__GMP_UNLIKELY(mpz_sgn(fp->inv_e) == 0)) return -1;
+    assert(a->i->_mp_size == fp->psize);
+    // normalized copy of a (rop may alias op)
+    for (i = 0; i < fp->psize; i++) {
+        tl[i] = a->i->_mp_d[i];
+    }
+    t->_mp_d = tl;
+    t->_mp_alloc = fp->psize;
+    t->_mp_size = fp->psize;
+    while ((t->_mp_size > 0) && (tl[t->_mp_size - 1] == 0)) {
+        t->_mp_size -= 1;
+    }
+    c->fp = fp;
+    mpFp_realloc(c);
+    mpz_powm_sec(c->i, t, fp->inv_e, fp->p);
+    for (i = c->i->_mp_size; i < fp->psize; i++) {
+        c->i->_mp_d[i] = 0;
+    }
+    c->i->_mp_size = fp->psize;
+#ifdef SAFE_CLEAN
+    memset(tl, 0, sizeof(tl));
+#endif
+    return (t->_mp_size == 0) ? -1 : 0;
+}
+
+int mpFp_inv_ct(mpFp_t c, mpFp_t a) {
+    if (__GMP_LIKELY(a->fp->sg_size != 0)) {
+        return mpFp_inv_safegcd(c, a);
+    }
+    return mpFp_inv_fermat(c, a);
+}
+
+int mpFp_field_set_inv(mpFp_field_ptr fp, int inv_type) {
+    switch (inv_type) {
+        case _MPFP_INV_GMP:
+            break;
+        case _MPFP_INV_SAFEGCD:
+            if (fp->sg_size == 0) return -1;
+            break;
+        case _MPFP_INV_FERMAT:
+            if (mpz_sgn(fp->inv_e) == 0) return -1;
+            break;
+        default:
+            return -1;
+    }
+    fp->inv_type = inv_type;
+    return 0;
+}
@@ -0,0 +1,375 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecc/field.h>
+#include <ecc/fieldi.h>
+#include <ecc/fieldlanes.h>
+#include <gmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__) && (GMP_NUMB_BITS == 64)
+#define _MPFP_LANES_IFMA
+#include <immintrin.h>
+#endif
+
+#define _MASK52     ((((mp_limb_t)1) << 52) - 1)
+
+typedef void (*_mpFp_mul_lanes_fn)(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, size_t n, mpFp_field_ptr fp);
+
+// extract the radix 2**52 limbs of element i (of n, interleaved)
+static inline void _lane_get52(mp_limb_t *o, mp_limb_t *a, size_t n, size_t i, mp_size_t psize, mp_size_t l52size) {
+    mp_size_t j, k;
+    int off;
+    for (j = 0; j < l52size; j++) {
+        k = (52 * j) / GMP_NUMB_BITS;
+        off = (52 * j) % GMP_NUMB_BITS;
+        o[j] = a[(k * n) + i] >> off;
+        if ((off > 12) && ((k + 1) < psize)) {
+            o[j] |= a[((k + 1) * n) + i] << (GMP_NUMB_BITS - off);
+        }
+        o[j] &= _MASK52;
+    }
+}
+
+// store radix 2**52 limbs (normalized, value < p) as element i
+static inline void _lane_set52(mp_limb_t *r, size_t n, size_t i, mp_size_t psize, mp_limb_t *o, mp_size_t l52size) {
+    mp_size_t j, k;
+    int off;
+    for (k = 0; k < psize; k++) {
+        r[(k * n) + i] = 0;
+    }
+    for (j = 0; j < l52size; j++) {
+        k = (52 * j) / GMP_NUMB_BITS;
+        off = (52 * j) % GMP_NUMB_BITS;
+        r[(k * n) + i] |= o[j] << off;
+        if ((off > 12) && ((k + 1) < psize)) {
+            r[((k + 1) * n) + i] |= o[j] >> (GMP_NUMB_BITS - off);
+        }
+    }
+}
+
+void _mpFp_field_lanes_setup(mpFp_field_ptr fp) {
+    mpz_t r2;
+    mp_limb_t p0, inv;
+    int i;
+
+    fp->l52size = 0;
+#if GMP_NUMB_BITS == 64
+    // Montgomery reduction requires p odd
+    if (mpz_even_p(fp->p)) return;
+    fp->l52size = (mpz_sizeinbase(fp->p, 2) + 51) / 52;
+    assert(fp->l52size <= _MPFP_MAX_LIMBS52);
+    _lane_get52(fp->p52, fp->p->_mp_d, 1, 0, fp->psize, fp->l52size);
+
+    // -1/p mod 2**52 by Newton iteration (p0 * p0 == 1 mod 8 for odd p0,
+    // each iteration doubles the number of correct bits)
+    p0 = fp->p->_mp_d[0];
+    inv = p0;
+    for (i = 0; i < 5; i++) {
+        inv *= 2 - (p0 * inv);
+    }
+    assert((inv * p0) == 1);
+    fp->pinv52 = (-inv) & _MASK52;
+
+    // R**2 mod p
+    mpz_init(r2);
+    mpz_setbit(r2, 2 * 52 * fp->l52size);
+    mpz_mod(r2, r2, fp->p);
+    for (i = 0; i < fp->l52size; i++) {
+        fp->r2_52[i] = 0;
+    }
+    for (i = 0; i < fp->l52size; i++) {
+        mp_size_t k;
+        int off;
+        k = (52 * i) / GMP_NUMB_BITS;
+        off = (52 * i) % GMP_NUMB_BITS;
+        fp->r2_52[i] = mpz_getlimbn(r2, k) >> off;
+        if (off > 12) {
+            fp->r2_52[i] |= mpz_getlimbn(r2, k + 1) << (GMP_NUMB_BITS - off);
+        }
+        fp->r2_52[i] &= _MASK52;
+    }
+    mpz_clear(r2);
+#endif
+    return;
+}
+
+// scalar implementation for lanes [start, n)
+static void _mpFp_mul_lanes_range(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, size_t n, size_t start, mpFp_field_ptr fp) {
+    mpFpi_t x, y;
+    size_t i;
+    mp_size_t k;
+
+    mpFpi_init_fp(x, fp);
+    mpFpi_init_fp(y, fp);
+    for (i = start; i < n; i++) {
+        for (k = 0; k < fp->psize; k++) {
+            x->d[k] = a[(k * n) + i];
+            y->d[k] = b[(k * n) + i];
+        }
+        mpFpi_mul(x, x, y);
+        for (k = 0; k < fp->psize; k++) {
+            r[(k * n) + i] = x->d[k];
+        }
+    }
+    mpFpi_clear(y);
+    mpFpi_clear(x);
+    return;
+}
+
+static void _mpFp_mul_lanes_scalar(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, size_t n, mpFp_field_ptr fp) {
+    _mpFp_mul_lanes_range(r, a, b, n, 0, fp);
+}
+
+#ifdef _MPFP_LANES_IFMA
+
+// Montgomery multiplication (t = a * b / R mod p) of 8 independent lanes.
+// Each 64 bit accumulator gathers 52 bit partial products, with at most 4
+// additions per outer iteration, so l52size iterations cannot overflow.
+// a, b, r hold l52size vectors of 8 lanes (i.e. limb j of lane w at 8*j+w)
+__attribute__((target("avx512f,avx512ifma")))
+static void _mont_mul_x8(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, mpFp_field_ptr fp) {
+    __m512i t[_MPFP_MAX_LIMBS52 + 1];
+    __m512i av[_MPFP_MAX_LIMBS52];
+    __m512i zero, mask, pinv, bi, m, pj, c;
+    __mmask8 keep;
+    mp_size_t i, j, L;
+
+    L = fp->l52size;
+    zero = _mm512_setzero_si512();
+    mask = _mm512_set1_epi64(_MASK52);
+    pinv = _mm512_set1_epi64(fp->pinv52);
+    for (j = 0; j < L; j++) {
+        av[j] = _mm512_loadu_si512((void *)&(a[8 * j]));
+        t[j] = zero;
+    }
+    t[L] = zero;
+
+    for (i = 0; i < L; i++) {
+        bi = _mm512_loadu_si512((void *)&(b[8 * i]));
+        for (j = 0; j < L; j++) {
+            t[j] = _mm512_madd52lo_epu64(t[j], av[j], bi);
+            t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], av[j], bi);
+        }
+        // m = t0 * (-1/p) mod 2**52, adding m * p clears the low 52 bits
+        m = _mm512_madd52lo_epu64(zero, t[0], pinv);
+        m = _mm512_and_si512(m, mask);
+        for (j = 0; j < L; j++) {
+            pj = _mm512_set1_epi64(fp->p52[j]);
+            t[j] = _mm512_madd52lo_epu64(t[j], pj, m);
+            t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], pj, m);
+        }
+        c = _mm512_srli_epi64(t[0], 52);
+        for (j = 0; j < L; j++) {
+            t[j] = t[j + 1];
+        }
+        t[0] = _mm512_add_epi64(t[0], c);
+        t[L] = zero;
+    }
+
+    // propagate carries, t < 2p
+    for (j = 0; j < (L - 1); j++) {
+        c = _mm512_srli_epi64(t[j], 52);
+        t[j] = _mm512_and_si512(t[j], mask);
+        t[j + 1] = _mm512_add_epi64(t[j + 1], c);
+    }
+    // av = t - p, keep t where the subtraction borrows
+    c = zero;
+    for (j = 0; j < L; j++) {
+        pj = _mm512_set1_epi64(fp->p52[j]);
+        av[j] = _mm512_sub_epi64(_mm512_sub_epi64(t[j], pj), c);
+        c = _mm512_srli_epi64(av[j], 63);
+        av[j] = _mm512_and_si512(av[j], mask);
+    }
+    keep = _mm512_cmpneq_epi64_mask(c, zero);
+    for (j = 0; j < L; j++) {
+        t[j] = _mm512_mask_blend_epi64(keep, av[j], t[j]);
+        _mm512_storeu_si512((void *)&(r[8 * j]), t[j]);
+    }
+    return;
+}
+
+// 4 lane variant of _mont_mul_x8 using IFMA on 256 bit vectors
+__attribute__((target("avx512f,avx512ifma,avx512vl")))
+static void _mont_mul_x4(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, mpFp_field_ptr fp) {
+    __m256i t[_MPFP_MAX_LIMBS52 + 1];
+    __m256i av[_MPFP_MAX_LIMBS52];
+    __m256i zero, mask, pinv, bi, m, pj, c;
+    __mmask8 keep;
+    mp_size_t i, j, L;
+
+    L = fp->l52size;
+    zero = _mm256_setzero_si256();
+    mask = _mm256_set1_epi64x(_MASK52);
+    pinv = _mm256_set1_epi64x(fp->pinv52);
+    for (j = 0; j < L; j++) {
+        av[j] = _mm256_loadu_si256((__m256i *)&(a[4 * j]));
+        t[j] = zero;
+    }
+    t[L] = zero;
+
+    for (i = 0; i < L; i++) {
+        bi = _mm256_loadu_si256((__m256i *)&(b[4 * i]));
+        for (j = 0; j < L; j++) {
+            t[j] = _mm256_madd52lo_epu64(t[j], av[j], bi);
+            t[j + 1] = _mm256_madd52hi_epu64(t[j + 1], av[j], bi);
+        }
+        m = _mm256_madd52lo_epu64(zero, t[0], pinv);
+        m = _mm256_and_si256(m, mask);
+        for (j = 0; j < L; j++) {
+            pj = _mm256_set1_epi64x(fp->p52[j]);
+            t[j] = _mm256_madd52lo_epu64(t[j], pj, m);
+            t[j + 1] = _mm256_madd52hi_epu64(t[j + 1], pj, m);
+        }
+        c = _mm256_srli_epi64(t[0], 52);
+        for (j = 0; j < L; j++) {
+            t[j] = t[j + 1];
+        }
+        t[0] = _mm256_add_epi64(t[0], c);
+        t[L] = zero;
+    }
+
+    for (j = 0; j < (L - 1); j++) {
+        c = _mm256_srli_epi64(t[j], 52);
+        t[j] = _mm256_and_si256(t[j], mask);
+        t[j + 1] = _mm256_add_epi64(t[j + 1], c);
+    }
+    c = zero;
+    for (j = 0; j < L; j++) {
+        pj = _mm256_set1_epi64x(fp->p52[j]);
+        av[j] = _mm256_sub_epi64(_mm256_sub_epi64(t[j], pj), c);
+        c = _mm256_srli_epi64(av[j], 63);
+        av[j] = _mm256_and_si256(av[j], mask);
+    }
+    keep = _mm256_cmpneq_epi64_mask(c, zero);
+    for (j = 0; j < L; j++) {
+        t[j] = _mm256_mask_blend_epi64(keep, av[j], t[j]);
+        _mm256_storeu_si256((__m256i *)&(r[4 * j]), t[j]);
+    }
+    return;
+}
+
+typedef void (*_mont_mul_fn)(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, mpFp_field_ptr fp);
+
+// convert groups of W lanes to radix 2**52, multiply as a * b / R * R**2 / R
+// and convert back. Lanes which do not fill a complete group use the scalar
+// implementation.
+static inline void _mpFp_mul_lanes_vec(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, size_t n, mpFp_field_ptr fp, _mont_mul_fn kernel, size_t W) {
+    mp_limb_t A[_MPFP_MAX_LIMBS52 * 8];
+    mp_limb_t B[_MPFP_MAX_LIMBS52 * 8];
+    mp_limb_t R2[_MPFP_MAX_LIMBS52 * 8];
+    mp_limb_t o[_MPFP_MAX_LIMBS52];
+    mp_size_t j, L;
+    size_t i, w;
+
+    L = fp->l52size;
+    if (__GMP_UNLIKELY(L == 0)) {
+        _mpFp_mul_lanes_scalar(r, a, b, n, fp);
+        return;
+    }
+    for (j = 0; j < L; j++) {
+        for (w = 0; w < W; w++) {
+            R2[(W * j) + w] = fp->r2_52[j];
+        }
+    }
+    for (i = 0; (i + W) <= n; i += W) {
+        for (w = 0; w < W; w++) {
+            _lane_get52(o, a, n, i + w, fp->psize, L);
+            for (j = 0; j < L; j++) {
+                A[(W * j) + w] = o[j];
+            }
+            _lane_get52(o, b, n, i + w, fp->psize, L);
+            for (j = 0; j < L; j++) {
+                B[(W * j) + w] = o[j];
+            }
+        }
+        kernel(A, A, B, fp);
+        kernel(A, A, R2, fp);
+        for (w = 0; w < W; w++) {
+            for (j = 0; j < L; j++) {
+                o[j] = A[(W * j) + w];
+            }
+            _lane_set52(r, n, i + w, fp->psize, o, L);
+        }
+    }
+    if (i < n) {
+        _mpFp_mul_lanes_range(r, a, b, n, i, fp);
+    }
+#ifdef  SAFE_CLEAN
+    memset((void *)A, 0, sizeof(A));
+    memset((void *)B, 0, sizeof(B));
+#endif
+    return;
+}
+
+static void _mpFp_mul_lanes_x8(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, size_t n, mpFp_field_ptr fp) {
+    _mpFp_mul_lanes_vec(r, a, b, n, fp, _mont_mul_x8, 8);
+}
+
+static void _mpFp_mul_lanes_x4(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, size_t n, mpFp_field_ptr fp) {
+    _mpFp_mul_lanes_vec(r, a, b, n, fp, _mont_mul_x4, 4);
+}
+
+#endif // _MPFP_LANES_IFMA
+
+static _mpFp_mul_lanes_fn _mul_lanes_impl = NULL;
+
+int  mpFp_lanes_select(int width) {
+    if (width <= 0) width = 8;
+#ifdef _MPFP_LANES_IFMA
+    __builtin_cpu_init();
+    if ((width >= 8) && __builtin_cpu_supports("avx512ifma")) {
+        _mul_lanes_impl = _mpFp_mul_lanes_x8;
+        return 8;
+    }
+    if ((width >= 4) && __builtin_cpu_supports("avx512ifma") &&
+        __builtin_cpu_supports("avx512vl")) {
+        _mul_lanes_impl = _mpFp_mul_lanes_x4;
+        return 4;
+    }
+#endif
+    _mul_lanes_impl = _mpFp_mul_lanes_scalar;
+    return 1;
+}
+
+void mpFp_mul_lanes(mp_limb_t *r, mp_limb_t *a, mp_limb_t *b, size_t n, mpFp_field_ptr fp) {
+    if (__GMP_UNLIKELY(_mul_lanes_impl == NULL)) {
+        mpFp_lanes_select(0);
+    }
+    _mul_lanes_impl(r, a, b, n, fp);
+    return;
+}
+
+void mpFp_sqr_lanes(mp_limb_t *r, mp_limb_t *a, size_t n, mpFp_field_ptr fp) {
+    mpFp_mul_lanes(r, a, a, n, fp);
+    return;
+}
@@ -0,0 +1,281 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// gencurves: build time generator of ecurve_const.h from the standard
+// curve tables in ecurve_std.h. Each curve is parsed and validated (the
+// generator must be on the curve) once, here, and emitted as static limb
+// arrays together with the constants mpECurve_set_mpz_mo would derive for
+// Montgomery curves (transform to short Weierstrass form) and 3 * b for the
+// short Weierstrass (RCB) addition formulas. The library
+// then sets up standard curves from limbs, without hex parsing or field
+// inversions.
+//
+// The output depends on the limb size of the GMP build (GMP_NUMB_BITS),
+// so the generator must run on (be built for) the target.
+
+#include <ecc/ecurve.h>
+#include <gmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ecurve_std.h"
+
+// values emitted per curve, in order
+#define _GEN_NVALUES    (12)
+
+static char *_gen_label[_GEN_NVALUES] = {"p", "c0", "c1", "n", "h", "Gx", "Gy",
+    "ws_a", "ws_b", "Binv", "Adiv3", "b3"};
+
+static char *_gen_type[] = {"EQTypeNone", "EQTypeUninitialized",
+    "EQTypeShortWeierstrass", "EQTypeEdwards", "EQTypeMontgomery",
+    "EQTypeTwistedEdwards"};
+
+typedef struct {
+    _mpECurve_eq_type type;
+    char *name;
+    int bits;
+    size_t size[_GEN_NVALUES];
+} _gen_curve_t;
+
+static _gen_curve_t *_gen_curve;
+static int _gen_count = 0;
+
+static void _gen_emit_mpz(int idx, int v, mpz_t z) {
+    size_t i, sz;
+
+    sz = mpz_size(z);
+    _gen_curve[idx].size[v] = sz;
+    printf("static const mp_limb_t _cc_%d_%s[] = {", idx, _gen_label[v]);
+    if (sz == 0) {
+        // no empty arrays in C, size (0) is in the table
+        printf("0");
+    }
+    for (i = 0; i < sz; i++) {
+        if (i > 0) printf(",");
+        if ((i % 4) == 0) printf("\n    ");
+        else printf(" ");
+#if GMP_NUMB_BITS > 32
+        printf("0x%016lxUL", (unsigned long)mpz_getlimbn(z, i));
+#else
+        printf("0x%08lxUL", (unsigned long)mpz_getlimbn(z, i));
+#endif
+    }
+    printf("};\n");
+    return;
+}
+
+static int _gen_on_curve(_mpECurve_eq_type type, mpz_t p, mpz_t c0, mpz_t c1, mpz_t x, mpz_t y) {
+    mpz_t l, r, t;
+    int on;
+
+    mpz_init(l);
+    mpz_init(r);
+    mpz_init(t);
+    switch (type) {
+        case EQTypeShortWeierstrass:
+            // y**2 = x**3 + ax + b
+            mpz_mul(l, y, y);
+            mpz_mul(t, x, x);
+            mpz_mul(r, t, x);
+            mpz_addmul(r, c0, x);
+            mpz_add(r, r, c1);
+            break;
+        case EQTypeEdwards:
+            // x**2 + y**2 = c**2 * (1 + (d * x**2 * y**2))
+            mpz_mul(l, x, x);
+            mpz_mul(t, y, y);
+            mpz_mul(r, l, t);
+            mpz_add(l, l, t);
+            mpz_mul(r, r, c1);
+            mpz_add_ui(r, r, 1);
+            mpz_mul(r, r, c0);
+            mpz_mul(r, r, c0);
+            break;
+        case EQTypeMontgomery:
+            // B * y**2 = x**3 + A * x**2 + x
+            mpz_mul(l, y, y);
+            mpz_mul(l, l, c0);
+            mpz_mul(t, x, x);
+            mpz_mul(r, t, x);
+            mpz_addmul(r, t, c1);
+            mpz_add(r, r, x);
+            break;
+        case EQTypeTwistedEdwards:
+            // a * x**2 + y**2 = 1 + (d * x**2 * y**2)
+            mpz_mul(l, x, x);
+            mpz_mul(t, y, y);
+            mpz_mul(r, l, t);
+            mpz_mul(r, r, c1);
+            mpz_add_ui(r, r, 1);
+            mpz_mul(l, l, c0);
+            mpz_add(l, l, t);
+            break;
+        default:
+            fprintf(stderr, "gencurves: unknown curve type\n");
+            exit(1);
+    }
+    mpz_mod(l, l, p);
+    mpz_mod(r, r, p);
+    on = (mpz_cmp(l, r) == 0);
+    mpz_clear(t);
+    mpz_clear(r);
+    mpz_clear(l);
+    return on;
+}
+
+static void _gen_curve_values(_mpECurve_eq_type type, char *name, char *sp,
+    char *sc0, char *sc1, char *sn, char *sh, char *sGx, char *sGy, int bits) {
+    mpz_t z[_GEN_NVALUES], t, u;
+    int idx, v;
+
+    idx = _gen_count++;
+    _gen_curve[idx].type = type;
+    _gen_curve[idx].name = name;
+    _gen_curve[idx].bits = bits;
+    for (v = 0; v < _GEN_NVALUES; v++) {
+        mpz_init(z[v]);
+    }
+    mpz_set_str(z[0], sp, 0);
+    mpz_set_str(z[1], sc0, 0);
+    mpz_set_str(z[2], sc1, 0);
+    mpz_set_str(z[3], sn, 0);
+    mpz_set_str(z[4], sh, 0);
+    mpz_set_str(z[5], sGx, 0);
+    mpz_set_str(z[6], sGy, 0);
+    // coefficients are stored reduced (as mpFp_set_mpz_fp would)
+    mpz_mod(z[1], z[1], z[0]);
+    mpz_mod(z[2], z[2], z[0]);
+    if (!_gen_on_curve(type, z[0], z[1], z[2], z[5], z[6])) {
+        fprintf(stderr, "gencurves: generator of %s is not on the curve\n", name);
+        exit(1);
+    }
+    if (type == EQTypeMontgomery) {
+        // c0 = B, c1 = A (see mpECurve_set_mpz_mo)
+        // ws_a = (3-A^2)/(3B^2), ws_b = (2A^3-9A)/(27B^3), Binv, Adiv3
+        mpz_init(t);
+        mpz_init(u);
+        mpz_mul(t, z[1], z[1]);
+        mpz_mul_ui(t, t, 3);
+        mpz_invert(t, t, z[0]);
+        mpz_mul(u, z[2], z[2]);
+        mpz_ui_sub(u, 3, u);
+        mpz_mul(z[7], u, t);
+        mpz_mod(z[7], z[7], z[0]);
+        mpz_powm_ui(t, z[1], 3, z[0]);
+        mpz_mul_ui(t, t, 27);
+        mpz_invert(t, t, z[0]);
+        mpz_powm_ui(u, z[2], 3, z[0]);
+        mpz_mul_ui(u, u, 2);
+        mpz_submul_ui(u, z[2], 9);
+        mpz_mul(z[8], u, t);
+        mpz_mod(z[8], z[8], z[0]);
+        mpz_invert(z[9], z[1], z[0]);
+        mpz_set_ui(t, 3);
+        mpz_invert(t, t, z[0]);
+        mpz_mul(z[10], z[2], t);
+        mpz_mod(z[10], z[10], z[0]);
+        mpz_clear(u);
+        mpz_clear(t);
+        // b3 = 3 * ws_b
+        mpz_mul_ui(z[11], z[8], 3);
+        mpz_mod(z[11], z[11], z[0]);
+    } else if (type == EQTypeShortWeierstrass) {
+        // b3 = 3 * b
+        mpz_mul_ui(z[11], z[2], 3);
+        mpz_mod(z[11], z[11], z[0]);
+    }
+
+    printf("// %s\n", name);
+    for (v = 0; v < _GEN_NVALUES; v++) {
+        _gen_emit_mpz(idx, v, z[v]);
+        mpz_clear(z[v]);
+    }
+    printf("\n");
+    return;
+}
+
+int main(void) {
+    size_t i, nws, ned, nmo, nte;
+    int idx, v;
+
+    nws = sizeof(_std_ws_curve) / sizeof(_std_ws_curve[0]);
+    ned = sizeof(_std_ed_curve) / sizeof(_std_ed_curve[0]);
+    nmo = sizeof(_std_mo_curve) / sizeof(_std_mo_curve[0]);
+    nte = sizeof(_std_te_curve) / sizeof(_std_te_curve[0]);
+    _gen_curve = (_gen_curve_t *)malloc((nws + ned + nmo + nte) * sizeof(_gen_curve_t));
+    if (_gen_curve == NULL) return 1;
+
+    printf("// generated by gencurves from ecurve_std.h, do not edit\n\n");
+    printf("#ifndef _EC_CURVE_CONST_H_INCLUDED_\n");
+    printf("#define _EC_CURVE_CONST_H_INCLUDED_\n\n");
+    printf("#include <ecc/ecurve.h>\n#include <gmp.h>\n\n");
+    printf("#define _MPECURVE_CONST_NUMB_BITS (%d)\n\n", GMP_NUMB_BITS);
+    printf("typedef struct {\n    const mp_limb_t *d;\n    mp_size_t size;\n} _mpECurve_const_mpz_t;\n\n");
+    printf("// c0, c1 are the coefficients in the order of the matching\n");
+    printf("// mpECurve_set_mpz_XX call, ws_a, ws_b, Binv, Adiv3 are only set\n");
+    printf("// (nonzero) for Montgomery curves, b3 = 3 * b (3 * ws_b) for short\n");
+    printf("// Weierstrass (Montgomery) curves\n");
+    printf("typedef struct {\n    _mpECurve_eq_type type;\n    char *name;\n    unsigned int bits;\n");
+    for (v = 0; v < _GEN_NVALUES; v++) {
+        printf("    _mpECurve_const_mpz_t %s;\n", _gen_label[v]);
+    }
+    printf("} _mpECurve_const_t;\n\n");
+
+    // same order as _mpECurve_list_standard_curves has always used
+    for (i = 0; i < nws; i++) {
+        _std_ws_curve_t *c = &(_std_ws_curve[i]);
+        _gen_curve_values(c->type, c->name, c->p, c->a, c->b, c->n, c->h, c->Gx, c->Gy, c->bits);
+    }
+    for (i = 0; i < ned; i++) {
+        _std_ed_curve_t *c = &(_std_ed_curve[i]);
+        _gen_curve_values(c->type, c->name, c->p, c->c, c->d, c->n, c->h, c->Gx, c->Gy, c->bits);
+    }
+    for (i = 0; i < nmo; i++) {
+        _std_mo_curve_t *c = &(_std_mo_curve[i]);
+        _gen_curve_values(c->type, c->name, c->p, c->B, c->A, c->n, c->h, c->Gx, c->Gy, c->bits);
+    }
+    for (i = 0; i < nte; i++) {
+        _std_te_curve_t *c = &(_std_te_curve[i]);
+        _gen_curve_values(c->type, c->name, c->p, c->a, c->d, c->n, c->h, c->Gx, c->Gy, c->bits);
+    }
+
+    printf("#define _MPECURVE_CONST_COUNT (%d)\n\n", _gen_count);
+    printf("static const _mpECurve_const_t _mpECurve_const[_MPECURVE_CONST_COUNT] = {\n");
+    for (idx = 0; idx < _gen_count; idx++) {
+        printf("    {\n        %s,\n        \"%s\",\n        %d,\n",
+            _gen_type[_gen_curve[idx].type], _gen_curve[idx].name, _gen_curve[idx].bits);
+        for (v = 0; v < _GEN_NVALUES; v++) {
+            printf("        {_cc_%d_%s, %lu},\n", idx, _gen_label[v], (unsigned long)_gen_curve[idx].size[v]);
+        }
+        printf("    },\n");
+    }
+    printf("};\n\n#endif // _EC_CURVE_CONST_H_INCLUDED_\n");
+    free(_gen_curve);
+    return 0;
+}
@@ -0,0 +1,150 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// gentables: build time generator of ecpbase_const.h, precomputed fixed
+// base (comb) tables for the generator of selected standard curves. The
+// table is built by the library itself (mpECP_scalar_base_mul_setup), then
+// normalized to affine coordinates and emitted in the internal point
+// representation (short Weierstrass form for Montgomery curves) as static
+// limb arrays. Entry 0 of every level is the neutral element and is not
+// stored. When the library is built with _MPECP_BASE_CONST a setup of one
+// of these generators uses the table in place: no setup time and no heap.
+//
+// The output depends on the limb size of the GMP build (GMP_NUMB_BITS),
+// so the generator must run on (be built for) the target.
+
+#include <ecc/ecpoint.h>
+#include <ecc/ecurve.h>
+#include <gmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static char *_gen_curve[] = {"P256", "secp256k1", "Ed25519", "P384"};
+
+static void _gen_emit_limbs(mpFp_t a, int psize, int *col) {
+    int i;
+
+    for (i = 0; i < psize; i++) {
+        if ((*col % 4) == 0) printf("\n    ");
+        else printf(" ");
+#if GMP_NUMB_BITS > 32
+        printf("0x%016lxUL,", (unsigned long)a->i->_mp_d[i]);
+#else
+        printf("0x%08lxUL,", (unsigned long)a->i->_mp_d[i]);
+#endif
+        *col += 1;
+    }
+    return;
+}
+
+static void _gen_table(int idx, char *name, int *base_bits, int *psize) {
+    mpECurve_t cv;
+    mpECP_t G;
+    mpECP_ptr *pts;
+    int i, j, nlevels, levelsz, col;
+
+    mpECurve_init(cv);
+    if (mpECurve_set_named(cv, name) != 0) {
+        fprintf(stderr, "gentables: unknown curve %s\n", name);
+        exit(1);
+    }
+    mpECP_init(G, cv);
+    mpECP_set_mpz(G, cv->G[0], cv->G[1], cv);
+    mpECP_scalar_base_mul_setup(G);
+    *base_bits = G->base_bits;
+    *psize = cv->fp->psize;
+    nlevels = (cv->bits + G->base_bits - 1) / G->base_bits;
+    levelsz = 1 << G->base_bits;
+
+    // all entries except the neutral (entry 0) of each level
+    pts = (mpECP_ptr *)malloc(nlevels * (levelsz - 1) * sizeof(mpECP_ptr));
+    if (pts == NULL) exit(1);
+    for (j = 0; j < nlevels; j++) {
+        for (i = 1; i < levelsz; i++) {
+            pts[(j * (levelsz - 1)) + (i - 1)] = &(G->base_pt[(j * levelsz) + i]);
+        }
+    }
+    mpECP_normalize_batch(pts, nlevels * (levelsz - 1));
+
+    printf("// %s, %d levels of %d points (x, y)\n", name, nlevels, levelsz - 1);
+    printf("static const mp_limb_t _bc_%d[] = {", idx);
+    col = 0;
+    for (i = 0; i < (nlevels * (levelsz - 1)); i++) {
+        if ((pts[i]->is_neutral != 0) || (mpFp_cmp_ui(pts[i]->z, 1) != 0)) {
+            fprintf(stderr, "gentables: %s table entry %d not affine\n", name, i);
+            exit(1);
+        }
+        _gen_emit_limbs(pts[i]->x, *psize, &col);
+        _gen_emit_limbs(pts[i]->y, *psize, &col);
+    }
+    printf("};\n\n");
+
+    free(pts);
+    mpECP_clear(G);
+    mpECurve_clear(cv);
+    return;
+}
+
+int main(void) {
+    int i, ncurves;
+    int *base_bits, *psize;
+
+    ncurves = sizeof(_gen_curve) / sizeof(_gen_curve[0]);
+    base_bits = (int *)malloc(ncurves * sizeof(int));
+    psize = (int *)malloc(ncurves * sizeof(int));
+    if ((base_bits == NULL) || (psize == NULL)) return 1;
+
+    printf("// generated by gentables, do not edit\n\n");
+    printf("#ifndef _EC_POINT_BASE_CONST_H_INCLUDED_\n");
+    printf("#define _EC_POINT_BASE_CONST_H_INCLUDED_\n\n");
+    printf("#include <gmp.h>\n\n");
+    printf("#define _MPECP_BASE_CONST_NUMB_BITS (%d)\n\n", GMP_NUMB_BITS);
+    printf("// xy holds (levels * ((1 << base_bits) - 1)) affine points of psize\n");
+    printf("// limbs x followed by psize limbs y, level j entry i (i > 0) is\n");
+    printf("// i * 2**(j * base_bits) * G\n");
+    printf("typedef struct {\n    char *name;\n    int base_bits;\n    int psize;\n");
+    printf("    const mp_limb_t *xy;\n} _mpECP_base_const_t;\n\n");
+
+    for (i = 0; i < ncurves; i++) {
+        _gen_table(i, _gen_curve[i], &(base_bits[i]), &(psize[i]));
+    }
+
+    printf("#define _MPECP_BASE_CONST_COUNT (%d)\n\n", ncurves);
+    printf("static const _mpECP_base_const_t _mpECP_base_const[] = {\n");
+    for (i = 0; i < ncurves; i++) {
+        printf("    {\"%s\", %d, %d, _bc_%d},\n", _gen_curve[i], base_bits[i], psize[i], i);
+    }
+    printf("};\n\n");
+    printf("#endif // _EC_POINT_BASE_CONST_H_INCLUDED_\n");
+
+    free(psize);
+    free(base_bits);
+    return 0;
+}
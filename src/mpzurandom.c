@@ -30,35 +30,238 @@
 
 #include <assert.h>
 #include <ecc/mpzurandom.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <gmp.h>
-#include <stdio.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
-static FILE *_f_urandom = NULL;
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 25)))
+#define _MPZ_URANDOM_GETRANDOM
+#include <sys/random.h>
+#endif
 
-static void _close_f_urandom(void) {
-    if (_f_urandom != NULL) {
-        fclose(_f_urandom);
-        _f_urandom = NULL;
+// Per-thread ChaCha20 based DRBG. Each thread keeps its own generator in
+// thread local storage (no locking), seeded from the kernel (getrandom, or
+// /dev/urandom where unavailable). Output is produced in blocks; after each
+// refill the first 32 bytes of keystream replace the key ("fast key
+// erasure") so earlier output cannot be reconstructed from the state. The
+// generator is reseeded after _MPZ_URANDOM_RESEED_BYTES of output and after
+// fork() (a child must never replay the parent's stream).
+
+#define _MPZ_URANDOM_BLOCKS         (8)
+#define _MPZ_URANDOM_BUFSZ          (_MPZ_URANDOM_BLOCKS * 64)
+#define _MPZ_URANDOM_RESEED_BYTES   (1UL << 20)
+
+typedef struct {
+    uint32_t        key[8];
+    unsigned char   buf[_MPZ_URANDOM_BUFSZ];
+    size_t          pos;
+    size_t          since_seed;
+    unsigned long   fork_gen;
+    int             seeded;
+} _mpz_urandom_state;
+
+static __thread _mpz_urandom_state _rng_state;
+
+static volatile unsigned long _rng_fork_gen = 0;
+static pthread_once_t _rng_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _rng_key;
+
+#define _ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define _CHACHA_QR(a, b, c, d)                          \
+    a += b; d ^= a; d = _ROTL32(d, 16);                 \
+    c += d; b ^= c; b = _ROTL32(b, 12);                 \
+    a += b; d ^= a; d = _ROTL32(d, 8);                  \
+    c += d; b ^= c; b = _ROTL32(b, 7);
+
+static inline void _store32_le(unsigned char *b, uint32_t v) {
+    b[0] = (unsigned char)(v);
+    b[1] = (unsigned char)(v >> 8);
+    b[2] = (unsigned char)(v >> 16);
+    b[3] = (unsigned char)(v >> 24);
+}
+
+static inline uint32_t _load32_le(const unsigned char *b) {
+    return ((uint32_t)b[0]) | ((uint32_t)b[1] << 8) |
+        ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+// one 64 byte ChaCha20 block (zero nonce, 64 bit block counter)
+static void _chacha20_block(unsigned char *out, const uint32_t *key, uint64_t counter) {
+    uint32_t in[16], x[16];
+    int i;
+
+    // "expand 32-byte k"
+    in[0] = 0x61707865;
+    in[1] = 0x3320646e;
+    in[2] = 0x79622d32;
+    in[3] = 0x6b206574;
+    for (i = 0; i < 8; i++) {
+        in[4 + i] = key[i];
+    }
+    in[12] = (uint32_t)counter;
+    in[13] = (uint32_t)(counter >> 32);
+    in[14] = 0;
+    in[15] = 0;
+
+    for (i = 0; i < 16; i++) {
+        x[i] = in[i];
     }
+    for (i = 0; i < 10; i++) {
+        _CHACHA_QR(x[0], x[4], x[8], x[12]);
+        _CHACHA_QR(x[1], x[5], x[9], x[13]);
+        _CHACHA_QR(x[2], x[6], x[10], x[14]);
+        _CHACHA_QR(x[3], x[7], x[11], x[15]);
+        _CHACHA_QR(x[0], x[5], x[10], x[15]);
+        _CHACHA_QR(x[1], x[6], x[11], x[12]);
+        _CHACHA_QR(x[2], x[7], x[8], x[13]);
+        _CHACHA_QR(x[3], x[4], x[9], x[14]);
+    }
+    for (i = 0; i < 16; i++) {
+        _store32_le(&(out[4 * i]), x[i] + in[i]);
+    }
+    memset((void *)x, 0, sizeof(x));
+    memset((void *)in, 0, sizeof(in));
+}
+
+static void _rng_entropy(unsigned char *buf, size_t len) {
+    size_t got = 0;
+#ifdef _MPZ_URANDOM_GETRANDOM
+    while (got < len) {
+        ssize_t r;
+        r = getrandom(&(buf[got]), len - got, 0);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            // e.g. ENOSYS on old kernels, fall back to /dev/urandom
+            break;
+        }
+        got += (size_t)r;
+    }
+#endif
+    if (got < len) {
+        int fd;
+        fd = open("/dev/urandom", O_RDONLY);
+        assert(fd >= 0);
+        while (got < len) {
+            ssize_t r;
+            r = read(fd, &(buf[got]), len - got);
+            if ((r < 0) && (errno == EINTR)) continue;
+            assert(r > 0);
+            got += (size_t)r;
+        }
+        close(fd);
+    }
+}
+
+static void _rng_atfork_child(void) {
+    _rng_fork_gen += 1;
+}
+
+static void _rng_thread_exit(void *st) {
+    memset(st, 0, sizeof(_mpz_urandom_state));
+}
+
+static void _rng_once_init(void) {
+    int status;
+    status = pthread_atfork(NULL, NULL, _rng_atfork_child);
+    assert(status == 0);
+    status = pthread_key_create(&_rng_key, _rng_thread_exit);
+    assert(status == 0);
+}
+
+// generate a new buffer of output and rekey from its first 32 bytes
+static void _rng_refill(_mpz_urandom_state *st) {
+    int i;
+    for (i = 0; i < _MPZ_URANDOM_BLOCKS; i++) {
+        _chacha20_block(&(st->buf[64 * i]), st->key, (uint64_t)i);
+    }
+    for (i = 0; i < 8; i++) {
+        st->key[i] = _load32_le(&(st->buf[4 * i]));
+    }
+    memset((void *)st->buf, 0, 32);
+    st->pos = 32;
+}
+
+// mix fresh entropy into the key (an initial seed is mixed into zero)
+static void _rng_seed(_mpz_urandom_state *st) {
+    unsigned char seed[32];
+    int i;
+    if (st->seeded == 0) {
+        pthread_once(&_rng_once, _rng_once_init);
+        // so the state is wiped when the thread exits
+        pthread_setspecific(_rng_key, (void *)st);
+    }
+    _rng_entropy(seed, sizeof(seed));
+    for (i = 0; i < 8; i++) {
+        st->key[i] ^= _load32_le(&(seed[4 * i]));
+    }
+    memset((void *)seed, 0, sizeof(seed));
+    st->fork_gen = _rng_fork_gen;
+    st->since_seed = 0;
+    st->seeded = 1;
+    _rng_refill(st);
+}
+
+static void _rng_bytes(unsigned char *out, size_t len) {
+    _mpz_urandom_state *st;
+    st = &_rng_state;
+    if (__GMP_UNLIKELY((st->seeded == 0) || (st->fork_gen != _rng_fork_gen) ||
+        (st->since_seed >= _MPZ_URANDOM_RESEED_BYTES))) {
+        _rng_seed(st);
+    }
+    while (len > 0) {
+        size_t n;
+        if (st->pos >= _MPZ_URANDOM_BUFSZ) {
+            _rng_refill(st);
+        }
+        n = _MPZ_URANDOM_BUFSZ - st->pos;
+        if (n > len) n = len;
+        memcpy(out, &(st->buf[st->pos]), n);
+        // consumed output is not retained in the state
+        memset((void *)&(st->buf[st->pos]), 0, n);
+        st->pos += n;
+        st->since_seed += n;
+        out += n;
+        len -= n;
+    }
+}
+
+void mpz_urandom_reseed(void) {
+    _rng_seed(&_rng_state);
     return;
 }
 
 void mpz_urandom(mpz_t rop, mpz_t rand_max) {
-    int bytes, sz_read;
-    char *buffer;
-    if (_f_urandom == NULL) {
-        _f_urandom = fopen("/dev/urandom", "rb");
-        assert(_f_urandom != NULL);
-        atexit(_close_f_urandom);
+    mp_limb_t *rl;
+    mp_size_t n, i;
+    mp_limb_t mask;
+    size_t bits;
+
+    assert(mpz_sgn(rand_max) > 0);
+    n = mpz_size(rand_max);
+    bits = mpz_sizeinbase(rand_max, 2);
+    // mask off bits above the top bit of rand_max in the top limb
+    mask = ~((mp_limb_t)0);
+    if ((bits % GMP_NUMB_BITS) != 0) {
+        mask >>= GMP_NUMB_BITS - (bits % GMP_NUMB_BITS);
     }
-    // bytes intentionally long to ensure uniformity, will truncate with modulo
-    bytes = ((mpz_sizeinbase(rand_max,2) + 7) >> 3) * 2;
-    buffer = (char *)malloc((bytes) * sizeof(char));
-    sz_read = fread(buffer, sizeof(char), bytes, _f_urandom);
-    assert(sz_read == bytes);
-    mpz_import(rop, sz_read, 1, sizeof(char), 0, 0, buffer);
-    mpz_mod(rop, rop, rand_max);
-    free(buffer);
+
+    // rejection sampling directly into the limbs of rop (no modular bias),
+    // each candidate is accepted with probability > 1/2. mpz_limbs_write
+    // only reallocates if rop is too small (never for mpFp elements)
+    rl = mpz_limbs_write(rop, n);
+    do {
+        _rng_bytes((unsigned char *)rl, n * sizeof(mp_limb_t));
+        rl[n - 1] &= mask;
+    } while (mpn_cmp(rl, mpz_limbs_read(rand_max), n) >= 0);
+
+    // normalize
+    for (i = n; (i > 0) && (rl[i - 1] == 0); i--);
+    mpz_limbs_finish(rop, i);
     return;
 }
@@ -0,0 +1,93 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecc/field.h>
+#include <ecc/scratch.h>
+#include <gmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+void mpECScratch_init(mpECScratch_t scr, size_t nlimbs) {
+    scr->d = (mp_limb_t *)malloc(nlimbs * sizeof(mp_limb_t));
+    assert(scr->d != NULL);
+    scr->alloc = nlimbs;
+    scr->used = 0;
+    scr->owner = 1;
+    return;
+}
+
+void mpECScratch_init_buffer(mpECScratch_t scr, mp_limb_t *d, size_t nlimbs) {
+    scr->d = d;
+    scr->alloc = nlimbs;
+    scr->used = 0;
+    scr->owner = 0;
+    return;
+}
+
+void mpECScratch_clear(mpECScratch_t scr) {
+#ifdef  SAFE_CLEAN
+    memset((void *)scr->d, 0, scr->alloc * sizeof(mp_limb_t));
+#endif
+    if (scr->owner != 0) {
+        free(scr->d);
+    }
+    scr->d = NULL;
+    scr->alloc = 0;
+    scr->used = 0;
+    scr->owner = 0;
+    return;
+}
+
+size_t mpECScratch_mark(mpECScratch_t scr) {
+    return scr->used;
+}
+
+void mpECScratch_release(mpECScratch_t scr, size_t mark) {
+    assert(mark <= scr->used);
+#ifdef  SAFE_CLEAN
+    memset((void *)&(scr->d[mark]), 0, (scr->used - mark) * sizeof(mp_limb_t));
+#endif
+    scr->used = mark;
+    return;
+}
+
+void mpFp_init_scratch(mpFp_t a, mpFp_field_ptr fp, mpECScratch_t scr) {
+    assert(fp != NULL);
+    // if this is out of bounds the arena was sized too small for the
+    // calculation, there is no recovery (by design, no fallback to malloc)
+    assert((scr->used + fp->p2size) <= scr->alloc);
+    a->fp = fp;
+    a->i->_mp_d = &(scr->d[scr->used]);
+    a->i->_mp_alloc = fp->p2size;
+    a->i->_mp_size = 0;
+    scr->used += fp->p2size;
+    return;
+}
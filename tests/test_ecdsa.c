@@ -32,6 +32,7 @@
 #include <ecc/ecdsa.h>
 #include <ecc/ecurve.h>
 #include <ecc/ecpoint.h>
+#include <ecc/ecpkeycache.h>
 #include <ecc/field.h>
 #include <ecc/mpzurandom.h>
 #include <ecc/safememory.h>
@@ -41,7 +42,10 @@
 #include <sodium.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
 #include <time.h>
+#include <unistd.h>
 
 void wrap_libsodium_sha512(unsigned char *hash, unsigned char *msg, size_t sz) {
     int status;
@@ -57,6 +61,21 @@ void wrap_libsodium_sha256(unsigned char *hash, unsigned char *msg, size_t sz) {
     return;
 }
 
+void wrap_libsodium_sha512_init(void *ctx) {
+    crypto_hash_sha512_init((crypto_hash_sha512_state *)ctx);
+    return;
+}
+
+void wrap_libsodium_sha512_update(void *ctx, unsigned char *msg, size_t sz) {
+    crypto_hash_sha512_update((crypto_hash_sha512_state *)ctx, msg, (unsigned long long)sz);
+    return;
+}
+
+void wrap_libsodium_sha512_final(void *ctx, unsigned char *hash) {
+    crypto_hash_sha512_final((crypto_hash_sha512_state *)ctx, hash);
+    return;
+}
+
 #define _TEST_MESSAGE_MAX   (100)
 
 START_TEST(test_mpECDSA_sscheme_init) {
@@ -179,6 +198,10 @@ START_TEST(test_mpECDSA_sscheme_init) {
 }
 END_TEST
 
+// input block sizes for HMAC
+#define _TEST_SHA256_BLOCKSZ    (64)
+#define _TEST_SHA512_BLOCKSZ    (128)
+
 typedef struct {
     char *curve_name;
     _ecdsa_dohash hash_func;
@@ -557,6 +580,692 @@ START_TEST(test_mpECDSA_reference_test_vectors) {
 }
 END_TEST
 
+START_TEST(test_mpECDSA_deterministic) {
+    int nvecs;
+    int i;
+
+    nvecs = sizeof(rfc6979_ecdsa_test_vectors) / sizeof(rfc6979_ecdsa_test_vectors[0]);
+    for (i = 0; i < nvecs; i++) {
+        mpECDSAHashfunc_t H;
+        mpECurve_t cv;
+        mpECDSASignatureScheme_t sscheme;
+        mpECDSASignature_t sig;
+        mpECDSASignature_t sig2;
+        mpFp_t sK;
+        mpECP_t pK;
+        mpz_t z;
+        unsigned char *msg;
+        size_t msz;
+        int status;
+
+        mpECDSAHashfunc_init(H);
+        H->dohash = rfc6979_ecdsa_test_vectors[i].hash_func;
+        H->hsz = rfc6979_ecdsa_test_vectors[i].hash_size;
+
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, rfc6979_ecdsa_test_vectors[i].curve_name);
+        assert(status == 0);
+
+        // HMAC needs the block size, which is not guessed from hsz
+        mpECDSASignatureScheme_init(sscheme, cv, H);
+        assert(mpECDSASignatureScheme_set_deterministic(sscheme, 1) != 0);
+        assert(sscheme->deterministic == 0);
+        mpECDSASignatureScheme_clear(sscheme);
+        if (rfc6979_ecdsa_test_vectors[i].hash_func == wrap_libsodium_sha256) {
+            mpECDSAHashfunc_set_blocksize(H, _TEST_SHA256_BLOCKSZ);
+        } else {
+            mpECDSAHashfunc_set_blocksize(H, _TEST_SHA512_BLOCKSZ);
+        }
+
+        printf("deterministic signature for curve %s (%zu byte hash) for message \"%s\"\n",
+            rfc6979_ecdsa_test_vectors[i].curve_name,
+            rfc6979_ecdsa_test_vectors[i].hash_size,
+            rfc6979_ecdsa_test_vectors[i].message);
+
+        mpECDSASignatureScheme_init(sscheme, cv, H);
+        status = mpECDSASignatureScheme_set_deterministic(sscheme, 1);
+        assert(status == 0);
+
+        mpz_init(z);
+        mpFp_init(sK, cv->n);
+        mpz_set_str(z, rfc6979_ecdsa_test_vectors[i].x, 16);
+        mpFp_set_mpz(sK, z, cv->n);
+        mpECP_init(pK, cv);
+        mpECP_scalar_base_mul(pK, sscheme->cv_G, sK);
+
+        msg = (unsigned char *)rfc6979_ecdsa_test_vectors[i].message;
+        msz = strlen((char *)msg);
+        status = mpECDSASignature_init_Sign(sig, sscheme, sK, msg, msz);
+        assert(status == 0);
+
+        // the nonce (and therefore r, s) must match the RFC exactly
+        mpz_set_str(z, rfc6979_ecdsa_test_vectors[i].r, 16);
+        assert(mpFp_cmp_mpz(sig->r, z) == 0);
+        mpz_set_str(z, rfc6979_ecdsa_test_vectors[i].s, 16);
+        assert(mpFp_cmp_mpz(sig->s, z) == 0);
+
+        status = mpECDSASignature_verify_cmp(sig, pK, msg, msz);
+        assert(status == 0);
+
+        // and be reproducible
+        status = mpECDSASignature_init_Sign(sig2, sscheme, sK, msg, msz);
+        assert(status == 0);
+        assert(mpFp_cmp(sig->r, sig2->r) == 0);
+        assert(mpFp_cmp(sig->s, sig2->s) == 0);
+
+        mpECDSASignature_clear(sig2);
+        mpECDSASignature_clear(sig);
+        mpECP_clear(pK);
+        mpFp_clear(sK);
+        mpz_clear(z);
+        mpECDSASignatureScheme_clear(sscheme);
+        mpECurve_clear(cv);
+        mpECDSAHashfunc_clear(H);
+    }
+}
+END_TEST
+
+// count GMP allocations (wrapping whatever allocator is installed)
+static void *(*_alloc_func)(size_t);
+static void *(*_realloc_func)(void *, size_t, size_t);
+static void (*_free_func)(void *, size_t);
+static long _gmp_alloc_count = 0;
+
+static void *_counting_alloc(size_t sz) {
+    _gmp_alloc_count++;
+    return _alloc_func(sz);
+}
+
+static void *_counting_realloc(void *old, size_t oldsz, size_t newsz) {
+    _gmp_alloc_count++;
+    return _realloc_func(old, oldsz, newsz);
+}
+
+static void _counting_free(void *old, size_t oldsz) {
+    _gmp_alloc_count++;
+    _free_func(old, oldsz);
+}
+
+START_TEST(test_mpECDSA_noalloc) {
+    char *curves[] = {"secp256k1", "P384", "Ed25519", "Curve25519", "E-521", NULL};
+    mpECDSAHashfunc_t H;
+    int i;
+
+    mpECDSAHashfunc_init(H);
+    H->dohash = wrap_libsodium_sha256;
+    H->hsz = crypto_hash_sha256_BYTES;
+    mpECDSAHashfunc_set_blocksize(H, _TEST_SHA256_BLOCKSZ);
+
+    mp_get_memory_functions(&_alloc_func, &_realloc_func, &_free_func);
+
+    for (i = 0; curves[i] != NULL; i++) {
+        mpECurve_t cv;
+        mpECDSASignatureScheme_t sscheme;
+        mpECDSASignature_t sig;
+        mpFp_t sK;
+        mpECP_t pK;
+        unsigned char msg[_TEST_MESSAGE_MAX];
+        int status;
+        int j;
+
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, curves[i]);
+        assert(status == 0);
+
+        printf("validating heap use of ECDSA for curve %s\n", curves[i]);
+
+        mpFp_init(sK, cv->n);
+        do {
+            mpFp_urandom(sK, cv->n);
+        } while (mpFp_cmp_ui(sK, 0) == 0);
+
+        mpECDSASignatureScheme_init(sscheme, cv, H);
+
+        mpECP_init(pK, cv);
+        mpECP_scalar_base_mul(pK, sscheme->cv_G, sK);
+
+        for (j = 1; j < _TEST_MESSAGE_MAX; j++) {
+            randombytes_buf(msg, j);
+            // alternate between random and RFC 6979 nonces
+            status = mpECDSASignatureScheme_set_deterministic(sscheme, j & 1);
+            assert(status == 0);
+
+            mp_set_memory_functions(_counting_alloc, _counting_realloc, _counting_free);
+            _gmp_alloc_count = 0;
+            status = mpECDSASignature_init_Sign(sig, sscheme, sK, msg, j);
+            assert(status == 0);
+            // only the signature (r, s) elements are allocated
+            assert(_gmp_alloc_count == 2);
+            _gmp_alloc_count = 0;
+            status = mpECDSASignature_verify_cmp(sig, pK, msg, j);
+            assert(status == 0);
+            assert(_gmp_alloc_count == 0);
+            mp_set_memory_functions(_alloc_func, _realloc_func, _free_func);
+
+            mpECDSASignature_clear(sig);
+        }
+
+        mpECP_clear(pK);
+        mpECDSASignatureScheme_clear(sscheme);
+        mpFp_clear(sK);
+        mpECurve_clear(cv);
+    }
+    mpECDSAHashfunc_clear(H);
+}
+END_TEST
+
+#define _TEST_POOL_SIZE     (16)
+
+START_TEST(test_mpECDSA_nonce_pool) {
+    char *curves[] = {"secp256k1", "P384", "Ed25519", "E-521", NULL};
+    mpECDSAHashfunc_t H;
+    int i;
+
+    mpECDSAHashfunc_init(H);
+    H->dohash = wrap_libsodium_sha256;
+    H->hsz = crypto_hash_sha256_BYTES;
+
+    for (i = 0; curves[i] != NULL; i++) {
+        mpECurve_t cv;
+        mpECDSASignatureScheme_t sscheme;
+        mpECDSANoncePool_t pool;
+        mpECDSASignature_t sig;
+        mpFp_t sK;
+        mpECP_t pK;
+        mpz_t prev_r;
+        unsigned char msg[_TEST_MESSAGE_MAX];
+        clock_t start, stop;
+        int status;
+        int j;
+
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, curves[i]);
+        assert(status == 0);
+
+        printf("validating ECDSA nonce pool for curve %s\n", curves[i]);
+
+        mpFp_init(sK, cv->n);
+        do {
+            mpFp_urandom(sK, cv->n);
+        } while (mpFp_cmp_ui(sK, 0) == 0);
+
+        mpECDSASignatureScheme_init(sscheme, cv, H);
+        mpECP_init(pK, cv);
+        mpECP_scalar_base_mul(pK, sscheme->cv_G, sK);
+
+        mpz_init(prev_r);
+        mpECDSANoncePool_init(pool, sscheme, _TEST_POOL_SIZE);
+        assert(mpECDSANoncePool_count(pool) == 0);
+        assert(mpECDSANoncePool_fill(pool, _TEST_POOL_SIZE / 2) == (_TEST_POOL_SIZE / 2));
+        assert(mpECDSANoncePool_count(pool) == (_TEST_POOL_SIZE / 2));
+        assert(mpECDSANoncePool_fill(pool, 2 * _TEST_POOL_SIZE) == (_TEST_POOL_SIZE / 2));
+        assert(mpECDSANoncePool_count(pool) == _TEST_POOL_SIZE);
+        mpECDSASignatureScheme_set_nonce_pool(sscheme, pool);
+
+        // each signature consumes exactly one entry, then falls back to
+        // fresh nonces once the pool is drained
+        randombytes_buf(msg, _TEST_MESSAGE_MAX);
+        for (j = 0; j < _TEST_POOL_SIZE + 4; j++) {
+            status = mpECDSASignature_init_Sign(sig, sscheme, sK, msg, _TEST_MESSAGE_MAX);
+            assert(status == 0);
+            if (j < _TEST_POOL_SIZE) {
+                assert(mpECDSANoncePool_count(pool) == (_TEST_POOL_SIZE - j - 1));
+            } else {
+                assert(mpECDSANoncePool_count(pool) == 0);
+            }
+            status = mpECDSASignature_verify_cmp(sig, pK, msg, _TEST_MESSAGE_MAX);
+            assert(status == 0);
+            // nonces are never reused (same message, so r must differ)
+            if (j > 0) {
+                assert(mpFp_cmp_mpz(sig->r, prev_r) != 0);
+            }
+            mpz_set_mpFp(prev_r, sig->r);
+            mpECDSASignature_clear(sig);
+        }
+
+        // background worker refills the pool
+        status = mpECDSANoncePool_start(pool);
+        assert(status == 0);
+        assert(mpECDSANoncePool_start(pool) != 0);
+        while (mpECDSANoncePool_count(pool) < _TEST_POOL_SIZE) {
+            usleep(1000);
+        }
+        start = clock();
+        for (j = 0; j < (4 * _TEST_POOL_SIZE); j++) {
+            randombytes_buf(msg, _TEST_MESSAGE_MAX);
+            status = mpECDSASignature_init_Sign(sig, sscheme, sK, msg, _TEST_MESSAGE_MAX);
+            assert(status == 0);
+            status = mpECDSASignature_verify_cmp(sig, pK, msg, _TEST_MESSAGE_MAX);
+            assert(status == 0);
+            mpECDSASignature_clear(sig);
+        }
+        stop = clock();
+        printf("sign+verify with worker running: %d in %f sec\n", 4 * _TEST_POOL_SIZE, ((double)(stop - start)) / CLOCKS_PER_SEC);
+        mpECDSANoncePool_stop(pool);
+        mpECDSANoncePool_stop(pool);
+
+        // a forked child must not reuse the parent's entries. The worker
+        // is running (in the parent only) and the pool is full at the fork.
+        {
+            unsigned char rp[2 * sscheme->nsz];
+            unsigned char rc[2 * sscheme->nsz + sizeof(size_t)];
+            size_t ccount;
+            pid_t pid;
+            int fd[2];
+
+            status = mpECDSANoncePool_start(pool);
+            assert(status == 0);
+            while (mpECDSANoncePool_count(pool) < _TEST_POOL_SIZE) {
+                usleep(1000);
+            }
+            assert(pipe(fd) == 0);
+            randombytes_buf(msg, _TEST_MESSAGE_MAX);
+            pid = fork();
+            assert(pid >= 0);
+            if (pid == 0) {
+                // child: report the pool count seen after the fork and r
+                close(fd[0]);
+                ccount = mpECDSANoncePool_count(pool);
+                status = mpECDSASignature_init_Sign(sig, sscheme, sK, msg, _TEST_MESSAGE_MAX);
+                if (status != 0) _exit(1);
+                if (mpECDSASignature_verify_cmp(sig, pK, msg, _TEST_MESSAGE_MAX) != 0) _exit(1);
+                mpECDSASignature_out_bytes(rc, sig);
+                memcpy(rc + (2 * sscheme->nsz), &ccount, sizeof(size_t));
+                if (write(fd[1], rc, sizeof(rc)) != (ssize_t)sizeof(rc)) _exit(1);
+                close(fd[1]);
+                mpECDSASignature_clear(sig);
+                // the worker does not exist in the child, so this must
+                // not wait for it
+                mpECDSANoncePool_clear(pool);
+                _exit(0);
+            }
+            close(fd[1]);
+            status = mpECDSASignature_init_Sign(sig, sscheme, sK, msg, _TEST_MESSAGE_MAX);
+            assert(status == 0);
+            mpECDSASignature_out_bytes(rp, sig);
+            mpECDSASignature_clear(sig);
+            assert(read(fd[0], rc, sizeof(rc)) == (ssize_t)sizeof(rc));
+            close(fd[0]);
+            assert(waitpid(pid, &status, 0) == pid);
+            assert(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+            memcpy(&ccount, rc + (2 * sscheme->nsz), sizeof(size_t));
+            assert(ccount == 0);
+            // same message and key, so equal r would mean a shared nonce
+            assert(memcmp(rp, rc, sscheme->nsz) != 0);
+            mpECDSANoncePool_stop(pool);
+        }
+
+        mpECDSANoncePool_clear(pool);
+        assert(sscheme->pool == NULL);
+        mpz_clear(prev_r);
+
+        mpECP_clear(pK);
+        mpECDSASignatureScheme_clear(sscheme);
+        mpFp_clear(sK);
+        mpECurve_clear(cv);
+    }
+    mpECDSAHashfunc_clear(H);
+}
+END_TEST
+
+#define _TEST_STREAM_SIZE   (100000)
+
+START_TEST(test_mpECDSA_digest) {
+    char *curves[] = {"secp256k1", "P384", "Ed25519", "E-521", NULL};
+    mpECDSAHashfunc_t H;
+    mpECDSAHashCtx_t hctx;
+    unsigned char *msg;
+    int i;
+
+    mpECDSAHashfunc_init(H);
+    H->dohash = wrap_libsodium_sha512;
+    H->hsz = crypto_hash_sha512_BYTES;
+    // no incremental interface
+    assert(mpECDSAHashCtx_init(hctx, H) != 0);
+    mpECDSAHashfunc_set_incremental(H, wrap_libsodium_sha512_init,
+        wrap_libsodium_sha512_update, wrap_libsodium_sha512_final,
+        sizeof(crypto_hash_sha512_state));
+
+    msg = (unsigned char *)malloc(_TEST_STREAM_SIZE);
+    assert(msg != NULL);
+
+    for (i = 0; curves[i] != NULL; i++) {
+        mpECurve_t cv;
+        mpECDSASignatureScheme_t sscheme;
+        mpECDSASignature_t sig;
+        mpFp_t sK;
+        mpECP_t pK;
+        unsigned char hash[crypto_hash_sha512_BYTES];
+        unsigned char hash2[crypto_hash_sha512_BYTES];
+        size_t pos;
+        int status;
+        int j;
+
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, curves[i]);
+        assert(status == 0);
+
+        printf("validating ECDSA sign/verify of streamed digest for curve %s\n", curves[i]);
+
+        mpFp_init(sK, cv->n);
+        do {
+            mpFp_urandom(sK, cv->n);
+        } while (mpFp_cmp_ui(sK, 0) == 0);
+
+        mpECDSASignatureScheme_init(sscheme, cv, H);
+        mpECP_init(pK, cv);
+        mpECP_scalar_base_mul(pK, sscheme->cv_G, sK);
+
+        status = mpECDSAHashCtx_init(hctx, sscheme->H);
+        assert(status == 0);
+
+        for (j = 0; j < 4; j++) {
+            randombytes_buf(msg, _TEST_STREAM_SIZE);
+
+            // hash in randomly sized pieces
+            pos = 0;
+            while (pos < _TEST_STREAM_SIZE) {
+                size_t chunk;
+
+                chunk = (size_t)(randombytes_random() % 5000);
+                if (chunk > (_TEST_STREAM_SIZE - pos)) {
+                    chunk = _TEST_STREAM_SIZE - pos;
+                }
+                mpECDSAHashCtx_update(hctx, msg + pos, chunk);
+                pos += chunk;
+            }
+            mpECDSAHashCtx_final(hctx, hash);
+            H->dohash(hash2, msg, _TEST_STREAM_SIZE);
+            assert(memcmp(hash, hash2, sizeof(hash)) == 0);
+
+            // digest and message interfaces are interchangeable
+            status = mpECDSASignature_init_Sign_digest(sig, sscheme, sK, hash, sizeof(hash));
+            assert(status == 0);
+            status = mpECDSASignature_verify_cmp(sig, pK, msg, _TEST_STREAM_SIZE);
+            assert(status == 0);
+            status = mpECDSASignature_verify_cmp_digest(sig, pK, hash, sizeof(hash));
+            assert(status == 0);
+            status = mpECDSASignature_verify_cmp_digest(sig, pK, hash, sizeof(hash) - 1);
+            assert(status != 0);
+            hash[0] ^= 0x01;
+            status = mpECDSASignature_verify_cmp_digest(sig, pK, hash, sizeof(hash));
+            assert(status != 0);
+            mpECDSASignature_clear(sig);
+
+            status = mpECDSASignature_init_Sign(sig, sscheme, sK, msg, _TEST_STREAM_SIZE);
+            assert(status == 0);
+            status = mpECDSASignature_verify_cmp_digest(sig, pK, hash2, sizeof(hash2));
+            assert(status == 0);
+            mpECDSASignature_clear(sig);
+        }
+
+        status = mpECDSASignature_init_Sign_digest(sig, sscheme, sK, hash, sizeof(hash) - 1);
+        assert(status != 0);
+
+        mpECDSAHashCtx_clear(hctx);
+        mpECP_clear(pK);
+        mpECDSASignatureScheme_clear(sscheme);
+        mpFp_clear(sK);
+        mpECurve_clear(cv);
+    }
+    free(msg);
+    mpECDSAHashfunc_clear(H);
+}
+END_TEST
+
+#define _TEST_ENCODE_BATCH  (32)
+
+START_TEST(test_mpECDSA_encode) {
+    char *curves[] = {"secp256k1", "P384", "Ed25519", "E-521", NULL};
+    mpECDSAHashfunc_t H;
+    int i;
+
+    mpECDSAHashfunc_init(H);
+    H->dohash = wrap_libsodium_sha256;
+    H->hsz = crypto_hash_sha256_BYTES;
+
+    mp_get_memory_functions(&_alloc_func, &_realloc_func, &_free_func);
+
+    for (i = 0; curves[i] != NULL; i++) {
+        mpECurve_t cv;
+        mpECDSASignatureScheme_t sscheme;
+        mpECDSASignature_t sig[_TEST_ENCODE_BATCH];
+        mpECDSASignature_t sigcp[_TEST_ENCODE_BATCH];
+        mpECDSASignature_ptr sigp[_TEST_ENCODE_BATCH];
+        mpECDSASignature_ptr sigcpp[_TEST_ENCODE_BATCH];
+        int bstatus[_TEST_ENCODE_BATCH];
+        size_t dlen[_TEST_ENCODE_BATCH];
+        mpFp_t sK;
+        unsigned char msg[_TEST_MESSAGE_MAX];
+        unsigned char *raw;
+        unsigned char *der;
+        size_t rawsz;
+        size_t dermax;
+        clock_t start, stop;
+        int status;
+        int j;
+
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, curves[i]);
+        assert(status == 0);
+
+        printf("validating ECDSA signature encoding for curve %s\n", curves[i]);
+
+        mpFp_init(sK, cv->n);
+        do {
+            mpFp_urandom(sK, cv->n);
+        } while (mpFp_cmp_ui(sK, 0) == 0);
+
+        mpECDSASignatureScheme_init(sscheme, cv, H);
+        dermax = mpECDSASignatureScheme_der_max_bytelen(sscheme);
+        rawsz = sscheme->nsz << 1;
+        raw = (unsigned char *)malloc(rawsz * _TEST_ENCODE_BATCH);
+        der = (unsigned char *)malloc(dermax * _TEST_ENCODE_BATCH);
+
+        for (j = 0; j < _TEST_ENCODE_BATCH; j++) {
+            unsigned char *exp;
+            size_t expsz;
+            int dsz;
+
+            randombytes_buf(msg, _TEST_MESSAGE_MAX);
+            status = mpECDSASignature_init_Sign(sig[j], sscheme, sK, msg, _TEST_MESSAGE_MAX);
+            assert(status == 0);
+            mpECDSASignature_init(sigcp[j], sscheme);
+            sigp[j] = sig[j];
+            sigcpp[j] = sigcp[j];
+
+            // raw encoding matches the allocating export
+            assert(mpECDSASignature_out_bytelen(sig[j]) == rawsz);
+            mpECDSASignature_out_bytes(raw, sig[j]);
+            exp = mpECDSASignature_export_bytes(sig[j], &expsz);
+            assert(expsz == rawsz);
+            assert(memcmp(raw, exp, rawsz) == 0);
+            free(exp);
+
+            mp_set_memory_functions(_counting_alloc, _counting_realloc, _counting_free);
+            _gmp_alloc_count = 0;
+            status = mpECDSASignature_set_bytes(sigcp[j], raw, rawsz);
+            assert(status == 0);
+            assert(mpFp_cmp(sig[j]->r, sigcp[j]->r) == 0);
+            assert(mpFp_cmp(sig[j]->s, sigcp[j]->s) == 0);
+
+            dsz = mpECDSASignature_out_der(der, dermax, sig[j]);
+            assert(dsz > 0);
+            assert(dsz == mpECDSASignature_out_der_bytelen(sig[j]));
+            assert(der[0] == 0x30);
+            assert(mpECDSASignature_out_der(der, dsz - 1, sig[j]) < 0);
+            status = mpECDSASignature_set_der(sigcp[j], der, dsz);
+            assert(status == 0);
+            assert(mpFp_cmp(sig[j]->r, sigcp[j]->r) == 0);
+            assert(mpFp_cmp(sig[j]->s, sigcp[j]->s) == 0);
+            assert(_gmp_alloc_count == 0);
+            mp_set_memory_functions(_alloc_func, _realloc_func, _free_func);
+
+            // malformed encodings
+            assert(mpECDSASignature_set_der(sigcp[j], der, dsz - 1) != 0);
+            der[0] = 0x31;
+            assert(mpECDSASignature_set_der(sigcp[j], der, dsz) != 0);
+            der[0] = 0x30;
+            assert(mpECDSASignature_set_bytes(sigcp[j], raw, rawsz - 1) != 0);
+            memset(raw, 0xFF, sscheme->nsz);
+            assert(mpECDSASignature_set_bytes(sigcp[j], raw, rawsz) != 0);
+            memset(raw, 0x00, sscheme->nsz);
+            assert(mpECDSASignature_set_bytes(sigcp[j], raw, rawsz) != 0);
+            // valid r with invalid s
+            mpECDSASignature_out_bytes(raw, sig[j]);
+            memset(raw + sscheme->nsz, 0x00, sscheme->nsz);
+            assert(mpECDSASignature_set_bytes(sigcp[j], raw, rawsz) != 0);
+            // failed decodes leave the signature unchanged
+            assert(mpFp_cmp(sig[j]->r, sigcp[j]->r) == 0);
+            assert(mpFp_cmp(sig[j]->s, sigcp[j]->s) == 0);
+        }
+
+        {
+            // non-minimal INTEGER (extra leading zero) must be rejected, only
+            // constructed for short form lengths and r without the high bit
+            unsigned char nm[dermax + 1];
+            int dsz;
+
+            dsz = mpECDSASignature_out_der(der, dermax, sig[0]);
+            if ((der[1] < 0x7F) && ((der[4] & 0x80) == 0)) {
+                nm[0] = 0x30;
+                nm[1] = der[1] + 1;
+                nm[2] = 0x02;
+                nm[3] = der[3] + 1;
+                nm[4] = 0x00;
+                memcpy(nm + 5, der + 4, dsz - 4);
+                assert(mpECDSASignature_set_der(sigcp[0], nm, dsz + 1) != 0);
+                // but the original is fine
+                assert(mpECDSASignature_set_der(sigcp[0], der, dsz) == 0);
+            }
+        }
+
+        start = clock();
+        mpECDSASignature_out_bytes_batch(raw, sigp, _TEST_ENCODE_BATCH);
+        status = mpECDSASignature_set_bytes_batch(sigcpp, raw, _TEST_ENCODE_BATCH, bstatus);
+        assert(status == 0);
+        status = mpECDSASignature_out_der_batch(der, dermax * _TEST_ENCODE_BATCH, dlen, sigp, _TEST_ENCODE_BATCH);
+        assert(status > 0);
+        status = mpECDSASignature_set_der_batch(sigcpp, der, dlen, _TEST_ENCODE_BATCH, bstatus);
+        assert(status == 0);
+        stop = clock();
+        printf("encode+decode raw+DER batch: %d in %f sec\n", _TEST_ENCODE_BATCH, ((double)(stop - start)) / CLOCKS_PER_SEC);
+
+        // one invalid entry is reported individually
+        memset(raw + (3 * rawsz), 0, rawsz);
+        status = mpECDSASignature_set_bytes_batch(sigcpp, raw, _TEST_ENCODE_BATCH, bstatus);
+        assert(status != 0);
+        for (j = 0; j < _TEST_ENCODE_BATCH; j++) {
+            assert((bstatus[j] != 0) == (j == 3));
+            // including the invalid entry, which keeps its previous value
+            assert(mpFp_cmp(sig[j]->r, sigcp[j]->r) == 0);
+            assert(mpFp_cmp(sig[j]->s, sigcp[j]->s) == 0);
+        }
+
+        for (j = 0; j < _TEST_ENCODE_BATCH; j++) {
+            mpECDSASignature_clear(sigcp[j]);
+            mpECDSASignature_clear(sig[j]);
+        }
+        free(der);
+        free(raw);
+        mpECDSASignatureScheme_clear(sscheme);
+        mpFp_clear(sK);
+        mpECurve_clear(cv);
+    }
+    mpECDSAHashfunc_clear(H);
+}
+END_TEST
+
+#define _TEST_VERIFY_COUNT  (100)
+
+START_TEST(test_mpECDSA_keycache) {
+    char *curves[] = {"secp256k1", "P384", "Ed25519", NULL};
+    mpECDSAHashfunc_t H;
+    int i;
+
+    mpECDSAHashfunc_init(H);
+    H->dohash = wrap_libsodium_sha256;
+    H->hsz = crypto_hash_sha256_BYTES;
+
+    for (i = 0; curves[i] != NULL; i++) {
+        mpECurve_t cv;
+        mpECDSASignatureScheme_t sscheme;
+        mpECDSASignature_t sig;
+        mpECPKeyCache_t cache;
+        mpFp_t sK;
+        mpECP_t pK;
+        mpECP_ptr cpK;
+        unsigned char msg[_TEST_MESSAGE_MAX];
+        unsigned char *kbuf;
+        size_t ksz;
+        clock_t start, stop;
+        double tnocache, tcache;
+        int status;
+        int j;
+
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, curves[i]);
+        assert(status == 0);
+
+        mpFp_init(sK, cv->n);
+        do {
+            mpFp_urandom(sK, cv->n);
+        } while (mpFp_cmp_ui(sK, 0) == 0);
+
+        mpECDSASignatureScheme_init(sscheme, cv, H);
+        mpECP_init(pK, cv);
+        mpECP_scalar_base_mul(pK, sscheme->cv_G, sK);
+        ksz = mpECP_out_bytelen(pK, 1);
+        kbuf = (unsigned char *)malloc(ksz);
+        mpECP_out_bytes(kbuf, pK, 1);
+        mpECPKeyCache_init(cache, cv, 16);
+
+        randombytes_buf(msg, _TEST_MESSAGE_MAX);
+        status = mpECDSASignature_init_Sign(sig, sscheme, sK, msg, _TEST_MESSAGE_MAX);
+        assert(status == 0);
+
+        start = clock();
+        for (j = 0; j < _TEST_VERIFY_COUNT; j++) {
+            status = mpECDSASignature_verify_cmp(sig, pK, msg, _TEST_MESSAGE_MAX);
+            assert(status == 0);
+        }
+        stop = clock();
+        tnocache = ((double)(stop - start)) / CLOCKS_PER_SEC;
+
+        start = clock();
+        for (j = 0; j < _TEST_VERIFY_COUNT; j++) {
+            cpK = mpECPKeyCache_lookup(cache, kbuf, ksz);
+            assert(cpK != NULL);
+            status = mpECDSASignature_verify_cmp(sig, cpK, msg, _TEST_MESSAGE_MAX);
+            assert(status == 0);
+        }
+        stop = clock();
+        tcache = ((double)(stop - start)) / CLOCKS_PER_SEC;
+        assert(cache->misses == 1);
+        assert(cache->hits == (_TEST_VERIFY_COUNT - 1));
+        assert(cache->promotions == 1);
+
+        // and a bad signature still fails against the cached key
+        msg[0] ^= 0x01;
+        cpK = mpECPKeyCache_lookup(cache, kbuf, ksz);
+        status = mpECDSASignature_verify_cmp(sig, cpK, msg, _TEST_MESSAGE_MAX);
+        assert(status != 0);
+
+        printf("verify %s: %d direct in %f sec, %d with key cache in %f sec\n",
+            curves[i], _TEST_VERIFY_COUNT, tnocache, _TEST_VERIFY_COUNT, tcache);
+
+        mpECDSASignature_clear(sig);
+        mpECPKeyCache_clear(cache);
+        free(kbuf);
+        mpECP_clear(pK);
+        mpECDSASignatureScheme_clear(sscheme);
+        mpFp_clear(sK);
+        mpECurve_clear(cv);
+    }
+    mpECDSAHashfunc_clear(H);
+}
+END_TEST
+
 static Suite *mpECDSA_test_suite(void) {
     Suite *s;
     TCase *tc;
@@ -566,6 +1275,12 @@ static Suite *mpECDSA_test_suite(void) {
 
     tcase_add_test(tc, test_mpECDSA_sscheme_init);
     tcase_add_test(tc, test_mpECDSA_reference_test_vectors);
+    tcase_add_test(tc, test_mpECDSA_deterministic);
+    tcase_add_test(tc, test_mpECDSA_noalloc);
+    tcase_add_test(tc, test_mpECDSA_nonce_pool);
+    tcase_add_test(tc, test_mpECDSA_digest);
+    tcase_add_test(tc, test_mpECDSA_encode);
+    tcase_add_test(tc, test_mpECDSA_keycache);
 
      // set no timeout instead of default 4
     tcase_set_timeout(tc, 0.0);
@@ -30,6 +30,7 @@
 
 #include <assert.h>
 #include <ecc/ecelgamal.h>
+#include <ecc/ecelgamaldec.h>
 #include <ecc/ecurve.h>
 #include <ecc/ecpoint.h>
 #include <ecc/field.h>
@@ -42,6 +43,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 
 START_TEST(test_mpECElgamal_init) {
     int i;
@@ -116,6 +118,666 @@ START_TEST(test_mpECElgamal_init) {
 }
 END_TEST
 
+START_TEST(test_mpECElgamal_encryptor) {
+    int i;
+    char **curves;
+
+    i = 0;
+    curves = _mpECurve_list_standard_curves();
+    while (curves[i] != NULL) {
+        mpECurve_t cv;
+        mpECP_t cv_G;
+        mpFp_t sK;
+        mpECP_t pK;
+        mpECP_t ptxt0;
+        mpECP_t ptxt1;
+        mpECElgamalCiphertext_t ctxt;
+        mpECElgamalEncryptor_t enc;
+        int64_t start_time, stop_time;
+        double enc_rate, ref_rate;
+        int status;
+        int j;
+
+        printf("Testing Elgamal encryptor for curve %s\n", curves[i]);
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, curves[i]);
+        assert(status == 0);
+
+        mpECP_init(cv_G, cv);
+        mpECP_set_mpz(cv_G, cv->G[0], cv->G[1], cv);
+
+        mpFp_init(sK, cv->n);
+        do {
+            mpFp_urandom(sK, cv->n);
+        } while (mpFp_cmp_ui(sK, 0) == 0);
+
+        mpECP_init(pK, cv);
+        mpECP_scalar_mul(pK, cv_G, sK);
+
+        status = mpECElgamalEncryptor_init(enc, pK);
+        assert(status == 0);
+
+        mpECP_init(ptxt0, cv);
+        for (j = 0; j < 20; j++) {
+            mpECP_urandom(ptxt0, cv);
+            status = mpECElgamalEncryptor_init_encrypt(ctxt, enc, ptxt0);
+            assert(status == 0);
+            status = mpECElgamal_init_decrypt(ptxt1, sK, ctxt);
+            assert(status == 0);
+            assert(mpECP_cmp(ptxt1, ptxt0) == 0);
+            mpECP_clear(ptxt1);
+            mpECElgamal_clear(ctxt);
+        }
+
+        start_time = clock();
+        for (j = 0; j < 100; j++) {
+            mpECElgamalEncryptor_init_encrypt(ctxt, enc, ptxt0);
+            mpECElgamal_clear(ctxt);
+        }
+        stop_time = clock();
+        enc_rate = (100.0 * CLOCKS_PER_SEC) / ((double)(stop_time - start_time));
+        start_time = clock();
+        for (j = 0; j < 100; j++) {
+            mpECElgamal_init_encrypt(ctxt, pK, ptxt0);
+            mpECElgamal_clear(ctxt);
+        }
+        stop_time = clock();
+        ref_rate = (100.0 * CLOCKS_PER_SEC) / ((double)(stop_time - start_time));
+        printf("encryptor rate = %g enc/sec (%g X)\n", enc_rate, enc_rate / ref_rate);
+        printf("init_encrypt rate = %g enc/sec\n", ref_rate);
+
+        mpECElgamalEncryptor_clear(enc);
+        mpECP_clear(ptxt0);
+        mpECP_clear(pK);
+        mpFp_clear(sK);
+        mpECP_clear(cv_G);
+        mpECurve_clear(cv);
+        free(curves[i]);
+        i++;
+    }
+    free(curves);
+}
+END_TEST
+
+#define _TEST_ELGAMAL_BATCH (100)
+
+START_TEST(test_mpECElgamal_batch) {
+    int i;
+    char **curves;
+
+    i = 0;
+    curves = _mpECurve_list_standard_curves();
+    while (curves[i] != NULL) {
+        mpECurve_t cv;
+        mpECP_t cv_G;
+        mpFp_t sK;
+        mpECP_t pK;
+        static mpECP_t ptxt0[_TEST_ELGAMAL_BATCH];
+        static mpECP_t ptxt1[_TEST_ELGAMAL_BATCH];
+        static mpECElgamalCiphertext_t ctxt[_TEST_ELGAMAL_BATCH];
+        mpECP_ptr p0[_TEST_ELGAMAL_BATCH];
+        mpECP_ptr p1[_TEST_ELGAMAL_BATCH];
+        mpECElgamalCiphertext_ptr cp[_TEST_ELGAMAL_BATCH];
+        mpECP_t ptxt;
+        mpECElgamalEncryptor_t enc;
+        int64_t start_time, stop_time;
+        double t_single, t_batch;
+        int status;
+        int j;
+
+        printf("Testing Elgamal batch for curve %s\n", curves[i]);
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, curves[i]);
+        assert(status == 0);
+
+        mpECP_init(cv_G, cv);
+        mpECP_set_mpz(cv_G, cv->G[0], cv->G[1], cv);
+
+        mpFp_init(sK, cv->n);
+        do {
+            mpFp_urandom(sK, cv->n);
+        } while (mpFp_cmp_ui(sK, 0) == 0);
+
+        mpECP_init(pK, cv);
+        mpECP_scalar_mul(pK, cv_G, sK);
+        status = mpECElgamalEncryptor_init(enc, pK);
+        assert(status == 0);
+
+        for (j = 0; j < _TEST_ELGAMAL_BATCH; j++) {
+            mpECP_init(ptxt0[j], cv);
+            mpECP_urandom(ptxt0[j], cv);
+            p0[j] = ptxt0[j];
+            p1[j] = ptxt1[j];
+            cp[j] = ctxt[j];
+        }
+        mpECP_set_neutral(ptxt0[3], cv);
+
+        status = mpECElgamal_encrypt_batch(cp, enc, p0, _TEST_ELGAMAL_BATCH);
+        assert(status == 0);
+        for (j = 0; j < _TEST_ELGAMAL_BATCH; j++) {
+            status = mpECElgamal_init_decrypt(ptxt, sK, ctxt[j]);
+            assert(status == 0);
+            assert(mpECP_cmp(ptxt, ptxt0[j]) == 0);
+            mpECP_clear(ptxt);
+        }
+        status = mpECElgamal_decrypt_batch(p1, sK, cp, _TEST_ELGAMAL_BATCH);
+        assert(status == 0);
+        for (j = 0; j < _TEST_ELGAMAL_BATCH; j++) {
+            assert(mpECP_cmp(ptxt1[j], ptxt0[j]) == 0);
+            if (ptxt1[j]->is_neutral == 0) {
+                assert(mpFp_cmp_ui(ptxt1[j]->z, 1) == 0);
+            }
+            mpECP_clear(ptxt1[j]);
+        }
+
+        start_time = clock();
+        for (j = 0; j < _TEST_ELGAMAL_BATCH; j++) {
+            mpECElgamal_init_decrypt(ptxt1[j], sK, ctxt[j]);
+        }
+        stop_time = clock();
+        t_single = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        for (j = 0; j < _TEST_ELGAMAL_BATCH; j++) {
+            mpECP_clear(ptxt1[j]);
+        }
+        start_time = clock();
+        mpECElgamal_decrypt_batch(p1, sK, cp, _TEST_ELGAMAL_BATCH);
+        stop_time = clock();
+        t_batch = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        printf("decrypt %d: %f sec single, %f sec batch\n", _TEST_ELGAMAL_BATCH, t_single, t_batch);
+        for (j = 0; j < _TEST_ELGAMAL_BATCH; j++) {
+            mpECP_clear(ptxt1[j]);
+            mpECElgamal_clear(ctxt[j]);
+        }
+
+        start_time = clock();
+        for (j = 0; j < _TEST_ELGAMAL_BATCH; j++) {
+            mpECElgamalEncryptor_init_encrypt(ctxt[j], enc, ptxt0[j]);
+        }
+        stop_time = clock();
+        t_single = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        for (j = 0; j < _TEST_ELGAMAL_BATCH; j++) {
+            mpECElgamal_clear(ctxt[j]);
+        }
+        start_time = clock();
+        mpECElgamal_encrypt_batch(cp, enc, p0, _TEST_ELGAMAL_BATCH);
+        stop_time = clock();
+        t_batch = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        printf("encrypt %d: %f sec single, %f sec batch (normalized)\n", _TEST_ELGAMAL_BATCH, t_single, t_batch);
+        for (j = 0; j < _TEST_ELGAMAL_BATCH; j++) {
+            mpECElgamal_clear(ctxt[j]);
+            mpECP_clear(ptxt0[j]);
+        }
+
+        mpECElgamalEncryptor_clear(enc);
+        mpECP_clear(pK);
+        mpFp_clear(sK);
+        mpECP_clear(cv_G);
+        mpECurve_clear(cv);
+        free(curves[i]);
+        i++;
+    }
+    free(curves);
+}
+END_TEST
+
+#define _TEST_ELGAMAL_SUM    (1000)
+
+START_TEST(test_mpECElgamal_homomorphic) {
+    int i, j, status;
+    char *test_curve[] = {"secp256k1", "P384", "Ed25519", "E-521", "Curve25519", "Curve41417"};
+    int ncurves;
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0; i < ncurves; i++) {
+        mpECurve_t cv;
+        mpECP_t cv_G, pK, ptxt, expect, t;
+        mpFp_t sK, w;
+        mpz_t m, mm;
+        mpECElgamalEncryptor_t enc;
+        static mpECElgamalCiphertext_t ctxt[_TEST_ELGAMAL_SUM];
+        static mpFp_t wt[_TEST_ELGAMAL_SUM];
+        static unsigned long mv[_TEST_ELGAMAL_SUM];
+        mpECElgamalCiphertext_ptr cp[_TEST_ELGAMAL_SUM];
+        mpFp_ptr wp[_TEST_ELGAMAL_SUM];
+        mpECElgamalCiphertext_t r;
+        int64_t start_time, stop_time;
+        double t_naive, t_sum;
+
+        printf("Testing Elgamal homomorphic operations for curve %s\n", test_curve[i]);
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, test_curve[i]);
+        assert(status == 0);
+        mpECP_init(cv_G, cv);
+        mpECP_set_mpz(cv_G, cv->G[0], cv->G[1], cv);
+        mpECP_scalar_base_mul_setup(cv_G);
+        mpFp_init(sK, cv->n);
+        mpFp_urandom(sK, cv->n);
+        mpECP_init(pK, cv);
+        mpECP_scalar_base_mul(pK, cv_G, sK);
+        status = mpECElgamalEncryptor_init(enc, pK);
+        assert(status == 0);
+        mpECP_init(expect, cv);
+        mpECP_init(t, cv);
+        mpFp_init(w, cv->n);
+        mpz_init(m);
+        mpz_init(mm);
+
+        // ctxt[j] encrypts mv[j] * G
+        for (j = 0; j < _TEST_ELGAMAL_SUM; j++) {
+            mv[j] = randombytes_random() % 1000;
+            mpz_set_ui(m, mv[j]);
+            mpECP_scalar_base_mul_mpz(t, cv_G, m);
+            status = mpECElgamalEncryptor_init_encrypt(ctxt[j], enc, t);
+            assert(status == 0);
+            cp[j] = ctxt[j];
+            mpFp_init(wt[j], cv->n);
+            mpFp_set_ui(wt[j], randombytes_random(), cv->n);
+            wp[j] = wt[j];
+        }
+        mpFp_set_ui(wt[5], 0, cv->n);
+
+        // add, scalar_mul (in place)
+        mpECElgamal_init(r, cv);
+        status = mpECElgamal_add(r, ctxt[0], ctxt[1]);
+        assert(status == 0);
+        mpECElgamal_init_decrypt(ptxt, sK, r);
+        mpz_set_ui(m, mv[0] + mv[1]);
+        mpECP_scalar_base_mul_mpz(expect, cv_G, m);
+        assert(mpECP_cmp(ptxt, expect) == 0);
+        mpECP_clear(ptxt);
+        mpFp_urandom(w, cv->n);
+        status = mpECElgamal_scalar_mul(r, r, w);
+        assert(status == 0);
+        mpECElgamal_init_decrypt(ptxt, sK, r);
+        mpECP_scalar_mul(expect, expect, w);
+        assert(mpECP_cmp(ptxt, expect) == 0);
+        mpECP_clear(ptxt);
+
+        // empty, unweighted and weighted sums
+        status = mpECElgamal_sum(r, cp, NULL, 0);
+        assert(status == 0);
+        mpECElgamal_init_decrypt(ptxt, sK, r);
+        mpECP_set_neutral(expect, cv);
+        assert(mpECP_cmp(ptxt, expect) == 0);
+        mpECP_clear(ptxt);
+
+        status = mpECElgamal_sum(r, cp, NULL, _TEST_ELGAMAL_SUM);
+        assert(status == 0);
+        mpz_set_ui(m, 0);
+        for (j = 0; j < _TEST_ELGAMAL_SUM; j++) {
+            mpz_add_ui(m, m, mv[j]);
+        }
+        mpECElgamal_init_decrypt(ptxt, sK, r);
+        mpECP_scalar_base_mul_mpz(expect, cv_G, m);
+        assert(mpECP_cmp(ptxt, expect) == 0);
+        mpECP_clear(ptxt);
+
+        // unweighted sum of one term, and in place (rop is also a term)
+        status = mpECElgamal_sum(r, cp + 3, NULL, 1);
+        assert(status == 0);
+        mpECElgamal_init_decrypt(ptxt, sK, r);
+        mpz_set_ui(m, mv[3]);
+        mpECP_scalar_base_mul_mpz(expect, cv_G, m);
+        assert(mpECP_cmp(ptxt, expect) == 0);
+        mpECP_clear(ptxt);
+        {
+            mpECElgamalCiphertext_ptr ip[3];
+
+            ip[0] = ctxt[1];
+            ip[1] = r;
+            ip[2] = ctxt[2];
+            status = mpECElgamal_sum(r, ip, NULL, 3);
+            assert(status == 0);
+            mpECElgamal_init_decrypt(ptxt, sK, r);
+            mpz_set_ui(m, mv[1] + mv[2] + mv[3]);
+            mpECP_scalar_base_mul_mpz(expect, cv_G, m);
+            assert(mpECP_cmp(ptxt, expect) == 0);
+            mpECP_clear(ptxt);
+        }
+
+        for (j = 1; j <= _TEST_ELGAMAL_SUM; j *= 10) {
+            int l;
+
+            status = mpECElgamal_sum(r, cp, wp, j);
+            assert(status == 0);
+            mpz_set_ui(m, 0);
+            for (l = 0; l < j; l++) {
+                mpz_set_mpFp(mm, wt[l]);
+                mpz_addmul_ui(m, mm, mv[l]);
+            }
+            mpECElgamal_init_decrypt(ptxt, sK, r);
+            mpz_mod(m, m, cv->n);
+            mpECP_scalar_base_mul_mpz(expect, cv_G, m);
+            assert(mpECP_cmp(ptxt, expect) == 0);
+            mpECP_clear(ptxt);
+        }
+
+        start_time = clock();
+        mpECElgamal_sum(r, cp, wp, _TEST_ELGAMAL_SUM);
+        stop_time = clock();
+        t_sum = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        start_time = clock();
+        {
+            mpECElgamalCiphertext_t s;
+
+            mpECElgamal_init(s, cv);
+            for (j = 0; j < _TEST_ELGAMAL_SUM; j++) {
+                mpECElgamal_scalar_mul(s, ctxt[j], wt[j]);
+                mpECElgamal_add(r, r, s);
+            }
+            mpECElgamal_clear(s);
+        }
+        stop_time = clock();
+        t_naive = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        printf("weighted sum of %d (32 bit weights): %f sec scalar_mul + add, %f sec sum\n", _TEST_ELGAMAL_SUM, t_naive, t_sum);
+
+        mpECElgamal_clear(r);
+        for (j = 0; j < _TEST_ELGAMAL_SUM; j++) {
+            mpFp_clear(wt[j]);
+            mpECElgamal_clear(ctxt[j]);
+        }
+        mpz_clear(mm);
+        mpz_clear(m);
+        mpFp_clear(w);
+        mpECP_clear(t);
+        mpECP_clear(expect);
+        mpECElgamalEncryptor_clear(enc);
+        mpECP_clear(pK);
+        mpFp_clear(sK);
+        mpECP_clear(cv_G);
+        mpECurve_clear(cv);
+    }
+}
+END_TEST
+
+#define _TEST_ELGAMAL_RERAND  (100)
+
+START_TEST(test_mpECElgamal_rerandomize) {
+    int i;
+    char **curves;
+
+    i = 0;
+    curves = _mpECurve_list_standard_curves();
+    while (curves[i] != NULL) {
+        mpECurve_t cv;
+        mpECP_t cv_G;
+        mpFp_t sK;
+        mpECP_t pK;
+        mpECP_t neutral;
+        mpECP_t ptxt0[_TEST_ELGAMAL_RERAND];
+        mpECP_t ptxt1;
+        mpECP_t C0;
+        mpECElgamalCiphertext_t ctxt[_TEST_ELGAMAL_RERAND];
+        mpECElgamalCiphertext_ptr cp[_TEST_ELGAMAL_RERAND];
+        mpECElgamalCiphertext_t ectxt;
+        mpECElgamalEncryptor_t enc;
+        int64_t start_time, stop_time;
+        double ref_time, single_time, batch_time;
+        int status;
+        int j;
+
+        printf("Testing Elgamal rerandomize for curve %s\n", curves[i]);
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, curves[i]);
+        assert(status == 0);
+
+        mpECP_init(cv_G, cv);
+        mpECP_set_mpz(cv_G, cv->G[0], cv->G[1], cv);
+
+        mpFp_init(sK, cv->n);
+        do {
+            mpFp_urandom(sK, cv->n);
+        } while (mpFp_cmp_ui(sK, 0) == 0);
+
+        mpECP_init(pK, cv);
+        mpECP_scalar_mul(pK, cv_G, sK);
+
+        status = mpECElgamalEncryptor_init(enc, pK);
+        assert(status == 0);
+
+        mpECP_init(neutral, cv);
+        mpECP_set_neutral(neutral, cv);
+        mpECP_init(C0, cv);
+        for (j = 0; j < _TEST_ELGAMAL_RERAND; j++) {
+            mpECP_init(ptxt0[j], cv);
+            mpECP_urandom(ptxt0[j], cv);
+            status = mpECElgamalEncryptor_init_encrypt(ctxt[j], enc, ptxt0[j]);
+            assert(status == 0);
+            cp[j] = ctxt[j];
+        }
+
+        // single: plaintext preserved, ciphertext changed
+        for (j = 0; j < 10; j++) {
+            mpECP_set(C0, ctxt[j]->C);
+            status = mpECElgamal_rerandomize(ctxt[j], enc);
+            assert(status == 0);
+            assert(mpECP_cmp(C0, ctxt[j]->C) != 0);
+            status = mpECElgamal_init_decrypt(ptxt1, sK, ctxt[j]);
+            assert(status == 0);
+            assert(mpECP_cmp(ptxt1, ptxt0[j]) == 0);
+            mpECP_clear(ptxt1);
+        }
+
+        // batch, applied several times (as in a shuffle)
+        for (j = 0; j < 3; j++) {
+            status = mpECElgamal_rerandomize_batch(cp, enc, _TEST_ELGAMAL_RERAND);
+            assert(status == 0);
+        }
+        for (j = 0; j < _TEST_ELGAMAL_RERAND; j++) {
+            status = mpECElgamal_init_decrypt(ptxt1, sK, ctxt[j]);
+            assert(status == 0);
+            assert(mpECP_cmp(ptxt1, ptxt0[j]) == 0);
+            mpECP_clear(ptxt1);
+        }
+
+        // reference: add a fresh encryption of the neutral element
+        start_time = clock();
+        for (j = 0; j < _TEST_ELGAMAL_RERAND; j++) {
+            mpECElgamal_init_encrypt(ectxt, pK, neutral);
+            mpECP_add(ctxt[j]->C, ctxt[j]->C, ectxt->C);
+            mpECP_add(ctxt[j]->D, ctxt[j]->D, ectxt->D);
+            mpECElgamal_clear(ectxt);
+        }
+        stop_time = clock();
+        ref_time = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        start_time = clock();
+        for (j = 0; j < _TEST_ELGAMAL_RERAND; j++) {
+            mpECElgamal_rerandomize(ctxt[j], enc);
+        }
+        stop_time = clock();
+        single_time = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        start_time = clock();
+        mpECElgamal_rerandomize_batch(cp, enc, _TEST_ELGAMAL_RERAND);
+        stop_time = clock();
+        batch_time = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        printf("rerandomize %d: %f sec encrypt(O), %f sec single, %f sec batch (normalized)\n", _TEST_ELGAMAL_RERAND, ref_time, single_time, batch_time);
+
+        for (j = 0; j < _TEST_ELGAMAL_RERAND; j++) {
+            mpECElgamal_clear(ctxt[j]);
+            mpECP_clear(ptxt0[j]);
+        }
+        mpECP_clear(C0);
+        mpECP_clear(neutral);
+        mpECElgamalEncryptor_clear(enc);
+        mpECP_clear(pK);
+        mpFp_clear(sK);
+        mpECP_clear(cv_G);
+        mpECurve_clear(cv);
+        free(curves[i]);
+        i++;
+    }
+    free(curves);
+}
+END_TEST
+
+#define _TEST_DECODE_RANGE  (UINT64_C(1) << 20)
+
+// saved table layout: 8 byte magic, then uint64_t baby, slots, bits, gkey,
+// gval, then slots (key, val) uint64_t pairs
+#define _TEST_DECODE_HDR    (48)
+
+// overwrite the uint64_t at offset in path
+static void _test_decode_patch(char *path, long offset, uint64_t v) {
+    FILE *f;
+
+    f = fopen(path, "r+b");
+    assert(f != NULL);
+    assert(fseek(f, offset, SEEK_SET) == 0);
+    assert(fwrite(&v, sizeof(v), 1, f) == 1);
+    assert(fclose(f) == 0);
+    return;
+}
+
+START_TEST(test_mpECElgamal_decode) {
+    int i, j, status;
+    char *test_curve[] = {"secp256k1", "P384", "Ed25519", "E-521", "Curve25519", "Curve41417"};
+    int ncurves;
+    char path[] = "/tmp/test_ecelgamal_decode_XXXXXX";
+    int fd;
+
+    fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0; i < ncurves; i++) {
+        mpECurve_t cv, cv2;
+        mpECP_t cv_G, pK, ptxt;
+        mpFp_t sK;
+        mpz_t mz;
+        mpECElgamalEncryptor_t enc;
+        mpECElgamalCiphertext_t ctxt;
+        mpECElgamalDecoder_t dec, fdec;
+        uint64_t m, mv[8];
+        int64_t start_time, stop_time;
+        double t_init, t_decode;
+
+        printf("Testing Elgamal decode for curve %s\n", test_curve[i]);
+        mpECurve_init(cv);
+        status = mpECurve_set_named(cv, test_curve[i]);
+        assert(status == 0);
+        mpECP_init(cv_G, cv);
+        mpECP_set_mpz(cv_G, cv->G[0], cv->G[1], cv);
+        mpFp_init(sK, cv->n);
+        mpFp_urandom(sK, cv->n);
+        mpECP_init(pK, cv);
+        mpECP_scalar_mul(pK, cv_G, sK);
+        status = mpECElgamalEncryptor_init(enc, pK);
+        assert(status == 0);
+        mpECP_init(ptxt, cv);
+        mpz_init(mz);
+
+        start_time = clock();
+        status = mpECElgamalDecoder_init(dec, cv, _TEST_DECODE_RANGE, 0);
+        assert(status == 0);
+        stop_time = clock();
+        t_init = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+
+        mv[0] = 0;
+        mv[1] = 1;
+        mv[2] = dec->baby;
+        mv[3] = (2 * dec->baby) + 1;
+        mv[4] = _TEST_DECODE_RANGE - 1;
+        for (j = 5; j < 8; j++) {
+            mv[j] = randombytes_random() % _TEST_DECODE_RANGE;
+        }
+        t_decode = 0.0;
+        for (j = 0; j < 8; j++) {
+            mpz_set_ui(mz, mv[j]);
+            mpECP_scalar_mul_mpz(ptxt, cv_G, mz);
+            status = mpECElgamalEncryptor_init_encrypt(ctxt, enc, ptxt);
+            assert(status == 0);
+            start_time = clock();
+            status = mpECElgamal_decrypt_decode(&m, dec, sK, ctxt);
+            stop_time = clock();
+            t_decode += ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+            assert(status == 0);
+            assert(m == mv[j]);
+            mpECElgamal_clear(ctxt);
+        }
+        printf("decode range 2**20: %f sec table (%lu entries), %f sec / decode\n", t_init, (unsigned long)dec->baby, t_decode / 8.0);
+
+        // out of range
+        mpz_set_ui(mz, _TEST_DECODE_RANGE);
+        mpECP_scalar_mul_mpz(ptxt, cv_G, mz);
+        status = mpECElgamalDecoder_decode(&m, dec, ptxt);
+        assert(status != 0);
+
+        // multithreaded giant steps, explicit (small) baby table
+        mpECElgamalDecoder_clear(dec);
+        status = mpECElgamalDecoder_init(dec, cv, _TEST_DECODE_RANGE, 16);
+        assert(status == 0);
+        mpECElgamalDecoder_set_threads(dec, 4);
+        for (j = 0; j < 8; j++) {
+            mpz_set_ui(mz, mv[j]);
+            mpECP_scalar_mul_mpz(ptxt, cv_G, mz);
+            status = mpECElgamalDecoder_decode(&m, dec, ptxt);
+            assert(status == 0);
+            assert(m == mv[j]);
+        }
+
+        // save and map, with a larger range than the table was built for
+        status = mpECElgamalDecoder_save(dec, path);
+        assert(status == 0);
+        status = mpECElgamalDecoder_init_file(fdec, cv, path, 4 * _TEST_DECODE_RANGE);
+        assert(status == 0);
+        assert(fdec->baby == 16);
+        mpz_set_ui(mz, (3 * _TEST_DECODE_RANGE) + 12345);
+        mpECP_scalar_mul_mpz(ptxt, cv_G, mz);
+        status = mpECElgamalDecoder_decode(&m, fdec, ptxt);
+        assert(status == 0);
+        assert(m == (3 * _TEST_DECODE_RANGE) + 12345);
+        mpECElgamalDecoder_clear(fdec);
+
+        // table is tied to its curve
+        mpECurve_init(cv2);
+        status = mpECurve_set_named(cv2, test_curve[(i + 1) % ncurves]);
+        assert(status == 0);
+        status = mpECElgamalDecoder_init_file(fdec, cv2, path, _TEST_DECODE_RANGE);
+        assert(status != 0);
+        mpECurve_clear(cv2);
+
+        // corrupt tables: no empty slot (probes are bounded), baby steps
+        // not fitting the table, slot count overflowing the size check
+        {
+            uint64_t k, slots;
+
+            slots = dec->mask + 1;
+            for (k = 0; k < slots; k++) {
+                _test_decode_patch(path, _TEST_DECODE_HDR + (16 * k) + 8, 2);
+            }
+            status = mpECElgamalDecoder_init_file(fdec, cv, path, _TEST_DECODE_RANGE);
+            assert(status == 0);
+            mpz_set_ui(mz, _TEST_DECODE_RANGE);
+            mpECP_scalar_mul_mpz(ptxt, cv_G, mz);
+            status = mpECElgamalDecoder_decode(&m, fdec, ptxt);
+            assert(status != 0);
+            mpECElgamalDecoder_clear(fdec);
+
+            _test_decode_patch(path, 8, slots);
+            status = mpECElgamalDecoder_init_file(fdec, cv, path, _TEST_DECODE_RANGE);
+            assert(status != 0);
+
+            _test_decode_patch(path, 8, 1);
+            _test_decode_patch(path, 16, UINT64_C(1) << 60);
+            assert(truncate(path, _TEST_DECODE_HDR) == 0);
+            status = mpECElgamalDecoder_init_file(fdec, cv, path, _TEST_DECODE_RANGE);
+            assert(status != 0);
+        }
+
+        mpECElgamalDecoder_clear(dec);
+        mpz_clear(mz);
+        mpECP_clear(ptxt);
+        mpECElgamalEncryptor_clear(enc);
+        mpECP_clear(pK);
+        mpFp_clear(sK);
+        mpECP_clear(cv_G);
+        mpECurve_clear(cv);
+    }
+    unlink(path);
+}
+END_TEST
+
 static Suite *mpECDSA_test_suite(void) {
     Suite *s;
     TCase *tc;
@@ -124,6 +786,11 @@ static Suite *mpECDSA_test_suite(void) {
     tc = tcase_create("EC Elgamal encryption algorithm");
 
     tcase_add_test(tc, test_mpECElgamal_init);
+    tcase_add_test(tc, test_mpECElgamal_encryptor);
+    tcase_add_test(tc, test_mpECElgamal_batch);
+    tcase_add_test(tc, test_mpECElgamal_homomorphic);
+    tcase_add_test(tc, test_mpECElgamal_rerandomize);
+    tcase_add_test(tc, test_mpECElgamal_decode);
 
      // set no timeout instead of default 4
     tcase_set_timeout(tc, 0.0);
@@ -30,12 +30,18 @@
 
 #include <assert.h>
 #include <check.h>
+#include <ecc/ecpbatch.h>
+#include <ecc/ecphash.h>
+#include <ecc/ecpkeycache.h>
 #include <ecc/ecpoint.h>
 #include <ecc/ecurve.h>
 #include <ecc/safememory.h>
 #include <gmp.h>
+#include <sodium.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 START_TEST(test_mpECP_create) {
     int error;
@@ -690,6 +696,823 @@ START_TEST(test_mpECP_scalar_base_mul) {
 }
 END_TEST
 
+START_TEST(test_mpECP_base_const) {
+    int error, i, j, ncurves;
+    // the first four have prebuilt tables (if enabled), Curve25519 does not
+    char *test_curve[] = {"P256", "secp256k1", "Ed25519", "P384", "Curve25519"};
+    mpECurve_t cv;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        mpECP_t a, b, c, d;
+        mpFp_t k;
+        clock_t start, first, runtime;
+
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpECP_init(d, cv);
+        mpFp_init(k, cv->n);
+        mpFp_urandom(k, cv->n);
+        mpECP_set_mpz(a, cv->G[0], cv->G[1], cv);
+        mpECP_set_mpz(b, cv->G[0], cv->G[1], cv);
+
+        // first multiplication includes the setup
+        start = clock();
+        mpECP_scalar_base_mul(c, a, k);
+        first = clock() - start;
+        // table built at runtime (a different window is never prebuilt)
+        start = clock();
+        mpECP_scalar_base_mul_setup_bits(b, 7);
+        mpECP_scalar_base_mul(d, b, k);
+        runtime = clock() - start;
+        assert(b->base_const == NULL);
+        assert(mpECP_cmp(c, d) == 0);
+        printf("%s prebuilt = %d, first base mul %ld ticks (runtime setup %ld)\n",
+            test_curve[i], (a->base_const != NULL), (long)first, (long)runtime);
+        if (i == (ncurves - 1)) assert(a->base_const == NULL);
+
+        for (j = 0; j < 100; j++) {
+            if (j == 0) {
+                mpFp_set_ui(k, 0, cv->n);
+            } else if (j == 1) {
+                mpFp_set_ui(k, 0, cv->n);
+                mpFp_sub_ui(k, k, 1);
+            } else {
+                mpFp_urandom(k, cv->n);
+            }
+            mpECP_scalar_base_mul(c, a, k);
+            mpECP_scalar_base_mul(d, b, k);
+            assert(mpECP_cmp(c, d) == 0);
+            mpECP_scalar_mul(d, a, k);
+            assert(mpECP_cmp(c, d) == 0);
+        }
+
+        // swap moves the table, set releases it
+        mpECP_swap(a, b);
+        mpECP_scalar_base_mul(c, b, k);
+        assert(mpECP_cmp(c, d) == 0);
+        mpECP_set(b, c);
+        assert((b->base_bits == 0) && (b->base_const == NULL));
+
+        mpFp_clear(k);
+        mpECP_clear(d);
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpECurve_clear(cv);
+}
+END_TEST
+
+START_TEST(test_mpECP_scratch) {
+    int error, i, j, ncurves;
+    char *test_curve[] = {"secp256k1", "Curve41417", "Ed25519", "M-511", "P521"};
+    mpECurve_t cv;
+    mpECScratch_t scr;
+    mpECurve_init(cv);
+    // heap allocated arena, reused across all curves
+    mpECScratch_init(scr, _MPEC_SCRATCH_LIMBS);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        mpECP_t a, b, c;
+        mpFp_t k;
+        size_t mark;
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpFp_init(k, cv->n);
+        for (j = 0; j < 10; j++) {
+            mark = mpECScratch_mark(scr);
+            mpECP_init_scratch(c, cv, scr);
+            assert(mpECScratch_mark(scr) > mark);
+            mpECP_urandom(a, cv);
+            mpFp_urandom(k, cv->n);
+            mpECP_scalar_mul(b, a, k);
+            mpECP_scalar_mul_scratch(c, a, k, scr);
+            assert(mpECP_cmp(b, c) == 0);
+            mpECP_scalar_base_mul(b, a, k);
+            assert(mpECP_cmp(b, c) == 0);
+            mpECP_set_neutral(c, cv);
+            mpECP_scalar_base_mul_scratch(c, a, k, scr);
+            assert(mpECP_cmp(b, c) == 0);
+            mpECScratch_release(scr, mark);
+            assert(mpECScratch_mark(scr) == mark);
+        }
+        mpFp_clear(k);
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpECScratch_clear(scr);
+    mpECurve_clear(cv);
+}
+END_TEST
+
+START_TEST(test_mpECP_batch) {
+    int error, i, j, ncurves;
+    char *test_curve[] = {"secp256k1", "Curve41417", "Ed25519", "M-511", "E-521", "P384"};
+    mpECurve_t cv;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        mpECPBatch_t ba, bb, bc;
+        mpECP_t a[16], b[16], c, d;
+        unsigned char *buf, *sbuf;
+        int bytes, compress;
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECPBatch_init(ba, 16, cv);
+        mpECPBatch_init(bb, 16, cv);
+        mpECPBatch_init(bc, 16, cv);
+        mpECP_init(c, cv);
+        mpECP_init(d, cv);
+        for (j = 0; j < 16; j++) {
+            mpECP_init(a[j], cv);
+            mpECP_init(b[j], cv);
+            mpECP_urandom(a[j], cv);
+            mpECP_urandom(b[j], cv);
+        }
+        // exercise neutral and P + (-P)
+        mpECP_set_neutral(a[3], cv);
+        mpECP_neg(b[5], a[5]);
+        mpECP_set(b[7], a[7]);
+        for (j = 0; j < 16; j++) {
+            mpECPBatch_set_mpECP(ba, j, a[j]);
+            mpECPBatch_set_mpECP(bb, j, b[j]);
+        }
+        for (j = 0; j < 16; j++) {
+            mpECP_set_mpECPBatch(c, ba, j);
+            assert(mpECP_cmp(c, a[j]) == 0);
+        }
+
+        mpECPBatch_add(bc, ba, bb);
+        for (j = 0; j < 16; j++) {
+            mpECP_add(d, a[j], b[j]);
+            mpECP_set_mpECPBatch(c, bc, j);
+            assert(mpECP_cmp(c, d) == 0);
+        }
+
+        mpECPBatch_double(bc, ba);
+        for (j = 0; j < 16; j++) {
+            mpECP_double(d, a[j]);
+            mpECP_set_mpECPBatch(c, bc, j);
+            assert(mpECP_cmp(c, d) == 0);
+        }
+
+        // normalize in place, points must be unchanged (and z == 1)
+        mpECPBatch_normalize(bc);
+        for (j = 0; j < 16; j++) {
+            mpECP_double(d, a[j]);
+            mpECP_set_mpECPBatch(c, bc, j);
+            assert(mpECP_cmp(c, d) == 0);
+            if (c->is_neutral == 0) {
+                assert(mpFp_cmp_ui(c->z, 1) == 0);
+            }
+        }
+
+        for (compress = 0; compress < 2; compress++) {
+            bytes = mpECPBatch_out_bytelen(bc, compress);
+            assert(bytes == mpECP_out_bytelen(a[0], compress));
+            buf = (unsigned char *)malloc(16 * bytes);
+            sbuf = (unsigned char *)malloc(bytes);
+            mpECPBatch_add(bc, ba, bb);
+            mpECPBatch_out_bytes(buf, bc, compress);
+            for (j = 0; j < 16; j++) {
+                mpECP_add(d, a[j], b[j]);
+                mpECP_out_bytes(sbuf, d, compress);
+                assert(memcmp(sbuf, &(buf[j * bytes]), bytes) == 0);
+            }
+            error = mpECPBatch_set_bytes(ba, buf, bytes, cv);
+            assert(error == 0);
+            for (j = 0; j < 16; j++) {
+                mpECP_add(d, a[j], b[j]);
+                mpECP_set_mpECPBatch(c, ba, j);
+                assert(mpECP_cmp(c, d) == 0);
+            }
+            // invalid encodings are reported and set to neutral
+            buf[2 * bytes] = 0x07;
+            error = mpECPBatch_set_bytes(ba, buf, bytes, cv);
+            assert(error != 0);
+            mpECP_set_mpECPBatch(c, ba, 2);
+            mpECP_set_neutral(d, cv);
+            assert(mpECP_cmp(c, d) == 0);
+            free(sbuf);
+            free(buf);
+            for (j = 0; j < 16; j++) {
+                mpECPBatch_set_mpECP(ba, j, a[j]);
+            }
+        }
+
+        for (j = 0; j < 16; j++) {
+            mpECP_clear(b[j]);
+            mpECP_clear(a[j]);
+        }
+        mpECP_clear(d);
+        mpECP_clear(c);
+        mpECPBatch_clear(bc);
+        mpECPBatch_clear(bb);
+        mpECPBatch_clear(ba);
+    }
+
+    mpECurve_clear(cv);
+}
+END_TEST
+
+#define _TEST_DECODE_BATCH  (150)
+
+START_TEST(test_mpECP_set_bytes_batch) {
+    int error, i, j, ncurves;
+    char *test_curve[] = {"secp256k1", "P384", "Ed25519", "E-521", "Curve25519", "M-511", "Curve41417"};
+    mpECurve_t cv;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        static mpECP_t a[_TEST_DECODE_BATCH];
+        static mpECP_t b[_TEST_DECODE_BATCH];
+        mpECP_ptr bp[_TEST_DECODE_BATCH];
+        unsigned char *bufs[_TEST_DECODE_BATCH];
+        size_t lens[_TEST_DECODE_BATCH];
+        int status[_TEST_DECODE_BATCH];
+        mpECP_t c;
+        int64_t start_time, stop_time;
+        double t_single, t_batch;
+
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(c, cv);
+        for (j = 0; j < _TEST_DECODE_BATCH; j++) {
+            int compress = ((j % 7) != 3);
+
+            mpECP_init(a[j], cv);
+            mpECP_init(b[j], cv);
+            bp[j] = b[j];
+            mpECP_urandom(a[j], cv);
+            if (j == 11) mpECP_set_neutral(a[j], cv);
+            lens[j] = mpECP_out_bytelen(a[j], compress);
+            bufs[j] = (unsigned char *)malloc(lens[j]);
+            mpECP_out_bytes(bufs[j], a[j], compress);
+        }
+
+        error = mpECP_set_bytes_batch(bp, bufs, lens, _TEST_DECODE_BATCH, cv, status);
+        assert(error == 0);
+        for (j = 0; j < _TEST_DECODE_BATCH; j++) {
+            assert(status[j] == 0);
+            assert(mpECP_cmp(b[j], a[j]) == 0);
+        }
+
+        // bad encodings are reported individually: bad prefix, bad length,
+        // x not on the curve (found by scanning for an x without a root)
+        bufs[5][0] = 0x07;
+        lens[17] -= 1;
+        for (j = 0; j < 256; j++) {
+            bufs[77][lens[77] - 1] ^= (unsigned char)j;
+            if (mpECP_set_bytes(c, bufs[77], lens[77], cv) != 0) break;
+            bufs[77][lens[77] - 1] ^= (unsigned char)j;
+        }
+        assert(j < 256);
+        error = mpECP_set_bytes_batch(bp, bufs, lens, _TEST_DECODE_BATCH, cv, status);
+        assert(error != 0);
+        for (j = 0; j < _TEST_DECODE_BATCH; j++) {
+            if ((j == 5) || (j == 17) || (j == 77)) {
+                assert(status[j] != 0);
+            } else {
+                assert(status[j] == 0);
+                assert(mpECP_cmp(b[j], a[j]) == 0);
+            }
+        }
+
+        start_time = clock();
+        for (j = 0; j < _TEST_DECODE_BATCH; j++) {
+            mpECP_set_bytes(b[j], bufs[j], lens[j], cv);
+        }
+        stop_time = clock();
+        t_single = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        start_time = clock();
+        mpECP_set_bytes_batch(bp, bufs, lens, _TEST_DECODE_BATCH, cv, NULL);
+        stop_time = clock();
+        t_batch = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        printf("decode %d points (%s): %f sec single, %f sec batch\n", _TEST_DECODE_BATCH, test_curve[i], t_single, t_batch);
+
+        for (j = 0; j < _TEST_DECODE_BATCH; j++) {
+            free(bufs[j]);
+            mpECP_clear(b[j]);
+            mpECP_clear(a[j]);
+        }
+        mpECP_clear(c);
+    }
+
+    mpECurve_clear(cv);
+}
+END_TEST
+
+#define _TEST_KEYCACHE_SIZE (8)
+#define _TEST_KEYCACHE_KEYS  (12)
+
+#define _TEST_MUL_BATCH  (40)
+
+START_TEST(test_mpECP_scalar_mul_batch) {
+    int error, i, j, l, ncurves;
+    char *test_curve[] = {"secp256k1", "P384", "Ed25519", "E-521", "Curve25519", "M-511", "Curve41417"};
+    mpECurve_t cv;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        static mpECP_t a[_TEST_MUL_BATCH];
+        static mpECP_t b[_TEST_MUL_BATCH];
+        mpECP_ptr ap[_TEST_MUL_BATCH];
+        mpECP_ptr bp[_TEST_MUL_BATCH];
+        mpECP_t c;
+        mpFp_t k;
+        mpz_t kk;
+        int64_t start_time, stop_time;
+        double t_single, t_batch;
+
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        printf("Testing batch scalar multiplication for curve %s\n", test_curve[i]);
+        mpECP_init(c, cv);
+        mpFp_init(k, cv->n);
+        mpz_init(kk);
+        for (j = 0; j < _TEST_MUL_BATCH; j++) {
+            mpECP_init(a[j], cv);
+            mpECP_init(b[j], cv);
+            ap[j] = a[j];
+            bp[j] = b[j];
+            mpECP_urandom(a[j], cv);
+            if (j == 7) mpECP_set_neutral(a[j], cv);
+        }
+
+        // small, large (n - 1, n - 2) and random (odd and even) scalars
+        for (l = 0; l < 10; l++) {
+            switch (l) {
+                case 0:
+                case 1:
+                case 2:
+                case 3:
+                    mpFp_set_ui(k, l, cv->n);
+                    break;
+                case 4:
+                case 5:
+                    mpz_sub_ui(kk, cv->n, l - 3);
+                    mpFp_set_mpz(k, kk, cv->n);
+                    break;
+                default:
+                    mpFp_urandom(k, cv->n);
+                    break;
+            }
+            mpECP_scalar_mul_batch(bp, ap, k, _TEST_MUL_BATCH);
+            for (j = 0; j < _TEST_MUL_BATCH; j++) {
+                mpECP_scalar_mul(c, a[j], k);
+                assert(mpECP_cmp(b[j], c) == 0);
+            }
+            // normalized points are unchanged (and affine)
+            mpECP_normalize_batch(bp, _TEST_MUL_BATCH);
+            for (j = 0; j < _TEST_MUL_BATCH; j++) {
+                mpECP_scalar_mul(c, a[j], k);
+                assert(mpECP_cmp(b[j], c) == 0);
+                if (b[j]->is_neutral == 0) {
+                    assert(mpFp_cmp_ui(b[j]->z, 1) == 0);
+                }
+            }
+        }
+
+        // in place
+        mpFp_urandom(k, cv->n);
+        for (j = 0; j < _TEST_MUL_BATCH; j++) {
+            mpECP_scalar_mul(b[j], a[j], k);
+        }
+        mpECP_scalar_mul_batch(ap, ap, k, _TEST_MUL_BATCH);
+        for (j = 0; j < _TEST_MUL_BATCH; j++) {
+            assert(mpECP_cmp(a[j], b[j]) == 0);
+        }
+
+        start_time = clock();
+        for (j = 0; j < _TEST_MUL_BATCH; j++) {
+            mpECP_scalar_mul(b[j], a[j], k);
+        }
+        stop_time = clock();
+        t_single = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        start_time = clock();
+        mpECP_scalar_mul_batch(bp, ap, k, _TEST_MUL_BATCH);
+        stop_time = clock();
+        t_batch = ((double)(stop_time - start_time)) / CLOCKS_PER_SEC;
+        printf("multiply %d points (%s): %f sec single, %f sec batch\n", _TEST_MUL_BATCH, test_curve[i], t_single, t_batch);
+
+        for (j = 0; j < _TEST_MUL_BATCH; j++) {
+            mpECP_clear(b[j]);
+            mpECP_clear(a[j]);
+        }
+        mpz_clear(kk);
+        mpFp_clear(k);
+        mpECP_clear(c);
+    }
+
+    mpECurve_clear(cv);
+}
+END_TEST
+
+START_TEST(test_mpECP_keycache) {
+    int error, i, j, k, ncurves;
+    char *test_curve[] = {"secp256k1", "Ed25519", "Curve25519", "P384", "E-521"};
+    mpECurve_t cv;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        mpECPKeyCache_t cache;
+        mpECP_t a[_TEST_KEYCACHE_KEYS];
+        mpECP_t c, d;
+        mpECP_ptr p;
+        mpFp_t sc;
+        unsigned char *buf;
+        int bytes;
+
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        printf("validating public key cache for curve %s\n", test_curve[i]);
+
+        mpECPKeyCache_init(cache, cv, _TEST_KEYCACHE_SIZE);
+        mpECPKeyCache_set_promotion(cache, 3, 4);
+        {
+            // bucket hash key is random per cache
+            mpECPKeyCache_t other;
+
+            mpECPKeyCache_init(other, cv, _TEST_KEYCACHE_SIZE);
+            assert((other->hkey[0] != cache->hkey[0]) || (other->hkey[1] != cache->hkey[1]));
+            mpECPKeyCache_clear(other);
+        }
+        mpECP_init(c, cv);
+        mpECP_init(d, cv);
+        mpFp_init(sc, cv->n);
+        bytes = mpECP_out_bytelen(c, 1);
+        buf = (unsigned char *)malloc(_TEST_KEYCACHE_KEYS * bytes);
+        for (j = 0; j < _TEST_KEYCACHE_KEYS; j++) {
+            mpECP_init(a[j], cv);
+            mpECP_urandom(a[j], cv);
+            mpECP_out_bytes(&buf[j * bytes], a[j], 1);
+        }
+
+        // first pass: all misses, last _TEST_KEYCACHE_SIZE remain cached
+        for (j = 0; j < _TEST_KEYCACHE_KEYS; j++) {
+            p = mpECPKeyCache_lookup(cache, &buf[j * bytes], bytes);
+            assert(p != NULL);
+            assert(mpECP_cmp(p, a[j]) == 0);
+        }
+        assert(cache->misses == _TEST_KEYCACHE_KEYS);
+        assert(cache->hits == 0);
+        assert(cache->evictions == (_TEST_KEYCACHE_KEYS - _TEST_KEYCACHE_SIZE));
+        assert(cache->count == _TEST_KEYCACHE_SIZE);
+
+        // most recent keys hit
+        for (j = _TEST_KEYCACHE_KEYS - _TEST_KEYCACHE_SIZE; j < _TEST_KEYCACHE_KEYS; j++) {
+            p = mpECPKeyCache_lookup(cache, &buf[j * bytes], bytes);
+            assert(mpECP_cmp(p, a[j]) == 0);
+        }
+        assert(cache->hits == _TEST_KEYCACHE_SIZE);
+        assert(cache->promotions == 0);
+
+        // a hot key is promoted and scalar multiplication is unchanged
+        j = _TEST_KEYCACHE_KEYS - 1;
+        p = mpECPKeyCache_lookup(cache, &buf[j * bytes], bytes);
+        assert(cache->promotions == 1);
+        assert(p->base_bits == 4);
+        for (k = 0; k < 10; k++) {
+            mpFp_urandom(sc, cv->n);
+            mpECP_scalar_base_mul(c, p, sc);
+            mpECP_scalar_mul(d, a[j], sc);
+            assert(mpECP_cmp(c, d) == 0);
+        }
+
+        // evicted key misses, evicting the least recently used
+        mpECPKeyCache_reset_stats(cache);
+        p = mpECPKeyCache_lookup(cache, &buf[0], bytes);
+        assert(mpECP_cmp(p, a[0]) == 0);
+        assert((cache->misses == 1) && (cache->evictions == 1));
+        p = mpECPKeyCache_lookup(cache, &buf[(_TEST_KEYCACHE_KEYS - 1) * bytes], bytes);
+        assert(cache->hits == 1);
+        p = mpECPKeyCache_lookup(cache, &buf[(_TEST_KEYCACHE_KEYS - _TEST_KEYCACHE_SIZE) * bytes], bytes);
+        assert(cache->misses == 2);
+
+        // invalid encodings are rejected (and not cached)
+        buf[0] = 0x07;
+        assert(mpECPKeyCache_lookup(cache, &buf[0], bytes) == NULL);
+        assert(mpECPKeyCache_lookup(cache, &buf[0], bytes) == NULL);
+        assert(cache->misses == 4);
+
+        for (j = 0; j < _TEST_KEYCACHE_KEYS; j++) {
+            mpECP_clear(a[j]);
+        }
+        free(buf);
+        mpFp_clear(sc);
+        mpECP_clear(d);
+        mpECP_clear(c);
+        mpECPKeyCache_clear(cache);
+    }
+
+    mpECurve_clear(cv);
+}
+END_TEST
+
+static void wrap_libsodium_sha256(unsigned char *hash, unsigned char *msg, size_t sz) {
+    int status;
+    status = crypto_hash_sha256(hash, msg, (unsigned long long)sz);
+    assert(status == 0);
+    return;
+}
+
+static void wrap_libsodium_sha512(unsigned char *hash, unsigned char *msg, size_t sz) {
+    int status;
+    status = crypto_hash_sha512(hash, msg, (unsigned long long)sz);
+    assert(status == 0);
+    return;
+}
+
+static void wrap_libsodium_sha256_init(void *ctx) {
+    crypto_hash_sha256_init((crypto_hash_sha256_state *)ctx);
+    return;
+}
+
+static void wrap_libsodium_sha256_update(void *ctx, unsigned char *msg, size_t sz) {
+    crypto_hash_sha256_update((crypto_hash_sha256_state *)ctx, msg, (unsigned long long)sz);
+    return;
+}
+
+static void wrap_libsodium_sha256_final(void *ctx, unsigned char *hash) {
+    crypto_hash_sha256_final((crypto_hash_sha256_state *)ctx, hash);
+    return;
+}
+
+typedef struct {
+    char *curve;
+    int sha;
+    int ro;
+    char *dst;
+    char *msg;
+    char *x;
+    char *y;
+} _test_h2c_vector_t;
+
+// RFC 9380 appendix J
+static _test_h2c_vector_t test_h2c[] = {
+    {"P256", 256, 1, "QUUX-V01-CS02-with-P256_XMD:SHA-256_SSWU_RO_", "",
+        "0x2c15230b26dbc6fc9a37051158c95b79656e17a1a920b11394ca91c44247d3e4",
+        "0x8a7a74985cc5c776cdfe4b1f19884970453912e9d31528c060be9ab5c43e8415"},
+    {"P256", 256, 1, "QUUX-V01-CS02-with-P256_XMD:SHA-256_SSWU_RO_", "abc",
+        "0x0bb8b87485551aa43ed54f009230450b492fead5f1cc91658775dac4a3388a0f",
+        "0x5c41b3d0731a27a7b14bc0bf0ccded2d8751f83493404c84a88e71ffd424212e"},
+    {"P256", 256, 0, "QUUX-V01-CS02-with-P256_XMD:SHA-256_SSWU_NU_", "",
+        "0xf871caad25ea3b59c16cf87c1894902f7e7b2c822c3d3f73596c5ace8ddd14d1",
+        "0x87b9ae23335bee057b99bac1e68588b18b5691af476234b8971bc4f011ddc99b"},
+    {"Curve25519", 512, 1, "QUUX-V01-CS02-with-curve25519_XMD:SHA-512_ELL2_RO_", "",
+        "0x2de3780abb67e861289f5749d16d3e217ffa722192d16bbd9d1bfb9d112b98c0",
+        "0x3b5dc2a498941a1033d176567d457845637554a2fe7a3507d21abd1c1bd6e878"},
+    {"Ed25519", 512, 1, "QUUX-V01-CS02-with-edwards25519_XMD:SHA-512_ELL2_RO_", "",
+        "0x3c3da6925a3c3c268448dcabb47ccde5439559d9599646a8260e47b1e4822fc6",
+        "0x09a6c8561a0b22bef63124c588ce4c62ea83a3c899763af26d795302e115dc21"}
+};
+
+#define _TEST_H2C_MESSAGES  (200)
+#define _TEST_H2C_BIG_MESSAGE   (16 * 1024 * 1024)
+
+START_TEST(test_mpECP_hash_to_curve) {
+    int error, i, j, ncurves, nvectors;
+    // SVDW, SSWU, SSWU (p = 1 mod 8), Edwards, Montgomery, twisted Edwards
+    char *test_curve[] = {"secp256k1", "P384", "P224", "Curve41417", "E-521", "M-511", "Ed448-Goldilocks", "Ed25519"};
+    char *xmd_dst = "QUUX-V01-CS02-with-expander-SHA256-128";
+    char *xmd_msg[] = {"", "abc", "abcdef0123456789"};
+    char *xmd_out[] = {
+        "68a985b87eb6b46952128911f2a4412bbc302a9d759667f87f7a21d803f07235",
+        "d8ccab23b5985ccea865c6c97b6e5b8350e794e603b4b97902f53a8a0d605615",
+        "eff31487c770a893cfb36f912fbfcbff40d5661771ca4b2cb4eafe524333f5c1"};
+    mpECDSAHashfunc_t H256, H256i, H512;
+    unsigned char xout[32];
+    mpECurve_t cv;
+    mpz_t x, y;
+
+    mpECDSAHashfunc_init(H256);
+    H256->dohash = wrap_libsodium_sha256;
+    H256->hsz = crypto_hash_sha256_BYTES;
+    // expand_message_xmd needs the block size
+    assert(mpECP_expand_message_xmd(xout, 32, (unsigned char *)"", 0,
+        (unsigned char *)xmd_dst, strlen(xmd_dst), H256) != 0);
+    mpECDSAHashfunc_set_blocksize(H256, 64);
+    mpECDSAHashfunc_init(H512);
+    H512->dohash = wrap_libsodium_sha512;
+    H512->hsz = crypto_hash_sha512_BYTES;
+    mpECDSAHashfunc_set_blocksize(H512, 128);
+    mpECDSAHashfunc_init(H256i);
+    H256i->dohash = wrap_libsodium_sha256;
+    H256i->hsz = crypto_hash_sha256_BYTES;
+    mpECDSAHashfunc_set_blocksize(H256i, 64);
+    mpECDSAHashfunc_set_incremental(H256i, wrap_libsodium_sha256_init,
+        wrap_libsodium_sha256_update, wrap_libsodium_sha256_final,
+        sizeof(crypto_hash_sha256_state));
+    mpECurve_init(cv);
+    mpz_init(x);
+    mpz_init(y);
+
+    // one-shot (copied) and incremental hashing of msg_prime
+    for (i = 0; i < (sizeof(xmd_msg) / sizeof(xmd_msg[0])); i++) {
+        unsigned char out[32];
+        char hex[65];
+
+        error = mpECP_expand_message_xmd(out, 32, (unsigned char *)xmd_msg[i],
+            strlen(xmd_msg[i]), (unsigned char *)xmd_dst, strlen(xmd_dst), H256);
+        assert(error == 0);
+        for (j = 0; j < 32; j++) {
+            sprintf(&hex[2 * j], "%02x", out[j]);
+        }
+        assert(strcmp(hex, xmd_out[i]) == 0);
+        error = mpECP_expand_message_xmd(out, 32, (unsigned char *)xmd_msg[i],
+            strlen(xmd_msg[i]), (unsigned char *)xmd_dst, strlen(xmd_dst), H256i);
+        assert(error == 0);
+        for (j = 0; j < 32; j++) {
+            sprintf(&hex[2 * j], "%02x", out[j]);
+        }
+        assert(strcmp(hex, xmd_out[i]) == 0);
+    }
+    // large messages are not copied to the stack
+    {
+        unsigned char out[2][64];
+        unsigned char *big;
+
+        big = (unsigned char *)malloc(_TEST_H2C_BIG_MESSAGE);
+        assert(big != NULL);
+        memset(big, 0x5a, _TEST_H2C_BIG_MESSAGE);
+        error = mpECP_expand_message_xmd(out[0], 64, big, _TEST_H2C_BIG_MESSAGE,
+            (unsigned char *)xmd_dst, strlen(xmd_dst), H256);
+        assert(error == 0);
+        error = mpECP_expand_message_xmd(out[1], 64, big, _TEST_H2C_BIG_MESSAGE,
+            (unsigned char *)xmd_dst, strlen(xmd_dst), H256i);
+        assert(error == 0);
+        assert(memcmp(out[0], out[1], 64) == 0);
+        free(big);
+    }
+    // ell > 255
+    {
+        unsigned char out[256 * 32];
+        error = mpECP_expand_message_xmd(out, 256 * 32, (unsigned char *)"", 0,
+            (unsigned char *)xmd_dst, strlen(xmd_dst), H256);
+        assert(error != 0);
+    }
+
+    nvectors = sizeof(test_h2c) / sizeof(test_h2c[0]);
+    for (i = 0; i < nvectors; i++) {
+        mpECPHashToCurve_t h2c;
+        mpECP_t a, b;
+
+        error = mpECurve_set_named(cv, test_h2c[i].curve);
+        assert(error == 0);
+        error = mpECPHashToCurve_init(h2c, cv, (test_h2c[i].sha == 256) ? H256 : H512,
+            (unsigned char *)test_h2c[i].dst, strlen(test_h2c[i].dst));
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        if (test_h2c[i].ro) {
+            error = mpECPHashToCurve_hash(a, h2c, (unsigned char *)test_h2c[i].msg, strlen(test_h2c[i].msg));
+        } else {
+            error = mpECPHashToCurve_encode(a, h2c, (unsigned char *)test_h2c[i].msg, strlen(test_h2c[i].msg));
+        }
+        assert(error == 0);
+        mpz_set_str(x, test_h2c[i].x, 0);
+        mpz_set_str(y, test_h2c[i].y, 0);
+        mpECP_set_mpz(b, x, y, cv);
+        assert(mpECP_cmp(a, b) == 0);
+        mpECP_clear(b);
+        mpECP_clear(a);
+        mpECPHashToCurve_clear(h2c);
+    }
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        mpECPHashToCurve_t h2c;
+        mpECP_t a, b, c;
+        mpFp_t u;
+        unsigned char msg[16];
+        clock_t start, hash_t, rand_t;
+
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        error = mpECPHashToCurve_init(h2c, cv, H512, (unsigned char *)"ECCLIB-TEST", 11);
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpFp_init_fp(u, cv->fp);
+        mpECP_set_neutral(c, cv);
+
+        // exceptional inputs of the maps still give curve points
+        for (j = 0; j < 2; j++) {
+            mpFp_set_ui_fp(u, j, cv->fp);
+            mpECPHashToCurve_map(a, h2c, u);
+            mpz_set_mpECP_affine_x(x, a);
+            mpz_set_mpECP_affine_y(y, a);
+            assert(mpECurve_point_check(cv, x, y));
+        }
+
+        for (j = 0; j < _TEST_H2C_MESSAGES; j++) {
+            memset(msg, 0, sizeof(msg));
+            sprintf((char *)msg, "id-%d", j);
+            error = mpECPHashToCurve_hash(a, h2c, msg, sizeof(msg));
+            assert(error == 0);
+            mpz_set_mpECP_affine_x(x, a);
+            mpz_set_mpECP_affine_y(y, a);
+            assert(mpECurve_point_check(cv, x, y));
+            // prime order subgroup
+            mpECP_scalar_mul_mpz(b, a, cv->n);
+            assert(mpECP_cmp(b, c) == 0);
+            error = mpECPHashToCurve_encode(b, h2c, msg, sizeof(msg));
+            assert(error == 0);
+            assert(mpECP_cmp(a, b) != 0);
+        }
+        start = clock();
+        for (j = 0; j < _TEST_H2C_MESSAGES; j++) {
+            sprintf((char *)msg, "id-%d", j);
+            mpECPHashToCurve_hash(a, h2c, msg, sizeof(msg));
+        }
+        hash_t = clock() - start;
+        start = clock();
+        for (j = 0; j < _TEST_H2C_MESSAGES; j++) {
+            mpECP_urandom(a, cv);
+        }
+        rand_t = clock() - start;
+        printf("%s hash_to_curve %ld ticks, urandom %ld ticks (%d points)\n",
+            test_curve[i], (long)hash_t, (long)rand_t, _TEST_H2C_MESSAGES);
+
+        mpFp_clear(u);
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+        mpECPHashToCurve_clear(h2c);
+    }
+
+    // Z and L of the RFC 9380 P384 and P521 suites (8.3, 8.4)
+    {
+        char *zcurve[] = {"P384", "P521"};
+        unsigned long zneg[] = {12, 4};
+        size_t zL[] = {72, 98};
+
+        for (i = 0; i < 2; i++) {
+            mpECPHashToCurve_t h2c;
+
+            error = mpECurve_set_named(cv, zcurve[i]);
+            assert(error == 0);
+            error = mpECPHashToCurve_init(h2c, cv, H512, (unsigned char *)"ECCLIB-TEST", 11);
+            assert(error == 0);
+            assert(h2c->map == _MPECP_MAP_SSWU);
+            assert(h2c->L == zL[i]);
+            mpz_set_mpFp(x, h2c->Z);
+            mpz_add_ui(x, x, zneg[i]);
+            assert(mpz_cmp(x, cv->fp->p) == 0);
+            mpECPHashToCurve_clear(h2c);
+        }
+    }
+
+    // oversize DST is reduced the same way by both hash interfaces, and
+    // hash_to_field output is limited by expand_message_xmd
+    {
+        mpECPHashToCurve_t h2c, h2ci;
+        unsigned char dst[300];
+        mpFp_t u0;
+        mpFp_ptr up[1];
+
+        error = mpECurve_set_named(cv, "P256");
+        assert(error == 0);
+        memset(dst, 'D', sizeof(dst));
+        error = mpECPHashToCurve_init(h2c, cv, H256, dst, sizeof(dst));
+        assert(error == 0);
+        error = mpECPHashToCurve_init(h2ci, cv, H256i, dst, sizeof(dst));
+        assert(error == 0);
+        assert(h2c->dsz == crypto_hash_sha256_BYTES);
+        assert((h2ci->dsz == h2c->dsz) && (memcmp(h2ci->dst, h2c->dst, h2c->dsz) == 0));
+        mpFp_init_fp(u0, cv->fp);
+        up[0] = u0;
+        assert(mpECPHashToCurve_hash_to_field(up, 0, h2c, dst, 1) != 0);
+        assert(mpECPHashToCurve_hash_to_field(up, (65535 / h2c->L) + 1, h2c, dst, 1) != 0);
+        mpFp_clear(u0);
+        mpECPHashToCurve_clear(h2ci);
+        mpECPHashToCurve_clear(h2c);
+    }
+
+    mpz_clear(y);
+    mpz_clear(x);
+    mpECurve_clear(cv);
+    mpECDSAHashfunc_clear(H512);
+    mpECDSAHashfunc_clear(H256i);
+    mpECDSAHashfunc_clear(H256);
+}
+END_TEST
+
 static Suite *mpECP_test_suite(void) {
     Suite *s;
     TCase *tc;
@@ -708,6 +1531,13 @@ static Suite *mpECP_test_suite(void) {
     tcase_add_test(tc, test_mpECP_scalar_mul);
     tcase_add_test(tc, test_mpECP_urandom);
     tcase_add_test(tc, test_mpECP_scalar_base_mul);
+    tcase_add_test(tc, test_mpECP_base_const);
+    tcase_add_test(tc, test_mpECP_scratch);
+    tcase_add_test(tc, test_mpECP_batch);
+    tcase_add_test(tc, test_mpECP_set_bytes_batch);
+    tcase_add_test(tc, test_mpECP_scalar_mul_batch);
+    tcase_add_test(tc, test_mpECP_keycache);
+    tcase_add_test(tc, test_mpECP_hash_to_curve);
     suite_add_tcase(s, tc);
     return s;
 }
@@ -35,6 +35,7 @@
 #include <check.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 START_TEST(test_mpECurve_create) {
     int status;
@@ -207,6 +208,147 @@ START_TEST(test_mpECurve_all_named) {
 }
 END_TEST
 
+START_TEST(test_mpECurve_registry) {
+    int i, j, error, status;
+    mpECurve_t a;
+    mpECurve_ptr cvp;
+    char **clist;
+    int64_t start_time, stop_time;
+    double named_rate, mpz_rate;
+
+    assert(mpECurve_named("thisisnotthenameofacurve") == NULL);
+    mpECurve_init(a);
+    clist = _mpECurve_list_standard_curves();
+    i = 0;
+    while(clist[i] != NULL) {
+        cvp = mpECurve_named(clist[i]);
+        assert(cvp != NULL);
+        // shared instance
+        assert(mpECurve_named(clist[i]) == cvp);
+        error = mpECurve_set_named(a, clist[i]);
+        assert(error == 0);
+        assert(mpECurve_cmp(a, cvp) == 0);
+        assert(mpECurve_point_check(cvp, cvp->G[0], cvp->G[1]) != 0);
+        free(clist[i]);
+        i += 1;
+    }
+    free(clist);
+
+    // Montgomery curves also need transform constants (inversions)
+    cvp = mpECurve_named("Curve25519");
+    start_time = clock();
+    for (j = 0; j < 1000; j++) {
+        mpECurve_set_named(a, "Curve25519");
+    }
+    stop_time = clock();
+    named_rate = (1000.0 * CLOCKS_PER_SEC) / ((double)(stop_time - start_time));
+    start_time = clock();
+    for (j = 0; j < 1000; j++) {
+        status = mpECurve_set_mpz_mo(a, cvp->fp->p, cvp->coeff.mo.B->i,
+            cvp->coeff.mo.A->i, cvp->n, cvp->h, cvp->G[0], cvp->G[1],
+            cvp->bits);
+        assert(status == 0);
+    }
+    stop_time = clock();
+    mpz_rate = (1000.0 * CLOCKS_PER_SEC) / ((double)(stop_time - start_time));
+    printf("set_named rate = %g /sec, set_mpz_mo rate = %g /sec (%g X)\n", named_rate, mpz_rate, named_rate / mpz_rate);
+
+    mpECurve_clear(a);
+}
+END_TEST
+
+START_TEST(test_mpECurve_interned) {
+    int i, j, status;
+    mpECurve_t a, b;
+    mpECurve_ptr cvp, prev;
+    char **clist;
+    int64_t start_time, stop_time;
+    double cmp_rate;
+
+    mpECurve_init(a);
+    mpECurve_init(b);
+    prev = NULL;
+    clist = _mpECurve_list_standard_curves();
+    i = 0;
+    while(clist[i] != NULL) {
+        cvp = mpECurve_named(clist[i]);
+        assert(cvp->id != 0);
+        // same parameters through a different setter, same id
+        mpECurve_set_named(a, clist[i]);
+        assert(a->id == cvp->id);
+        switch(cvp->type) {
+            case EQTypeShortWeierstrass:
+                status = mpECurve_set_mpz_ws(b, cvp->fp->p, cvp->coeff.ws.a->i,
+                    cvp->coeff.ws.b->i, cvp->n, cvp->h, cvp->G[0], cvp->G[1],
+                    cvp->bits);
+                assert(mpFp_cmp(b->coeff.ws.b3, cvp->coeff.ws.b3) == 0);
+                break;
+            case EQTypeEdwards:
+                status = mpECurve_set_mpz_ed(b, cvp->fp->p, cvp->coeff.ed.c->i,
+                    cvp->coeff.ed.d->i, cvp->n, cvp->h, cvp->G[0], cvp->G[1],
+                    cvp->bits);
+                break;
+            case EQTypeMontgomery:
+                status = mpECurve_set_mpz_mo(b, cvp->fp->p, cvp->coeff.mo.B->i,
+                    cvp->coeff.mo.A->i, cvp->n, cvp->h, cvp->G[0], cvp->G[1],
+                    cvp->bits);
+                // precomputed (build time) transform constants
+                assert(mpFp_cmp(b->coeff.mo.ws_a, cvp->coeff.mo.ws_a) == 0);
+                assert(mpFp_cmp(b->coeff.mo.ws_b, cvp->coeff.mo.ws_b) == 0);
+                assert(mpFp_cmp(b->coeff.mo.Binv, cvp->coeff.mo.Binv) == 0);
+                assert(mpFp_cmp(b->coeff.mo.Adiv3, cvp->coeff.mo.Adiv3) == 0);
+                assert(mpFp_cmp(b->coeff.mo.ws_b3, cvp->coeff.mo.ws_b3) == 0);
+                break;
+            case EQTypeTwistedEdwards:
+                status = mpECurve_set_mpz_te(b, cvp->fp->p, cvp->coeff.te.a->i,
+                    cvp->coeff.te.d->i, cvp->n, cvp->h, cvp->G[0], cvp->G[1],
+                    cvp->bits);
+                break;
+            default:
+                assert(0);
+        }
+        assert(status == 0);
+        assert(b->id == cvp->id);
+        assert(mpECurve_cmp(b, cvp) == 0);
+        // (named) curves are all distinct, except aliases (e.g. P256)
+        if (prev != NULL) {
+            assert((mpECurve_cmp(prev, cvp) == 0) == (prev->id == cvp->id));
+        }
+        prev = cvp;
+        free(clist[i]);
+        i += 1;
+    }
+    free(clist);
+
+    // a different generator is a different curve
+    cvp = mpECurve_named("secp256k1");
+    mpECurve_set(a, cvp);
+    status = mpECurve_set_str_ws(b,
+        "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F",
+        "0", "7",
+        "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141",
+        "1",
+        "0xC6047F9441ED7D6D3045406E95C07CD85C778E4B8CEF3CA7ABAC09B95C709EE5",
+        "0x1AE168FEA63DC339A3C58419466CEAEEF7F632653266D0E1236431A950CFE52A",
+        256);
+    assert(status == 0);
+    assert(mpECurve_cmp(a, b) != 0);
+    assert(mpECurve_cmp(a, cvp) == 0);
+
+    start_time = clock();
+    for (j = 0; j < 1000000; j++) {
+        status |= mpECurve_cmp(a, cvp);
+    }
+    stop_time = clock();
+    assert(status == 0);
+    cmp_rate = (1000000.0 * CLOCKS_PER_SEC) / ((double)(stop_time - start_time));
+    printf("mpECurve_cmp rate = %g /sec\n", cmp_rate);
+
+    mpECurve_clear(b);
+    mpECurve_clear(a);
+}
+END_TEST
+
 static Suite *mpECurve_test_suite(void) {
     Suite *s;
     TCase *tc;
@@ -218,6 +360,8 @@ static Suite *mpECurve_test_suite(void) {
     tcase_add_test(tc, test_mpECurve_cmp);
     tcase_add_test(tc, test_mpECurve_named);
     tcase_add_test(tc, test_mpECurve_all_named);
+    tcase_add_test(tc, test_mpECurve_registry);
+    tcase_add_test(tc, test_mpECurve_interned);
     suite_add_tcase(s, tc);
     return s;
 }
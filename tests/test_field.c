@@ -31,6 +31,8 @@
 #include <assert.h>
 #include <ecc/ecurve.h>
 #include <ecc/field.h>
+#include <ecc/fieldi.h>
+#include <ecc/fieldlanes.h>
 #include <ecc/mpzurandom.h>
 #include <ecc/safememory.h>
 #include <gmp.h>
@@ -38,6 +40,7 @@
 #include <check.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 typedef struct {
@@ -1020,6 +1023,90 @@ START_TEST(test_mpFp_pow_extended) {
 }
 END_TEST
 
+START_TEST(test_mpFp_pow_small) {
+    int i, j, k;
+    int nfields;
+    mpFp_t a, b, c;
+    mpz_t aa, bb, d, e, p;
+    int64_t start_time, stop_time;
+    double fp_rate, mpz_rate;
+
+    mpz_init(aa);
+    mpz_init(bb);
+    mpz_init(d);
+    mpz_init(e);
+    mpz_init(p);
+
+    nfields = sizeof(test_prime_fields)/sizeof(test_prime_fields[0]);
+
+    for (j = 0 ; j < nfields; j++) {
+        mpz_set_str(p,test_prime_fields[j], 0);
+        mpFp_init(a, p);
+        mpFp_init(b, p);
+        mpFp_init(c, p);
+
+        gmp_printf("Testing small exponent POW for field 0x%ZX\n", p);
+
+        for (i = 0; i < 100; i++) {
+            mpFp_urandom(a, p);
+            mpz_set_mpFp(aa, a);
+
+            // small exponents (fast paths), in place and out of place
+            for (k = 0; k < 40; k++) {
+                mpz_powm_ui(d, aa, k, p);
+                mpFp_pow_ui(c, a, k);
+                assert(mpFp_cmp_mpz(c, d) == 0);
+                mpFp_set(b, a);
+                mpFp_pow_ui(b, b, k);
+                assert(mpFp_cmp_mpz(b, d) == 0);
+            }
+
+            // exponents larger than p and negative exponents
+            mpz_pow_ui(bb, p, 3);
+            mpz_urandom(e, bb);
+            mpz_powm(d, aa, e, p);
+            mpFp_pow_mpz(c, a, e);
+            assert(mpFp_cmp_mpz(c, d) == 0);
+            if (mpz_sgn(aa) != 0) {
+                mpz_neg(e, e);
+                mpz_powm(d, aa, e, p);
+                mpFp_set(b, a);
+                mpFp_pow_mpz(b, b, e);
+                assert(mpFp_cmp_mpz(b, d) == 0);
+            }
+        }
+        // squares (curve arithmetic)
+        mpFp_urandom(a, p);
+        mpz_set_mpFp(aa, a);
+        start_time = clock();
+        for (i = 0; i < 200000; i++) {
+            mpFp_pow_ui(c, a, 2);
+        }
+        stop_time = clock();
+        fp_rate = (200000.0 * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+        start_time = clock();
+        for (i = 0; i < 200000; i++) {
+            mpz_powm_ui(d, aa, 2, p);
+        }
+        stop_time = clock();
+        mpz_rate = (200000.0 * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+        assert(mpFp_cmp_mpz(c, d) == 0);
+        printf("mpFp POW(2) rate = %g exps/sec (%g X)\n", fp_rate, (fp_rate / mpz_rate));
+        printf("mpz  POW(2) rate = %g exps/sec\n", mpz_rate);
+
+        mpFp_clear(c);
+        mpFp_clear(b);
+        mpFp_clear(a);
+    }
+
+    mpz_clear(p);
+    mpz_clear(e);
+    mpz_clear(d);
+    mpz_clear(bb);
+    mpz_clear(aa);
+}
+END_TEST
+
 START_TEST(test_mpFp_sqr_extended) {
     int i, j;
     int nfields;
@@ -1451,6 +1538,144 @@ START_TEST(test_mpFp_cswap_extended) {
 }
 END_TEST
 
+START_TEST(test_mpFp_inv_ct) {
+    int i, j, k;
+    int nfields;
+    mpFp_t a, b, c;
+    mpz_t aa, d, p;
+    int64_t start_time, stop_time;
+    double gmp_rate, sg_rate, fermat_rate;
+    static mpFp_t v[1000];
+
+    mpz_init(aa);
+    mpz_init(d);
+    mpz_init(p);
+
+    nfields = sizeof(test_prime_fields)/sizeof(test_prime_fields[0]);
+
+    for (j = 0 ; j < nfields; j++) {
+        mpz_set_str(p,test_prime_fields[j], 0);
+        mpFp_init(a, p);
+        mpFp_init(b, p);
+        mpFp_init(c, p);
+
+        gmp_printf("Testing constant-time INV for field 0x%ZX\n", p);
+#ifdef _MPFP_SAFEGCD
+        assert(a->fp->sg_size != 0);
+#endif
+
+        // zero has no inverse, rop is set to zero
+        mpFp_set_ui(a, 0, p);
+        mpFp_set_ui(b, 1, p);
+        assert(mpFp_inv_safegcd(b, a) != 0 || a->fp->sg_size == 0);
+        assert((mpFp_cmp_ui(b, 0) == 0) || a->fp->sg_size == 0);
+        mpFp_set_ui(b, 1, p);
+        assert(mpFp_inv_fermat(b, a) != 0);
+        assert(mpFp_cmp_ui(b, 0) == 0);
+        mpFp_set_ui(b, 1, p);
+        assert(mpFp_inv_ct(b, a) != 0);
+        assert(mpFp_cmp_ui(b, 0) == 0);
+
+        for (i = 0; i < 2000; i++) {
+            // edge values 1, 2, p - 1, p - 2 then random
+            switch (i) {
+                case 0:
+                    mpFp_set_ui(a, 1, p);
+                    break;
+                case 1:
+                    mpFp_set_ui(a, 2, p);
+                    break;
+                case 2:
+                    mpz_sub_ui(aa, p, 1);
+                    mpFp_set_mpz(a, aa, p);
+                    break;
+                case 3:
+                    mpz_sub_ui(aa, p, 2);
+                    mpFp_set_mpz(a, aa, p);
+                    break;
+                default:
+                    mpFp_urandom(a, p);
+                    if (mpFp_cmp_ui(a, 0) == 0) mpFp_set_ui(a, 1, p);
+                    break;
+            }
+            mpz_set_mpFp(aa, a);
+            assert(mpz_invert(d, aa, p) != 0);
+
+            if (a->fp->sg_size != 0) {
+                assert(mpFp_inv_safegcd(b, a) == 0);
+                assert(mpFp_cmp_mpz(b, d) == 0);
+            }
+            assert(mpFp_inv_fermat(b, a) == 0);
+            assert(mpFp_cmp_mpz(b, d) == 0);
+            // in place
+            mpFp_set(c, a);
+            assert(mpFp_inv_ct(c, c) == 0);
+            assert(mpFp_cmp_mpz(c, d) == 0);
+        }
+
+        // backend selection applies to mpFp_inv, restore GMP after
+        for (k = _MPFP_INV_GMP; k <= _MPFP_INV_FERMAT; k++) {
+            if ((k == _MPFP_INV_SAFEGCD) && (a->fp->sg_size == 0)) {
+                assert(mpFp_field_set_inv(a->fp, k) != 0);
+                continue;
+            }
+            assert(mpFp_field_set_inv(a->fp, k) == 0);
+            assert(a->fp->inv_type == k);
+            mpFp_urandom(a, p);
+            mpz_set_mpFp(aa, a);
+            if (mpz_invert(d, aa, p) != 0) {
+                assert(mpFp_inv(b, a) == 0);
+                assert(mpFp_cmp_mpz(b, d) == 0);
+            }
+            mpFp_set_ui(a, 0, p);
+            assert(mpFp_inv(b, a) != 0);
+        }
+        assert(mpFp_field_set_inv(a->fp, -1) != 0);
+        assert(mpFp_field_set_inv(a->fp, _MPFP_INV_GMP) == 0);
+
+        for (i = 0; i < 1000; i++) {
+            mpFp_init(v[i], p);
+            mpFp_urandom(v[i], p);
+        }
+        start_time = clock();
+        for (i = 0; i < 1000; i++) {
+            mpFp_inv(b, v[i]);
+        }
+        stop_time = clock();
+        gmp_rate = (1000.0 * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+        sg_rate = 0.0;
+        if (a->fp->sg_size != 0) {
+            start_time = clock();
+            for (i = 0; i < 1000; i++) {
+                mpFp_inv_safegcd(b, v[i]);
+            }
+            stop_time = clock();
+            sg_rate = (1000.0 * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+        }
+        start_time = clock();
+        for (i = 0; i < 1000; i++) {
+            mpFp_inv_fermat(b, v[i]);
+        }
+        stop_time = clock();
+        fermat_rate = (1000.0 * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+        printf("mpz_invert INV rate = %g invs/sec\n", gmp_rate);
+        printf("safegcd    INV rate = %g invs/sec (%g X)\n", sg_rate, (sg_rate / gmp_rate));
+        printf("Fermat     INV rate = %g invs/sec (%g X)\n", fermat_rate, (fermat_rate / gmp_rate));
+        for (i = 0; i < 1000; i++) {
+            mpFp_clear(v[i]);
+        }
+
+        mpFp_clear(c);
+        mpFp_clear(b);
+        mpFp_clear(a);
+    }
+
+    mpz_clear(p);
+    mpz_clear(d);
+    mpz_clear(aa);
+}
+END_TEST
+
 START_TEST(test_mpFp_sqrt_basic) {
     int i, j, error, bb, cc;
     int primes[] = {11, 13, 17, 19, 23, 29, 31, 1021};
@@ -1577,6 +1802,123 @@ START_TEST(test_mpFp_sqrt_extended) {
 }
 END_TEST
 
+START_TEST(test_mpFp_sqrt_strategy) {
+    int i, j, status, leg;
+    // 3 mod 4, 5 mod 8 and 1 mod 8 (P224 p with 2**96 | p - 1) primes
+    char *primes[] = {"11", "13", "17", "41", "97", "1021", "65537",
+        "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F",
+        "0x7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffed",
+        "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF000000000000000000000001"};
+    int type[] = {_MPFP_SQRT_3MOD4, _MPFP_SQRT_5MOD8, _MPFP_SQRT_TS,
+        _MPFP_SQRT_TS, _MPFP_SQRT_TS, _MPFP_SQRT_5MOD8, _MPFP_SQRT_TS,
+        _MPFP_SQRT_3MOD4, _MPFP_SQRT_5MOD8, _MPFP_SQRT_TS};
+    mpFp_t a, b, c;
+    mpz_t p, aa;
+    mpz_init(p);
+    mpz_init(aa);
+
+    for (j = 0 ; j < (sizeof(primes)/sizeof(primes[0])); j++) {
+        int n;
+        int64_t start_time, stop_time;
+
+        mpz_set_str(p, primes[j], 0);
+        mpFp_init(a, p);
+        mpFp_init(b, p);
+        mpFp_init(c, p);
+        assert(a->fp->sqrt_type == type[j]);
+        gmp_printf("Testing SQRT (type %d, s = %d) for field 0x%ZX\n", a->fp->sqrt_type, a->fp->sqrt_s, p);
+
+        // exhaustive for small fields, otherwise random elements; roots
+        // exist exactly for the quadratic residues (and zero)
+        n = (mpz_cmp_ui(p, 2000) < 0) ? mpz_get_ui(p) : 2000;
+        start_time = clock();
+        for (i = 0; i < n; i++) {
+            if (mpz_cmp_ui(p, 2000) < 0) {
+                mpFp_set_ui(a, i, p);
+            } else {
+                mpFp_urandom(a, p);
+            }
+            mpz_set_mpFp(aa, a);
+            leg = mpz_legendre(aa, p);
+            mpFp_set(b, a);
+            status = mpFp_sqrt(b, b);
+            assert((status == 0) == (leg >= 0));
+            if (status == 0) {
+                mpFp_sqr(c, b);
+                assert(mpFp_cmp(c, a) == 0);
+            } else {
+                // rop is untouched on failure
+                assert(mpFp_cmp(b, a) == 0);
+            }
+            // squares always have a root
+            mpFp_sqr(c, a);
+            status = mpFp_sqrt(b, c);
+            assert(status == 0);
+            mpFp_sqr(b, b);
+            assert(mpFp_cmp(b, c) == 0);
+        }
+        stop_time = clock();
+        printf("%d (2 sqrt + checks) in %f sec\n", n, ((double)(stop_time - start_time)) / CLOCKS_PER_SEC);
+
+        mpFp_clear(c);
+        mpFp_clear(b);
+        mpFp_clear(a);
+    }
+
+    mpz_clear(aa);
+    mpz_clear(p);
+}
+END_TEST
+
+START_TEST(test_mpFp_is_square) {
+    int i, j, leg;
+    char *primes[] = {"11", "13", "17", "41", "97", "1021", "65537",
+        "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F",
+        "0x7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffed",
+        "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF000000000000000000000001"};
+    mpFp_t a, b;
+    mpz_t p, aa;
+    mpz_init(p);
+    mpz_init(aa);
+
+    for (j = 0 ; j < (sizeof(primes)/sizeof(primes[0])); j++) {
+        int n;
+
+        mpz_set_str(p, primes[j], 0);
+        mpFp_init(a, p);
+        mpFp_init(b, p);
+        gmp_printf("Testing IS_SQUARE for field 0x%ZX\n", p);
+
+        // zero is a square
+        mpFp_set_ui(a, 0, p);
+        assert(mpFp_is_square(a) != 0);
+
+        // exhaustive for small fields, otherwise random elements and their
+        // squares, agreeing with the Legendre symbol and with mpFp_sqrt
+        n = (mpz_cmp_ui(p, 2000) < 0) ? mpz_get_ui(p) : 2000;
+        for (i = 0; i < n; i++) {
+            if (mpz_cmp_ui(p, 2000) < 0) {
+                mpFp_set_ui(a, i, p);
+            } else {
+                mpFp_urandom(a, p);
+            }
+            mpz_set_mpFp(aa, a);
+            leg = mpz_legendre(aa, p);
+            assert((mpFp_is_square(a) != 0) == (leg >= 0));
+            assert((mpFp_is_square(a) != 0) == (mpFp_sqrt(b, a) == 0));
+            mpFp_sqr(b, a);
+            assert(mpFp_is_square(b) != 0);
+        }
+
+        mpFp_clear(b);
+        mpFp_clear(a);
+    }
+
+    mpz_clear(aa);
+    mpz_clear(p);
+}
+END_TEST
+
 START_TEST(test_mpFp_tstbit) {
     int i, j, k, bit;
     int primes[] = {11, 13, 17, 19, 23, 29, 31};
@@ -1751,6 +2093,374 @@ START_TEST(test_mpFp_point_check) {
 }
 END_TEST
 
+START_TEST(test_mpFpi_differential) {
+    int i, j, bit;
+    int nfields;
+    // static as w/large values of ARRAY_SZ the stack exceeds ulimit allowance
+    static mpFp_t a[ARRAY_SZ];
+    static mpFp_t b[ARRAY_SZ];
+    static mpFpi_t ai[ARRAY_SZ];
+    static mpFpi_t bi[ARRAY_SZ];
+    mpFp_t c, d;
+    mpFpi_t ci, di;
+    mpz_t e, p;
+    unsigned long ui;
+    int64_t start_time, stop_time;
+    double fp_rate, fpi_rate;
+
+    mpz_init(e);
+    mpz_init(p);
+
+    nfields = sizeof(test_prime_fields)/sizeof(test_prime_fields[0]);
+
+    for (j = 0 ; j < nfields; j++) {
+        mpFp_field_ptr fp;
+        mpz_set_str(p,test_prime_fields[j], 0);
+        fp = _mpFp_field_lookup(p);
+
+        gmp_printf("Testing inline limb (mpFpi) for field 0x%ZX\n", p);
+
+        for (i = 0; i < ARRAY_SZ; i++) {
+            mpFp_init(a[i], p);
+            mpFp_init(b[i], p);
+            mpFp_urandom(a[i], p);
+            mpFp_urandom(b[i], p);
+            mpFpi_set_mpFp(ai[i], a[i]);
+            mpz_set_mpFp(e, b[i]);
+            mpFpi_set_mpz_fp(bi[i], e, fp);
+        }
+        mpFp_init(c, p);
+        mpFp_init(d, p);
+        mpFpi_init_fp(ci, fp);
+        mpFpi_init_fp(di, fp);
+
+        for (i = 0; i < ARRAY_SZ; i++) {
+            mpFp_set_mpFpi(c, ai[i]);
+            assert(mpFp_cmp(c, a[i]) == 0);
+            mpz_set_mpFpi(e, bi[i]);
+            assert(mpFp_cmp_mpz(b[i], e) == 0);
+            assert((mpFpi_cmp(ai[i], bi[i]) == 0) == (mpFp_cmp(a[i], b[i]) == 0));
+
+            mpFp_add(c, a[i], b[i]);
+            mpFpi_add(ci, ai[i], bi[i]);
+            mpFpi_set_mpFp(di, c);
+            assert(mpFpi_cmp(ci, di) == 0);
+
+            mpFp_sub(c, a[i], b[i]);
+            mpFpi_sub(ci, ai[i], bi[i]);
+            mpFpi_set_mpFp(di, c);
+            assert(mpFpi_cmp(ci, di) == 0);
+
+            mpFp_neg(c, a[i]);
+            mpFpi_neg(ci, ai[i]);
+            mpFpi_set_mpFp(di, c);
+            assert(mpFpi_cmp(ci, di) == 0);
+
+            mpFp_mul(c, a[i], b[i]);
+            mpFpi_mul(ci, ai[i], bi[i]);
+            mpFpi_set_mpFp(di, c);
+            assert(mpFpi_cmp(ci, di) == 0);
+
+            ui = (unsigned long)ui_urandom(0);
+            mpFp_mul_ui(c, a[i], ui);
+            mpFpi_mul_ui(ci, ai[i], ui);
+            mpFpi_set_mpFp(di, c);
+            assert(mpFpi_cmp(ci, di) == 0);
+
+            mpFp_sqr(c, a[i]);
+            mpFpi_sqr(ci, ai[i]);
+            mpFpi_set_mpFp(di, c);
+            assert(mpFpi_cmp(ci, di) == 0);
+
+            // in place (aliased) operation
+            mpFpi_set(ci, ai[i]);
+            mpFpi_mul(ci, ci, ci);
+            mpFpi_sqr(di, ai[i]);
+            assert(mpFpi_cmp(ci, di) == 0);
+
+            bit = (int)(ui_urandom(0) % (mpz_sizeinbase(p, 2) + 1));
+            assert(mpFpi_tstbit(ai[i], bit) == mpFp_tstbit(a[i], bit));
+
+            if (mpFp_inv(c, a[i]) == 0) {
+                assert(mpFpi_inv(ci, ai[i]) == 0);
+                mpFpi_set_mpFp(di, c);
+                assert(mpFpi_cmp(ci, di) == 0);
+                mpFpi_mul(di, ci, ai[i]);
+                assert(mpFpi_cmp_ui(di, 1) == 0);
+            } else {
+                assert(mpFpi_inv(ci, ai[i]) != 0);
+            }
+
+            if ((i & 0xFF) == 0) {
+                mpz_set_mpFp(e, b[i]);
+                mpFp_pow_mpz(c, a[i], e);
+                mpFpi_pow_mpz(ci, ai[i], e);
+                mpFpi_set_mpFp(di, c);
+                assert(mpFpi_cmp(ci, di) == 0);
+            }
+
+            mpFpi_set(ci, ai[i]);
+            mpFpi_set(di, bi[i]);
+            mpFpi_cswap(ci, di, 0);
+            assert(mpFpi_cmp(ci, ai[i]) == 0);
+            assert(mpFpi_cmp(di, bi[i]) == 0);
+            mpFpi_cswap(ci, di, 1);
+            assert(mpFpi_cmp(ci, bi[i]) == 0);
+            assert(mpFpi_cmp(di, ai[i]) == 0);
+        }
+
+        // zero and small values, negative mpz
+        mpFpi_set_ui_fp(ci, 0, fp);
+        mpFpi_neg(di, ci);
+        assert(mpFpi_cmp_ui(di, 0) == 0);
+        assert(mpFpi_inv(di, ci) != 0);
+        mpz_set_si(e, -1);
+        mpFpi_set_mpz_fp(ci, e, fp);
+        mpFpi_set_ui_fp(di, 1, fp);
+        mpFpi_add(di, di, ci);
+        assert(mpFpi_cmp_ui(di, 0) == 0);
+
+        start_time = clock();
+        for (i = 0; i < ARRAY_SZ; i++) {
+            mpFp_mul(c, a[i], b[i]);
+        }
+        stop_time = clock();
+        fp_rate = ((double)ARRAY_SZ * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+        start_time = clock();
+        for (i = 0; i < ARRAY_SZ; i++) {
+            mpFpi_mul(ci, ai[i], bi[i]);
+        }
+        stop_time = clock();
+        fpi_rate = ((double)ARRAY_SZ * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+        printf("mpFpi MUL rate = %g muls/sec (%g X)\n", fpi_rate, (fpi_rate / fp_rate));
+        printf("mpFp  MUL rate = %g muls/sec\n", fp_rate);
+
+        mpFpi_clear(di);
+        mpFpi_clear(ci);
+        mpFp_clear(d);
+        mpFp_clear(c);
+        for (i = ARRAY_SZ-1; i >= 0; i--) {
+            mpFpi_clear(bi[i]);
+            mpFpi_clear(ai[i]);
+            mpFp_clear(b[i]);
+            mpFp_clear(a[i]);
+        }
+    }
+
+    mpz_clear(p);
+    mpz_clear(e);
+}
+END_TEST
+
+START_TEST(test_mpFp_mul_lanes) {
+    int i, j, k, w, nw;
+    int nfields;
+    int widths[] = {1, 4, 8};
+    // lane count deliberately not a multiple of the vector width
+    const size_t n = 1003;
+    mp_limb_t *al, *bl, *rl;
+    mpFp_t a, b, c, d;
+    mpz_t p;
+    int64_t start_time, stop_time;
+    double lane_rate, fp_rate;
+
+    mpz_init(p);
+    nfields = sizeof(test_prime_fields)/sizeof(test_prime_fields[0]);
+    nw = sizeof(widths)/sizeof(widths[0]);
+
+    for (j = 0 ; j < nfields; j++) {
+        mpFp_field_ptr fp;
+        mpz_set_str(p,test_prime_fields[j], 0);
+        fp = _mpFp_field_lookup(p);
+
+        al = (mp_limb_t *)malloc(n * fp->psize * sizeof(mp_limb_t));
+        bl = (mp_limb_t *)malloc(n * fp->psize * sizeof(mp_limb_t));
+        rl = (mp_limb_t *)malloc(n * fp->psize * sizeof(mp_limb_t));
+        mpFp_init(a, p);
+        mpFp_init(b, p);
+        mpFp_init(c, p);
+        mpFp_init(d, p);
+
+        for (i = 0; i < n; i++) {
+            mpFp_urandom(a, p);
+            mpFp_urandom(b, p);
+            // extreme values in the first lanes
+            if (i < 2) mpFp_set_ui(a, 0, p);
+            if ((i >= 2) && (i < 4)) {
+                mpFp_set_ui(a, 1, p);
+                mpFp_sub_ui(a, a, 2);
+                mpFp_set(b, a);
+            }
+            for (k = 0; k < fp->psize; k++) {
+                al[(k * n) + i] = a->i->_mp_d[k];
+                bl[(k * n) + i] = b->i->_mp_d[k];
+            }
+        }
+
+        for (w = 0; w < nw; w++) {
+            int sel;
+            sel = mpFp_lanes_select(widths[w]);
+            assert(sel <= widths[w]);
+            gmp_printf("Testing %d lane MUL for field 0x%ZX\n", sel, p);
+
+            mpFp_mul_lanes(rl, al, bl, n, fp);
+            for (i = 0; i < n; i++) {
+                for (k = 0; k < fp->psize; k++) {
+                    a->i->_mp_d[k] = al[(k * n) + i];
+                    b->i->_mp_d[k] = bl[(k * n) + i];
+                    d->i->_mp_d[k] = rl[(k * n) + i];
+                }
+                mpFp_mul(c, a, b);
+                assert(mpFp_cmp(c, d) == 0);
+            }
+
+            // aliased output, squaring
+            memcpy(rl, al, n * fp->psize * sizeof(mp_limb_t));
+            mpFp_sqr_lanes(rl, rl, n, fp);
+            for (i = 0; i < n; i++) {
+                for (k = 0; k < fp->psize; k++) {
+                    a->i->_mp_d[k] = al[(k * n) + i];
+                    d->i->_mp_d[k] = rl[(k * n) + i];
+                }
+                mpFp_sqr(c, a);
+                assert(mpFp_cmp(c, d) == 0);
+            }
+
+            start_time = clock();
+            for (i = 0; i < 100; i++) {
+                mpFp_mul_lanes(rl, al, bl, n, fp);
+            }
+            stop_time = clock();
+            lane_rate = ((double)n * 100 * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+            start_time = clock();
+            for (i = 0; i < (100 * n); i++) {
+                mpFp_mul(c, a, b);
+            }
+            stop_time = clock();
+            fp_rate = ((double)n * 100 * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+            printf("%d lane MUL rate = %g muls/sec (%g X)\n", sel, lane_rate, (lane_rate / fp_rate));
+        }
+        mpFp_lanes_select(0);
+
+        mpFp_clear(d);
+        mpFp_clear(c);
+        mpFp_clear(b);
+        mpFp_clear(a);
+        free(rl);
+        free(bl);
+        free(al);
+    }
+
+    mpz_clear(p);
+}
+END_TEST
+
+#ifdef _MPFP_KERNEL4
+START_TEST(test_mpFp_mul_kernel4) {
+    int i, j, k, sel;
+    int nfields;
+    char *fields4[] = {
+        "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F",
+        "0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF",
+        "0x7fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffed",
+        "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141"};
+    mpFp_t a, b, c;
+    mpz_t aa, bb, d, p;
+    int64_t start_time, stop_time;
+    double k_rate, mpz_rate;
+
+    mpz_init(aa);
+    mpz_init(bb);
+    mpz_init(d);
+    mpz_init(p);
+
+    nfields = sizeof(fields4)/sizeof(fields4[0]);
+    // plus random primes of 193..256 bits (all 4 limb sizes)
+    for (j = 0 ; j < (nfields + 64); j++) {
+        if (j < nfields) {
+            mpz_set_str(p, fields4[j], 0);
+        } else {
+            mpz_set_ui(p, 0);
+            mpz_setbit(p, 192 + (j - nfields));
+            mpz_urandom(aa, p);
+            mpz_add(p, p, aa);
+            mpz_nextprime(p, p);
+        }
+        assert(mpz_size(p) == 4);
+
+        mpFp_init(a, p);
+        mpFp_init(b, p);
+        mpFp_init(c, p);
+
+        for (sel = 0; sel < 2; sel++) {
+            k = _mpFp_kernel4_select(sel);
+            assert(k >= 0);
+            if (j < nfields) {
+                gmp_printf("Testing 4 limb kernel (%s) for field 0x%ZX\n", (k != 0) ? "mulx/adx" : "portable", p);
+            }
+            for (i = 0; i < ARRAY_SZ; i++) {
+                mpFp_urandom(a, p);
+                mpFp_urandom(b, p);
+                // extreme values
+                if (i < 3) {
+                    mpFp_set_ui(a, i, p);
+                    mpFp_neg(b, a);
+                } else if (i < 6) {
+                    mpFp_set_ui(a, 0, p);
+                    mpFp_sub_ui(a, a, i - 2);
+                    mpFp_set(b, a);
+                }
+                mpz_set_mpFp(aa, a);
+                mpz_set_mpFp(bb, b);
+
+                // reference is the general mpz_mod path
+                mpz_mul(d, aa, bb);
+                mpz_mod(d, d, p);
+                mpFp_mul(c, a, b);
+                assert(mpFp_cmp_mpz(c, d) == 0);
+
+                mpz_mul(d, aa, aa);
+                mpz_mod(d, d, p);
+                mpFp_sqr(c, a);
+                assert(mpFp_cmp_mpz(c, d) == 0);
+
+                // aliased
+                mpFp_mul(a, a, a);
+                assert(mpFp_cmp_mpz(a, d) == 0);
+            }
+
+            if (j < nfields) {
+                start_time = clock();
+                for (i = 0; i < ARRAY_SZ; i++) {
+                    mpFp_mul(c, a, b);
+                }
+                stop_time = clock();
+                k_rate = ((double)ARRAY_SZ * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+                start_time = clock();
+                for (i = 0; i < ARRAY_SZ; i++) {
+                    mpz_mul(d, aa, bb);
+                    mpz_mod(d, d, p);
+                }
+                stop_time = clock();
+                mpz_rate = ((double)ARRAY_SZ * CLOCKS_PER_SEC)/((double)(stop_time - start_time));
+                printf("4 limb MUL rate = %g muls/sec (%g X mpz)\n", k_rate, (k_rate / mpz_rate));
+            }
+        }
+        _mpFp_kernel4_select(1);
+
+        mpFp_clear(c);
+        mpFp_clear(b);
+        mpFp_clear(a);
+    }
+
+    mpz_clear(p);
+    mpz_clear(d);
+    mpz_clear(bb);
+    mpz_clear(aa);
+}
+END_TEST
+#endif
+
 static Suite *mpFp_test_suite(void) {
     Suite *s;
     TCase *tc;
@@ -1769,14 +2479,23 @@ static Suite *mpFp_test_suite(void) {
     tcase_add_test(tc, test_mpFp_mul_extended);
     tcase_add_test(tc, test_mpFp_pow_basic);
     tcase_add_test(tc, test_mpFp_pow_extended);
+    tcase_add_test(tc, test_mpFp_pow_small);
     tcase_add_test(tc, test_mpFp_sqr_extended);
     tcase_add_test(tc, test_mpFp_inv_basic);
     tcase_add_test(tc, test_mpFp_inv_extended);
+    tcase_add_test(tc, test_mpFp_inv_ct);
     tcase_add_test(tc, test_mpFp_sqrt_basic);
     tcase_add_test(tc, test_mpFp_sqrt_extended);
+    tcase_add_test(tc, test_mpFp_sqrt_strategy);
+    tcase_add_test(tc, test_mpFp_is_square);
     tcase_add_test(tc, test_mpFp_tstbit);
     tcase_add_test(tc, test_mpFp_urandom);
     tcase_add_test(tc, test_mpFp_point_check);
+    tcase_add_test(tc, test_mpFpi_differential);
+    tcase_add_test(tc, test_mpFp_mul_lanes);
+#ifdef _MPFP_KERNEL4
+    tcase_add_test(tc, test_mpFp_mul_kernel4);
+#endif
 
      // set no timeout instead of default 4
     tcase_set_timeout(tc, 0.0);
@@ -33,8 +33,13 @@
 #include <ecc/safememory.h>
 #include <gmp.h>
 #include <check.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 START_TEST(test_mpzurandom) {
     int i;
@@ -58,14 +63,139 @@ START_TEST(test_mpzurandom) {
 }
 END_TEST
 
+START_TEST(test_mpzurandom_range) {
+    int i, j;
+    mpz_t a, b, max;
+    mpz_init(a);
+    mpz_init(b);
+    mpz_init(max);
+
+    // rand_max == 1 can only return 0
+    mpz_set_ui(max, 1);
+    for (i = 0; i < 100; i++) {
+        mpz_urandom(b, max);
+        assert(mpz_cmp_ui(b, 0) == 0);
+    }
+
+    // powers of two (worst case for rejection) and their neighbors
+    for (j = 1; j < 600; j++) {
+        mpz_set_ui(max, 0);
+        mpz_setbit(max, j);
+        mpz_add_ui(max, max, (j % 3));
+        mpz_sub_ui(max, max, (j % 3 == 2) ? 3 : 0);
+        mpz_set_ui(a, 0);
+        for (i = 0; i < 64; i++) {
+            mpz_urandom(b, max);
+            assert(mpz_sgn(b) >= 0);
+            assert(mpz_cmp(b, max) < 0);
+            mpz_ior(a, a, b);
+        }
+        // with 64 draws every bit should have been set at least once
+        if (j > 8) {
+            assert(mpz_sizeinbase(a, 2) == mpz_sizeinbase(max, 2) ||
+                mpz_sizeinbase(a, 2) == (mpz_sizeinbase(max, 2) - 1));
+        }
+    }
+
+    // small range, all values should be observed
+    mpz_set_ui(max, 7);
+    j = 0;
+    for (i = 0; i < 1000; i++) {
+        mpz_urandom(b, max);
+        j |= 1 << mpz_get_ui(b);
+    }
+    assert(j == 0x7F);
+
+    mpz_clear(max);
+    mpz_clear(b);
+    mpz_clear(a);
+}
+END_TEST
+
+static void *_draw_thread(void *arg) {
+    mpz_t max;
+    mpz_ptr r;
+    r = (mpz_ptr)arg;
+    mpz_init(max);
+    mpz_set_ui(max, 0);
+    mpz_setbit(max, 256);
+    mpz_urandom(r, max);
+    mpz_clear(max);
+    return NULL;
+}
+
+START_TEST(test_mpzurandom_thread_fork) {
+    int i, status, fd[2];
+    pid_t pid;
+    pthread_t th[4];
+    mpz_t r[4], max, a, b;
+    unsigned char buf[32];
+    mpz_init(max);
+    mpz_init(a);
+    mpz_init(b);
+    mpz_set_ui(max, 0);
+    mpz_setbit(max, 256);
+
+    // independent per-thread generators
+    for (i = 0; i < 4; i++) {
+        mpz_init(r[i]);
+        status = pthread_create(&(th[i]), NULL, _draw_thread, (void *)r[i]);
+        assert(status == 0);
+    }
+    for (i = 0; i < 4; i++) {
+        pthread_join(th[i], NULL);
+    }
+    for (i = 1; i < 4; i++) {
+        assert(mpz_cmp(r[0], r[i]) != 0);
+    }
+
+    // parent and child must not share output after fork
+    mpz_urandom(a, max);
+    status = pipe(fd);
+    assert(status == 0);
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        size_t cnt;
+        memset(buf, 0, sizeof(buf));
+        mpz_urandom(a, max);
+        mpz_export(buf, &cnt, 1, 1, 1, 0, a);
+        status = write(fd[1], buf, sizeof(buf));
+        _exit(status == sizeof(buf) ? 0 : 1);
+    }
+    mpz_urandom(b, max);
+    status = read(fd[0], buf, sizeof(buf));
+    assert(status == sizeof(buf));
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+    mpz_import(a, sizeof(buf), 1, 1, 1, 0, buf);
+    assert(mpz_cmp(a, b) != 0);
+    close(fd[0]);
+    close(fd[1]);
+
+    mpz_urandom_reseed();
+    mpz_urandom(a, max);
+    assert(mpz_cmp(a, max) < 0);
+
+    for (i = 0; i < 4; i++) {
+        mpz_clear(r[i]);
+    }
+    mpz_clear(b);
+    mpz_clear(a);
+    mpz_clear(max);
+}
+END_TEST
+
 static Suite *mpzR_test_suite(void) {
     Suite *s;
     TCase *tc;
     
-    s = suite_create("Cryptographically secure random (/dev/urandom) for mpz");
+    s = suite_create("Cryptographically secure random (ChaCha20 DRBG) for mpz");
     tc = tcase_create("arithmetic");
 
     tcase_add_test(tc, test_mpzurandom);
+    tcase_add_test(tc, test_mpzurandom_range);
+    tcase_add_test(tc, test_mpzurandom_thread_fork);
     suite_add_tcase(s, tc);
     return s;
 }